@@ -0,0 +1,80 @@
+// Bench.cpp : This file contains the 'main' function. Program execution begins and ends there.
+// Checks and benchmarks for the parts of Common that run without a window or a device
+// Runs every suite, or only the ones named on the command line, and exits with the number of failed checks
+//
+
+#include "pch.h"
+#include "Bench.h"
+#include <cstring>
+
+namespace {
+
+struct Suite {
+    char const *Name;
+    void (*Run)();
+};
+
+Suite const SUITES[] = {
+    { "image", Bench::RunImageBatchLoader },
+    { "import", Bench::RunModelImporter },
+    { "obj", Bench::RunModelObjParallelParser },
+    { "scan", Bench::RunModelScanLoader },
+    { "texture", Bench::RunTextureCompressor },
+    { "tlsf", Bench::RunTlsfAllocator },
+    { "weld", Bench::RunVertexWeldTable },
+};
+
+uint32_t g_failedCheckCount = 0;
+
+bool IsSelected(Suite const &suite, int argc, char **argv) {
+    if (argc < 2) {
+        return true;
+    }
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], suite.Name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+namespace Bench {
+
+bool Check(bool condition, char const *expression, char const *file, int line) {
+    if (!condition) {
+        LOG_ERROR("%s(%d): Check failed: %s\n", file, line, expression);
+        ++g_failedCheckCount;
+    }
+    return condition;
+}
+
+f64 SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace Bench
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; ++i) {
+        bool known = false;
+        for (auto const &suite : SUITES) {
+            known = known || strcmp(argv[i], suite.Name) == 0;
+        }
+        if (!known) {
+            LOG_ERROR("Unknown suite %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    for (auto const &suite : SUITES) {
+        if (IsSelected(suite, argc, argv)) {
+            LOG_INFO("[%s]\n", suite.Name);
+            suite.Run();
+        }
+    }
+
+    LOG_INFO("%u checks failed\n", g_failedCheckCount);
+    return static_cast<int>(g_failedCheckCount);
+}
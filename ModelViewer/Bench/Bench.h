@@ -0,0 +1,20 @@
+#pragma once
+
+namespace Bench {
+
+// Logs the failed expression, the run exits with the number of failed checks
+#define BENCH_CHECK(x) Bench::Check((x), #x, __FILE__, __LINE__)
+bool Check(bool condition, char const *expression, char const *file, int line);
+
+f64 SecondsSince(std::chrono::steady_clock::time_point start);
+
+// Suites, run by name from the command line
+void RunImageBatchLoader();
+void RunModelImporter();
+void RunModelObjParallelParser();
+void RunModelScanLoader();
+void RunTextureCompressor();
+void RunTlsfAllocator();
+void RunVertexWeldTable();
+
+} // namespace Bench
@@ -0,0 +1,128 @@
+#include "pch.h"
+#include "Bench.h"
+#include "ImageBatchLoader.h"
+#include "ImageLoader.h"
+#include "ThreadPool.h"
+#include "Hash.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <random>
+
+#pragma warning( push, 0 )
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb/stb_image_write.h"
+#pragma warning( pop )
+
+namespace Bench {
+
+namespace {
+
+struct EncodedImage {
+    std::vector<uint8_t> Png;
+    uint64_t PixelsHash;
+    size_t PixelsSize;
+};
+
+void AppendPng(void *context, void *data, int size) {
+    std::vector<uint8_t> *png = reinterpret_cast<std::vector<uint8_t>*>(context);
+    png->insert(png->end(), reinterpret_cast<uint8_t*>(data), reinterpret_cast<uint8_t*>(data) + size);
+}
+
+// Material textures of a few sizes, noisy enough that the PNGs do not shrink to nothing
+std::vector<EncodedImage> GenerateImages(uint32_t imageCount) {
+    const uint32_t SIZES[][2] = { { 1024, 1024 }, { 2048, 1024 }, { 512, 512 }, { 2048, 2048 } };
+
+    std::mt19937 random(121314);
+    std::uniform_int_distribution<int32_t> noiseDistribution(-3, 3);
+    std::vector<EncodedImage> images(imageCount);
+    for (uint32_t i = 0; i < imageCount; ++i) {
+        uint32_t width = SIZES[i % countof(SIZES)][0];
+        uint32_t height = SIZES[i % countof(SIZES)][1];
+        std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+        for (uint32_t y = 0; y < height; ++y) {
+            for (uint32_t x = 0; x < width; ++x) {
+                f32 shade = 0.5f + 0.5f * std::sin(x * 0.01f * (i + 1) + y * 0.007f);
+                uint8_t *pixel = &pixels[(static_cast<size_t>(y) * width + x) * 4];
+                for (uint32_t c = 0; c < 4; ++c) {
+                    int32_t value = static_cast<int32_t>(shade * (c == 3 ? 255.0f : 60.0f * (c + 1))) + noiseDistribution(random);
+                    pixel[c] = static_cast<uint8_t>(std::clamp(value, 0, 255));
+                }
+            }
+        }
+
+        stbi_write_png_to_func(AppendPng, &images[i].Png, width, height, 4, pixels.data(), width * 4);
+        images[i].PixelsHash = Graphics::HashBytes64(pixels.data(), pixels.size());
+        images[i].PixelsSize = pixels.size();
+    }
+    return images;
+}
+
+} // namespace
+
+// Images per second through ImageBatchLoader at growing thread counts, with a generous and a tight memory budget
+// Estimated peak is what the loader held from its budget, decoded peak is the pixels actually alive at once
+void RunImageBatchLoader() {
+    const uint32_t IMAGE_COUNT = 24;
+    const size_t BUDGETS[] = { 256 * 1024 * 1024, 48 * 1024 * 1024 };
+
+    std::vector<EncodedImage> images = GenerateImages(IMAGE_COUNT);
+    std::vector<size_t> memoryEstimates;
+    size_t pngSize = 0;
+    size_t pixelsSize = 0;
+    for (auto const &image : images) {
+        memoryEstimates.push_back(Graphics::ImageBatchLoader::EstimateDecodeMemory(image.Png.data(), image.Png.size(), 4));
+        BENCH_CHECK(memoryEstimates.back() >= image.PixelsSize);
+        pngSize += image.Png.size();
+        pixelsSize += image.PixelsSize;
+    }
+    LOG_INFO("  %u PNG images, %.1f MB encoded, %.1f MB decoded\n", IMAGE_COUNT, pngSize / (1024.0 * 1024.0), pixelsSize / (1024.0 * 1024.0));
+
+    uint32_t hardwareThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    for (size_t budget : BUDGETS) {
+        for (uint32_t threadCount = 1; ; threadCount = std::min(threadCount * 2, hardwareThreadCount)) {
+            Graphics::ThreadPool threadPool;
+            if (threadCount > 1) {
+                threadPool.Initialize(threadCount - 1);
+            }
+            Graphics::ImageBatchLoader batchLoader;
+            batchLoader.SetThreadPool(&threadPool);
+            batchLoader.SetMemoryBudget(budget);
+
+            std::atomic<size_t> decodedSize(0);
+            std::atomic<size_t> peakDecodedSize(0);
+            std::atomic<uint32_t> failedCount(0);
+            auto start = std::chrono::steady_clock::now();
+            batchLoader.Run(memoryEstimates, [&](uint32_t index) {
+                Graphics::ImageLoader loader;
+                if (!loader.LoadImageFromMemory(images[index].Png.data(), images[index].Png.size(), 4)) {
+                    ++failedCount;
+                    return;
+                }
+                size_t size = static_cast<size_t>(loader.GetWidth()) * loader.GetHeight() * 4;
+                size_t inFlight = decodedSize += size;
+                size_t peak = peakDecodedSize;
+                while (inFlight > peak && !peakDecodedSize.compare_exchange_weak(peak, inFlight)) {
+                }
+                if (Graphics::HashBytes64(loader.GetData(), size) != images[index].PixelsHash) {
+                    ++failedCount;
+                }
+                decodedSize -= size;
+            });
+            f64 seconds = SecondsSince(start);
+            threadPool.Finalize();
+
+            LOG_INFO("  %3zu MB budget, %2u threads: %.1f images/s, %.1f MB/s decoded, peak %.1f MB estimated, %.1f MB decoded\n",
+                budget / (1024 * 1024), threadCount, IMAGE_COUNT / seconds, pixelsSize / (1024.0 * 1024.0) / seconds,
+                batchLoader.GetPeakMemory() / (1024.0 * 1024.0), peakDecodedSize.load() / (1024.0 * 1024.0));
+            BENCH_CHECK(failedCount == 0);
+            BENCH_CHECK(batchLoader.GetPeakMemory() <= std::max(budget, *std::max_element(memoryEstimates.begin(), memoryEstimates.end())));
+
+            if (threadCount == hardwareThreadCount) {
+                break;
+            }
+        }
+    }
+}
+
+} // namespace Bench
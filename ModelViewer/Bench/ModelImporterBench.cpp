@@ -0,0 +1,545 @@
+#include "pch.h"
+#include "Bench.h"
+#include "ModelImporter.h"
+#include "Camera.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "VertexQuantization.h"
+#include "TextureContainerLoader.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <filesystem>
+#include <random>
+
+#pragma warning( push, 0 )
+#include "stb/stb_image_write.h"
+#pragma warning( pop )
+
+namespace Bench {
+
+namespace {
+
+using Graphics::ModelImporter;
+using Graphics::TexturedVertex;
+
+struct ImportMesh {
+    std::vector<TexturedVertex> Vertices;
+    std::vector<uint32_t> Indices;
+    std::vector<Graphics::ModelObjLoader::SubMesh> SubMeshes;
+};
+
+// Height field of gridSize x gridSize vertices in two materials, with triangles shuffled within each material as a poor
+//   exporter leaves them and a few vertices no triangle uses
+ImportMesh GenerateMesh(uint32_t gridSize) {
+    ImportMesh mesh;
+    for (uint32_t y = 0; y < gridSize; ++y) {
+        for (uint32_t x = 0; x < gridSize; ++x) {
+            f32 u = static_cast<f32>(x) / (gridSize - 1);
+            f32 v = static_cast<f32>(y) / (gridSize - 1);
+            TexturedVertex vertex{};
+            vertex.position = glm::vec3(static_cast<f32>(x), std::sin(u * 12.0f) * std::cos(v * 9.0f) * 4.0f, static_cast<f32>(y));
+            vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+            vertex.color = glm::vec3(1.0f);
+            vertex.texCoord = glm::vec2(u, v);
+            mesh.Vertices.push_back(vertex);
+        }
+    }
+    for (uint32_t i = 0; i < gridSize; ++i) {
+        TexturedVertex unused{};
+        unused.position = glm::vec3(-1.0f, 0.0f, static_cast<f32>(i));
+        mesh.Vertices.push_back(unused);
+    }
+
+    std::mt19937 random(161718);
+    uint32_t splitRow = gridSize / 2;
+    for (uint32_t material = 0; material < 2; ++material) {
+        std::vector<std::array<uint32_t, 3>> triangles;
+        for (uint32_t y = material == 0 ? 0 : splitRow; y < (material == 0 ? splitRow : gridSize - 1); ++y) {
+            for (uint32_t x = 0; x + 1 < gridSize; ++x) {
+                uint32_t i = y * gridSize + x;
+                triangles.push_back({ i, i + gridSize, i + 1 });
+                triangles.push_back({ i + 1, i + gridSize, i + gridSize + 1 });
+            }
+        }
+        std::shuffle(triangles.begin(), triangles.end(), random);
+
+        mesh.SubMeshes.push_back({ static_cast<uint32_t>(mesh.Indices.size()), static_cast<uint32_t>(triangles.size() * 3), static_cast<int32_t>(material) });
+        for (auto const &triangle : triangles) {
+            mesh.Indices.insert(mesh.Indices.end(), triangle.begin(), triangle.end());
+        }
+    }
+    return mesh;
+}
+
+// Triangles of a submesh by the grid cells of their corners, rotated to start at the smallest so winding is kept
+std::vector<std::array<uint32_t, 3>> GetGridTriangles(ImportMesh const &mesh, Graphics::ModelObjLoader::SubMesh const &subMesh, uint32_t gridSize) {
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for (uint32_t i = subMesh.IndexOffset; i < subMesh.IndexOffset + subMesh.IndexCount; i += 3) {
+        std::array<uint32_t, 3> triangle;
+        for (uint32_t corner = 0; corner < 3; ++corner) {
+            glm::vec3 const &position = mesh.Vertices[mesh.Indices[i + corner]].position;
+            triangle[corner] = static_cast<uint32_t>(position.z) * gridSize + static_cast<uint32_t>(position.x);
+        }
+        std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+        triangles.push_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+ImportMesh CheckOptimizeMesh(ImportMesh const &mesh, uint32_t gridSize) {
+    ImportMesh optimized;
+    optimized.SubMeshes = mesh.SubMeshes;
+    auto start = std::chrono::steady_clock::now();
+    ModelImporter::OptimizeMesh(mesh.Vertices.data(), mesh.Vertices.size(), mesh.Indices.data(), static_cast<uint32_t>(mesh.Indices.size()),
+        mesh.SubMeshes.data(), static_cast<uint32_t>(mesh.SubMeshes.size()), &optimized.Vertices, &optimized.Indices);
+    f64 seconds = SecondsSince(start);
+
+    auto before = Graphics::AnalyzeVertexCache(mesh.Indices.data(), mesh.Indices.size(), mesh.Vertices.size());
+    auto after = Graphics::AnalyzeVertexCache(optimized.Indices.data(), optimized.Indices.size(), optimized.Vertices.size());
+    LOG_INFO("  OptimizeMesh: %u triangles in %.3f s, ACMR %.3f -> %.3f\n", after.TriangleCount, seconds, before.ACMR, after.ACMR);
+    BENCH_CHECK(after.ACMR < before.ACMR * 0.5f);
+
+    // Unused vertices are dropped, the others are numbered in the order they are first used
+    BENCH_CHECK(optimized.Vertices.size() == static_cast<size_t>(gridSize) * gridSize);
+    uint32_t nextVertex = 0;
+    bool firstUseOrder = true;
+    for (uint32_t index : optimized.Indices) {
+        firstUseOrder = firstUseOrder && index <= nextVertex;
+        nextVertex = std::max(nextVertex, index + 1);
+    }
+    BENCH_CHECK(firstUseOrder);
+
+    for (auto const &subMesh : mesh.SubMeshes) {
+        BENCH_CHECK(GetGridTriangles(optimized, subMesh, gridSize) == GetGridTriangles(mesh, subMesh, gridSize));
+    }
+    return optimized;
+}
+
+void CheckBuildMeshlets(ImportMesh const &mesh) {
+    std::vector<Graphics::Meshlet> meshlets;
+    auto start = std::chrono::steady_clock::now();
+    ModelImporter::BuildMeshlets(mesh.Vertices.data(), mesh.Vertices.size(), mesh.Indices.data(),
+        mesh.SubMeshes.data(), static_cast<uint32_t>(mesh.SubMeshes.size()), &meshlets);
+    f64 seconds = SecondsSince(start);
+
+    uint32_t coneCount = 0;
+    uint32_t vertexCount = 0;
+    for (auto const &meshlet : meshlets) {
+        coneCount += meshlet.ConeCutoff < 1.0f ? 1 : 0;
+        vertexCount += meshlet.VertexCount;
+    }
+    LOG_INFO("  BuildMeshlets: %zu meshlets in %.3f s, %.1f triangles and %.1f vertices each, %u with backface cones\n",
+        meshlets.size(), seconds, mesh.Indices.size() / 3.0 / meshlets.size(), static_cast<f64>(vertexCount) / meshlets.size(), coneCount);
+
+    // Meshlets follow each other through the index buffer and stay within their submesh and the limits
+    uint32_t nextIndex = 0;
+    bool covered = true;
+    bool withinLimits = true;
+    bool withinSubMesh = true;
+    bool boundsContain = true;
+    for (auto const &meshlet : meshlets) {
+        covered = covered && meshlet.FirstIndex == nextIndex && meshlet.TriangleCount > 0;
+        nextIndex = meshlet.FirstIndex + meshlet.TriangleCount * 3;
+        withinLimits = withinLimits && meshlet.TriangleCount <= Graphics::MeshletBuilder::MAX_TRIANGLES &&
+            meshlet.VertexCount <= Graphics::MeshletBuilder::MAX_VERTICES;
+
+        auto subMesh = std::find_if(mesh.SubMeshes.begin(), mesh.SubMeshes.end(), [&](Graphics::ModelObjLoader::SubMesh const &subMesh) {
+            return meshlet.FirstIndex >= subMesh.IndexOffset && meshlet.FirstIndex < subMesh.IndexOffset + subMesh.IndexCount;
+        });
+        withinSubMesh = withinSubMesh && subMesh != mesh.SubMeshes.end() && subMesh->MaterialId == meshlet.MaterialId &&
+            nextIndex <= subMesh->IndexOffset + subMesh->IndexCount;
+
+        for (uint32_t i = meshlet.FirstIndex; i < nextIndex; ++i) {
+            boundsContain = boundsContain && glm::distance(mesh.Vertices[mesh.Indices[i]].position, meshlet.Center) <= meshlet.Radius * 1.001f + 1e-4f;
+        }
+    }
+    BENCH_CHECK(covered && nextIndex == mesh.Indices.size());
+    BENCH_CHECK(withinLimits);
+    BENCH_CHECK(withinSubMesh);
+    BENCH_CHECK(boundsContain);
+}
+
+// Meshlet of a flat patch at z = 5, its triangles wound as front faces for a camera looking down +z or reversed
+std::vector<Graphics::Meshlet> BuildPatchMeshlets(bool reversed) {
+    const uint32_t PATCH_SIZE = 8;
+
+    ImportMesh patch;
+    for (uint32_t y = 0; y < PATCH_SIZE; ++y) {
+        for (uint32_t x = 0; x < PATCH_SIZE; ++x) {
+            TexturedVertex vertex{};
+            vertex.position = glm::vec3(x / (PATCH_SIZE - 1.0f) - 0.5f, y / (PATCH_SIZE - 1.0f) - 0.5f, 5.0f);
+            patch.Vertices.push_back(vertex);
+        }
+    }
+    for (uint32_t y = 0; y + 1 < PATCH_SIZE; ++y) {
+        for (uint32_t x = 0; x + 1 < PATCH_SIZE; ++x) {
+            uint32_t i = y * PATCH_SIZE + x;
+            std::array<uint32_t, 6> cell = { i, i + 1, i + PATCH_SIZE, i + 1, i + PATCH_SIZE + 1, i + PATCH_SIZE };
+            if (reversed) {
+                std::swap(cell[1], cell[2]);
+                std::swap(cell[4], cell[5]);
+            }
+            patch.Indices.insert(patch.Indices.end(), cell.begin(), cell.end());
+        }
+    }
+    patch.SubMeshes.push_back({ 0, static_cast<uint32_t>(patch.Indices.size()), 0 });
+
+    std::vector<Graphics::Meshlet> meshlets;
+    ModelImporter::BuildMeshlets(patch.Vertices.data(), patch.Vertices.size(), patch.Indices.data(),
+        patch.SubMeshes.data(), static_cast<uint32_t>(patch.SubMeshes.size()), &meshlets);
+    return meshlets;
+}
+
+bool IsPatchVisible(std::vector<Graphics::Meshlet> const &meshlets, Graphics::Camera const &camera) {
+    Graphics::Frustum frustum = Graphics::ExtractFrustum(camera.ProjectionMatrix() * camera.ViewMatrix());
+    return std::any_of(meshlets.begin(), meshlets.end(), [&](Graphics::Meshlet const &meshlet) {
+        return Graphics::IsMeshletVisible(meshlet, frustum, camera.GetPosition());
+    });
+}
+
+// Culls patches through the renderer's camera, which must keep the ones it draws as front faces
+void CheckMeshletCulling() {
+    std::vector<Graphics::Meshlet> front = BuildPatchMeshlets(false);
+    std::vector<Graphics::Meshlet> back = BuildPatchMeshlets(true);
+    BENCH_CHECK(!front.empty() && front[0].ConeCutoff < 1.0f);
+
+    Graphics::Camera camera;
+    camera.SetNearFarPlanes(0.1f, 100.0f);
+    BENCH_CHECK(IsPatchVisible(front, camera));
+    BENCH_CHECK(!IsPatchVisible(back, camera));
+
+    // From the other side the reversed patch faces the camera
+    camera.SetPosition(0.0f, 0.0f, 10.0f);
+    camera.SetForward(0.0f, 0.0f, -1.0f);
+    BENCH_CHECK(!IsPatchVisible(front, camera));
+    BENCH_CHECK(IsPatchVisible(back, camera));
+
+    // Facing the camera but behind it
+    camera.SetPosition(0.0f, 0.0f, 10.0f);
+    camera.SetForward(0.0f, 0.0f, 1.0f);
+    BENCH_CHECK(!IsPatchVisible(back, camera));
+}
+
+void CheckBuildLods(ImportMesh const &mesh) {
+    std::vector<uint32_t> indices = mesh.Indices;
+    std::vector<ModelImporter::Lod> lods(1);
+    lods[0].SubMeshes = mesh.SubMeshes;
+    lods[0].Error = 0.0f;
+    auto start = std::chrono::steady_clock::now();
+    ModelImporter::BuildLods(mesh.Vertices.data(), mesh.Vertices.size(), true, &indices, &lods);
+    f64 seconds = SecondsSince(start);
+    LOG_INFO("  BuildLods: %zu levels in %.3f s\n", lods.size(), seconds);
+
+    // A smooth height field simplifies well, every level must be clearly coarser and less accurate than the one before
+    BENCH_CHECK(lods.size() == ModelImporter::MAX_LOD_COUNT);
+    size_t previousIndexCount = mesh.Indices.size();
+    for (size_t level = 1; level < lods.size(); ++level) {
+        size_t indexCount = 0;
+        bool validIndices = true;
+        bool sameMaterials = true;
+        for (size_t i = 0; i < lods[level].SubMeshes.size(); ++i) {
+            Graphics::ModelObjLoader::SubMesh const &subMesh = lods[level].SubMeshes[i];
+            indexCount += subMesh.IndexCount;
+            validIndices = validIndices && subMesh.IndexCount % 3 == 0 && subMesh.IndexOffset >= mesh.Indices.size() &&
+                subMesh.IndexOffset + subMesh.IndexCount <= indices.size();
+            for (uint32_t j = subMesh.IndexOffset; validIndices && j < subMesh.IndexOffset + subMesh.IndexCount; ++j) {
+                validIndices = indices[j] < mesh.Vertices.size();
+            }
+            sameMaterials = sameMaterials && i < mesh.SubMeshes.size() && subMesh.MaterialId == mesh.SubMeshes[i].MaterialId;
+        }
+        BENCH_CHECK(validIndices);
+        BENCH_CHECK(sameMaterials && lods[level].SubMeshes.size() == mesh.SubMeshes.size());
+        BENCH_CHECK(indexCount <= previousIndexCount * 0.8);
+        BENCH_CHECK(lods[level].Error > lods[level - 1].Error && std::isfinite(lods[level].Error));
+        previousIndexCount = indexCount;
+    }
+
+    // Through the renderer's camera on a 1080 pixel high swap chain the full mesh is drawn up close and the coarsest far away
+    f32 lodErrors[ModelImporter::MAX_LOD_COUNT];
+    uint32_t lodCount = static_cast<uint32_t>(std::min(lods.size(), static_cast<size_t>(ModelImporter::MAX_LOD_COUNT)));
+    for (uint32_t i = 0; i < lodCount; ++i) {
+        lodErrors[i] = lods[i].Error;
+    }
+    Graphics::Camera camera;
+    camera.SetAspectRatio(1920.0f, 1080.0f);
+    f32 projectionScale = fabsf(camera.ProjectionMatrix()[1][1]);
+    BENCH_CHECK(Graphics::SelectLodLevel(lodErrors, lodCount, 1.0f, projectionScale, 1080.0f, 1.0f) == 0);
+    BENCH_CHECK(Graphics::SelectLodLevel(lodErrors, lodCount, 1e6f, projectionScale, 1080.0f, 1.0f) == lodCount - 1);
+}
+
+// Largest difference between the vertices and their compact encoding, relative to the bounds and texture coordinate range
+glm::vec3 GetCompactError(ImportMesh const &mesh, Graphics::ModelMeshCache::Bounds const &bounds, glm::vec4 const &texCoordRange,
+                          std::vector<uint8_t> const &vertexData, uint32_t vertexStride) {
+    glm::vec3 extent = bounds.Max - bounds.Min;
+    glm::vec3 maxError(0.0f);
+    for (size_t i = 0; i < mesh.Vertices.size(); ++i) {
+        TexturedVertex const &vertex = mesh.Vertices[i];
+        Graphics::TexturedVertexCompact compact;
+        memcpy(&compact, vertexData.data() + i * vertexStride, sizeof(compact));
+        for (int axis = 0; axis < 3; ++axis) {
+            f32 position = bounds.Min[axis] + compact.position[axis] / 65535.0f * extent[axis];
+            maxError.x = std::max(maxError.x, std::abs(position - vertex.position[axis]) / std::max(extent[axis], 1e-6f));
+        }
+        maxError.y = std::max(maxError.y, glm::distance(Graphics::DecodeOctahedralSnorm16(compact.normal), vertex.normal));
+        for (int axis = 0; axis < 2; ++axis) {
+            f32 texCoord = texCoordRange[axis] + compact.texCoord[axis] / 65535.0f * texCoordRange[2 + axis];
+            maxError.z = std::max(maxError.z, std::abs(texCoord - vertex.texCoord[axis]) / std::max(texCoordRange[2 + axis], 1e-6f));
+        }
+    }
+    return maxError;
+}
+
+void CheckEncodeVertices(ImportMesh const &mesh) {
+    auto bounds = Graphics::ModelMeshCache::ComputeBounds(mesh.Vertices.data(), mesh.Vertices.size(), sizeof(TexturedVertex), offsetof(TexturedVertex, position));
+    glm::vec4 texCoordRange;
+    std::vector<uint8_t> vertexData;
+    auto start = std::chrono::steady_clock::now();
+    auto layout = ModelImporter::EncodeVertices(mesh.Vertices.data(), mesh.Vertices.size(), bounds, &texCoordRange, &vertexData);
+    f64 seconds = SecondsSince(start);
+
+    // White vertices with texture coordinates in [0, 1] fit the compact layout within half a unorm16 step
+    glm::vec3 error = GetCompactError(mesh, bounds, texCoordRange, vertexData, ModelImporter::GetVertexLayoutStride(layout));
+    LOG_INFO("  EncodeVertices: %zu vertices in %.3f s, %zu bytes, largest position error %g, normal %g, texture coordinate %g\n",
+        mesh.Vertices.size(), seconds, vertexData.size(), error.x, error.y, error.z);
+    BENCH_CHECK(layout == ModelImporter::VERTEX_LAYOUT_COMPACT);
+    BENCH_CHECK(vertexData.size() == mesh.Vertices.size() * sizeof(Graphics::TexturedVertexCompact));
+    BENCH_CHECK(error.x <= 0.5f / 65535.0f * 1.01f && error.z <= 0.5f / 65535.0f * 1.01f);
+    BENCH_CHECK(error.y < 1e-3f);
+
+    // Vertex colors keep the compact color layout, colors and widely repeating texture coordinates beyond it need full floats
+    ImportMesh colored = mesh;
+    for (auto &vertex : colored.Vertices) {
+        vertex.color = glm::vec3(vertex.texCoord, 0.5f);
+    }
+    layout = ModelImporter::EncodeVertices(colored.Vertices.data(), colored.Vertices.size(), bounds, &texCoordRange, &vertexData);
+    BENCH_CHECK(layout == ModelImporter::VERTEX_LAYOUT_COMPACT_COLOR);
+    bool colorsMatch = true;
+    for (size_t i = 0; i < colored.Vertices.size(); ++i) {
+        Graphics::TexturedVertexCompactColor compact;
+        memcpy(&compact, vertexData.data() + i * sizeof(compact), sizeof(compact));
+        for (int channel = 0; channel < 3; ++channel) {
+            colorsMatch = colorsMatch && compact.color[channel] == Graphics::EncodeUnorm8(colored.Vertices[i].color[channel]);
+        }
+    }
+    BENCH_CHECK(colorsMatch);
+
+    ImportMesh repeating = mesh;
+    repeating.Vertices[0].texCoord.x = 20.0f;
+    layout = ModelImporter::EncodeVertices(repeating.Vertices.data(), repeating.Vertices.size(), bounds, &texCoordRange, &vertexData);
+    BENCH_CHECK(layout == ModelImporter::VERTEX_LAYOUT_FULL);
+    BENCH_CHECK(vertexData.size() == repeating.Vertices.size() * sizeof(TexturedVertex) &&
+        memcmp(vertexData.data(), repeating.Vertices.data(), vertexData.size()) == 0);
+}
+
+// Decodes the full detail submeshes of an import back to grid triangles, as GetGridTriangles gives them for the source
+std::vector<std::array<uint32_t, 3>> GetImportedGridTriangles(ModelImporter::Mesh const &imported, int32_t materialId, uint32_t gridSize) {
+    glm::vec3 extent = imported.Bounds.Max - imported.Bounds.Min;
+    uint32_t vertexStride = ModelImporter::GetVertexLayoutStride(imported.Layout);
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for (uint32_t i = imported.Lods[0].FirstSubMesh; i < imported.Lods[0].FirstSubMesh + imported.Lods[0].SubMeshCount; ++i) {
+        Graphics::ModelMeshCache::SubMesh const &subMesh = imported.SubMeshes[i];
+        if (subMesh.MaterialId != materialId) {
+            continue;
+        }
+        const uint8_t *subMeshIndices = imported.IndexData.data() + static_cast<size_t>(subMesh.IndexOffset) * subMesh.IndexSize;
+        for (uint32_t j = 0; j < subMesh.IndexCount; j += 3) {
+            std::array<uint32_t, 3> triangle;
+            for (uint32_t corner = 0; corner < 3; ++corner) {
+                uint32_t index = 0;
+                memcpy(&index, subMeshIndices + static_cast<size_t>(j + corner) * subMesh.IndexSize, subMesh.IndexSize);
+                Graphics::TexturedVertexCompact compact;
+                memcpy(&compact, imported.VertexData.data() + static_cast<size_t>(subMesh.BaseVertex + index) * vertexStride, sizeof(compact));
+                f32 x = imported.Bounds.Min.x + compact.position[0] / 65535.0f * extent.x;
+                f32 z = imported.Bounds.Min.z + compact.position[2] / 65535.0f * extent.z;
+                triangle[corner] = static_cast<uint32_t>(std::lround(z)) * gridSize + static_cast<uint32_t>(std::lround(x));
+            }
+            std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+            triangles.push_back(triangle);
+        }
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+void CheckImport(ImportMesh const &mesh, uint32_t gridSize) {
+    ModelImporter importer;
+    ModelImporter::Mesh imported;
+    auto start = std::chrono::steady_clock::now();
+    importer.Import(mesh.Vertices.data(), mesh.Vertices.size(), mesh.Indices.data(), static_cast<uint32_t>(mesh.Indices.size()),
+        mesh.SubMeshes.data(), static_cast<uint32_t>(mesh.SubMeshes.size()), &imported);
+    f64 seconds = SecondsSince(start);
+    LOG_INFO("  Import: %.3f s, %zu vertex bytes, %zu index bytes in %zu submeshes over %zu levels\n",
+        seconds, imported.VertexData.size(), imported.IndexData.size(), imported.SubMeshes.size(), imported.Lods.size());
+
+    BENCH_CHECK(imported.Layout == ModelImporter::VERTEX_LAYOUT_COMPACT);
+    BENCH_CHECK(imported.VertexCount == static_cast<size_t>(gridSize) * gridSize);
+    BENCH_CHECK(imported.Lods.size() == ModelImporter::MAX_LOD_COUNT && !imported.Meshlets.empty());
+
+    // Submeshes of a level follow each other and every one refers to its own vertices
+    bool lodsContiguous = true;
+    bool subMeshesValid = true;
+    uint32_t subMesh16BitCount = 0;
+    size_t fullDetailIndexCount = 0;
+    for (size_t lod = 0; lod < imported.Lods.size(); ++lod) {
+        uint32_t expectedFirst = lod == 0 ? 0 : imported.Lods[lod - 1].FirstSubMesh + imported.Lods[lod - 1].SubMeshCount;
+        lodsContiguous = lodsContiguous && imported.Lods[lod].FirstSubMesh == expectedFirst;
+    }
+    size_t totalIndexCount = 0;
+    for (auto const &subMesh : imported.SubMeshes) {
+        subMesh16BitCount += subMesh.IndexSize == sizeof(uint16_t) ? 1 : 0;
+        totalIndexCount += subMesh.IndexCount;
+        subMeshesValid = subMeshesValid && (subMesh.IndexSize == sizeof(uint16_t) || subMesh.IndexSize == sizeof(uint32_t)) &&
+            (static_cast<size_t>(subMesh.IndexOffset) + subMesh.IndexCount) * subMesh.IndexSize <= imported.IndexData.size();
+        for (uint32_t i = 0; subMeshesValid && i < subMesh.IndexCount; ++i) {
+            uint32_t index = 0;
+            memcpy(&index, imported.IndexData.data() + (static_cast<size_t>(subMesh.IndexOffset) + i) * subMesh.IndexSize, subMesh.IndexSize);
+            subMeshesValid = subMesh.BaseVertex + index < imported.VertexCount;
+        }
+    }
+    for (uint32_t i = 0; i < imported.Lods[0].SubMeshCount; ++i) {
+        fullDetailIndexCount += imported.SubMeshes[imported.Lods[0].FirstSubMesh + i].IndexCount;
+    }
+    LOG_INFO("  %u of %zu submeshes with 16-bit indices\n", subMesh16BitCount, imported.SubMeshes.size());
+
+    // The optimized vertex order keeps long runs of triangles within 16 bits, only the triangles between them stay 32-bit
+    BENCH_CHECK(subMesh16BitCount > 0);
+    BENCH_CHECK(imported.IndexData.size() < totalIndexCount * sizeof(uint32_t) * 3 / 4);
+    BENCH_CHECK(lodsContiguous && imported.Lods.back().FirstSubMesh + imported.Lods.back().SubMeshCount == imported.SubMeshes.size());
+    BENCH_CHECK(subMeshesValid);
+    BENCH_CHECK(fullDetailIndexCount == mesh.Indices.size());
+
+    // Full detail still draws the source triangles of every material
+    for (auto const &subMesh : mesh.SubMeshes) {
+        BENCH_CHECK(GetImportedGridTriangles(imported, subMesh.MaterialId, gridSize) == GetGridTriangles(mesh, subMesh, gridSize));
+    }
+
+    // Cache descriptions point into the mesh
+    auto cacheData = ModelImporter::GetCacheData(imported, {});
+    BENCH_CHECK(cacheData.VertexData == imported.VertexData.data() && cacheData.VertexSize * cacheData.VertexCount == imported.VertexData.size());
+    BENCH_CHECK(cacheData.SubMeshCount == imported.SubMeshes.size() && cacheData.LodCount == imported.Lods.size() &&
+        cacheData.MeshletCount == imported.Meshlets.size());
+}
+
+// Fan of four triangles around the centre of a unit quad at x, texture coordinates from 0 to texCoordExtent
+// centerVertex replaces the centre vertex when given, so materials can share vertices
+void AddQuad(ImportMesh *mesh, f32 x, f32 texCoordExtent, int32_t materialId, uint32_t centerVertex = std::numeric_limits<uint32_t>::max()) {
+    const glm::vec2 CORNERS[] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f }, { 0.5f, 0.5f } };
+
+    uint32_t firstVertex = static_cast<uint32_t>(mesh->Vertices.size());
+    for (auto const &corner : CORNERS) {
+        TexturedVertex vertex{};
+        vertex.position = glm::vec3(x + corner.x, 0.0f, corner.y);
+        vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+        vertex.color = glm::vec3(1.0f);
+        vertex.texCoord = corner * texCoordExtent;
+        mesh->Vertices.push_back(vertex);
+    }
+    uint32_t center = centerVertex != std::numeric_limits<uint32_t>::max() ? centerVertex : firstVertex + 4;
+    mesh->SubMeshes.push_back({ static_cast<uint32_t>(mesh->Indices.size()), 12, materialId });
+    for (uint32_t i = 0; i < 4; ++i) {
+        mesh->Indices.insert(mesh->Indices.end(), { firstVertex + i, center, firstVertex + (i + 1) % 4 });
+    }
+}
+
+// Packs three small textures and leaves a large and a repeating one alone, then looks up every packed texture's centre in its page
+void CheckBuildTextureAtlas() {
+    struct AtlasTexture {
+        uint32_t Width;
+        uint32_t Height;
+        f32 TexCoordExtent;
+        bool Packed;
+    };
+    const AtlasTexture TEXTURES[] = { { 64, 64, 1.0f, true }, { 128, 32, 1.0f, true }, { 200, 256, 1.0f, true }, { 512, 512, 1.0f, false }, { 32, 32, 2.0f, false } };
+    const uint32_t TEXTURE_COUNT = countof(TEXTURES);
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path();
+    std::string modelPath = (directory / "BenchAtlas.obj").u8string();
+    ImportMesh mesh;
+    std::vector<std::string> materialTextures;
+    std::vector<glm::u8vec4> colors;
+    for (uint32_t i = 0; i < TEXTURE_COUNT; ++i) {
+        AtlasTexture const &texture = TEXTURES[i];
+        colors.push_back(glm::u8vec4(40 * (i + 1), 255 - 40 * i, 20 * i, 255));
+        std::vector<glm::u8vec4> pixels(static_cast<size_t>(texture.Width) * texture.Height, colors.back());
+        materialTextures.push_back("BenchAtlas" + std::to_string(i) + ".png");
+        stbi_write_png((directory / materialTextures.back()).u8string().c_str(), texture.Width, texture.Height, 4, pixels.data(), texture.Width * 4);
+
+        // The second material shares the first one's centre vertex, which has to be duplicated for its own placement
+        AddQuad(&mesh, static_cast<f32>(i), texture.TexCoordExtent, static_cast<int32_t>(i), i == 1 ? 4 : std::numeric_limits<uint32_t>::max());
+    }
+
+    ModelImporter importer;
+    Graphics::ModelGltfLoader gltfLoader;
+    std::vector<std::string> atlasMaterialTextures = materialTextures;
+    ImportMesh atlased;
+    bool packed = importer.BuildTextureAtlas(modelPath, gltfLoader, Graphics::TextureCompressor::BLOCK_FORMAT_NONE, mesh.Vertices.data(), mesh.Vertices.size(),
+        mesh.Indices.data(), static_cast<uint32_t>(mesh.Indices.size()), mesh.SubMeshes.data(), static_cast<uint32_t>(mesh.SubMeshes.size()),
+        &atlasMaterialTextures, &atlased.Vertices, &atlased.Indices, &atlased.SubMeshes);
+    BENCH_CHECK(packed);
+
+    // Packed materials are drawn as one submesh with the page, the others keep their texture and submesh
+    std::string pageTexture = "BenchAtlas.atlas0.dds";
+    bool texturesRenamed = true;
+    uint32_t packedCount = 0;
+    for (uint32_t i = 0; i < TEXTURE_COUNT; ++i) {
+        packedCount += TEXTURES[i].Packed ? 1 : 0;
+        texturesRenamed = texturesRenamed && atlasMaterialTextures[i] == (TEXTURES[i].Packed ? pageTexture : materialTextures[i]);
+    }
+    BENCH_CHECK(texturesRenamed);
+    BENCH_CHECK(atlased.SubMeshes.size() == 3 && atlased.SubMeshes[0].MaterialId == 0 && atlased.SubMeshes[0].IndexCount == 36);
+    BENCH_CHECK(atlased.Indices.size() == mesh.Indices.size() && atlased.Vertices.size() == mesh.Vertices.size() + 1);
+
+    // The page is unmapped before it is removed
+    {
+        Graphics::TextureContainerLoader page;
+        bool pageLoaded = packed && page.LoadFromFile((directory / pageTexture).u8string());
+        BENCH_CHECK(pageLoaded && page.GetFormat() == Graphics::TextureCompressor::BLOCK_FORMAT_NONE);
+        if (pageLoaded) {
+            LOG_INFO("  BuildTextureAtlas: %u of %u textures packed into a %ux%u page with %u levels\n",
+                packedCount, TEXTURE_COUNT, page.GetWidth(), page.GetHeight(), page.GetMipLevelCount());
+
+            // The centre of every packed quad samples its own texture's colour from the page
+            bool colorsMatch = true;
+            for (uint32_t i = 0; i < TEXTURE_COUNT; ++i) {
+                if (!TEXTURES[i].Packed) {
+                    continue;
+                }
+                glm::vec2 texCoord = atlased.Vertices[atlased.Indices[i * 12 + 1]].texCoord;
+                uint32_t x = std::min(static_cast<uint32_t>(texCoord.x * page.GetWidth()), page.GetWidth() - 1);
+                uint32_t y = std::min(static_cast<uint32_t>(texCoord.y * page.GetHeight()), page.GetHeight() - 1);
+                glm::u8vec4 pixel;
+                memcpy(&pixel, page.GetData() + page.GetMipLevel(0).Offset + (static_cast<size_t>(y) * page.GetWidth() + x) * 4, sizeof(pixel));
+                colorsMatch = colorsMatch && pixel == colors[i];
+            }
+            BENCH_CHECK(colorsMatch);
+        }
+    }
+
+    std::filesystem::remove(directory / pageTexture);
+    for (auto const &texture : materialTextures) {
+        std::filesystem::remove(directory / texture);
+    }
+}
+
+} // namespace
+
+// Import steps of a shuffled 1M triangle grid, each timed and checked against what it must preserve
+// Texture atlasing is checked on a few generated textures written to the temp directory
+void RunModelImporter() {
+    const uint32_t GRID_SIZE = 708;
+
+    ImportMesh mesh = GenerateMesh(GRID_SIZE);
+    LOG_INFO("  %zu vertices, %zu triangles in %zu submeshes\n", mesh.Vertices.size(), mesh.Indices.size() / 3, mesh.SubMeshes.size());
+
+    ImportMesh optimized = CheckOptimizeMesh(mesh, GRID_SIZE);
+    CheckBuildMeshlets(optimized);
+    CheckMeshletCulling();
+    CheckBuildLods(optimized);
+    CheckEncodeVertices(optimized);
+    CheckImport(mesh, GRID_SIZE);
+    CheckBuildTextureAtlas();
+}
+
+} // namespace Bench
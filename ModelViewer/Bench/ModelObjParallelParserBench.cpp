@@ -0,0 +1,115 @@
+#include "pch.h"
+#include "Bench.h"
+#include "ModelObjParallelParser.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace Bench {
+
+namespace {
+
+// Grid of gridSize x gridSize quads with positions, texture coordinates and normals, in a few groups and materials
+std::string GenerateObj(uint32_t gridSize) {
+    std::string obj;
+    obj.reserve(static_cast<size_t>(gridSize) * gridSize * 150);
+    char line[256];
+    for (uint32_t y = 0; y < gridSize; ++y) {
+        for (uint32_t x = 0; x < gridSize; ++x) {
+            f32 u = static_cast<f32>(x) / gridSize;
+            f32 v = static_cast<f32>(y) / gridSize;
+            snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n",
+                u * 100.0f, std::sin(u * 20.0f) * std::cos(v * 20.0f), v * 100.0f, u, v, 0.0f, 1.0f, 0.0f);
+            obj += line;
+        }
+    }
+    for (uint32_t y = 0; y + 1 < gridSize; ++y) {
+        if (y % (gridSize / 4 + 1) == 0) {
+            snprintf(line, sizeof(line), "g part%u\nusemtl material%u\n", y, y % 3);
+            obj += line;
+        }
+        for (uint32_t x = 0; x + 1 < gridSize; ++x) {
+            uint32_t i = y * gridSize + x + 1;
+            uint32_t j = i + gridSize;
+            snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n", i, i, i, i + 1, i + 1, i + 1, j + 1, j + 1, j + 1, j, j, j);
+            obj += line;
+        }
+    }
+    return obj;
+}
+
+bool IsSameResult(tinyobj::attrib_t const &a, std::vector<tinyobj::shape_t> const &aShapes,
+    tinyobj::attrib_t const &b, std::vector<tinyobj::shape_t> const &bShapes) {
+    if (a.vertices != b.vertices || a.normals != b.normals || a.texcoords != b.texcoords || aShapes.size() != bShapes.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < aShapes.size(); ++i) {
+        tinyobj::mesh_t const &aMesh = aShapes[i].mesh;
+        tinyobj::mesh_t const &bMesh = bShapes[i].mesh;
+        if (aShapes[i].name != bShapes[i].name || aMesh.num_face_vertices != bMesh.num_face_vertices ||
+            aMesh.material_ids != bMesh.material_ids || aMesh.indices.size() != bMesh.indices.size()) {
+            return false;
+        }
+        for (size_t j = 0; j < aMesh.indices.size(); ++j) {
+            tinyobj::index_t const &aIndex = aMesh.indices[j];
+            tinyobj::index_t const &bIndex = bMesh.indices[j];
+            if (aIndex.vertex_index != bIndex.vertex_index || aIndex.normal_index != bIndex.normal_index ||
+                aIndex.texcoord_index != bIndex.texcoord_index) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+// MB/s of tinyobj::LoadObj against the parallel parser at growing thread counts, on the same in-memory file
+void RunModelObjParallelParser() {
+    const uint32_t GRID_SIZE = 1024;
+
+    std::string obj = GenerateObj(GRID_SIZE);
+    f64 megabytes = obj.size() / (1024.0 * 1024.0);
+    LOG_INFO("  %.1f MB, %u vertices, %u quads\n", megabytes, GRID_SIZE * GRID_SIZE, (GRID_SIZE - 1) * (GRID_SIZE - 1));
+
+    tinyobj::attrib_t expectedAttrib;
+    std::vector<tinyobj::shape_t> expectedShapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+    std::istringstream objStream(obj);
+    auto start = std::chrono::steady_clock::now();
+    BENCH_CHECK(tinyobj::LoadObj(&expectedAttrib, &expectedShapes, &materials, &warn, &err, &objStream));
+    f64 seconds = SecondsSince(start);
+    LOG_INFO("  tinyobj::LoadObj: %.3f s, %.1f MB/s\n", seconds, megabytes / seconds);
+
+    uint32_t hardwareThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    for (uint32_t threadCount = 1; ; threadCount = std::min(threadCount * 2, hardwareThreadCount)) {
+        // The calling thread works through the chunks too, the pool adds the rest
+        Graphics::ThreadPool threadPool;
+        if (threadCount > 1) {
+            threadPool.Initialize(threadCount - 1);
+        }
+        Graphics::ModelObjParallelParser parser(&threadPool);
+
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        materials.clear();
+        warn.clear();
+        err.clear();
+        start = std::chrono::steady_clock::now();
+        bool parsed = parser.Parse(obj.data(), obj.size(), "", &attrib, &shapes, &materials, &warn, &err);
+        seconds = SecondsSince(start);
+        threadPool.Finalize();
+
+        LOG_INFO("  %2u threads: %.3f s, %.1f MB/s, %u chunks\n", threadCount, seconds, megabytes / seconds, parser.GetLastChunkCount());
+        BENCH_CHECK(parsed);
+        BENCH_CHECK(IsSameResult(attrib, shapes, expectedAttrib, expectedShapes));
+
+        if (threadCount == hardwareThreadCount) {
+            break;
+        }
+    }
+}
+
+} // namespace Bench
@@ -0,0 +1,136 @@
+#include "pch.h"
+#include "Bench.h"
+#include "ModelScanLoader.h"
+#include "ModelObjVertexWriterT.h"
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace Bench {
+
+namespace {
+
+struct ScanVertex {
+    glm::vec3 Position;
+    glm::vec3 Normal;
+};
+
+class ScanVertexWriter : public Graphics::ModelObjVertexWriterT<ScanVertexWriter, ScanVertex> {
+public:
+    static const bool COMBINE_MESHES = true;
+
+    static void BuildVertex(Corner const &corner, ScanVertex &vertex) {
+        vertex.Position = corner.Position;
+        vertex.Normal = corner.Normal;
+    }
+};
+
+// Height field of gridSize x gridSize vertices, two triangles per cell, as a scanner exports a surface
+glm::vec3 GridPosition(uint32_t gridSize, uint32_t x, uint32_t y) {
+    f32 u = static_cast<f32>(x) / gridSize;
+    f32 v = static_cast<f32>(y) / gridSize;
+    return glm::vec3(u, std::sin(u * 30.0f) * std::cos(v * 30.0f) * 0.05f, v);
+}
+
+template<typename TriangleFunc>
+void ForEachGridTriangle(uint32_t gridSize, TriangleFunc const &triangle) {
+    for (uint32_t y = 0; y + 1 < gridSize; ++y) {
+        for (uint32_t x = 0; x + 1 < gridSize; ++x) {
+            uint32_t i = y * gridSize + x;
+            triangle(i, i + gridSize, i + 1);
+            triangle(i + 1, i + gridSize, i + gridSize + 1);
+        }
+    }
+}
+
+// Shared vertices without normals, so the loader computes them
+void WritePly(std::filesystem::path const &path, uint32_t gridSize) {
+    std::ofstream file(path, std::ios::binary);
+    file << "ply\nformat binary_little_endian 1.0\ncomment Bench\n"
+        << "element vertex " << gridSize * gridSize << "\nproperty float x\nproperty float y\nproperty float z\n"
+        << "element face " << 2 * (gridSize - 1) * (gridSize - 1) << "\nproperty list uchar int vertex_indices\nend_header\n";
+    for (uint32_t y = 0; y < gridSize; ++y) {
+        for (uint32_t x = 0; x < gridSize; ++x) {
+            glm::vec3 position = GridPosition(gridSize, x, y);
+            file.write(reinterpret_cast<char const*>(&position), sizeof(position));
+        }
+    }
+    ForEachGridTriangle(gridSize, [&file](uint32_t a, uint32_t b, uint32_t c) {
+        uint8_t face[13] = { 3 };
+        memcpy(face + 1, &a, 4);
+        memcpy(face + 5, &b, 4);
+        memcpy(face + 9, &c, 4);
+        file.write(reinterpret_cast<char const*>(face), sizeof(face));
+    });
+}
+
+// Every triangle repeats its corners, they weld back into the grid's vertices
+void WriteStl(std::filesystem::path const &path, uint32_t gridSize) {
+    std::ofstream file(path, std::ios::binary);
+    char header[80] = "Bench";
+    uint32_t triangleCount = 2 * (gridSize - 1) * (gridSize - 1);
+    file.write(header, sizeof(header));
+    file.write(reinterpret_cast<char const*>(&triangleCount), sizeof(triangleCount));
+    ForEachGridTriangle(gridSize, [&file, gridSize](uint32_t a, uint32_t b, uint32_t c) {
+        glm::vec3 triangle[4] = {
+            glm::vec3(0.0f),
+            GridPosition(gridSize, a % gridSize, a / gridSize),
+            GridPosition(gridSize, b % gridSize, b / gridSize),
+            GridPosition(gridSize, c % gridSize, c / gridSize)
+        };
+        triangle[0] = glm::normalize(glm::cross(triangle[2] - triangle[1], triangle[3] - triangle[1]));
+        uint16_t attributeByteCount = 0;
+        file.write(reinterpret_cast<char const*>(triangle), sizeof(triangle));
+        file.write(reinterpret_cast<char const*>(&attributeByteCount), sizeof(attributeByteCount));
+    });
+}
+
+void MeasureLoad(char const *format, std::filesystem::path const &path, uint32_t gridSize) {
+    size_t triangleCount = 2 * static_cast<size_t>(gridSize - 1) * (gridSize - 1);
+    f64 megabytes = std::filesystem::file_size(path) / (1024.0 * 1024.0);
+
+    ScanVertexWriter writer;
+    Graphics::ModelScanLoader loader;
+    f32 lastProgress = 0.0f;
+    bool progressIncreasing = true;
+    loader.SetProgressCallback([&lastProgress, &progressIncreasing](f32 progress) {
+        progressIncreasing = progressIncreasing && progress >= lastProgress;
+        lastProgress = progress;
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    std::string error = loader.Load(path.string(), &writer);
+    f64 seconds = SecondsSince(start);
+    if (!BENCH_CHECK(error.empty())) {
+        LOG_ERROR("  %s\n", error.c_str());
+        return;
+    }
+
+    LOG_INFO("  %s: %.1f MB, %zu triangles in %.3f s, %.1f MB/s, %.2f M triangles/s\n",
+        format, megabytes, triangleCount, seconds, megabytes / seconds, triangleCount / 1000000.0 / seconds);
+    BENCH_CHECK(loader.GetIndexCount(0) == triangleCount * 3);
+    BENCH_CHECK(loader.GetVertexCount(0) == gridSize * gridSize);
+    BENCH_CHECK(progressIncreasing && lastProgress == 1.0f);
+}
+
+} // namespace
+
+// Loading throughput of the PLY and STL readers on 10M triangle files written to the temp directory
+void RunModelScanLoader() {
+    const uint32_t GRID_SIZE = 2300;
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path();
+    std::filesystem::path plyPath = directory / "BenchScan.ply";
+    std::filesystem::path stlPath = directory / "BenchScan.stl";
+
+    WritePly(plyPath, GRID_SIZE);
+    MeasureLoad("PLY", plyPath, GRID_SIZE);
+    std::filesystem::remove(plyPath);
+
+    WriteStl(stlPath, GRID_SIZE);
+    MeasureLoad("STL", stlPath, GRID_SIZE);
+    std::filesystem::remove(stlPath);
+}
+
+} // namespace Bench
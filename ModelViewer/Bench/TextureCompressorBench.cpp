@@ -0,0 +1,300 @@
+#include "pch.h"
+#include "Bench.h"
+#include "TextureCompressor.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace Bench {
+
+namespace {
+
+using Graphics::TextureCompressor;
+
+// Smooth shading with noise and hard edges in the color, a noisy alpha follows the shading over a gradient
+std::vector<uint8_t> GenerateImage(uint32_t width, uint32_t height) {
+    std::mt19937 random(91011);
+    std::uniform_int_distribution<int32_t> noiseDistribution(-6, 6);
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            f32 u = static_cast<f32>(x) / width;
+            f32 v = static_cast<f32>(y) / height;
+            f32 shade = 0.5f + 0.5f * std::sin(u * 17.0f + std::cos(v * 11.0f) * 3.0f);
+            bool stripe = (x / 37 + y / 53) % 5 == 0;
+            f32 color[3] = { shade * 220.0f, (1.0f - shade) * 180.0f + v * 60.0f, stripe ? 250.0f : u * 120.0f };
+            uint8_t *pixel = &pixels[(static_cast<size_t>(y) * width + x) * 4];
+            for (uint32_t c = 0; c < 3; ++c) {
+                pixel[c] = static_cast<uint8_t>(std::clamp(static_cast<int32_t>(color[c]) + noiseDistribution(random), 0, 255));
+            }
+            pixel[3] = static_cast<uint8_t>(std::clamp(static_cast<int32_t>(v * 180.0f + shade * 75.0f) + noiseDistribution(random), 0, 255));
+        }
+    }
+    return pixels;
+}
+
+void Expand565(uint16_t color, int32_t outColor[3]) {
+    int32_t r = (color >> 11) & 31;
+    int32_t g = (color >> 5) & 63;
+    int32_t b = color & 31;
+    outColor[0] = (r << 3) | (r >> 2);
+    outColor[1] = (g << 2) | (g >> 4);
+    outColor[2] = (b << 3) | (b >> 2);
+}
+
+// BC1 color block, always in the four color mode inside BC3
+void DecodeColorBlock(const uint8_t *block, bool allowThreeColors, uint8_t outPixels[64]) {
+    uint16_t color0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+    uint16_t color1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+    int32_t palette[4][4];
+    Expand565(color0, palette[0]);
+    Expand565(color1, palette[1]);
+    bool fourColors = !allowThreeColors || color0 > color1;
+    for (uint32_t c = 0; c < 3; ++c) {
+        if (fourColors) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    for (uint32_t i = 0; i < 4; ++i) {
+        palette[i][3] = 255;
+    }
+    if (!fourColors) {
+        palette[3][3] = 0;
+    }
+
+    uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+    for (uint32_t p = 0; p < 16; ++p) {
+        int32_t const *color = palette[(indices >> (p * 2)) & 3];
+        for (uint32_t c = 0; c < 4; ++c) {
+            outPixels[p * 4 + c] = static_cast<uint8_t>(color[c]);
+        }
+    }
+}
+
+void DecodeAlphaBlock(const uint8_t *block, uint8_t outPixels[64]) {
+    int32_t palette[8] = { block[0], block[1] };
+    if (palette[0] > palette[1]) {
+        for (int32_t i = 1; i < 7; ++i) {
+            palette[i + 1] = ((7 - i) * palette[0] + i * palette[1]) / 7;
+        }
+    }
+    else {
+        for (int32_t i = 1; i < 5; ++i) {
+            palette[i + 1] = ((5 - i) * palette[0] + i * palette[1]) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t indices = 0;
+    for (uint32_t i = 0; i < 6; ++i) {
+        indices |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+    }
+    for (uint32_t p = 0; p < 16; ++p) {
+        outPixels[p * 4 + 3] = static_cast<uint8_t>(palette[(indices >> (p * 3)) & 7]);
+    }
+}
+
+// Only the modes the compressor writes are decoded: 6, and 4 and 5 without rotation, anything else fails the block
+bool DecodeBc7Block(const uint8_t *block, uint8_t outPixels[64]) {
+    static const int32_t WEIGHTS2[4] = { 0, 21, 43, 64 };
+    static const int32_t WEIGHTS3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+    static const int32_t WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    uint32_t position = 0;
+    auto read = [block, &position](uint32_t bitCount) {
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < bitCount; ++i, ++position) {
+            value |= ((block[position / 8] >> (position % 8)) & 1) << i;
+        }
+        return value;
+    };
+    auto unquantize = [](int32_t value, uint32_t bits) {
+        return (value << (8 - bits)) | (value >> (2 * bits - 8));
+    };
+
+    uint32_t mode = 0;
+    while (mode < 8 && read(1) == 0) {
+        ++mode;
+    }
+
+    if (mode == 6) {
+        int32_t endpoints[2][4];
+        for (uint32_t c = 0; c < 4; ++c) {
+            endpoints[0][c] = read(7) << 1;
+            endpoints[1][c] = read(7) << 1;
+        }
+        uint32_t pBit0 = read(1);
+        uint32_t pBit1 = read(1);
+        for (uint32_t c = 0; c < 4; ++c) {
+            endpoints[0][c] |= pBit0;
+            endpoints[1][c] |= pBit1;
+        }
+        for (uint32_t p = 0; p < 16; ++p) {
+            int32_t weight = WEIGHTS4[read(p == 0 ? 3 : 4)];
+            for (uint32_t c = 0; c < 4; ++c) {
+                outPixels[p * 4 + c] = static_cast<uint8_t>(((64 - weight) * endpoints[0][c] + weight * endpoints[1][c] + 32) >> 6);
+            }
+        }
+        return true;
+    }
+
+    if (mode != 4 && mode != 5) {
+        return false;
+    }
+    if (read(2) != 0) {
+        return false;
+    }
+    uint32_t indexMode = mode == 4 ? read(1) : 0;
+    uint32_t colorBits = mode == 4 ? 5 : 7;
+    uint32_t alphaBits = mode == 4 ? 6 : 8;
+
+    int32_t endpoints[2][4];
+    for (uint32_t c = 0; c < 3; ++c) {
+        endpoints[0][c] = unquantize(read(colorBits), colorBits);
+        endpoints[1][c] = unquantize(read(colorBits), colorBits);
+    }
+    endpoints[0][3] = unquantize(read(alphaBits), alphaBits);
+    endpoints[1][3] = unquantize(read(alphaBits), alphaBits);
+
+    // Two sets of indices, the first is 2-bit and the second 3-bit in mode 4, index mode 1 gives the first set to alpha
+    uint32_t indices[2][16];
+    uint32_t indexBits[2] = { 2, mode == 4 ? 3u : 2u };
+    for (uint32_t set = 0; set < 2; ++set) {
+        for (uint32_t p = 0; p < 16; ++p) {
+            indices[set][p] = read(p == 0 ? indexBits[set] - 1 : indexBits[set]);
+        }
+    }
+    uint32_t colorSet = indexMode;
+    uint32_t alphaSet = 1 - indexMode;
+    const int32_t *colorWeights = indexBits[colorSet] == 2 ? WEIGHTS2 : WEIGHTS3;
+    const int32_t *alphaWeights = indexBits[alphaSet] == 2 ? WEIGHTS2 : WEIGHTS3;
+    for (uint32_t p = 0; p < 16; ++p) {
+        for (uint32_t c = 0; c < 4; ++c) {
+            int32_t weight = c < 3 ? colorWeights[indices[colorSet][p]] : alphaWeights[indices[alphaSet][p]];
+            outPixels[p * 4 + c] = static_cast<uint8_t>(((64 - weight) * endpoints[0][c] + weight * endpoints[1][c] + 32) >> 6);
+        }
+    }
+    return true;
+}
+
+std::vector<uint8_t> Decompress(std::vector<uint8_t> const &blocks, uint32_t width, uint32_t height, TextureCompressor::BlockFormat format) {
+    uint32_t blockSize = TextureCompressor::GetBlockSize(format);
+    uint32_t blockCountX = (width + 3) / 4;
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+    uint8_t blockPixels[64];
+    for (uint32_t blockY = 0; blockY < (height + 3) / 4; ++blockY) {
+        for (uint32_t blockX = 0; blockX < blockCountX; ++blockX) {
+            const uint8_t *block = &blocks[(static_cast<size_t>(blockY) * blockCountX + blockX) * blockSize];
+            switch (format) {
+            case TextureCompressor::BLOCK_FORMAT_BC1:
+                DecodeColorBlock(block, true, blockPixels);
+                break;
+            case TextureCompressor::BLOCK_FORMAT_BC3:
+                DecodeColorBlock(block + 8, false, blockPixels);
+                DecodeAlphaBlock(block, blockPixels);
+                break;
+            default:
+                if (!BENCH_CHECK(DecodeBc7Block(block, blockPixels))) {
+                    return pixels;
+                }
+                break;
+            }
+
+            for (uint32_t y = 0; y < 4 && blockY * 4 + y < height; ++y) {
+                for (uint32_t x = 0; x < 4 && blockX * 4 + x < width; ++x) {
+                    size_t pixel = static_cast<size_t>(blockY * 4 + y) * width + blockX * 4 + x;
+                    memcpy(&pixels[pixel * 4], blockPixels + (y * 4 + x) * 4, 4);
+                }
+            }
+        }
+    }
+    return pixels;
+}
+
+// Peak signal to noise ratio in dB over the channels [firstChannel, firstChannel + channelCount)
+f64 Psnr(std::vector<uint8_t> const &expected, std::vector<uint8_t> const &actual, uint32_t firstChannel, uint32_t channelCount) {
+    f64 squaredError = 0.0;
+    for (size_t i = 0; i < expected.size(); i += 4) {
+        for (uint32_t c = firstChannel; c < firstChannel + channelCount; ++c) {
+            f64 delta = static_cast<f64>(expected[i + c]) - actual[i + c];
+            squaredError += delta * delta;
+        }
+    }
+    f64 meanSquaredError = squaredError / (expected.size() / 4 * channelCount);
+    return meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : 99.0;
+}
+
+} // namespace
+
+// Compression speed with and without the thread pool and the refinement passes, and the quality of the result
+void RunTextureCompressor() {
+    // Not a multiple of 4, so the padded edge blocks are covered too
+    const uint32_t WIDTH = 2046;
+    const uint32_t HEIGHT = 1534;
+    // Lower bounds for this image, well under what the encoders reach, to catch broken blocks rather than small regressions
+    const f64 MIN_COLOR_PSNR = 30.0;
+    const f64 MIN_ALPHA_PSNR = 40.0;
+
+    struct Format {
+        char const *Name;
+        TextureCompressor::BlockFormat BlockFormat;
+        bool HasAlpha;
+    };
+    Format const FORMATS[] = {
+        { "BC1", TextureCompressor::BLOCK_FORMAT_BC1, false },
+        { "BC3", TextureCompressor::BLOCK_FORMAT_BC3, true },
+        { "BC7", TextureCompressor::BLOCK_FORMAT_BC7, true },
+    };
+
+    std::vector<uint8_t> pixels = GenerateImage(WIDTH, HEIGHT);
+    f64 megapixels = static_cast<f64>(WIDTH) * HEIGHT / 1e6;
+    LOG_INFO("  %ux%u RGBA\n", WIDTH, HEIGHT);
+
+    Graphics::ThreadPool threadPool;
+    threadPool.Initialize();
+
+    for (auto const &format : FORMATS) {
+        std::vector<uint8_t> blocks(TextureCompressor::GetCompressedSize(format.BlockFormat, WIDTH, HEIGHT));
+        for (bool highQuality : { false, true }) {
+            TextureCompressor compressor;
+            compressor.SetHighQuality(highQuality);
+
+            auto start = std::chrono::steady_clock::now();
+            compressor.Compress(pixels.data(), WIDTH, HEIGHT, format.BlockFormat, blocks.data());
+            f64 seconds = SecondsSince(start);
+
+            std::vector<uint8_t> threadedBlocks(blocks.size());
+            compressor.SetThreadPool(&threadPool);
+            start = std::chrono::steady_clock::now();
+            compressor.Compress(pixels.data(), WIDTH, HEIGHT, format.BlockFormat, threadedBlocks.data());
+            f64 threadedSeconds = SecondsSince(start);
+            BENCH_CHECK(threadedBlocks == blocks);
+
+            std::vector<uint8_t> decompressed = Decompress(blocks, WIDTH, HEIGHT, format.BlockFormat);
+            f64 colorPsnr = Psnr(pixels, decompressed, 0, 3);
+            f64 alphaPsnr = format.HasAlpha ? Psnr(pixels, decompressed, 3, 1) : 0.0;
+            LOG_INFO("  %s %s: %.1f MPixel/s, %.1f MPixel/s on %u threads, RGB %.2f dB",
+                format.Name, highQuality ? "high quality" : "normal", megapixels / seconds, megapixels / threadedSeconds,
+                threadPool.GetThreadCount() + 1, colorPsnr);
+            if (format.HasAlpha) {
+                LOG_INFO(", alpha %.2f dB", alphaPsnr);
+            }
+            LOG_INFO("\n");
+
+            BENCH_CHECK(colorPsnr > MIN_COLOR_PSNR);
+            BENCH_CHECK(!format.HasAlpha || alphaPsnr > MIN_ALPHA_PSNR);
+        }
+    }
+
+    threadPool.Finalize();
+}
+
+} // namespace Bench
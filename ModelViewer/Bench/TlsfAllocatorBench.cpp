@@ -0,0 +1,193 @@
+#include "pch.h"
+#include "Bench.h"
+#include "TlsfAllocator.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace Bench {
+
+namespace {
+
+using Graphics::TlsfAllocator;
+
+void CheckAlignment() {
+    TlsfAllocator allocator;
+    allocator.Initialize(1 << 20);
+
+    // Odd sizes first so that most later offsets start out misaligned
+    std::vector<TlsfAllocator::Handle> handles;
+    for (uint64_t alignment = 1; alignment <= 4096; alignment *= 2) {
+        for (uint64_t size : { uint64_t(3), uint64_t(17), uint64_t(1000) }) {
+            TlsfAllocator::Handle handle = allocator.Allocate(size, alignment);
+            if (!BENCH_CHECK(handle != TlsfAllocator::INVALID_HANDLE)) {
+                continue;
+            }
+            BENCH_CHECK(allocator.GetOffset(handle) % alignment == 0);
+            BENCH_CHECK(allocator.GetSize(handle) >= size);
+            handles.push_back(handle);
+        }
+    }
+
+    std::sort(handles.begin(), handles.end(), [&allocator](TlsfAllocator::Handle a, TlsfAllocator::Handle b) {
+        return allocator.GetOffset(a) < allocator.GetOffset(b);
+    });
+    for (size_t i = 1; i < handles.size(); ++i) {
+        BENCH_CHECK(allocator.GetOffset(handles[i - 1]) + allocator.GetSize(handles[i - 1]) <= allocator.GetOffset(handles[i]));
+    }
+    BENCH_CHECK(allocator.GetOffset(handles.back()) + allocator.GetSize(handles.back()) <= allocator.GetSize());
+
+    for (TlsfAllocator::Handle handle : handles) {
+        allocator.Free(handle);
+    }
+    BENCH_CHECK(allocator.IsEmpty());
+    BENCH_CHECK(allocator.GetStats().FreeRangeCount == 1);
+}
+
+void CheckCoalescing() {
+    TlsfAllocator allocator;
+    allocator.Initialize(4096);
+
+    TlsfAllocator::Handle handles[4];
+    for (uint32_t i = 0; i < 4; ++i) {
+        handles[i] = allocator.Allocate(1024, 1);
+        BENCH_CHECK(handles[i] != TlsfAllocator::INVALID_HANDLE);
+    }
+    BENCH_CHECK(allocator.GetStats().FreeRangeCount == 0);
+
+    // Freed in both orders, merging into the range before and the range after
+    allocator.Free(handles[1]);
+    allocator.Free(handles[2]);
+    TlsfAllocator::Stats stats = allocator.GetStats();
+    BENCH_CHECK(stats.FreeRangeCount == 1);
+    BENCH_CHECK(stats.LargestFreeRange == 2048);
+
+    TlsfAllocator::Handle merged = allocator.Allocate(2048, 1);
+    BENCH_CHECK(merged != TlsfAllocator::INVALID_HANDLE && allocator.GetOffset(merged) == 1024);
+
+    allocator.Free(handles[3]);
+    allocator.Free(handles[0]);
+    allocator.Free(merged);
+    stats = allocator.GetStats();
+    BENCH_CHECK(allocator.IsEmpty());
+    BENCH_CHECK(stats.FreeRangeCount == 1);
+    BENCH_CHECK(stats.LargestFreeRange == 4096);
+}
+
+void CheckExhaustion() {
+    TlsfAllocator allocator;
+    allocator.Initialize(4096);
+    BENCH_CHECK(allocator.Allocate(4097, 1) == TlsfAllocator::INVALID_HANDLE);
+
+    TlsfAllocator::Handle first = allocator.Allocate(1, 1);
+    BENCH_CHECK(first != TlsfAllocator::INVALID_HANDLE);
+
+    // There is room for the size, but no offset left at this alignment
+    BENCH_CHECK(allocator.Allocate(1024, 4096) == TlsfAllocator::INVALID_HANDLE);
+
+    TlsfAllocator::Handle rest = allocator.Allocate(4096 - allocator.GetSize(first), 1);
+    BENCH_CHECK(rest != TlsfAllocator::INVALID_HANDLE);
+    BENCH_CHECK(allocator.Allocate(1, 1) == TlsfAllocator::INVALID_HANDLE);
+
+    // Failed allocations change nothing, freed space is found again
+    allocator.Free(first);
+    BENCH_CHECK(allocator.Allocate(1, 1) != TlsfAllocator::INVALID_HANDLE);
+
+    TlsfAllocator empty;
+    BENCH_CHECK(empty.Allocate(1, 1) == TlsfAllocator::INVALID_HANDLE);
+}
+
+void CheckStats() {
+    TlsfAllocator allocator;
+    allocator.Initialize(1 << 16);
+
+    TlsfAllocator::Stats stats = allocator.GetStats();
+    BENCH_CHECK(stats.Size == 1 << 16);
+    BENCH_CHECK(stats.UsedSize == 0);
+    BENCH_CHECK(stats.AllocationCount == 0);
+    BENCH_CHECK(stats.FreeRangeCount == 1);
+    BENCH_CHECK(stats.LargestFreeRange == 1 << 16);
+    BENCH_CHECK(TlsfAllocator::GetFragmentation(stats) == 0.0f);
+
+    // Every other range freed, the last one merges with the 1024 bytes left at the end
+    std::vector<TlsfAllocator::Handle> handles;
+    for (uint32_t i = 0; i < 63; ++i) {
+        handles.push_back(allocator.Allocate(1024, 1));
+    }
+    for (size_t i = 0; i < handles.size(); i += 2) {
+        allocator.Free(handles[i]);
+    }
+    stats = allocator.GetStats();
+    BENCH_CHECK(stats.AllocationCount == 31);
+    BENCH_CHECK(stats.UsedSize == 31 * 1024);
+    BENCH_CHECK(stats.FreeRangeCount == 32);
+    BENCH_CHECK(stats.LargestFreeRange == 2048);
+
+    // 2048 of 33 * 1024 free bytes are in the largest range
+    f32 fragmentation = TlsfAllocator::GetFragmentation(stats);
+    BENCH_CHECK(std::abs(fragmentation - (1.0f - 2.0f / 33.0f)) < 1e-5f);
+
+    // Full means nothing is left to fragment
+    allocator.Initialize(1024);
+    allocator.Allocate(1024, 1);
+    BENCH_CHECK(TlsfAllocator::GetFragmentation(allocator.GetStats()) == 0.0f);
+}
+
+// Allocations of mixed sizes live for a random while, as device memory sees them from the asset loaders
+void MeasureThroughput() {
+    const uint64_t SIZE = uint64_t(1) << 32;
+    const size_t SLOT_COUNT = 16384;
+    const uint32_t OPERATION_COUNT = 4000000;
+
+    TlsfAllocator allocator;
+    allocator.Initialize(SIZE);
+    std::vector<TlsfAllocator::Handle> slots(SLOT_COUNT, TlsfAllocator::INVALID_HANDLE);
+    std::mt19937 random(1234);
+    std::uniform_int_distribution<size_t> slotDistribution(0, SLOT_COUNT - 1);
+    std::uniform_int_distribution<uint32_t> sizeBitsDistribution(4, 20);
+
+    uint32_t failedCount = 0;
+    f32 peakFragmentation = 0.0f;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < OPERATION_COUNT; ++i) {
+        TlsfAllocator::Handle &slot = slots[slotDistribution(random)];
+        if (slot != TlsfAllocator::INVALID_HANDLE) {
+            allocator.Free(slot);
+            slot = TlsfAllocator::INVALID_HANDLE;
+            continue;
+        }
+        uint64_t size = (uint64_t(1) << sizeBitsDistribution(random)) + (random() & 0xff);
+        slot = allocator.Allocate(size, 256);
+        failedCount += slot == TlsfAllocator::INVALID_HANDLE;
+        if ((i & 0xffff) == 0) {
+            peakFragmentation = std::max(peakFragmentation, TlsfAllocator::GetFragmentation(allocator.GetStats()));
+        }
+    }
+    f64 seconds = SecondsSince(start);
+
+    TlsfAllocator::Stats stats = allocator.GetStats();
+    LOG_INFO("  %u allocations and frees in %.3f s, %.1f M/s, %u failed\n", OPERATION_COUNT, seconds, OPERATION_COUNT / seconds / 1e6, failedCount);
+    LOG_INFO("  %u live allocations, %u free ranges, fragmentation %.3f (peak %.3f)\n",
+        stats.AllocationCount, stats.FreeRangeCount, TlsfAllocator::GetFragmentation(stats), peakFragmentation);
+    BENCH_CHECK(failedCount == 0);
+
+    for (TlsfAllocator::Handle slot : slots) {
+        if (slot != TlsfAllocator::INVALID_HANDLE) {
+            allocator.Free(slot);
+        }
+    }
+    BENCH_CHECK(allocator.IsEmpty());
+    BENCH_CHECK(allocator.GetStats().LargestFreeRange == SIZE);
+}
+
+} // namespace
+
+void RunTlsfAllocator() {
+    CheckAlignment();
+    CheckCoalescing();
+    CheckExhaustion();
+    CheckStats();
+    MeasureThroughput();
+}
+
+} // namespace Bench
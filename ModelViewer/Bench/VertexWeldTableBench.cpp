@@ -0,0 +1,112 @@
+#include "pch.h"
+#include "Bench.h"
+#include "VertexWeldTable.h"
+#include "Hash.h"
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string_view>
+#include <unordered_map>
+
+namespace Bench {
+
+namespace {
+
+struct WeldVertex {
+    f32 Position[3];
+    f32 Normal[3];
+    f32 TexCoord[2];
+};
+
+// Face corners of a mesh, every unique vertex is shared by about cornerCount / uniqueCount corners as in a closed triangle mesh
+std::vector<WeldVertex> GenerateCorners(size_t cornerCount, size_t uniqueCount) {
+    std::mt19937 random(5678);
+    std::uniform_real_distribution<f32> distribution(-1.0f, 1.0f);
+    std::vector<WeldVertex> uniqueVertices(uniqueCount);
+    for (auto &vertex : uniqueVertices) {
+        vertex = { { distribution(random), distribution(random), distribution(random) },
+            { distribution(random), distribution(random), distribution(random) },
+            { distribution(random), distribution(random) } };
+    }
+
+    std::uniform_int_distribution<size_t> indexDistribution(0, uniqueCount - 1);
+    std::vector<WeldVertex> corners(cornerCount);
+    for (auto &corner : corners) {
+        corner = uniqueVertices[indexDistribution(random)];
+    }
+    return corners;
+}
+
+// The unordered_map ModelObjVertexWriter used before VertexWeldTable, keyed by pointers into the vertex buffer
+void WeldWithMap(std::vector<WeldVertex> const &corners, std::vector<WeldVertex> *outVertices, std::vector<uint32_t> *outIndices) {
+    std::unordered_map<void*, uint32_t, std::function<size_t(void*)>, std::function<bool(void*, void*)>> uniqueVertices(1,
+        [](void *vertexData) {
+            return std::hash<std::string_view>{}({ reinterpret_cast<char*>(vertexData), sizeof(WeldVertex) });
+        },
+        [](void *lhs, void *rhs) {
+            return memcmp(lhs, rhs, sizeof(WeldVertex)) == 0;
+        });
+
+    // Reserved up front, the writer had to rebuild the map whenever the buffer grew
+    outVertices->reserve(corners.size());
+    for (auto const &corner : corners) {
+        void *key = const_cast<WeldVertex*>(&corner);
+        auto found = uniqueVertices.find(key);
+        if (found == uniqueVertices.end()) {
+            uint32_t newIndex = static_cast<uint32_t>(outVertices->size());
+            outVertices->push_back(corner);
+            found = uniqueVertices.insert(found, std::make_pair(reinterpret_cast<void*>(&outVertices->back()), newIndex));
+        }
+        outIndices->push_back(found->second);
+    }
+}
+
+void WeldWithTable(std::vector<WeldVertex> const &corners, std::vector<WeldVertex> *outVertices, std::vector<uint32_t> *outIndices,
+    uint64_t *outProbeCount) {
+    Graphics::VertexWeldTable uniqueVertices;
+    for (auto const &corner : corners) {
+        uint32_t nextIndex = static_cast<uint32_t>(outVertices->size());
+        uint64_t hash = Graphics::HashBytes64(&corner, sizeof(WeldVertex));
+        uint32_t index = uniqueVertices.FindOrInsert(hash, nextIndex, [&](uint32_t storedIndex) {
+            return memcmp(&(*outVertices)[storedIndex], &corner, sizeof(WeldVertex)) == 0;
+        });
+        if (index == nextIndex) {
+            outVertices->push_back(corner);
+        }
+        outIndices->push_back(index);
+    }
+    *outProbeCount = uniqueVertices.GetProbeCount();
+}
+
+} // namespace
+
+// Welding the corners of a 10M corner mesh, with the table as ModelObjVertexWriter uses it and with the map it replaced
+void RunVertexWeldTable() {
+    const size_t CORNER_COUNT = 10000000;
+
+    for (size_t uniqueCount : { CORNER_COUNT / 4, CORNER_COUNT / 2 }) {
+        std::vector<WeldVertex> corners = GenerateCorners(CORNER_COUNT, uniqueCount);
+
+        std::vector<WeldVertex> mapVertices;
+        std::vector<uint32_t> mapIndices;
+        mapIndices.reserve(CORNER_COUNT);
+        auto start = std::chrono::steady_clock::now();
+        WeldWithMap(corners, &mapVertices, &mapIndices);
+        f64 mapSeconds = SecondsSince(start);
+
+        std::vector<WeldVertex> tableVertices;
+        std::vector<uint32_t> tableIndices;
+        tableIndices.reserve(CORNER_COUNT);
+        uint64_t probeCount = 0;
+        start = std::chrono::steady_clock::now();
+        WeldWithTable(corners, &tableVertices, &tableIndices, &probeCount);
+        f64 tableSeconds = SecondsSince(start);
+
+        LOG_INFO("  %zu corners to %zu vertices: map %.3f s, table %.3f s (%.2fx), %.2f probes per corner\n",
+            CORNER_COUNT, tableVertices.size(), mapSeconds, tableSeconds, mapSeconds / tableSeconds, static_cast<f64>(probeCount) / CORNER_COUNT);
+        BENCH_CHECK(tableIndices == mapIndices);
+        BENCH_CHECK(tableVertices.size() == mapVertices.size());
+    }
+}
+
+} // namespace Bench
@@ -0,0 +1,20 @@
+// pch.h: This is a precompiled header file.
+// Files listed below are compiled only once, improving build performance for future builds.
+// Common's headers are built with the same glm settings as the Common library itself.
+
+#ifndef PCH_H
+#define PCH_H
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define GLM_FORCE_LEFT_HANDED
+#include "glm/glm.hpp"
+
+#include "Common.h"
+#include "ErrorCodes.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#endif //PCH_H
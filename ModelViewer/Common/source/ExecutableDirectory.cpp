@@ -0,0 +1,19 @@
+#include "pch.h"
+#include "ExecutableDirectory.h"
+
+namespace Graphics {
+
+std::filesystem::path GetExecutableDirectory() {
+#ifdef _WIN32
+    wchar_t cwd[MAX_PATH];
+    auto ret = GetModuleFileName(NULL, cwd, MAX_PATH);
+    ASSERT(ret != 0);
+    UNUSED_PARAM(ret);
+    std::filesystem::path exePath(cwd);
+    return exePath.parent_path();
+#else
+#error Not Supported
+#endif
+}
+
+} // namespace Graphics
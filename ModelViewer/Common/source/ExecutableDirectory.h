@@ -0,0 +1,10 @@
+#pragma once
+
+#include <filesystem>
+
+namespace Graphics {
+
+// Directory the running executable is in, relative asset and config paths are resolved against it
+std::filesystem::path GetExecutableDirectory();
+
+} // namespace Graphics
@@ -0,0 +1,104 @@
+#include "pch.h"
+#include "Hash.h"
+
+#include <cstring>
+
+namespace Graphics {
+
+namespace {
+
+const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ull;
+const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4Full;
+const uint64_t PRIME64_3 = 0x165667B19E3779F9ull;
+const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ull;
+const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ull;
+
+inline uint64_t RotateLeft(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t Read64(const uint8_t *data) {
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+inline uint32_t Read32(const uint8_t *data) {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+inline uint64_t Round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME64_2;
+    acc = RotateLeft(acc, 31);
+    return acc * PRIME64_1;
+}
+
+inline uint64_t MergeRound(uint64_t acc, uint64_t value) {
+    acc ^= Round(0, value);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+} // namespace
+
+uint64_t HashBytes64(const void *data, size_t dataSize, uint64_t seed) {
+    const uint8_t *cur = reinterpret_cast<const uint8_t*>(data);
+    const uint8_t *end = cur + dataSize;
+    uint64_t hash;
+
+    if (dataSize >= 32) {
+        const uint8_t *limit = end - 32;
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+        uint64_t v2 = seed + PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME64_1;
+
+        do {
+            v1 = Round(v1, Read64(cur));
+            v2 = Round(v2, Read64(cur + 8));
+            v3 = Round(v3, Read64(cur + 16));
+            v4 = Round(v4, Read64(cur + 24));
+            cur += 32;
+        } while (cur <= limit);
+
+        hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+        hash = MergeRound(hash, v1);
+        hash = MergeRound(hash, v2);
+        hash = MergeRound(hash, v3);
+        hash = MergeRound(hash, v4);
+    }
+    else {
+        hash = seed + PRIME64_5;
+    }
+
+    hash += static_cast<uint64_t>(dataSize);
+
+    while (cur + 8 <= end) {
+        hash ^= Round(0, Read64(cur));
+        hash = RotateLeft(hash, 27) * PRIME64_1 + PRIME64_4;
+        cur += 8;
+    }
+
+    if (cur + 4 <= end) {
+        hash ^= static_cast<uint64_t>(Read32(cur)) * PRIME64_1;
+        hash = RotateLeft(hash, 23) * PRIME64_2 + PRIME64_3;
+        cur += 4;
+    }
+
+    while (cur < end) {
+        hash ^= (*cur) * PRIME64_5;
+        hash = RotateLeft(hash, 11) * PRIME64_1;
+        ++cur;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= PRIME64_3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+} // namespace Graphics
@@ -0,0 +1,14 @@
+#pragma once
+
+namespace Graphics {
+
+// Fast non-cryptographic 64-bit hash of a block of memory (xxHash64)
+// Used for content keys of cached assets, so the result must stay stable between versions
+uint64_t HashBytes64(const void *data, size_t dataSize, uint64_t seed = 0);
+
+// Combines a value into an existing hash
+inline uint64_t HashCombine64(uint64_t hash, uint64_t value) {
+    return hash ^ (value + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2));
+}
+
+} // namespace Graphics
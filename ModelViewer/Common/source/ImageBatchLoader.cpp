@@ -0,0 +1,93 @@
+#include "pch.h"
+#include "ImageBatchLoader.h"
+#include "ImageLoader.h"
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace Graphics {
+
+namespace {
+
+const size_t DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024;
+
+} // namespace
+
+ImageBatchLoader::ImageBatchLoader()
+  : m_threadPool(nullptr),
+    m_memoryBudget(DEFAULT_MEMORY_BUDGET),
+    m_nextStartIndex(0),
+    m_memoryInFlight(0),
+    m_peakMemory(0) {
+}
+
+ImageBatchLoader::~ImageBatchLoader() {
+}
+
+void ImageBatchLoader::SetThreadPool(ThreadPool *threadPool) {
+    m_threadPool = threadPool;
+}
+
+void ImageBatchLoader::SetMemoryBudget(size_t memoryBudget) {
+    m_memoryBudget = memoryBudget;
+}
+
+size_t ImageBatchLoader::EstimateDecodeMemory(const void *data, size_t dataSize, uint32_t desiredChannels) {
+    uint32_t width, height, channels;
+    if (!ImageLoader::GetImageInfo(data, dataSize, &width, &height, &channels)) {
+        return 0;
+    }
+    size_t pixelsSize = static_cast<size_t>(width) * height * (desiredChannels ? desiredChannels : channels);
+    return pixelsSize * 2;
+}
+
+void ImageBatchLoader::Run(std::vector<size_t> const &memoryEstimates, DecodeTask const &task) {
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_nextStartIndex = 0;
+        m_memoryInFlight = 0;
+        m_peakMemory = 0;
+    }
+
+    uint32_t imageCount = static_cast<uint32_t>(memoryEstimates.size());
+    auto decodeImage = [this, &memoryEstimates, &task](uint32_t index) {
+        _acquireMemory(index, memoryEstimates[index]);
+        task(index);
+        _releaseMemory(memoryEstimates[index]);
+    };
+
+    if (m_threadPool && imageCount > 1) {
+        // Indices are claimed in order, so every image waiting for memory only waits on images that are already decoding
+        m_threadPool->ParallelFor(imageCount, decodeImage);
+    }
+    else {
+        for (uint32_t i = 0; i < imageCount; ++i) {
+            decodeImage(i);
+        }
+    }
+}
+
+size_t ImageBatchLoader::GetPeakMemory() const {
+    return m_peakMemory;
+}
+
+void ImageBatchLoader::_acquireMemory(uint32_t index, size_t memory) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_memoryReleased.wait(lock, [this, index, memory]() {
+        return index == m_nextStartIndex && (m_memoryInFlight == 0 || m_memoryInFlight + memory <= m_memoryBudget);
+    });
+
+    ++m_nextStartIndex;
+    m_memoryInFlight += memory;
+    m_peakMemory = std::max(m_peakMemory, m_memoryInFlight);
+
+    // The next image may fit alongside this one
+    m_memoryReleased.notify_all();
+}
+
+void ImageBatchLoader::_releaseMemory(size_t memory) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_memoryInFlight -= memory;
+    m_memoryReleased.notify_all();
+}
+
+} // namespace Graphics
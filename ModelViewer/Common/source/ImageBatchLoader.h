@@ -0,0 +1,59 @@
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+
+namespace Graphics {
+
+class ThreadPool;
+
+// Decodes a batch of images in parallel on a thread pool while keeping the memory of the decodes in flight under a budget
+// Images are started in order, each as soon as the budget has room for it, and an image larger than the whole budget
+// is decoded on its own. The calling thread decodes too, so this is safe to use from inside a worker thread
+class ImageBatchLoader {
+public:
+    // Decodes image index on any thread, what it decodes into and where the result goes is up to the task
+    // Tasks hand their image on as soon as it is done, they do not wait for the rest of the batch
+    typedef std::function<void(uint32_t index)> DecodeTask;
+
+public:
+    ImageBatchLoader();
+    ImageBatchLoader(ImageBatchLoader const &) = delete;
+    ImageBatchLoader &operator=(ImageBatchLoader const &) = delete;
+    ~ImageBatchLoader();
+
+    // Decodes on the calling thread only without a pool
+    void SetThreadPool(ThreadPool *threadPool);
+
+    // Bytes that decodes in flight may use together, 256MB by default
+    void SetMemoryBudget(size_t memoryBudget);
+
+    // Memory one image takes while it is decoded to desiredChannels (0 for its own), from its header
+    // Counts the decoded pixels and the decoder's working buffers, which are about as large again
+    // Returns 0 for data that is not a supported image
+    static size_t EstimateDecodeMemory(const void *data, size_t dataSize, uint32_t desiredChannels);
+
+    // Runs task for every image and returns once all are done
+    // memoryEstimates[i] is held from the budget while image i decodes
+    void Run(std::vector<size_t> const &memoryEstimates, DecodeTask const &task);
+
+    // Largest sum of estimates in flight at once during the last Run
+    size_t GetPeakMemory() const;
+
+private:
+    void _acquireMemory(uint32_t index, size_t memory);
+    void _releaseMemory(size_t memory);
+
+private:
+    ThreadPool *m_threadPool;
+    size_t m_memoryBudget;
+
+    std::mutex m_mutex;
+    std::condition_variable m_memoryReleased;
+    uint32_t m_nextStartIndex; // Images start in order, so large images are not starved by smaller ones after them
+    size_t m_memoryInFlight;
+    size_t m_peakMemory;
+};
+
+} // namespace Graphics
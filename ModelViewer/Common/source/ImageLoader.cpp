@@ -1,15 +1,74 @@
 #include "pch.h"
 #include "ImageLoader.h"
+#include "MemoryMappedFile.h"
+#include "ExecutableDirectory.h"
 
+#include <filesystem>
+#include <cstring>
+
+namespace Graphics {
+
+// The JPEG decoder allocates its output with one byte of padding
+static const size_t DECODE_PADDING = 1;
+
+// Memory that stb_image decodes the pixels of the current load into
+// stb_image allocates the output of a load with the size of the pixels, that allocation is served from the destination
+// so no copy is needed afterwards
+struct DecodeDestination {
+    void *Memory;
+    size_t Size; // Of the pixels, the memory has DECODE_PADDING more
+    bool InUse;
+};
+
+static thread_local DecodeDestination s_decodeDestination = { nullptr, 0, false };
+
+static void *_decodeMalloc(size_t size) {
+    DecodeDestination &destination = s_decodeDestination;
+    if (destination.Memory && !destination.InUse && size >= destination.Size && size <= destination.Size + DECODE_PADDING) {
+        destination.InUse = true;
+        return destination.Memory;
+    }
+    return malloc(size);
+}
+
+static void _decodeFree(void *memory) {
+    DecodeDestination &destination = s_decodeDestination;
+    if (memory && memory == destination.Memory) {
+        destination.InUse = false;
+        return;
+    }
+    free(memory);
+}
+
+static void *_decodeRealloc(void *memory, size_t oldSize, size_t newSize) {
+    DecodeDestination &destination = s_decodeDestination;
+    if (!memory || memory != destination.Memory) {
+        return realloc(memory, newSize);
+    }
+
+    // An intermediate buffer was served from the destination, it continues on the heap
+    void *moved = malloc(newSize);
+    if (moved) {
+        memcpy(moved, memory, std::min(oldSize, newSize));
+        destination.InUse = false;
+    }
+    return moved;
+}
+
+} // namespace Graphics
+
+#define STBI_MALLOC(size) Graphics::_decodeMalloc(size)
+#define STBI_REALLOC_SIZED(memory, oldSize, newSize) Graphics::_decodeRealloc(memory, oldSize, newSize)
+#define STBI_FREE(memory) Graphics::_decodeFree(memory)
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb/stb_image.h"
 
-#include <filesystem>
-
 namespace Graphics {
 
 ImageLoader::ImageLoader()
-  : m_width(0),
+  : m_data(nullptr),
+    m_ownsData(false),
+    m_width(0),
     m_height(0),
     m_depth(0),
     m_channels(0) {
@@ -17,7 +76,7 @@ ImageLoader::ImageLoader()
 }
 
 ImageLoader::~ImageLoader() {
-
+    _clear();
 }
 
 std::string const &ImageLoader::GetLastError() const {
@@ -25,64 +84,45 @@ std::string const &ImageLoader::GetLastError() const {
 }
 
 bool ImageLoader::LoadImageFromFile(std::string const &filePath, uint32_t desiredChannels) {
-#ifdef _WIN32
-    wchar_t cwd[MAX_PATH];
-    auto ret = GetModuleFileName(NULL, cwd, MAX_PATH);
-    ASSERT(ret != 0);
-    std::filesystem::path exePath(cwd);
-    exePath = exePath.parent_path();
-#else
-#error Not Supported
-#endif
+    return LoadImageFromFile(filePath, desiredChannels, nullptr);
+}
 
-    int width, height, channels;
-    exePath /= filePath;
-    stbi_uc *imageData = stbi_load(exePath.u8string().c_str(), &width, &height, &channels, desiredChannels);
+bool ImageLoader::LoadImageFromMemory(const void *data, size_t dataSize, uint32_t desiredChannels) {
+    return _decode(data, dataSize, desiredChannels, nullptr);
+}
 
-    if (!imageData) {
-        m_lastError = stbi_failure_reason();
+bool ImageLoader::LoadImageFromFile(std::string const &filePath, uint32_t desiredChannels, DestinationFunc const &destination) {
+    std::filesystem::path exePath = GetExecutableDirectory();
+
+    // Decode straight from the mapped file
+    MemoryMappedFile imageFile;
+    if (!imageFile.Open(exePath /= filePath)) {
+        m_lastError = imageFile.GetLastError();
         return false;
     }
 
-    m_data.resize(width * height * desiredChannels);
-    memcpy(m_data.data(), imageData, m_data.size());
-
-    m_width = width;
-    m_height = height;
-    m_depth = 1;
-    m_channels = desiredChannels;
-
-    stbi_image_free(imageData);
+    return _decode(imageFile.GetData(), imageFile.GetSize(), desiredChannels, destination ? &destination : nullptr);
+}
 
-    m_lastError.clear();
-    return true;
+bool ImageLoader::LoadImageFromMemory(const void *data, size_t dataSize, uint32_t desiredChannels, DestinationFunc const &destination) {
+    return _decode(data, dataSize, desiredChannels, destination ? &destination : nullptr);
 }
 
-bool ImageLoader::LoadImageFromMemory(void *data, size_t dataSize, uint32_t desiredChannels) {
-    int width, height, channels;
-    stbi_uc *imageData = stbi_load_from_memory(reinterpret_cast<stbi_uc*>(data), static_cast<int>(dataSize), &width, &height, &channels, desiredChannels);
+bool ImageLoader::GetImageInfo(const void *data, size_t dataSize, uint32_t *outWidth, uint32_t *outHeight, uint32_t *outChannels) {
+    ASSERT(outWidth && outHeight && outChannels);
 
-    if (!imageData) {
-        m_lastError = stbi_failure_reason();
+    int width, height, channels;
+    if (!stbi_info_from_memory(reinterpret_cast<const stbi_uc*>(data), static_cast<int>(dataSize), &width, &height, &channels)) {
         return false;
     }
-
-    m_data.resize(width * height * desiredChannels);
-    memcpy(m_data.data(), imageData, m_data.size());
-
-    m_width = width;
-    m_height = height;
-    m_depth = 1;
-    m_channels = desiredChannels;
-
-    stbi_image_free(imageData);
-
-    m_lastError.clear();
+    *outWidth = static_cast<uint32_t>(width);
+    *outHeight = static_cast<uint32_t>(height);
+    *outChannels = static_cast<uint32_t>(channels);
     return true;
 }
 
 const void *ImageLoader::GetData() const {
-    return m_data.data();
+    return m_data;
 }
 
 uint32_t ImageLoader::GetWidth() const {
@@ -101,4 +141,86 @@ uint32_t ImageLoader::GetChannels() const {
     return m_channels;
 }
 
+void *ImageLoader::ReleaseData() {
+    ASSERT(m_ownsData);
+    if (!m_ownsData) {
+        return nullptr;
+    }
+
+    void *data = m_data;
+    m_data = nullptr;
+    m_ownsData = false;
+    m_width = m_height = m_depth = m_channels = 0;
+    return data;
+}
+
+void ImageLoader::FreeData(void *data) {
+    stbi_image_free(data);
+}
+
+bool ImageLoader::_decode(const void *data, size_t dataSize, uint32_t desiredChannels, DestinationFunc const *destination) {
+    _clear();
+
+    const stbi_uc *encoded = reinterpret_cast<const stbi_uc*>(data);
+    int encodedSize = static_cast<int>(dataSize);
+
+    // The header gives the size of the pixels before anything is decoded
+    int width, height, channels;
+    if (!stbi_info_from_memory(encoded, encodedSize, &width, &height, &channels)) {
+        m_lastError = stbi_failure_reason();
+        return false;
+    }
+    uint32_t outChannels = desiredChannels ? desiredChannels : static_cast<uint32_t>(channels);
+    size_t outSize = static_cast<size_t>(width) * height * outChannels;
+
+    void *outData = nullptr;
+    if (destination) {
+        outData = (*destination)(width, height, outChannels, outSize + DECODE_PADDING);
+        if (!outData) {
+            m_lastError = "No memory to decode the image into";
+            return false;
+        }
+        s_decodeDestination = { outData, outSize, false };
+    }
+
+    stbi_uc *imageData = stbi_load_from_memory(encoded, encodedSize, &width, &height, &channels, outChannels);
+    s_decodeDestination = { nullptr, 0, false };
+
+    if (!imageData) {
+        m_lastError = stbi_failure_reason();
+        return false;
+    }
+
+    if (destination) {
+        // Only formats that decode through differently sized buffers end up outside the destination
+        if (imageData != outData) {
+            memcpy(outData, imageData, outSize);
+            stbi_image_free(imageData);
+        }
+        m_data = outData;
+        m_ownsData = false;
+    }
+    else {
+        m_data = imageData;
+        m_ownsData = true;
+    }
+
+    m_width = width;
+    m_height = height;
+    m_depth = 1;
+    m_channels = outChannels;
+
+    m_lastError.clear();
+    return true;
+}
+
+void ImageLoader::_clear() {
+    if (m_ownsData) {
+        stbi_image_free(m_data);
+    }
+    m_data = nullptr;
+    m_ownsData = false;
+    m_width = m_height = m_depth = m_channels = 0;
+}
+
 } // namespace Graphics
@@ -1,21 +1,38 @@
 #pragma once
 
+#include <functional>
+
 namespace Graphics {
 
 class ImageLoader {
 public:
-    typedef std::vector<uint8_t> DataArray;
+    // Called once the size of the image is known, before any pixels are decoded
+    // Returns size bytes of memory that the pixels are decoded into, or null to abort the load
+    // size has room for the width * height * channels bytes of pixels plus the padding some decoders allocate
+    typedef std::function<void*(uint32_t width, uint32_t height, uint32_t channels, size_t size)> DestinationFunc;
 
 public:
 
     ImageLoader();
+    ImageLoader(ImageLoader const &) = delete;
+    ImageLoader &operator=(ImageLoader const &) = delete;
     ~ImageLoader();
 
     std::string const &GetLastError() const;
 
     // When loading from file, the image will be loaded with 4 channels (rgba) per pixel
+    // desiredChannels of 0 keeps the image's own channel count
     bool LoadImageFromFile(std::string const &filePath, uint32_t desiredChannels);
-    bool LoadImageFromMemory(void *data, size_t dataSize, uint32_t desiredChannels);
+    bool LoadImageFromMemory(const void *data, size_t dataSize, uint32_t desiredChannels);
+
+    // Decodes into the memory returned by destination instead of memory owned by the loader
+    // Pixels are decoded in place for PNG and JPEG, other formats and rare PNG layouts are decoded aside and copied once
+    // GetData returns the destination afterwards
+    bool LoadImageFromFile(std::string const &filePath, uint32_t desiredChannels, DestinationFunc const &destination);
+    bool LoadImageFromMemory(const void *data, size_t dataSize, uint32_t desiredChannels, DestinationFunc const &destination);
+
+    // Reads the size and channel count from the image header without decoding the pixels
+    static bool GetImageInfo(const void *data, size_t dataSize, uint32_t *outWidth, uint32_t *outHeight, uint32_t *outChannels);
 
     const void *GetData() const;
     uint32_t GetWidth() const;
@@ -23,8 +40,18 @@ public:
     uint32_t GetDepth() const;
     uint32_t GetChannels() const; // Number of 8-bit channels per pixel
 
+    // Hands the decoded pixels over to the caller without copying them, they must be freed with FreeData
+    // Only valid after loading without a destination, the loader holds no image afterwards
+    void *ReleaseData();
+    static void FreeData(void *data);
+
+private:
+    bool _decode(const void *data, size_t dataSize, uint32_t desiredChannels, DestinationFunc const *destination);
+    void _clear();
+
 private:
-    DataArray m_data;
+    void *m_data;
+    bool m_ownsData; // Decoded by stb_image into its own allocation, as opposed to a destination
     uint32_t m_width, m_height, m_depth, m_channels;
     std::string m_lastError;
 
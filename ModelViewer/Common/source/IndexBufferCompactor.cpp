@@ -0,0 +1,132 @@
+#include "pch.h"
+#include "IndexBufferCompactor.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Graphics {
+
+namespace {
+
+const uint32_t MAX_16BIT_SPAN = 0xFFFF;
+
+} // namespace
+
+IndexBufferCompactor::IndexBufferCompactor()
+  : m_allowSplit(false) {
+}
+
+IndexBufferCompactor::~IndexBufferCompactor() {
+}
+
+void IndexBufferCompactor::SetAllowSplit(bool allowSplit) {
+    m_allowSplit = allowSplit;
+}
+
+void IndexBufferCompactor::AddRange(const uint32_t *indices, uint32_t indexCount, int32_t materialId) {
+    ASSERT(indices || indexCount == 0);
+    if (indexCount == 0) {
+        return;
+    }
+
+    auto minMax = std::minmax_element(indices, indices + indexCount);
+    uint32_t minIndex = *minMax.first;
+    uint32_t maxIndex = *minMax.second;
+    if (maxIndex - minIndex <= MAX_16BIT_SPAN || !m_allowSplit || indexCount % 3 != 0) {
+        _writeRange(indices, indexCount, minIndex, maxIndex, materialId);
+        return;
+    }
+
+    // Greedily grow runs of whole triangles while they still fit in 16 bits
+    std::vector<uint32_t> splits;
+    uint32_t runMin = std::numeric_limits<uint32_t>::max();
+    uint32_t runMax = 0;
+    for (uint32_t i = 0; i < indexCount; i += 3) {
+        uint32_t triangleMin = std::min({ indices[i], indices[i + 1], indices[i + 2] });
+        uint32_t triangleMax = std::max({ indices[i], indices[i + 1], indices[i + 2] });
+        uint32_t newMin = std::min(runMin, triangleMin);
+        uint32_t newMax = std::max(runMax, triangleMax);
+        if (newMax - newMin > MAX_16BIT_SPAN) {
+            splits.push_back(i);
+            newMin = triangleMin;
+            newMax = triangleMax;
+        }
+        runMin = newMin;
+        runMax = newMax;
+    }
+
+    // Runs too short to be worth a draw of their own are merged with the short runs around them into one 32-bit range,
+    // so triangles scattered between long runs cost one draw per gap rather than one each
+    auto writeRun = [this, indices, materialId](uint32_t runStart, uint32_t runEnd) {
+        if (runEnd > runStart) {
+            auto runMinMax = std::minmax_element(indices + runStart, indices + runEnd);
+            _writeRange(indices + runStart, runEnd - runStart, *runMinMax.first, *runMinMax.second, materialId);
+        }
+    };
+    splits.push_back(indexCount);
+    uint32_t runStart = 0;
+    uint32_t shortRunsStart = 0;
+    for (uint32_t runEnd : splits) {
+        if (runEnd - runStart >= MIN_SPLIT_TRIANGLES * 3) {
+            writeRun(shortRunsStart, runStart);
+            writeRun(runStart, runEnd);
+            shortRunsStart = runEnd;
+        }
+        runStart = runEnd;
+    }
+    writeRun(shortRunsStart, indexCount);
+}
+
+void IndexBufferCompactor::Clear() {
+    m_data.clear();
+    m_ranges.clear();
+}
+
+const uint8_t *IndexBufferCompactor::GetData() const {
+    return m_data.data();
+}
+
+size_t IndexBufferCompactor::GetDataSize() const {
+    return m_data.size();
+}
+
+uint32_t IndexBufferCompactor::GetRangeCount() const {
+    return static_cast<uint32_t>(m_ranges.size());
+}
+
+const IndexBufferCompactor::Range *IndexBufferCompactor::GetRanges() const {
+    return m_ranges.data();
+}
+
+void IndexBufferCompactor::_writeRange(const uint32_t *indices, uint32_t indexCount, uint32_t minIndex, uint32_t maxIndex, int32_t materialId) {
+    ASSERT(m_data.size() % 4 == 0);
+
+    Range range;
+    range.IndexCount = indexCount;
+    range.MaterialId = materialId;
+
+    size_t byteOffset = m_data.size();
+    if (maxIndex - minIndex <= MAX_16BIT_SPAN) {
+        range.IndexSize = sizeof(uint16_t);
+        range.BaseVertex = minIndex;
+
+        // Pad to keep the next range aligned for 32-bit indices
+        size_t byteSize = (static_cast<size_t>(indexCount) * sizeof(uint16_t) + 3) & ~static_cast<size_t>(3);
+        m_data.resize(byteOffset + byteSize, 0);
+        uint16_t *out = reinterpret_cast<uint16_t*>(m_data.data() + byteOffset);
+        for (uint32_t i = 0; i < indexCount; ++i) {
+            out[i] = static_cast<uint16_t>(indices[i] - minIndex);
+        }
+    }
+    else {
+        range.IndexSize = sizeof(uint32_t);
+        range.BaseVertex = 0;
+
+        m_data.resize(byteOffset + static_cast<size_t>(indexCount) * sizeof(uint32_t));
+        memcpy(m_data.data() + byteOffset, indices, static_cast<size_t>(indexCount) * sizeof(uint32_t));
+    }
+    range.FirstIndex = static_cast<uint32_t>(byteOffset / range.IndexSize);
+
+    m_ranges.push_back(range);
+}
+
+} // namespace Graphics
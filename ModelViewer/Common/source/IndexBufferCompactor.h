@@ -0,0 +1,51 @@
+#pragma once
+
+namespace Graphics {
+
+// Re-encodes 32-bit index ranges with the narrowest index type each range allows
+// A range whose vertices span at most 65536 vertices is stored as 16-bit indices relative to its lowest vertex,
+// which is then added back when drawing (the base vertex). Larger ranges are either kept as 32-bit indices or,
+// when splitting is enabled, split into consecutive runs of triangles that each fit in 16 bits, with the triangles
+// between those runs kept as 32-bit ranges
+// Every range starts on a 4 byte boundary so the whole buffer can be bound at offset 0 with either index type
+class IndexBufferCompactor {
+public:
+    struct Range {
+        uint32_t FirstIndex; // In units of IndexSize from the start of the data
+        uint32_t IndexCount;
+        uint32_t IndexSize;  // 2 or 4
+        uint32_t BaseVertex; // Added to every index of the range
+        int32_t MaterialId;
+    };
+
+public:
+    IndexBufferCompactor();
+    IndexBufferCompactor(IndexBufferCompactor const &) = delete;
+    IndexBufferCompactor &operator=(IndexBufferCompactor const &) = delete;
+    ~IndexBufferCompactor();
+
+    // Splitting only applies to triangle lists, 16-bit runs have at least MIN_SPLIT_TRIANGLES triangles
+    void SetAllowSplit(bool allowSplit);
+
+    // Appends one range of 32-bit indices, which may become more than one compacted range
+    void AddRange(const uint32_t *indices, uint32_t indexCount, int32_t materialId);
+    void Clear();
+
+    const uint8_t *GetData() const;
+    size_t GetDataSize() const;
+
+    uint32_t GetRangeCount() const;
+    const Range *GetRanges() const;
+
+private:
+    static const uint32_t MIN_SPLIT_TRIANGLES = 1024;
+
+    void _writeRange(const uint32_t *indices, uint32_t indexCount, uint32_t minIndex, uint32_t maxIndex, int32_t materialId);
+
+private:
+    bool m_allowSplit;
+    std::vector<uint8_t> m_data;
+    std::vector<Range> m_ranges;
+};
+
+} // namespace Graphics
@@ -1,8 +1,9 @@
 #include "pch.h"
 #include "JsonRendererRequirementsImpl.h"
+#include "MemoryMappedFile.h"
+#include "ExecutableDirectory.h"
 #include "rapidjson/istreamwrapper.h"
 #include "rapidjson/pointer.h"
-#include <fstream>
 #include <filesystem>
 
 namespace Graphics {
@@ -18,19 +19,16 @@ JsonRendererRequirementsImpl::~JsonRendererRequirementsImpl() {
 }
 
 void JsonRendererRequirementsImpl::Initialize(std::string const &settingsFilePath) {
-#ifdef _WIN32
-    wchar_t cwd[MAX_PATH];
-    auto ret = GetModuleFileName(NULL, cwd, MAX_PATH);
-    ASSERT(ret != 0);
-    std::filesystem::path exePath(cwd);
-    exePath = exePath.parent_path();
-#else
-#error Not Supported
-#endif
-    std::ifstream jsonFile(exePath /= settingsFilePath);
-    ASSERT_MSG(!jsonFile.fail() && jsonFile.is_open(), L"Invalid file path when parsing renderer requirements: %hs", settingsFilePath.c_str());
-    Initialize(jsonFile);
-    jsonFile.close();
+    std::filesystem::path exePath = GetExecutableDirectory();
+    MemoryMappedFile jsonFile;
+    bool opened = jsonFile.Open(exePath /= settingsFilePath);
+    ASSERT_MSG(opened, L"Invalid file path when parsing renderer requirements: %hs", settingsFilePath.c_str());
+    UNUSED_PARAM(opened);
+
+    // Parse straight from the mapped file
+    m_document = new rapidjson::Document;
+    m_document->Parse(reinterpret_cast<const char*>(jsonFile.GetData()), jsonFile.GetSize());
+    ASSERT_MSG(!m_document->HasParseError(), L"Invalid JSON stream when parsing renderer requirements");
 }
 
 void JsonRendererRequirementsImpl::Initialize(std::istream &dataStream) {
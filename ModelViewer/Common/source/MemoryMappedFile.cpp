@@ -0,0 +1,178 @@
+#include "pch.h"
+#include "MemoryMappedFile.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Graphics {
+
+MemoryMappedFile::MemoryMappedFile()
+  : m_data(nullptr),
+    m_size(0),
+    m_isOpen(false),
+#ifdef _WIN32
+    m_fileHandle(INVALID_HANDLE_VALUE),
+    m_mappingHandle(NULL) {
+#else
+    m_fileDescriptor(-1) {
+#endif
+}
+
+MemoryMappedFile::MemoryMappedFile(MemoryMappedFile &&other) noexcept
+  : MemoryMappedFile() {
+    _moveFrom(other);
+}
+
+MemoryMappedFile &MemoryMappedFile::operator=(MemoryMappedFile &&other) noexcept {
+    if (this != &other) {
+        Close();
+        _moveFrom(other);
+    }
+    return *this;
+}
+
+MemoryMappedFile::~MemoryMappedFile() {
+    Close();
+}
+
+std::string const &MemoryMappedFile::GetLastError() const {
+    return m_lastError;
+}
+
+bool MemoryMappedFile::Open(std::filesystem::path const &filePath) {
+    Close();
+
+#ifdef _WIN32
+    m_fileHandle = CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (m_fileHandle == INVALID_HANDLE_VALUE) {
+        m_lastError = "Unable to open file: " + filePath.u8string();
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(m_fileHandle, &fileSize)) {
+        m_lastError = "Unable to query file size: " + filePath.u8string();
+        Close();
+        return false;
+    }
+    m_size = static_cast<size_t>(fileSize.QuadPart);
+
+    // Zero sized files cannot be mapped
+    if (m_size > 0) {
+        m_mappingHandle = CreateFileMappingW(m_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (m_mappingHandle == NULL) {
+            m_lastError = "Unable to create file mapping: " + filePath.u8string();
+            Close();
+            return false;
+        }
+
+        m_data = reinterpret_cast<const uint8_t*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+        if (!m_data) {
+            m_lastError = "Unable to map view of file: " + filePath.u8string();
+            Close();
+            return false;
+        }
+    }
+#else
+    m_fileDescriptor = open(filePath.c_str(), O_RDONLY);
+    if (m_fileDescriptor == -1) {
+        m_lastError = "Unable to open file: " + filePath.u8string();
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(m_fileDescriptor, &fileStat) != 0) {
+        m_lastError = "Unable to query file size: " + filePath.u8string();
+        Close();
+        return false;
+    }
+    m_size = static_cast<size_t>(fileStat.st_size);
+
+    // Zero sized files cannot be mapped
+    if (m_size > 0) {
+        void *mapped = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fileDescriptor, 0);
+        if (mapped == MAP_FAILED) {
+            m_lastError = "Unable to map file: " + filePath.u8string();
+            Close();
+            return false;
+        }
+        madvise(mapped, m_size, MADV_SEQUENTIAL);
+        m_data = reinterpret_cast<const uint8_t*>(mapped);
+    }
+#endif
+
+    m_isOpen = true;
+    m_lastError.clear();
+    return true;
+}
+
+void MemoryMappedFile::Close() {
+#ifdef _WIN32
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mappingHandle != NULL) {
+        CloseHandle(m_mappingHandle);
+        m_mappingHandle = NULL;
+    }
+    if (m_fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_fileHandle);
+        m_fileHandle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (m_data) {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+    if (m_fileDescriptor != -1) {
+        close(m_fileDescriptor);
+        m_fileDescriptor = -1;
+    }
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_isOpen = false;
+}
+
+bool MemoryMappedFile::IsOpen() const {
+    return m_isOpen;
+}
+
+const uint8_t *MemoryMappedFile::GetData() const {
+    return m_data;
+}
+
+size_t MemoryMappedFile::GetSize() const {
+    return m_size;
+}
+
+void MemoryMappedFile::_moveFrom(MemoryMappedFile &other) {
+    m_data = other.m_data;
+    m_size = other.m_size;
+    m_isOpen = other.m_isOpen;
+#ifdef _WIN32
+    m_fileHandle = other.m_fileHandle;
+    m_mappingHandle = other.m_mappingHandle;
+    other.m_fileHandle = INVALID_HANDLE_VALUE;
+    other.m_mappingHandle = NULL;
+#else
+    m_fileDescriptor = other.m_fileDescriptor;
+    other.m_fileDescriptor = -1;
+#endif
+    m_lastError = std::move(other.m_lastError);
+
+    other.m_data = nullptr;
+    other.m_size = 0;
+    other.m_isOpen = false;
+}
+
+MemoryStreamBuffer::MemoryStreamBuffer(const void *data, size_t dataSize) {
+    char *begin = const_cast<char*>(reinterpret_cast<const char*>(data));
+    setg(begin, begin, begin + dataSize);
+}
+
+} // namespace Graphics
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <filesystem>
+#include <streambuf>
+
+namespace Graphics {
+
+// Read-only view of a whole file mapped into memory
+// Parsers can read straight from the mapped pages instead of copying the file into a buffer first
+class MemoryMappedFile {
+public:
+    MemoryMappedFile();
+    MemoryMappedFile(MemoryMappedFile const &) = delete;
+    MemoryMappedFile &operator=(MemoryMappedFile const &) = delete;
+    MemoryMappedFile(MemoryMappedFile &&other) noexcept;
+    MemoryMappedFile &operator=(MemoryMappedFile &&other) noexcept;
+    ~MemoryMappedFile();
+
+    std::string const &GetLastError() const;
+
+    // Maps the entire file, closing any previously opened file
+    // Empty files open successfully with a null data pointer
+    bool Open(std::filesystem::path const &filePath);
+    void Close();
+
+    bool IsOpen() const;
+    const uint8_t *GetData() const;
+    size_t GetSize() const;
+
+private:
+    void _moveFrom(MemoryMappedFile &other);
+
+private:
+    const uint8_t *m_data;
+    size_t m_size;
+    bool m_isOpen;
+#ifdef _WIN32
+    HANDLE m_fileHandle;
+    HANDLE m_mappingHandle;
+#else
+    int m_fileDescriptor;
+#endif
+    std::string m_lastError;
+};
+
+// Read-only stream buffer over a block of memory
+// Allows mapped files to be handed to parsers that only accept std::istream without copying them
+class MemoryStreamBuffer : public std::streambuf {
+public:
+    MemoryStreamBuffer(const void *data, size_t dataSize);
+};
+
+} // namespace Graphics
@@ -0,0 +1,349 @@
+#include "pch.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Graphics {
+
+namespace {
+
+// Vertex indices of a range relative to its lowest index, so per-vertex arrays only cover the span actually used
+struct VertexSpan {
+    uint32_t MinIndex;
+    uint32_t Count;
+};
+
+VertexSpan GetVertexSpan(const uint32_t *indices, size_t indexCount) {
+    if (indexCount == 0) {
+        return { 0, 0 };
+    }
+    auto minMax = std::minmax_element(indices, indices + indexCount);
+    return { *minMax.first, *minMax.second - *minMax.first + 1 };
+}
+
+// FIFO post-transform cache where a vertex is a hit if it was transformed within the last cacheSize misses
+class FifoCacheSimulator {
+public:
+    FifoCacheSimulator(uint32_t vertexCount, uint32_t cacheSize)
+      : m_cacheTimes(vertexCount, 0),
+        m_cacheSize(cacheSize),
+        m_time(cacheSize + 1) {
+    }
+
+    // Returns true on a miss
+    bool Access(uint32_t vertex) {
+        if (m_time - m_cacheTimes[vertex] > m_cacheSize) {
+            m_cacheTimes[vertex] = m_time++;
+            return true;
+        }
+        return false;
+    }
+
+    // Empties the cache
+    void Flush() {
+        m_time += m_cacheSize + 1;
+    }
+
+private:
+    std::vector<uint32_t> m_cacheTimes;
+    uint32_t m_cacheSize;
+    uint32_t m_time;
+};
+
+// Triangles using each vertex, stored as one array with offsets per vertex
+struct TriangleAdjacency {
+    std::vector<uint32_t> Offsets;
+    std::vector<uint32_t> Triangles;
+};
+
+void BuildAdjacency(const uint32_t *indices, size_t indexCount, VertexSpan const &span, TriangleAdjacency *outAdjacency) {
+    outAdjacency->Offsets.assign(static_cast<size_t>(span.Count) + 1, 0);
+    for (size_t i = 0; i < indexCount; ++i) {
+        ++outAdjacency->Offsets[indices[i] - span.MinIndex + 1];
+    }
+    for (uint32_t v = 0; v < span.Count; ++v) {
+        outAdjacency->Offsets[v + 1] += outAdjacency->Offsets[v];
+    }
+
+    std::vector<uint32_t> fill(outAdjacency->Offsets.begin(), outAdjacency->Offsets.end() - 1);
+    outAdjacency->Triangles.resize(indexCount);
+    for (size_t i = 0; i < indexCount; ++i) {
+        outAdjacency->Triangles[fill[indices[i] - span.MinIndex]++] = static_cast<uint32_t>(i / 3);
+    }
+}
+
+glm::vec3 ReadPosition(const uint8_t *vertexData, uint32_t vertexStride, uint32_t positionOffset, uint32_t vertex) {
+    glm::vec3 position;
+    memcpy(&position, vertexData + static_cast<size_t>(vertex) * vertexStride + positionOffset, sizeof(position));
+    return position;
+}
+
+} // namespace
+
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t *indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+    ASSERT(indexCount % 3 == 0);
+
+    VertexCacheStatistics statistics{};
+    statistics.TriangleCount = static_cast<uint32_t>(indexCount / 3);
+
+    VertexSpan span = GetVertexSpan(indices, indexCount);
+    ASSERT(indexCount == 0 || span.MinIndex + span.Count <= vertexCount);
+    UNUSED_PARAM(vertexCount);
+
+    FifoCacheSimulator cache(span.Count, cacheSize);
+    std::vector<bool> referenced(span.Count, false);
+    for (size_t i = 0; i < indexCount; ++i) {
+        uint32_t vertex = indices[i] - span.MinIndex;
+        if (cache.Access(vertex)) {
+            ++statistics.CacheMisses;
+        }
+        if (!referenced[vertex]) {
+            referenced[vertex] = true;
+            ++statistics.VertexCount;
+        }
+    }
+
+    if (statistics.TriangleCount > 0) {
+        statistics.ACMR = static_cast<f32>(statistics.CacheMisses) / statistics.TriangleCount;
+        statistics.ATVR = static_cast<f32>(statistics.CacheMisses) / statistics.VertexCount;
+    }
+    return statistics;
+}
+
+void OptimizeVertexCache(uint32_t *indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+    ASSERT(indexCount % 3 == 0);
+    if (indexCount == 0) {
+        return;
+    }
+
+    VertexSpan span = GetVertexSpan(indices, indexCount);
+    ASSERT(span.MinIndex + span.Count <= vertexCount);
+    UNUSED_PARAM(vertexCount);
+
+    TriangleAdjacency adjacency;
+    BuildAdjacency(indices, indexCount, span, &adjacency);
+
+    // Triangles not yet emitted for each vertex
+    std::vector<uint32_t> liveTriangles(span.Count);
+    for (uint32_t v = 0; v < span.Count; ++v) {
+        liveTriangles[v] = adjacency.Offsets[v + 1] - adjacency.Offsets[v];
+    }
+
+    size_t triangleCount = indexCount / 3;
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> cacheTimes(span.Count, 0);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(indexCount);
+
+    uint32_t time = cacheSize + 1;
+    uint32_t cursor = 0;
+    int64_t fanVertex = indices[0] - span.MinIndex;
+    while (fanVertex >= 0) {
+        // Emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        uint32_t fan = static_cast<uint32_t>(fanVertex);
+        for (uint32_t a = adjacency.Offsets[fan]; a < adjacency.Offsets[fan + 1]; ++a) {
+            uint32_t triangle = adjacency.Triangles[a];
+            if (emitted[triangle]) {
+                continue;
+            }
+            emitted[triangle] = true;
+
+            for (int corner = 0; corner < 3; ++corner) {
+                uint32_t vertex = indices[triangle * 3 + corner] - span.MinIndex;
+                output.push_back(indices[triangle * 3 + corner]);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                --liveTriangles[vertex];
+                if (time - cacheTimes[vertex] > cacheSize) {
+                    cacheTimes[vertex] = time++;
+                }
+            }
+        }
+
+        // Next fan around the candidate that will still be in the cache after its triangles are emitted,
+        // preferring the one that entered the cache earliest
+        fanVertex = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t vertex : candidates) {
+            if (liveTriangles[vertex] == 0) {
+                continue;
+            }
+            int64_t priority = 0;
+            if (time - cacheTimes[vertex] + 2 * liveTriangles[vertex] <= cacheSize) {
+                priority = time - cacheTimes[vertex];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                fanVertex = vertex;
+            }
+        }
+
+        if (fanVertex < 0) {
+            // Dead end, go back to the most recently used vertex that still has triangles
+            while (!deadEnds.empty()) {
+                uint32_t vertex = deadEnds.back();
+                deadEnds.pop_back();
+                if (liveTriangles[vertex] > 0) {
+                    fanVertex = vertex;
+                    break;
+                }
+            }
+        }
+        if (fanVertex < 0) {
+            // Otherwise pick the next vertex in input order that still has triangles
+            while (cursor < span.Count && liveTriangles[cursor] == 0) {
+                ++cursor;
+            }
+            if (cursor < span.Count) {
+                fanVertex = cursor;
+            }
+        }
+    }
+
+    ASSERT(output.size() == indexCount);
+    memcpy(indices, output.data(), indexCount * sizeof(uint32_t));
+}
+
+void OptimizeOverdraw(uint32_t *indices, size_t indexCount, const void *vertexData, size_t vertexCount, uint32_t vertexStride, uint32_t positionOffset,
+                      f32 threshold, uint32_t cacheSize) {
+    ASSERT(indexCount % 3 == 0);
+    ASSERT(vertexData);
+    if (indexCount == 0) {
+        return;
+    }
+
+    VertexSpan span = GetVertexSpan(indices, indexCount);
+    ASSERT(span.MinIndex + span.Count <= vertexCount);
+    UNUSED_PARAM(vertexCount);
+    size_t triangleCount = indexCount / 3;
+
+    // Hard cluster boundaries are where the cache runs dry, a triangle with three misses
+    std::vector<uint32_t> hardBoundaries;
+    {
+        FifoCacheSimulator cache(span.Count, cacheSize);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            int misses = 0;
+            for (int corner = 0; corner < 3; ++corner) {
+                misses += cache.Access(indices[t * 3 + corner] - span.MinIndex) ? 1 : 0;
+            }
+            if (misses == 3 || t == 0) {
+                hardBoundaries.push_back(static_cast<uint32_t>(t));
+            }
+        }
+        hardBoundaries.push_back(static_cast<uint32_t>(triangleCount));
+    }
+
+    // Split hard clusters further wherever the part so far is about as cache efficient as the whole cluster
+    std::vector<uint32_t> clusters;
+    {
+        FifoCacheSimulator cache(span.Count, cacheSize);
+        for (size_t c = 0; c + 1 < hardBoundaries.size(); ++c) {
+            uint32_t clusterStart = hardBoundaries[c];
+            uint32_t clusterEnd = hardBoundaries[c + 1];
+
+            cache.Flush();
+            uint32_t clusterMisses = 0;
+            for (uint32_t t = clusterStart; t < clusterEnd; ++t) {
+                for (int corner = 0; corner < 3; ++corner) {
+                    clusterMisses += cache.Access(indices[t * 3 + corner] - span.MinIndex) ? 1 : 0;
+                }
+            }
+            f32 clusterThreshold = threshold * static_cast<f32>(clusterMisses) / (clusterEnd - clusterStart);
+
+            cache.Flush();
+            uint32_t start = clusterStart;
+            uint32_t misses = 0;
+            clusters.push_back(start);
+            for (uint32_t t = clusterStart; t < clusterEnd; ++t) {
+                for (int corner = 0; corner < 3; ++corner) {
+                    misses += cache.Access(indices[t * 3 + corner] - span.MinIndex) ? 1 : 0;
+                }
+                if (t + 1 < clusterEnd && static_cast<f32>(misses) / (t + 1 - start) <= clusterThreshold) {
+                    start = t + 1;
+                    misses = 0;
+                    clusters.push_back(start);
+                    cache.Flush();
+                }
+            }
+        }
+        clusters.push_back(static_cast<uint32_t>(triangleCount));
+    }
+
+    // Sort clusters by how far they face away from the mesh center, outermost first (Sander et al. 2007)
+    const uint8_t *vertexBytes = reinterpret_cast<const uint8_t*>(vertexData);
+    size_t clusterCount = clusters.size() - 1;
+    std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+    glm::vec3 meshCentroid(0.0f);
+    f32 meshArea = 0.0f;
+    for (size_t c = 0; c < clusterCount; ++c) {
+        f32 clusterArea = 0.0f;
+        for (uint32_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+            glm::vec3 p0 = ReadPosition(vertexBytes, vertexStride, positionOffset, indices[t * 3 + 0]);
+            glm::vec3 p1 = ReadPosition(vertexBytes, vertexStride, positionOffset, indices[t * 3 + 1]);
+            glm::vec3 p2 = ReadPosition(vertexBytes, vertexStride, positionOffset, indices[t * 3 + 2]);
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            f32 area = glm::length(normal);
+
+            clusterCentroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+            clusterNormals[c] += normal;
+            clusterArea += area;
+        }
+
+        meshCentroid += clusterCentroids[c];
+        meshArea += clusterArea;
+        clusterCentroids[c] = clusterArea > 0.0f ? clusterCentroids[c] / clusterArea : glm::vec3(0.0f);
+    }
+    meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : glm::vec3(0.0f);
+
+    std::vector<f32> sortKeys(clusterCount);
+    std::vector<uint32_t> clusterOrder(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        f32 normalLength = glm::length(clusterNormals[c]);
+        sortKeys[c] = normalLength > 0.0f ? glm::dot(clusterCentroids[c] - meshCentroid, clusterNormals[c] / normalLength) : 0.0f;
+        clusterOrder[c] = static_cast<uint32_t>(c);
+    }
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&sortKeys](uint32_t lhs, uint32_t rhs) {
+        return sortKeys[lhs] > sortKeys[rhs];
+    });
+
+    std::vector<uint32_t> output;
+    output.reserve(indexCount);
+    for (uint32_t c : clusterOrder) {
+        output.insert(output.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+    }
+    memcpy(indices, output.data(), indexCount * sizeof(uint32_t));
+}
+
+size_t OptimizeVertexFetchRemap(uint32_t *indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t> *outRemap) {
+    ASSERT(outRemap);
+
+    outRemap->assign(vertexCount, INVALID_REMAP);
+    uint32_t nextVertex = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        ASSERT(indices[i] < vertexCount);
+        uint32_t &newIndex = (*outRemap)[indices[i]];
+        if (newIndex == INVALID_REMAP) {
+            newIndex = nextVertex++;
+        }
+        indices[i] = newIndex;
+    }
+    return nextVertex;
+}
+
+void RemapVertexData(void *dstVertexData, const void *srcVertexData, size_t vertexCount, uint32_t vertexStride, const uint32_t *remap) {
+    ASSERT(dstVertexData != srcVertexData);
+
+    uint8_t *dst = reinterpret_cast<uint8_t*>(dstVertexData);
+    const uint8_t *src = reinterpret_cast<const uint8_t*>(srcVertexData);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        if (remap[i] != INVALID_REMAP) {
+            memcpy(dst + static_cast<size_t>(remap[i]) * vertexStride, src + i * vertexStride, vertexStride);
+        }
+    }
+}
+
+} // namespace Graphics
@@ -0,0 +1,44 @@
+#pragma once
+
+namespace Graphics {
+
+// Post-import optimizations of indexed triangle lists
+// Every function works on 32-bit indices into vertices [0, vertexCount) and only reorders data, so the rendered
+// result is unchanged. Typical use on each submesh is OptimizeVertexCache, then OptimizeOverdraw, and once for
+// the whole mesh OptimizeVertexFetchRemap followed by RemapVertexData
+
+// Post-transform cache behaviour of an index buffer, simulated with a FIFO cache
+struct VertexCacheStatistics {
+    uint32_t TriangleCount;
+    uint32_t VertexCount;  // Distinct vertices referenced
+    uint32_t CacheMisses;  // Vertices transformed
+    f32 ACMR;              // Average cache miss ratio, misses per triangle (0.5 is ideal for large grids, 3 is worst)
+    f32 ATVR;              // Average transform to vertex ratio, misses per distinct vertex (1 is ideal)
+};
+
+// FIFO cache size the optimizations target, close to what current hardware behaves like
+static const uint32_t DEFAULT_VERTEX_CACHE_SIZE = 16;
+
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t *indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = DEFAULT_VERTEX_CACHE_SIZE);
+
+// Reorders triangles for post-transform vertex cache reuse (Tipsify, Sander et al. 2007)
+// Runs in linear time in the number of triangles and the span of vertex indices in the range
+void OptimizeVertexCache(uint32_t *indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = DEFAULT_VERTEX_CACHE_SIZE);
+
+// Reorders clusters of triangles so outward facing parts of the mesh are drawn first, reducing overdraw
+// indices should already be optimized for the vertex cache; clusters are split only where the cache ACMR of a
+// cluster stays within threshold times that of the original cluster, so 1.0 keeps the cache efficiency intact
+// Positions are read as 3 floats at positionOffset in each vertex of vertexStride bytes
+void OptimizeOverdraw(uint32_t *indices, size_t indexCount, const void *vertexData, size_t vertexCount, uint32_t vertexStride, uint32_t positionOffset,
+                      f32 threshold = 1.05f, uint32_t cacheSize = DEFAULT_VERTEX_CACHE_SIZE);
+
+// Renumbers vertices in the order the index buffer first uses them so vertex fetches walk memory linearly
+// indices are rewritten in place and outRemap receives the new index of every old vertex (INVALID_REMAP if unused)
+// Returns the number of vertices still referenced
+static const uint32_t INVALID_REMAP = 0xFFFFFFFF;
+size_t OptimizeVertexFetchRemap(uint32_t *indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t> *outRemap);
+
+// Copies vertices to their remapped positions, unused vertices are dropped
+void RemapVertexData(void *dstVertexData, const void *srcVertexData, size_t vertexCount, uint32_t vertexStride, const uint32_t *remap);
+
+} // namespace Graphics
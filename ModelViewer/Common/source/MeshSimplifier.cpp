@@ -0,0 +1,529 @@
+#include "pch.h"
+#include "MeshSimplifier.h"
+#include "Hash.h"
+#include "VertexWeldTable.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Graphics {
+
+namespace {
+
+const uint32_t INVALID_VERTEX = 0xFFFFFFFF;
+
+// Open edges weigh more on borders so the outline keeps its shape, seams only need to stay in place
+const f64 BORDER_EDGE_WEIGHT = 10.0;
+const f64 SEAM_EDGE_WEIGHT = 1.0;
+
+// Collapses up to this much more expensive than the cheapest ones a pass needs are still taken in the same pass
+const f32 PASS_COST_SLACK = 1.5f;
+
+// Cosine of the largest rotation a collapse may cause to a triangle, larger rotations fold the surface over time
+const f64 MIN_NORMAL_DOT = 0.25;
+
+} // namespace
+
+MeshSimplifier::MeshSimplifier()
+  : m_vertexData(nullptr),
+    m_vertexCount(0),
+    m_vertexStride(0),
+    m_positionOffset(0),
+    m_boundsMin(0.0f),
+    m_extent(0.0f),
+    m_baseVertex(0) {
+}
+
+MeshSimplifier::~MeshSimplifier() {
+}
+
+void MeshSimplifier::SetVertexData(const void *vertexData, size_t vertexCount, uint32_t vertexStride, uint32_t positionOffset) {
+    ASSERT(vertexData || vertexCount == 0);
+    ASSERT(positionOffset + sizeof(glm::vec3) <= vertexStride);
+
+    m_vertexData = reinterpret_cast<const uint8_t*>(vertexData);
+    m_vertexCount = vertexCount;
+    m_vertexStride = vertexStride;
+    m_positionOffset = positionOffset;
+
+    glm::vec3 boundsMin(std::numeric_limits<f32>::max());
+    glm::vec3 boundsMax(std::numeric_limits<f32>::lowest());
+    for (size_t i = 0; i < vertexCount; ++i) {
+        glm::vec3 position = _readPosition(static_cast<uint32_t>(i));
+        boundsMin = glm::min(boundsMin, position);
+        boundsMax = glm::max(boundsMax, position);
+    }
+    m_boundsMin = vertexCount > 0 ? boundsMin : glm::vec3(0.0f);
+    m_extent = vertexCount > 0 ? std::max({ boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z }) : 0.0f;
+}
+
+void MeshSimplifier::AddAttribute(uint32_t offset, uint32_t componentCount, f32 weight) {
+    ASSERT(offset + componentCount * sizeof(f32) <= m_vertexStride);
+    m_attributes.push_back({ offset, componentCount, weight });
+}
+
+f32 MeshSimplifier::GetMeshExtent() const {
+    return m_extent;
+}
+
+f32 MeshSimplifier::Simplify(const uint32_t *indices, size_t indexCount, size_t targetIndexCount, f32 targetError, std::vector<uint32_t> *outIndices) {
+    ASSERT(indexCount % 3 == 0);
+    ASSERT(outIndices);
+
+    outIndices->assign(indices, indices + indexCount);
+    if (indexCount <= targetIndexCount || m_extent <= 0.0f) {
+        return 0.0f;
+    }
+
+    _prepare(indices, indexCount);
+    _classifyVertices(m_currentIndices);
+    _buildQuadrics(m_currentIndices);
+
+    size_t vertexCount = m_positions.size();
+    f64 maxCost = static_cast<f64>(targetError) * targetError;
+    f32 resultError = 0.0f;
+
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> collapseRemap(vertexCount);
+    std::vector<bool> lockedPositions(vertexCount);
+    while (m_currentIndices.size() > targetIndexCount) {
+        _buildTriangleAdjacency(m_currentIndices);
+
+        // Cheapest valid direction of every edge
+        collapses.clear();
+        for (size_t i = 0; i < m_currentIndices.size(); i += 3) {
+            for (int e = 0; e < 3; ++e) {
+                uint32_t a = m_currentIndices[i + e];
+                uint32_t b = m_currentIndices[i + (e + 1) % 3];
+                f32 costAB = _collapseCost(a, b);
+                f32 costBA = _collapseCost(b, a);
+                Collapse collapse = costAB <= costBA ? Collapse{ a, b, costAB } : Collapse{ b, a, costBA };
+                if (collapse.Cost < std::numeric_limits<f32>::max() && collapse.Cost <= maxCost) {
+                    collapses.push_back(collapse);
+                }
+            }
+        }
+        if (collapses.empty()) {
+            break;
+        }
+        std::sort(collapses.begin(), collapses.end(), [](Collapse const &lhs, Collapse const &rhs) {
+            if (lhs.Cost != rhs.Cost) {
+                return lhs.Cost < rhs.Cost;
+            }
+            return lhs.From != rhs.From ? lhs.From < rhs.From : lhs.To < rhs.To;
+        });
+
+        // Collapses of one pass never touch the same triangles, so their costs and flip checks stay accurate
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            collapseRemap[v] = v;
+        }
+        std::fill(lockedPositions.begin(), lockedPositions.end(), false);
+
+        // Each pass only takes the cheaper collapses it needs, the rest are reconsidered with updated costs in the next pass
+        size_t trianglesToRemove = (m_currentIndices.size() - targetIndexCount) / 3;
+        size_t passGoal = std::min(collapses.size(), (trianglesToRemove + 1) / 2);
+        f32 passMaxCost = collapses[passGoal > 0 ? passGoal - 1 : 0].Cost * PASS_COST_SLACK;
+        size_t trianglesRemoved = 0;
+        for (auto const &collapse : collapses) {
+            if (trianglesRemoved >= trianglesToRemove || collapse.Cost > passMaxCost) {
+                break;
+            }
+
+            uint32_t fromPosition = m_positionRemap[collapse.From];
+            uint32_t toPosition = m_positionRemap[collapse.To];
+            if (lockedPositions[fromPosition] || lockedPositions[toPosition] || _flipsTriangle(collapse.From, collapse.To)) {
+                continue;
+            }
+
+            if (m_kinds[collapse.From] == VERTEX_KIND_SEAM) {
+                collapseRemap[m_wedges[collapse.From]] = _seamTarget(collapse.From, collapse.To);
+            }
+            collapseRemap[collapse.From] = collapse.To;
+            _addQuadric(&m_quadrics[toPosition], m_quadrics[fromPosition]);
+
+            // Every triangle around the collapsed vertex changes shape, so none of their vertices may move in this pass
+            for (uint32_t t = m_triangleOffsets[fromPosition]; t < m_triangleOffsets[fromPosition + 1]; ++t) {
+                const uint32_t *corners = &m_currentIndices[static_cast<size_t>(m_triangles[t]) * 3];
+                for (int c = 0; c < 3; ++c) {
+                    lockedPositions[m_positionRemap[corners[c]]] = true;
+                }
+            }
+
+            resultError = std::max(resultError, collapse.Cost);
+            trianglesRemoved += m_kinds[collapse.From] == VERTEX_KIND_BORDER ? 1 : 2;
+        }
+        if (trianglesRemoved == 0) {
+            break;
+        }
+
+        // Drop the triangles that collapsed
+        size_t writeIndex = 0;
+        for (size_t i = 0; i < m_currentIndices.size(); i += 3) {
+            uint32_t a = collapseRemap[m_currentIndices[i + 0]];
+            uint32_t b = collapseRemap[m_currentIndices[i + 1]];
+            uint32_t c = collapseRemap[m_currentIndices[i + 2]];
+            uint32_t positionA = m_positionRemap[a];
+            uint32_t positionB = m_positionRemap[b];
+            uint32_t positionC = m_positionRemap[c];
+            if (positionA == positionB || positionB == positionC || positionA == positionC) {
+                continue;
+            }
+            m_currentIndices[writeIndex++] = a;
+            m_currentIndices[writeIndex++] = b;
+            m_currentIndices[writeIndex++] = c;
+        }
+        m_currentIndices.resize(writeIndex);
+
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            if (m_loop[v] != INVALID_VERTEX) {
+                m_loop[v] = collapseRemap[m_loop[v]];
+            }
+            if (m_loopBack[v] != INVALID_VERTEX) {
+                m_loopBack[v] = collapseRemap[m_loopBack[v]];
+            }
+        }
+    }
+
+    outIndices->resize(m_currentIndices.size());
+    for (size_t i = 0; i < m_currentIndices.size(); ++i) {
+        (*outIndices)[i] = m_currentIndices[i] + m_baseVertex;
+    }
+    return sqrtf(resultError);
+}
+
+void MeshSimplifier::_addPlane(Quadric *quadric, glm::dvec3 const &normal, f64 distance, f64 weight) {
+    quadric->A00 += weight * normal.x * normal.x;
+    quadric->A11 += weight * normal.y * normal.y;
+    quadric->A22 += weight * normal.z * normal.z;
+    quadric->A10 += weight * normal.y * normal.x;
+    quadric->A20 += weight * normal.z * normal.x;
+    quadric->A21 += weight * normal.z * normal.y;
+    quadric->B0 += weight * normal.x * distance;
+    quadric->B1 += weight * normal.y * distance;
+    quadric->B2 += weight * normal.z * distance;
+    quadric->C += weight * distance * distance;
+    quadric->Weight += weight;
+}
+
+void MeshSimplifier::_addQuadric(Quadric *quadric, Quadric const &other) {
+    quadric->A00 += other.A00;
+    quadric->A11 += other.A11;
+    quadric->A22 += other.A22;
+    quadric->A10 += other.A10;
+    quadric->A20 += other.A20;
+    quadric->A21 += other.A21;
+    quadric->B0 += other.B0;
+    quadric->B1 += other.B1;
+    quadric->B2 += other.B2;
+    quadric->C += other.C;
+    quadric->Weight += other.Weight;
+}
+
+f64 MeshSimplifier::_evaluate(Quadric const &quadric, glm::dvec3 const &position) {
+    f64 x = position.x;
+    f64 y = position.y;
+    f64 z = position.z;
+    return quadric.A00 * x * x + quadric.A11 * y * y + quadric.A22 * z * z +
+           2.0 * (quadric.A10 * x * y + quadric.A20 * x * z + quadric.A21 * y * z) +
+           2.0 * (quadric.B0 * x + quadric.B1 * y + quadric.B2 * z) +
+           quadric.C;
+}
+
+glm::vec3 MeshSimplifier::_readPosition(uint32_t vertex) const {
+    glm::vec3 position;
+    memcpy(&position, m_vertexData + static_cast<size_t>(vertex) * m_vertexStride + m_positionOffset, sizeof(position));
+    return position;
+}
+
+f64 MeshSimplifier::_attributeDistance(uint32_t vertex, uint32_t target) const {
+    const uint8_t *vertexData = m_vertexData + static_cast<size_t>(vertex + m_baseVertex) * m_vertexStride;
+    const uint8_t *targetData = m_vertexData + static_cast<size_t>(target + m_baseVertex) * m_vertexStride;
+
+    f64 distance = 0.0;
+    for (auto const &attribute : m_attributes) {
+        f64 attributeDistance = 0.0;
+        for (uint32_t c = 0; c < attribute.ComponentCount; ++c) {
+            f32 a, b;
+            memcpy(&a, vertexData + attribute.Offset + c * sizeof(f32), sizeof(f32));
+            memcpy(&b, targetData + attribute.Offset + c * sizeof(f32), sizeof(f32));
+            attributeDistance += static_cast<f64>(a - b) * (a - b);
+        }
+        distance += attributeDistance * attribute.Weight * attribute.Weight;
+    }
+    return distance;
+}
+
+void MeshSimplifier::_prepare(const uint32_t *indices, size_t indexCount) {
+    // Per vertex data only covers the span of indices in use
+    auto minMax = std::minmax_element(indices, indices + indexCount);
+    m_baseVertex = *minMax.first;
+    uint32_t vertexCount = *minMax.second - m_baseVertex + 1;
+    ASSERT(static_cast<size_t>(*minMax.second) < m_vertexCount);
+
+    m_currentIndices.resize(indexCount);
+    std::vector<bool> referenced(vertexCount, false);
+    for (size_t i = 0; i < indexCount; ++i) {
+        m_currentIndices[i] = indices[i] - m_baseVertex;
+        referenced[m_currentIndices[i]] = true;
+    }
+
+    m_positions.resize(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        m_positions[v] = glm::dvec3(_readPosition(v + m_baseVertex) - m_boundsMin) / static_cast<f64>(m_extent);
+    }
+
+    // Weld referenced vertices by position, each position is represented by its first vertex
+    m_positionRemap.resize(vertexCount);
+    m_wedges.resize(vertexCount);
+    VertexWeldTable positionTable;
+    positionTable.Reserve(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        m_wedges[v] = v;
+        if (!referenced[v]) {
+            m_positionRemap[v] = v;
+            continue;
+        }
+
+        glm::vec3 position = _readPosition(v + m_baseVertex);
+        uint32_t first = positionTable.FindOrInsert(HashBytes64(&position, sizeof(position)), v, [&](uint32_t storedIndex) {
+            glm::vec3 storedPosition = _readPosition(storedIndex + m_baseVertex);
+            return memcmp(&storedPosition, &position, sizeof(position)) == 0;
+        });
+        m_positionRemap[v] = first;
+        if (first != v) {
+            m_wedges[v] = m_wedges[first];
+            m_wedges[first] = v;
+        }
+    }
+}
+
+void MeshSimplifier::_classifyVertices(std::vector<uint32_t> const &indices) {
+    uint32_t vertexCount = static_cast<uint32_t>(m_positions.size());
+
+    // Outgoing half edges of every vertex
+    std::vector<uint32_t> edgeOffsets(static_cast<size_t>(vertexCount) + 1, 0);
+    for (uint32_t index : indices) {
+        ++edgeOffsets[index + 1];
+    }
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        edgeOffsets[v + 1] += edgeOffsets[v];
+    }
+    std::vector<uint32_t> edgeTargets(indices.size());
+    std::vector<uint32_t> fill(edgeOffsets.begin(), edgeOffsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (int e = 0; e < 3; ++e) {
+            edgeTargets[fill[indices[i + e]]++] = indices[i + (e + 1) % 3];
+        }
+    }
+    auto hasEdge = [&](uint32_t from, uint32_t to) {
+        for (uint32_t i = edgeOffsets[from]; i < edgeOffsets[from + 1]; ++i) {
+            if (edgeTargets[i] == to) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // Neighbours across open edges, INVALID_VERTEX if there are none and the vertex itself if there is more than one
+    std::vector<uint32_t> openIncoming(vertexCount, INVALID_VERTEX);
+    std::vector<uint32_t> openOutgoing(vertexCount, INVALID_VERTEX);
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        for (uint32_t i = edgeOffsets[v]; i < edgeOffsets[v + 1]; ++i) {
+            uint32_t target = edgeTargets[i];
+            if (target == v) {
+                openIncoming[v] = v;
+                openOutgoing[v] = v;
+            }
+            else if (!hasEdge(target, v)) {
+                openIncoming[target] = openIncoming[target] == INVALID_VERTEX ? v : target;
+                openOutgoing[v] = openOutgoing[v] == INVALID_VERTEX ? target : v;
+            }
+        }
+    }
+
+    auto hasSingleOpenEdges = [&](uint32_t v) {
+        return openIncoming[v] != INVALID_VERTEX && openIncoming[v] != v && openOutgoing[v] != INVALID_VERTEX && openOutgoing[v] != v;
+    };
+
+    m_kinds.assign(vertexCount, VERTEX_KIND_LOCKED);
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        if (m_positionRemap[v] != v) {
+            continue;
+        }
+
+        uint32_t wedge = m_wedges[v];
+        if (wedge == v) {
+            if (openIncoming[v] == INVALID_VERTEX && openOutgoing[v] == INVALID_VERTEX) {
+                m_kinds[v] = VERTEX_KIND_MANIFOLD;
+            }
+            else if (hasSingleOpenEdges(v)) {
+                m_kinds[v] = VERTEX_KIND_BORDER;
+            }
+        }
+        else if (m_wedges[wedge] == v && hasSingleOpenEdges(v) && hasSingleOpenEdges(wedge)) {
+            // Both copies must run along the same seam in opposite directions
+            if (m_positionRemap[openIncoming[v]] == m_positionRemap[openOutgoing[wedge]] &&
+                m_positionRemap[openOutgoing[v]] == m_positionRemap[openIncoming[wedge]]) {
+                m_kinds[v] = VERTEX_KIND_SEAM;
+            }
+        }
+    }
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        m_kinds[v] = m_kinds[m_positionRemap[v]];
+    }
+
+    m_loop.assign(vertexCount, INVALID_VERTEX);
+    m_loopBack.assign(vertexCount, INVALID_VERTEX);
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        if (m_kinds[v] == VERTEX_KIND_BORDER || m_kinds[v] == VERTEX_KIND_SEAM) {
+            m_loop[v] = openOutgoing[v];
+            m_loopBack[v] = openIncoming[v];
+        }
+    }
+}
+
+void MeshSimplifier::_buildQuadrics(std::vector<uint32_t> const &indices) {
+    m_quadrics.assign(m_positions.size(), Quadric{});
+    m_vertexAreas.assign(m_positions.size(), 0.0);
+
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        uint32_t corners[3] = { indices[i + 0], indices[i + 1], indices[i + 2] };
+        glm::dvec3 p0 = m_positions[corners[0]];
+        glm::dvec3 normal = glm::cross(m_positions[corners[1]] - p0, m_positions[corners[2]] - p0);
+        f64 length = glm::length(normal);
+        if (length <= 0.0) {
+            continue;
+        }
+        normal /= length;
+        f64 area = length * 0.5;
+
+        for (uint32_t corner : corners) {
+            _addPlane(&m_quadrics[m_positionRemap[corner]], normal, -glm::dot(normal, p0), area);
+            m_vertexAreas[corner] += area / 3.0;
+        }
+
+        // Open edges get a plane through the edge perpendicular to the triangle, keeping the edge from moving sideways
+        for (int e = 0; e < 3; ++e) {
+            uint32_t from = corners[e];
+            uint32_t to = corners[(e + 1) % 3];
+            if (m_loop[from] != to) {
+                continue;
+            }
+
+            glm::dvec3 edge = m_positions[to] - m_positions[from];
+            f64 edgeLength = glm::length(edge);
+            glm::dvec3 edgeNormal = glm::cross(edge / edgeLength, normal);
+            f64 weight = edgeLength * edgeLength * (m_kinds[from] == VERTEX_KIND_BORDER ? BORDER_EDGE_WEIGHT : SEAM_EDGE_WEIGHT);
+            f64 distance = -glm::dot(edgeNormal, m_positions[from]);
+            _addPlane(&m_quadrics[m_positionRemap[from]], edgeNormal, distance, weight);
+            _addPlane(&m_quadrics[m_positionRemap[to]], edgeNormal, distance, weight);
+        }
+    }
+}
+
+void MeshSimplifier::_buildTriangleAdjacency(std::vector<uint32_t> const &indices) {
+    m_triangleOffsets.assign(m_positions.size() + 1, 0);
+    for (uint32_t index : indices) {
+        ++m_triangleOffsets[m_positionRemap[index] + 1];
+    }
+    for (size_t v = 0; v < m_positions.size(); ++v) {
+        m_triangleOffsets[v + 1] += m_triangleOffsets[v];
+    }
+
+    m_triangles.resize(indices.size());
+    std::vector<uint32_t> fill(m_triangleOffsets.begin(), m_triangleOffsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        m_triangles[fill[m_positionRemap[indices[i]]]++] = static_cast<uint32_t>(i / 3);
+    }
+}
+
+bool MeshSimplifier::_flipsTriangle(uint32_t from, uint32_t to) const {
+    uint32_t fromPosition = m_positionRemap[from];
+    uint32_t toPosition = m_positionRemap[to];
+    glm::dvec3 const &newPosition = m_positions[to];
+
+    for (uint32_t i = m_triangleOffsets[fromPosition]; i < m_triangleOffsets[fromPosition + 1]; ++i) {
+        const uint32_t *corners = &m_currentIndices[static_cast<size_t>(m_triangles[i]) * 3];
+        glm::dvec3 positions[3];
+        glm::dvec3 newPositions[3];
+        bool collapses = false;
+        for (int c = 0; c < 3; ++c) {
+            uint32_t position = m_positionRemap[corners[c]];
+            collapses |= position == toPosition;
+            positions[c] = m_positions[corners[c]];
+            newPositions[c] = position == fromPosition ? newPosition : positions[c];
+        }
+        if (collapses) {
+            continue;
+        }
+
+        glm::dvec3 normal = glm::cross(positions[1] - positions[0], positions[2] - positions[0]);
+        glm::dvec3 newNormal = glm::cross(newPositions[1] - newPositions[0], newPositions[2] - newPositions[0]);
+        if (glm::dot(normal, newNormal) <= MIN_NORMAL_DOT * glm::length(normal) * glm::length(newNormal)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+f32 MeshSimplifier::_collapseCost(uint32_t from, uint32_t to) const {
+    // Vertices that cannot move, by the kind of the vertex collapsing (rows) and the one collapsed onto (columns)
+    static const bool CAN_COLLAPSE[VERTEX_KIND_COUNT][VERTEX_KIND_COUNT] = {
+        { true, true, true, true },
+        { false, true, false, false },
+        { false, false, true, false },
+        { false, false, false, false },
+    };
+
+    uint32_t fromPosition = m_positionRemap[from];
+    uint32_t toPosition = m_positionRemap[to];
+    uint8_t fromKind = m_kinds[from];
+    if (fromPosition == toPosition || !CAN_COLLAPSE[fromKind][m_kinds[to]]) {
+        return std::numeric_limits<f32>::max();
+    }
+
+    // Borders and seams only move along themselves
+    uint32_t seamTarget = INVALID_VERTEX;
+    if (fromKind == VERTEX_KIND_BORDER || fromKind == VERTEX_KIND_SEAM) {
+        if (m_loop[from] != to && m_loopBack[from] != to) {
+            return std::numeric_limits<f32>::max();
+        }
+        if (fromKind == VERTEX_KIND_SEAM) {
+            seamTarget = _seamTarget(from, to);
+            if (seamTarget == INVALID_VERTEX || m_positionRemap[seamTarget] != toPosition) {
+                return std::numeric_limits<f32>::max();
+            }
+        }
+    }
+
+    Quadric quadric = m_quadrics[fromPosition];
+    _addQuadric(&quadric, m_quadrics[toPosition]);
+    f64 cost = quadric.Weight > 0.0 ? std::max(_evaluate(quadric, m_positions[to]), 0.0) / quadric.Weight : 0.0;
+    if (!m_attributes.empty()) {
+        cost += _attributeDistance(from, to);
+        if (seamTarget != INVALID_VERTEX) {
+            cost += _attributeDistance(m_wedges[from], seamTarget);
+        }
+    }
+    return static_cast<f32>(cost);
+}
+
+uint32_t MeshSimplifier::_seamTarget(uint32_t from, uint32_t to) const {
+    // The other copy moves the same way along its side of the seam, which runs in the opposite direction
+    uint32_t wedge = m_wedges[from];
+    return m_loop[from] == to ? m_loopBack[wedge] : m_loop[wedge];
+}
+
+uint32_t SelectLodLevel(const f32 *lodErrors, uint32_t lodCount, f32 distance, f32 projectionScale, f32 viewportHeight, f32 maxPixelError) {
+    ASSERT(lodErrors || lodCount == 0);
+
+    // Pixels covered by one model unit at this distance
+    f32 pixelsPerUnit = projectionScale * viewportHeight * 0.5f / std::max(distance, std::numeric_limits<f32>::epsilon());
+    for (uint32_t lod = lodCount; lod > 1; --lod) {
+        if (lodErrors[lod - 1] * pixelsPerUnit <= maxPixelError) {
+            return lod - 1;
+        }
+    }
+    return 0;
+}
+
+} // namespace Graphics
@@ -0,0 +1,107 @@
+#pragma once
+
+namespace Graphics {
+
+// Reduces the triangle count of indexed triangle lists with quadric error metric edge collapses (Garland and Heckbert 1997)
+// Vertices only ever collapse onto one of their neighbours, so every simplified index list keeps using the original
+// vertex buffer and LOD levels can share it
+// Vertices sharing a position with different attributes (UV or normal seams) only move along the seam with all of their
+// copies, open borders only move along the border and anything more complex stays in place
+// The result only depends on the input, so the same mesh always simplifies to the same indices
+class MeshSimplifier {
+public:
+    MeshSimplifier();
+    MeshSimplifier(MeshSimplifier const &) = delete;
+    MeshSimplifier &operator=(MeshSimplifier const &) = delete;
+    ~MeshSimplifier();
+
+    // Vertices the indices refer to, positions are read as 3 floats at positionOffset
+    // Errors are measured relative to the largest extent of these vertices
+    void SetVertexData(const void *vertexData, size_t vertexCount, uint32_t vertexStride, uint32_t positionOffset);
+
+    // Float attributes to preserve, a difference of 1 in every component costs as much as moving by weight times the mesh extent
+    void AddAttribute(uint32_t offset, uint32_t componentCount, f32 weight);
+
+    // Largest extent of the vertex data, converts relative errors to model units
+    f32 GetMeshExtent() const;
+
+    // Simplifies towards targetIndexCount indices without any collapse exceeding targetError (relative to the mesh extent)
+    // Writes the remaining triangles to outIndices and returns the largest error of the collapses made
+    f32 Simplify(const uint32_t *indices, size_t indexCount, size_t targetIndexCount, f32 targetError, std::vector<uint32_t> *outIndices);
+
+private:
+    // Symmetric 4x4 matrix of the summed squared distances to planes, weighted by area
+    struct Quadric {
+        f64 A00, A11, A22, A10, A20, A21;
+        f64 B0, B1, B2;
+        f64 C;
+        f64 Weight;
+    };
+
+    struct Attribute {
+        uint32_t Offset;
+        uint32_t ComponentCount;
+        f32 Weight;
+    };
+
+    // How a vertex may move
+    enum VertexKind : uint8_t {
+        VERTEX_KIND_MANIFOLD = 0, // Can collapse onto any neighbour
+        VERTEX_KIND_BORDER,       // Single open border through the vertex, collapses along it
+        VERTEX_KIND_SEAM,         // Two copies with different attributes, collapses along the seam
+        VERTEX_KIND_LOCKED,       // Never moves
+
+        VERTEX_KIND_COUNT
+    };
+
+    struct Collapse {
+        uint32_t From;
+        uint32_t To;
+        f32 Cost;
+    };
+
+    static void _addPlane(Quadric *quadric, glm::dvec3 const &normal, f64 distance, f64 weight);
+    static void _addQuadric(Quadric *quadric, Quadric const &other);
+    static f64 _evaluate(Quadric const &quadric, glm::dvec3 const &position);
+
+    glm::vec3 _readPosition(uint32_t vertex) const;
+    f64 _attributeDistance(uint32_t vertex, uint32_t target) const;
+
+    void _prepare(const uint32_t *indices, size_t indexCount);
+    void _classifyVertices(std::vector<uint32_t> const &indices);
+    void _buildQuadrics(std::vector<uint32_t> const &indices);
+    void _buildTriangleAdjacency(std::vector<uint32_t> const &indices);
+    bool _flipsTriangle(uint32_t from, uint32_t to) const;
+    f32 _collapseCost(uint32_t from, uint32_t to) const;
+    uint32_t _seamTarget(uint32_t from, uint32_t to) const;
+
+private:
+    const uint8_t *m_vertexData;
+    size_t m_vertexCount;
+    uint32_t m_vertexStride;
+    uint32_t m_positionOffset;
+    glm::vec3 m_boundsMin;
+    f32 m_extent;
+    std::vector<Attribute> m_attributes;
+
+    // Per simplification, indexed by vertex relative to the lowest index in use
+    uint32_t m_baseVertex;
+    std::vector<glm::dvec3> m_positions;       // Normalized to the mesh extent
+    std::vector<uint32_t> m_positionRemap;     // First vertex with the same position
+    std::vector<uint32_t> m_wedges;            // Circular list of the vertices sharing a position
+    std::vector<uint8_t> m_kinds;
+    std::vector<uint32_t> m_loop;              // Next vertex along the open edge of border and seam vertices
+    std::vector<uint32_t> m_loopBack;          // Previous vertex along the open edge
+    std::vector<Quadric> m_quadrics;           // Per position
+    std::vector<f64> m_vertexAreas;            // Area around each vertex, weighs its attribute error
+    std::vector<uint32_t> m_triangleOffsets;   // Triangles around each position
+    std::vector<uint32_t> m_triangles;
+    std::vector<uint32_t> m_currentIndices;
+};
+
+// Picks the coarsest LOD level whose error, projected to the screen, stays within maxPixelError
+// lodErrors are in model units, increasing from level 0 (full detail); distance is from the camera to the closest point of
+// the object in the same units; projectionScale is element [1][1] of the projection matrix and viewportHeight in pixels
+uint32_t SelectLodLevel(const f32 *lodErrors, uint32_t lodCount, f32 distance, f32 projectionScale, f32 viewportHeight, f32 maxPixelError);
+
+} // namespace Graphics
@@ -0,0 +1,230 @@
+#include "pch.h"
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Graphics {
+
+namespace {
+
+// Cones wider than this (the cosine of the widest angle between a triangle normal and the axis) cannot be culled
+// often enough to be worth testing
+const f32 MIN_CONE_SPREAD = 0.1f;
+
+} // namespace
+
+MeshletBuilder::MeshletBuilder()
+  : m_vertexData(nullptr),
+    m_vertexCount(0),
+    m_vertexStride(0),
+    m_positionOffset(0) {
+}
+
+MeshletBuilder::~MeshletBuilder() {
+}
+
+void MeshletBuilder::SetVertexData(const void *vertexData, size_t vertexCount, uint32_t vertexStride, uint32_t positionOffset) {
+    ASSERT(vertexData || vertexCount == 0);
+    ASSERT(positionOffset + sizeof(glm::vec3) <= vertexStride);
+
+    m_vertexData = reinterpret_cast<const uint8_t*>(vertexData);
+    m_vertexCount = vertexCount;
+    m_vertexStride = vertexStride;
+    m_positionOffset = positionOffset;
+    m_vertexMeshlet.assign(vertexCount, 0);
+}
+
+void MeshletBuilder::AddRange(const uint32_t *indices, uint32_t firstIndex, uint32_t indexCount, int32_t materialId) {
+    ASSERT(indices || indexCount == 0);
+    ASSERT(indexCount % 3 == 0);
+
+    // Vertices are tagged with the meshlet being built so membership checks are a single lookup
+    uint32_t meshletStart = 0;
+    uint32_t meshletTag = static_cast<uint32_t>(m_meshlets.size()) + 1;
+    m_meshletVertices.clear();
+    for (uint32_t i = 0; i < indexCount; i += 3) {
+        uint32_t a = indices[i + 0];
+        uint32_t b = indices[i + 1];
+        uint32_t c = indices[i + 2];
+        ASSERT(a < m_vertexCount && b < m_vertexCount && c < m_vertexCount);
+
+        uint32_t newVertexCount = (m_vertexMeshlet[a] != meshletTag ? 1 : 0) +
+                                  (m_vertexMeshlet[b] != meshletTag && b != a ? 1 : 0) +
+                                  (m_vertexMeshlet[c] != meshletTag && c != a && c != b ? 1 : 0);
+        if (m_meshletVertices.size() + newVertexCount > MAX_VERTICES || (i - meshletStart) / 3 == MAX_TRIANGLES) {
+            _writeMeshlet(indices + meshletStart, firstIndex + meshletStart, (i - meshletStart) / 3, materialId);
+            meshletStart = i;
+            meshletTag = static_cast<uint32_t>(m_meshlets.size()) + 1;
+            m_meshletVertices.clear();
+        }
+
+        for (uint32_t vertex : { a, b, c }) {
+            if (m_vertexMeshlet[vertex] != meshletTag) {
+                m_vertexMeshlet[vertex] = meshletTag;
+                m_meshletVertices.push_back(vertex);
+            }
+        }
+    }
+
+    if (meshletStart < indexCount) {
+        _writeMeshlet(indices + meshletStart, firstIndex + meshletStart, (indexCount - meshletStart) / 3, materialId);
+    }
+}
+
+void MeshletBuilder::Clear() {
+    m_meshlets.clear();
+    std::fill(m_vertexMeshlet.begin(), m_vertexMeshlet.end(), 0);
+}
+
+uint32_t MeshletBuilder::GetMeshletCount() const {
+    return static_cast<uint32_t>(m_meshlets.size());
+}
+
+const Meshlet *MeshletBuilder::GetMeshlets() const {
+    return m_meshlets.data();
+}
+
+glm::vec3 MeshletBuilder::_getPosition(uint32_t vertex) const {
+    glm::vec3 position;
+    memcpy(&position, m_vertexData + static_cast<size_t>(vertex) * m_vertexStride + m_positionOffset, sizeof(position));
+    return position;
+}
+
+glm::vec3 MeshletBuilder::_getFrontNormal(const uint32_t *triangle) const {
+    // Front faces are counter clockwise on screen, which after the left handed projection's flip of y means
+    // cross(p1 - p0, p2 - p0) points away from the viewer
+    glm::vec3 p0 = _getPosition(triangle[0]);
+    glm::vec3 normal = glm::cross(_getPosition(triangle[2]) - p0, _getPosition(triangle[1]) - p0);
+    f32 length = glm::length(normal);
+    return length > 0.0f ? normal / length : glm::vec3(0.0f);
+}
+
+void MeshletBuilder::_writeMeshlet(const uint32_t *indices, uint32_t firstIndex, uint32_t triangleCount, int32_t materialId) {
+    ASSERT(!m_meshletVertices.empty());
+
+    Meshlet meshlet{};
+    meshlet.FirstIndex = firstIndex;
+    meshlet.TriangleCount = triangleCount;
+    meshlet.VertexCount = static_cast<uint32_t>(m_meshletVertices.size());
+    meshlet.MaterialId = materialId;
+
+    // Bounding sphere (Ritter), start from two far apart vertices then grow to fit the rest
+    glm::vec3 first = _getPosition(m_meshletVertices[0]);
+    glm::vec3 farthest = first;
+    glm::vec3 opposite = first;
+    f32 maxDistance = 0.0f;
+    for (uint32_t vertex : m_meshletVertices) {
+        glm::vec3 position = _getPosition(vertex);
+        f32 distance = glm::dot(position - first, position - first);
+        if (distance > maxDistance) {
+            maxDistance = distance;
+            farthest = position;
+        }
+    }
+    maxDistance = 0.0f;
+    for (uint32_t vertex : m_meshletVertices) {
+        glm::vec3 position = _getPosition(vertex);
+        f32 distance = glm::dot(position - farthest, position - farthest);
+        if (distance > maxDistance) {
+            maxDistance = distance;
+            opposite = position;
+        }
+    }
+
+    glm::vec3 center = (farthest + opposite) * 0.5f;
+    f32 radius = glm::length(opposite - farthest) * 0.5f;
+    for (uint32_t vertex : m_meshletVertices) {
+        glm::vec3 position = _getPosition(vertex);
+        f32 distance = glm::length(position - center);
+        if (distance > radius) {
+            f32 newRadius = (radius + distance) * 0.5f;
+            center += (position - center) * ((newRadius - radius) / distance);
+            radius = newRadius;
+        }
+    }
+    meshlet.Center = center;
+    meshlet.Radius = radius;
+
+    // Normal cone around the average triangle normal
+    glm::vec3 normalSum(0.0f);
+    for (uint32_t t = 0; t < triangleCount; ++t) {
+        normalSum += _getFrontNormal(indices + t * 3);
+    }
+
+    meshlet.ConeApex = center;
+    meshlet.ConeCutoff = 1.0f;
+    meshlet.ConeAxis = glm::vec3(0.0f);
+    f32 axisLength = glm::length(normalSum);
+    if (axisLength > 0.0f) {
+        glm::vec3 axis = normalSum / axisLength;
+
+        f32 minDot = 1.0f;
+        for (uint32_t t = 0; t < triangleCount && minDot > MIN_CONE_SPREAD; ++t) {
+            glm::vec3 normal = _getFrontNormal(indices + t * 3);
+            if (normal != glm::vec3(0.0f)) {
+                minDot = std::min(minDot, glm::dot(axis, normal));
+            }
+        }
+
+        if (minDot > MIN_CONE_SPREAD) {
+            // Move the apex back until every triangle's plane is in front of it, so the test holds for cameras close to the meshlet
+            f32 maxOffset = 0.0f;
+            for (uint32_t t = 0; t < triangleCount; ++t) {
+                glm::vec3 normal = _getFrontNormal(indices + t * 3);
+                if (normal != glm::vec3(0.0f)) {
+                    maxOffset = std::max(maxOffset, glm::dot(center - _getPosition(indices[t * 3]), normal) / glm::dot(axis, normal));
+                }
+            }
+
+            meshlet.ConeApex = center - axis * maxOffset;
+            meshlet.ConeAxis = axis;
+            meshlet.ConeCutoff = sqrtf(1.0f - minDot * minDot);
+        }
+    }
+
+    m_meshlets.push_back(meshlet);
+}
+
+Frustum ExtractFrustum(glm::mat4x4 const &viewProjection) {
+    // Rows of the matrix, glm is column major
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; ++i) {
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+
+    Frustum frustum;
+    frustum.Planes[0] = rows[3] + rows[0]; // Left
+    frustum.Planes[1] = rows[3] - rows[0]; // Right
+    frustum.Planes[2] = rows[3] + rows[1]; // Bottom
+    frustum.Planes[3] = rows[3] - rows[1]; // Top
+    frustum.Planes[4] = rows[2];           // Near, clip depth starts at 0
+    frustum.Planes[5] = rows[3] - rows[2]; // Far
+
+    // Normalized so distances to the planes are in the same units as the bounding spheres
+    for (auto &plane : frustum.Planes) {
+        f32 length = glm::length(glm::vec3(plane));
+        if (length > 0.0f) {
+            plane /= length;
+        }
+    }
+    return frustum;
+}
+
+bool IsMeshletVisible(Meshlet const &meshlet, Frustum const &frustum, glm::vec3 const &cameraPosition) {
+    for (auto const &plane : frustum.Planes) {
+        if (glm::dot(glm::vec3(plane), meshlet.Center) + plane.w < -meshlet.Radius) {
+            return false;
+        }
+    }
+
+    if (meshlet.ConeCutoff < 1.0f) {
+        glm::vec3 apexDirection = meshlet.ConeApex - cameraPosition;
+        f32 apexDistance = glm::length(apexDirection);
+        if (apexDistance > 0.0f && glm::dot(apexDirection, meshlet.ConeAxis) >= meshlet.ConeCutoff * apexDistance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace Graphics
@@ -0,0 +1,80 @@
+#pragma once
+
+namespace Graphics {
+
+// Cluster of consecutive triangles of an index buffer with the data needed to cull it
+// Front faces are wound like the renderer's, cross(p1 - p0, p2 - p0) pointing away from the viewer
+struct Meshlet {
+    uint32_t FirstIndex; // Into the index buffer the meshlet was built from
+    uint32_t TriangleCount;
+    uint32_t VertexCount; // Distinct vertices referenced
+    int32_t MaterialId;
+
+    // Bounding sphere
+    glm::vec3 Center;
+    f32 Radius;
+
+    // Normal cone, every triangle faces away from viewers inside the cone
+    // ConeCutoff is the sine of the cone's half angle, 1 or more if the triangles spread too much to be culled this way
+    glm::vec3 ConeApex;
+    f32 ConeCutoff;
+    glm::vec3 ConeAxis;
+    f32 Reserved;
+};
+static_assert(sizeof(Meshlet) == 64, "Meshlet is stored in mesh caches, keep it tightly packed");
+
+// View frustum as planes with their normals (xyz) pointing inside and distance in w
+struct Frustum {
+    glm::vec4 Planes[6];
+};
+
+// Splits index ranges into meshlets of at most MAX_VERTICES vertices and MAX_TRIANGLES triangles
+// Triangles are taken in order so each meshlet is one contiguous part of the index buffer, the input should be
+// optimized for the vertex cache first so meshlets come out spatially compact
+class MeshletBuilder {
+public:
+    static const uint32_t MAX_VERTICES = 64;
+    static const uint32_t MAX_TRIANGLES = 124;
+
+public:
+    MeshletBuilder();
+    MeshletBuilder(MeshletBuilder const &) = delete;
+    MeshletBuilder &operator=(MeshletBuilder const &) = delete;
+    ~MeshletBuilder();
+
+    // Vertices the indices refer to, positions are read as 3 floats at positionOffset
+    void SetVertexData(const void *vertexData, size_t vertexCount, uint32_t vertexStride, uint32_t positionOffset);
+
+    // Appends the meshlets of a range of triangles starting at firstIndex in the index buffer
+    // Meshlets never span two ranges
+    void AddRange(const uint32_t *indices, uint32_t firstIndex, uint32_t indexCount, int32_t materialId);
+    void Clear();
+
+    uint32_t GetMeshletCount() const;
+    const Meshlet *GetMeshlets() const;
+
+private:
+    glm::vec3 _getPosition(uint32_t vertex) const;
+    glm::vec3 _getFrontNormal(const uint32_t *triangle) const; // Unit length, zero for degenerate triangles
+    void _writeMeshlet(const uint32_t *indices, uint32_t firstIndex, uint32_t triangleCount, int32_t materialId);
+
+private:
+    const uint8_t *m_vertexData;
+    size_t m_vertexCount;
+    uint32_t m_vertexStride;
+    uint32_t m_positionOffset;
+
+    std::vector<Meshlet> m_meshlets;
+    std::vector<uint32_t> m_vertexMeshlet; // Last meshlet (plus one) each vertex was added to
+    std::vector<uint32_t> m_meshletVertices;
+};
+
+// Extracts the frustum of a view projection matrix with 0 to 1 clip depth
+// Pass projection * view * model to get the frustum in the model's local space
+Frustum ExtractFrustum(glm::mat4x4 const &viewProjection);
+
+// Returns false if the meshlet is fully outside the frustum or all of its triangles face away from cameraPosition
+// cameraPosition is in the same space as the frustum
+bool IsMeshletVisible(Meshlet const &meshlet, Frustum const &frustum, glm::vec3 const &cameraPosition);
+
+} // namespace Graphics
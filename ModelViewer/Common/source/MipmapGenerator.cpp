@@ -0,0 +1,129 @@
+#include "pch.h"
+#include "MipmapGenerator.h"
+#include "ThreadPool.h"
+#include <algorithm>
+
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include "stb/stb_image_resize2.h"
+
+namespace Graphics {
+
+namespace {
+
+// Levels with fewer output rows are resized on the calling thread, splitting them costs more than it saves
+const uint32_t MIN_PARALLEL_ROWS = 64;
+
+bool GetPixelLayout(uint32_t channels, stbir_pixel_layout *outLayout) {
+    switch (channels) {
+    case 1:
+        *outLayout = STBIR_1CHANNEL;
+        return true;
+    case 2:
+        *outLayout = STBIR_RA; // Grey and alpha
+        return true;
+    case 3:
+        *outLayout = STBIR_RGB;
+        return true;
+    case 4:
+        *outLayout = STBIR_RGBA;
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+MipmapGenerator::MipmapGenerator()
+  : m_threadPool(nullptr) {
+}
+
+MipmapGenerator::~MipmapGenerator() {
+}
+
+void MipmapGenerator::SetThreadPool(ThreadPool *threadPool) {
+    m_threadPool = threadPool;
+}
+
+uint32_t MipmapGenerator::GetMipLevelCount(uint32_t width, uint32_t height) {
+    uint32_t extent = std::max(width, height);
+    uint32_t levelCount = 1;
+    while (extent > 1) {
+        extent >>= 1;
+        ++levelCount;
+    }
+    return levelCount;
+}
+
+uint32_t MipmapGenerator::GetLevelExtent(uint32_t extent, uint32_t level) {
+    return std::max(extent >> level, 1u);
+}
+
+size_t MipmapGenerator::GetLevelSize(uint32_t width, uint32_t height, uint32_t channels, uint32_t level) {
+    return static_cast<size_t>(GetLevelExtent(width, level)) * GetLevelExtent(height, level) * channels;
+}
+
+size_t MipmapGenerator::GetLevelsSize(uint32_t width, uint32_t height, uint32_t channels, uint32_t firstLevel, uint32_t levelCount) {
+    size_t size = 0;
+    for (uint32_t level = firstLevel; level < firstLevel + levelCount; ++level) {
+        size += GetLevelSize(width, height, channels, level);
+    }
+    return size;
+}
+
+bool MipmapGenerator::Generate(const void *baseLevel, uint32_t width, uint32_t height, uint32_t channels, bool srgb, uint32_t mipLevelCount, void *outLevels) const {
+    ASSERT(baseLevel);
+    ASSERT(outLevels || mipLevelCount <= 1);
+    ASSERT(mipLevelCount <= GetMipLevelCount(width, height));
+
+    stbir_pixel_layout pixelLayout;
+    if (!GetPixelLayout(channels, &pixelLayout)) {
+        return false;
+    }
+
+    const uint8_t *source = reinterpret_cast<const uint8_t*>(baseLevel);
+    uint8_t *destination = reinterpret_cast<uint8_t*>(outLevels);
+    for (uint32_t level = 1; level < mipLevelCount; ++level) {
+        uint32_t sourceWidth = GetLevelExtent(width, level - 1);
+        uint32_t sourceHeight = GetLevelExtent(height, level - 1);
+        uint32_t levelWidth = GetLevelExtent(width, level);
+        uint32_t levelHeight = GetLevelExtent(height, level);
+
+        STBIR_RESIZE resize;
+        stbir_resize_init(&resize, source, static_cast<int>(sourceWidth), static_cast<int>(sourceHeight), 0,
+                          destination, static_cast<int>(levelWidth), static_cast<int>(levelHeight), 0,
+                          pixelLayout, srgb ? STBIR_TYPE_UINT8_SRGB : STBIR_TYPE_UINT8);
+
+        int splitCount = 1;
+        if (m_threadPool && levelHeight >= MIN_PARALLEL_ROWS) {
+            splitCount = static_cast<int>(m_threadPool->GetThreadCount()) + 1;
+        }
+        splitCount = stbir_build_samplers_with_splits(&resize, splitCount);
+        if (splitCount == 0) {
+            return false;
+        }
+
+        bool resized = true;
+        if (splitCount > 1) {
+            std::vector<uint8_t> splitResults(splitCount);
+            m_threadPool->ParallelFor(static_cast<uint32_t>(splitCount), [&resize, &splitResults](uint32_t split) {
+                splitResults[split] = static_cast<uint8_t>(stbir_resize_extended_split(&resize, static_cast<int>(split), 1));
+            });
+            resized = std::find(splitResults.begin(), splitResults.end(), 0) == splitResults.end();
+        }
+        else {
+            resized = stbir_resize_extended_split(&resize, 0, 1) != 0;
+        }
+        stbir_free_samplers(&resize);
+        if (!resized) {
+            return false;
+        }
+
+        source = destination;
+        destination += GetLevelSize(width, height, channels, level);
+    }
+
+    return true;
+}
+
+} // namespace Graphics
@@ -0,0 +1,38 @@
+#pragma once
+
+namespace Graphics {
+
+class ThreadPool;
+
+// Generates the mip chain of 8-bit images with stb_image_resize2, which uses SSE2/AVX where available
+// sRGB images are filtered in linear space, and RGBA images weight color by alpha so transparent texels do not bleed
+// Each level is computed from the one before it, split into horizontal bands that run in parallel on the thread pool, if one is set
+class MipmapGenerator {
+public:
+    MipmapGenerator();
+    MipmapGenerator(MipmapGenerator const &) = delete;
+    MipmapGenerator &operator=(MipmapGenerator const &) = delete;
+    ~MipmapGenerator();
+
+    void SetThreadPool(ThreadPool *threadPool);
+
+    // Levels of a full chain down to 1x1
+    static uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+
+    // Width or height of a level
+    static uint32_t GetLevelExtent(uint32_t extent, uint32_t level);
+    static size_t GetLevelSize(uint32_t width, uint32_t height, uint32_t channels, uint32_t level);
+
+    // Bytes taken by levels [firstLevel, firstLevel + levelCount) stored one after another
+    static size_t GetLevelsSize(uint32_t width, uint32_t height, uint32_t channels, uint32_t firstLevel, uint32_t levelCount);
+
+    // Halves baseLevel until mipLevelCount levels exist, levels 1 onwards are written one after another to outLevels
+    // outLevels must hold GetLevelsSize(width, height, channels, 1, mipLevelCount - 1) bytes
+    // Returns false if the resizer fails
+    bool Generate(const void *baseLevel, uint32_t width, uint32_t height, uint32_t channels, bool srgb, uint32_t mipLevelCount, void *outLevels) const;
+
+private:
+    ThreadPool *m_threadPool;
+};
+
+} // namespace Graphics
@@ -0,0 +1,770 @@
+#include "pch.h"
+#include "ModelGltfLoader.h"
+#include "ExecutableDirectory.h"
+#include "glm/gtc/quaternion.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include <filesystem>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <cctype>
+
+namespace Graphics {
+
+namespace {
+
+// Binary glTF container, all values little endian
+const uint32_t GLB_MAGIC = 0x46546C67; // "glTF"
+const uint32_t GLB_VERSION = 2;
+const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+const uint32_t GLB_CHUNK_BIN = 0x004E4942;
+
+struct GlbHeader {
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t Length;
+};
+
+struct GlbChunkHeader {
+    uint32_t Length;
+    uint32_t Type;
+};
+
+const uint32_t PRIMITIVE_MODE_TRIANGLES = 4;
+
+const char EMBEDDED_IMAGE_PREFIX[] = "#gltf-image:";
+
+uint32_t GetComponentSize(uint32_t componentType) {
+    switch (componentType) {
+    case ModelGltfLoader::COMPONENT_TYPE_BYTE:
+    case ModelGltfLoader::COMPONENT_TYPE_UNSIGNED_BYTE:
+        return 1;
+    case ModelGltfLoader::COMPONENT_TYPE_SHORT:
+    case ModelGltfLoader::COMPONENT_TYPE_UNSIGNED_SHORT:
+        return 2;
+    case ModelGltfLoader::COMPONENT_TYPE_UNSIGNED_INT:
+    case ModelGltfLoader::COMPONENT_TYPE_FLOAT:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+// Matrix accessors are never used for geometry, they are left unsupported
+uint32_t GetComponentCount(const char *type) {
+    if (strcmp(type, "SCALAR") == 0) {
+        return 1;
+    }
+    if (strcmp(type, "VEC2") == 0) {
+        return 2;
+    }
+    if (strcmp(type, "VEC3") == 0) {
+        return 3;
+    }
+    if (strcmp(type, "VEC4") == 0) {
+        return 4;
+    }
+    return 0;
+}
+
+// Lookups that treat missing or mistyped members as absent
+const rapidjson::Value *FindMember(rapidjson::Value const &object, const char *name) {
+    if (!object.IsObject()) {
+        return nullptr;
+    }
+    auto member = object.FindMember(name);
+    return member != object.MemberEnd() ? &member->value : nullptr;
+}
+
+const rapidjson::Value *FindArray(rapidjson::Value const &object, const char *name) {
+    const rapidjson::Value *value = FindMember(object, name);
+    return value && value->IsArray() ? value : nullptr;
+}
+
+uint32_t GetArraySize(rapidjson::Value const &object, const char *name) {
+    const rapidjson::Value *value = FindArray(object, name);
+    return value ? value->Size() : 0;
+}
+
+bool GetUint(rapidjson::Value const &object, const char *name, uint32_t *outValue) {
+    const rapidjson::Value *value = FindMember(object, name);
+    if (!value || !value->IsUint()) {
+        return false;
+    }
+    *outValue = value->GetUint();
+    return true;
+}
+
+uint64_t GetUint64(rapidjson::Value const &object, const char *name, uint64_t defaultValue) {
+    const rapidjson::Value *value = FindMember(object, name);
+    return value && value->IsUint64() ? value->GetUint64() : defaultValue;
+}
+
+std::string GetString(rapidjson::Value const &object, const char *name) {
+    const rapidjson::Value *value = FindMember(object, name);
+    return value && value->IsString() ? std::string(value->GetString(), value->GetStringLength()) : std::string();
+}
+
+// Reads up to count numbers of an array member, returns false if the member is missing or not all numbers
+bool GetFloats(rapidjson::Value const &object, const char *name, f32 *outValues, uint32_t count) {
+    const rapidjson::Value *value = FindArray(object, name);
+    if (!value || value->Size() != count) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        if (!(*value)[i].IsNumber()) {
+            return false;
+        }
+        outValues[i] = static_cast<f32>((*value)[i].GetDouble());
+    }
+    return true;
+}
+
+// Relative uris are percent encoded
+std::string DecodeUri(std::string const &uri) {
+    std::string decoded;
+    decoded.reserve(uri.size());
+    for (size_t i = 0; i < uri.size(); ++i) {
+        if (uri[i] == '%' && i + 2 < uri.size() && isxdigit(static_cast<unsigned char>(uri[i + 1])) && isxdigit(static_cast<unsigned char>(uri[i + 2]))) {
+            decoded.push_back(static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16)));
+            i += 2;
+        }
+        else {
+            decoded.push_back(uri[i]);
+        }
+    }
+    return decoded;
+}
+
+// Decodes "data:[<mime type>];base64,<data>" uris, returns false if the uri is not a base64 data uri
+bool DecodeDataUri(std::string const &uri, std::vector<uint8_t> *outData, std::string *outMimeType) {
+    const char DATA_PREFIX[] = "data:";
+    const char BASE64_MARKER[] = ";base64,";
+    if (uri.compare(0, sizeof(DATA_PREFIX) - 1, DATA_PREFIX) != 0) {
+        return false;
+    }
+    size_t marker = uri.find(BASE64_MARKER);
+    if (marker == std::string::npos) {
+        return false;
+    }
+    *outMimeType = uri.substr(sizeof(DATA_PREFIX) - 1, marker - (sizeof(DATA_PREFIX) - 1));
+
+    uint8_t decodeTable[256];
+    memset(decodeTable, 0xFF, sizeof(decodeTable));
+    const char BASE64_CHARACTERS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    for (uint8_t i = 0; i < 64; ++i) {
+        decodeTable[static_cast<uint8_t>(BASE64_CHARACTERS[i])] = i;
+    }
+
+    size_t dataStart = marker + sizeof(BASE64_MARKER) - 1;
+    outData->clear();
+    outData->reserve((uri.size() - dataStart) / 4 * 3);
+    uint32_t bits = 0;
+    uint32_t bitCount = 0;
+    for (size_t i = dataStart; i < uri.size() && uri[i] != '='; ++i) {
+        uint8_t value = decodeTable[static_cast<uint8_t>(uri[i])];
+        if (value == 0xFF) {
+            return false;
+        }
+        bits = (bits << 6) | value;
+        bitCount += 6;
+        if (bitCount >= 8) {
+            bitCount -= 8;
+            outData->push_back(static_cast<uint8_t>(bits >> bitCount));
+        }
+    }
+    return true;
+}
+
+glm::mat4x4 GetNodeTransform(rapidjson::Value const &node) {
+    f32 values[16];
+    if (GetFloats(node, "matrix", values, 16)) {
+        // Column major, same as glm
+        glm::mat4x4 matrix;
+        memcpy(&matrix, values, sizeof(matrix));
+        return matrix;
+    }
+
+    glm::mat4x4 transform(1.0f);
+    if (GetFloats(node, "translation", values, 3)) {
+        transform = glm::translate(transform, glm::vec3(values[0], values[1], values[2]));
+    }
+    if (GetFloats(node, "rotation", values, 4)) {
+        // Stored as xyzw
+        transform = transform * glm::mat4_cast(glm::quat(values[3], values[0], values[1], values[2]));
+    }
+    if (GetFloats(node, "scale", values, 3)) {
+        transform = glm::scale(transform, glm::vec3(values[0], values[1], values[2]));
+    }
+    return transform;
+}
+
+template<typename T>
+f32 ReadComponent(const uint8_t *data, bool normalized) {
+    T value;
+    memcpy(&value, data, sizeof(T));
+    if (!normalized) {
+        return static_cast<f32>(value);
+    }
+    // Signed values map both -max and -max - 1 to -1
+    return std::max(static_cast<f32>(value) / static_cast<f32>(std::numeric_limits<T>::max()), -1.0f);
+}
+
+} // namespace
+
+ModelGltfLoader::ModelGltfLoader() {
+}
+
+ModelGltfLoader::~ModelGltfLoader() {
+}
+
+std::string ModelGltfLoader::Load(std::string const &filePath) {
+    std::filesystem::path exePath = GetExecutableDirectory();
+
+    exePath /= filePath;
+
+    m_bufferFiles.clear();
+    m_decodedData.clear();
+    m_buffers.clear();
+    m_meshes.clear();
+    m_meshInstances.clear();
+    m_materials.clear();
+    m_images.clear();
+
+    auto startTime = std::chrono::steady_clock::now();
+    if (!m_file.Open(exePath)) {
+        return m_file.GetLastError();
+    }
+
+    // Binary files hold the json and the first buffer as chunks, text files are only json
+    const char *json = reinterpret_cast<const char*>(m_file.GetData());
+    size_t jsonSize = m_file.GetSize();
+    BufferData binaryChunk{ nullptr, 0 };
+    GlbHeader header{};
+    if (m_file.GetSize() >= sizeof(GlbHeader)) {
+        memcpy(&header, m_file.GetData(), sizeof(header));
+    }
+    if (header.Magic == GLB_MAGIC) {
+        if (header.Version != GLB_VERSION || header.Length > m_file.GetSize()) {
+            return "Unsupported or truncated glb file: " + filePath;
+        }
+
+        json = nullptr;
+        size_t offset = sizeof(GlbHeader);
+        while (offset + sizeof(GlbChunkHeader) <= header.Length) {
+            GlbChunkHeader chunk;
+            memcpy(&chunk, m_file.GetData() + offset, sizeof(chunk));
+            offset += sizeof(GlbChunkHeader);
+            if (chunk.Length > header.Length - offset) {
+                return "Truncated glb chunk: " + filePath;
+            }
+
+            if (chunk.Type == GLB_CHUNK_JSON && !json) {
+                json = reinterpret_cast<const char*>(m_file.GetData() + offset);
+                jsonSize = chunk.Length;
+            }
+            else if (chunk.Type == GLB_CHUNK_BIN && !binaryChunk.Data) {
+                binaryChunk = { m_file.GetData() + offset, chunk.Length };
+            }
+
+            // Chunks are 4 byte aligned
+            offset += (static_cast<size_t>(chunk.Length) + 3) & ~static_cast<size_t>(3);
+        }
+        if (!json) {
+            return "No json chunk in glb file: " + filePath;
+        }
+    }
+
+    rapidjson::Document document;
+    document.Parse(json, jsonSize);
+    if (document.HasParseError() || !document.IsObject()) {
+        return "Invalid json in gltf file: " + filePath;
+    }
+
+    std::string error = _loadBuffers(document, exePath.parent_path(), binaryChunk);
+    std::vector<AccessorView> accessors;
+    if (error.empty()) {
+        error = _loadAccessors(document, &accessors);
+    }
+    if (error.empty()) {
+        error = _loadMeshes(document, accessors);
+    }
+    if (error.empty()) {
+        error = _loadImages(document);
+    }
+    if (error.empty()) {
+        error = _loadMaterials(document);
+    }
+    if (error.empty()) {
+        error = _loadScene(document);
+    }
+    if (!error.empty()) {
+        return error + ": " + filePath;
+    }
+
+    f64 loadSeconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - startTime).count();
+    LOG_VERBOSE("Loaded %s (%.2f MB) in %.3f ms: %zu meshes, %zu instances, %zu materials, %zu images\n",
+        filePath.c_str(), m_file.GetSize() / (1024.0 * 1024.0), loadSeconds * 1000.0,
+        m_meshes.size(), m_meshInstances.size(), m_materials.size(), m_images.size());
+
+    return "";
+}
+
+uint32_t ModelGltfLoader::GetMeshCount() const {
+    return static_cast<uint32_t>(m_meshes.size());
+}
+
+ModelGltfLoader::Mesh const &ModelGltfLoader::GetMesh(uint32_t meshIndex) const {
+    return m_meshes[meshIndex];
+}
+
+uint32_t ModelGltfLoader::GetMeshInstanceCount() const {
+    return static_cast<uint32_t>(m_meshInstances.size());
+}
+
+const ModelGltfLoader::MeshInstance *ModelGltfLoader::GetMeshInstances() const {
+    return m_meshInstances.data();
+}
+
+uint32_t ModelGltfLoader::GetMaterialCount() const {
+    return static_cast<uint32_t>(m_materials.size());
+}
+
+ModelGltfLoader::Material const &ModelGltfLoader::GetMaterial(uint32_t materialIndex) const {
+    return m_materials[materialIndex];
+}
+
+uint32_t ModelGltfLoader::GetImageCount() const {
+    return static_cast<uint32_t>(m_images.size());
+}
+
+ModelGltfLoader::Image const &ModelGltfLoader::GetImage(uint32_t imageIndex) const {
+    return m_images[imageIndex];
+}
+
+void ModelGltfLoader::ReadFloats(AccessorView const &view, uint32_t componentCount, void *dst, size_t dstStride) {
+    uint8_t *dstData = reinterpret_cast<uint8_t*>(dst);
+    uint32_t readCount = std::min(componentCount, view.ComponentCount);
+    if (!view.Data) {
+        for (uint32_t i = 0; i < view.Count; ++i) {
+            memset(dstData + i * dstStride, 0, readCount * sizeof(f32));
+        }
+        return;
+    }
+
+    // Float data is copied as is, the common case for positions, normals and texture coordinates
+    if (view.ComponentType == COMPONENT_TYPE_FLOAT) {
+        for (uint32_t i = 0; i < view.Count; ++i) {
+            memcpy(dstData + i * dstStride, view.Data + static_cast<size_t>(i) * view.Stride, readCount * sizeof(f32));
+        }
+        return;
+    }
+
+    uint32_t componentSize = GetComponentSize(view.ComponentType);
+    for (uint32_t i = 0; i < view.Count; ++i) {
+        const uint8_t *element = view.Data + static_cast<size_t>(i) * view.Stride;
+        f32 *values = reinterpret_cast<f32*>(dstData + i * dstStride);
+        for (uint32_t c = 0; c < readCount; ++c) {
+            const uint8_t *component = element + c * componentSize;
+            switch (view.ComponentType) {
+            case COMPONENT_TYPE_BYTE:
+                values[c] = ReadComponent<int8_t>(component, view.Normalized);
+                break;
+            case COMPONENT_TYPE_UNSIGNED_BYTE:
+                values[c] = ReadComponent<uint8_t>(component, view.Normalized);
+                break;
+            case COMPONENT_TYPE_SHORT:
+                values[c] = ReadComponent<int16_t>(component, view.Normalized);
+                break;
+            case COMPONENT_TYPE_UNSIGNED_SHORT:
+                values[c] = ReadComponent<uint16_t>(component, view.Normalized);
+                break;
+            case COMPONENT_TYPE_UNSIGNED_INT:
+                values[c] = ReadComponent<uint32_t>(component, view.Normalized);
+                break;
+            }
+        }
+    }
+}
+
+bool ModelGltfLoader::ReadIndices(AccessorView const &view, uint32_t vertexCount, uint32_t baseVertex, uint32_t *dst) {
+    // Indices without a buffer view are all zero
+    if (!view.Data) {
+        std::fill(dst, dst + view.Count, baseVertex);
+        return view.Count == 0 || vertexCount > 0;
+    }
+
+    uint32_t maxIndex = 0;
+    switch (view.ComponentType) {
+    case COMPONENT_TYPE_UNSIGNED_BYTE:
+        for (uint32_t i = 0; i < view.Count; ++i) {
+            uint32_t index = view.Data[static_cast<size_t>(i) * view.Stride];
+            maxIndex = std::max(maxIndex, index);
+            dst[i] = index + baseVertex;
+        }
+        break;
+    case COMPONENT_TYPE_UNSIGNED_SHORT:
+        for (uint32_t i = 0; i < view.Count; ++i) {
+            uint16_t index;
+            memcpy(&index, view.Data + static_cast<size_t>(i) * view.Stride, sizeof(index));
+            maxIndex = std::max(maxIndex, static_cast<uint32_t>(index));
+            dst[i] = index + baseVertex;
+        }
+        break;
+    case COMPONENT_TYPE_UNSIGNED_INT:
+        // Index data is tightly packed so 32-bit indices are a single copy
+        memcpy(dst, view.Data, static_cast<size_t>(view.Count) * sizeof(uint32_t));
+        for (uint32_t i = 0; i < view.Count; ++i) {
+            maxIndex = std::max(maxIndex, dst[i]);
+            dst[i] += baseVertex;
+        }
+        break;
+    default:
+        return false;
+    }
+    return view.Count == 0 || maxIndex < vertexCount;
+}
+
+std::string ModelGltfLoader::GetEmbeddedImageName(uint32_t imageIndex) {
+    return EMBEDDED_IMAGE_PREFIX + std::to_string(imageIndex);
+}
+
+bool ModelGltfLoader::ParseEmbeddedImageName(std::string const &name, uint32_t *outImageIndex) {
+    const size_t prefixLength = sizeof(EMBEDDED_IMAGE_PREFIX) - 1;
+    if (name.size() <= prefixLength || name.compare(0, prefixLength, EMBEDDED_IMAGE_PREFIX) != 0) {
+        return false;
+    }
+    for (size_t i = prefixLength; i < name.size(); ++i) {
+        if (!isdigit(static_cast<unsigned char>(name[i]))) {
+            return false;
+        }
+    }
+    *outImageIndex = static_cast<uint32_t>(std::stoul(name.substr(prefixLength)));
+    return true;
+}
+
+std::string ModelGltfLoader::_loadBuffers(rapidjson::Value const &document, std::filesystem::path const &directory, BufferData binaryChunk) {
+    const rapidjson::Value *buffers = FindArray(document, "buffers");
+    if (!buffers) {
+        return "";
+    }
+
+    for (rapidjson::SizeType i = 0; i < buffers->Size(); ++i) {
+        rapidjson::Value const &buffer = (*buffers)[i];
+        uint64_t byteLength = GetUint64(buffer, "byteLength", 0);
+        std::string uri = GetString(buffer, "uri");
+
+        // The first buffer of a glb file may refer to the binary chunk, which can be padded past byteLength
+        BufferData data{ nullptr, 0 };
+        if (uri.empty()) {
+            if (i != 0 || !binaryChunk.Data) {
+                return "Buffer " + std::to_string(i) + " has no data";
+            }
+            data = binaryChunk;
+        }
+        else {
+            std::string mimeType;
+            auto &decoded = m_decodedData.emplace_back();
+            if (DecodeDataUri(uri, &decoded, &mimeType)) {
+                data = { decoded.data(), decoded.size() };
+            }
+            else {
+                m_decodedData.pop_back();
+                auto &bufferFile = m_bufferFiles.emplace_back();
+                if (!bufferFile.Open(directory / std::filesystem::u8path(DecodeUri(uri)))) {
+                    return bufferFile.GetLastError();
+                }
+                data = { bufferFile.GetData(), bufferFile.GetSize() };
+            }
+        }
+
+        if (data.Size < byteLength) {
+            return "Buffer " + std::to_string(i) + " is smaller than its byteLength";
+        }
+        data.Size = static_cast<size_t>(byteLength);
+        m_buffers.push_back(data);
+    }
+    return "";
+}
+
+const uint8_t *ModelGltfLoader::_getBufferView(rapidjson::Value const &document, uint32_t bufferViewIndex, size_t *outSize, uint32_t *outStride) const {
+    const rapidjson::Value *bufferViews = FindArray(document, "bufferViews");
+    if (!bufferViews || bufferViewIndex >= bufferViews->Size()) {
+        return nullptr;
+    }
+
+    rapidjson::Value const &bufferView = (*bufferViews)[bufferViewIndex];
+    uint32_t bufferIndex = 0;
+    if (!GetUint(bufferView, "buffer", &bufferIndex) || bufferIndex >= m_buffers.size()) {
+        return nullptr;
+    }
+
+    uint64_t byteOffset = GetUint64(bufferView, "byteOffset", 0);
+    uint64_t byteLength = GetUint64(bufferView, "byteLength", 0);
+    BufferData const &buffer = m_buffers[bufferIndex];
+    if (byteOffset > buffer.Size || byteLength > buffer.Size - byteOffset) {
+        return nullptr;
+    }
+
+    *outSize = static_cast<size_t>(byteLength);
+    *outStride = 0;
+    GetUint(bufferView, "byteStride", outStride);
+    return buffer.Data + byteOffset;
+}
+
+std::string ModelGltfLoader::_loadAccessors(rapidjson::Value const &document, std::vector<AccessorView> *outAccessors) {
+    const rapidjson::Value *accessors = FindArray(document, "accessors");
+    if (!accessors) {
+        return "";
+    }
+
+    outAccessors->reserve(accessors->Size());
+    for (rapidjson::SizeType i = 0; i < accessors->Size(); ++i) {
+        rapidjson::Value const &accessor = (*accessors)[i];
+        AccessorView view{};
+        GetUint(accessor, "count", &view.Count);
+        GetUint(accessor, "componentType", &view.ComponentType);
+        view.ComponentCount = GetComponentCount(GetString(accessor, "type").c_str());
+        const rapidjson::Value *normalized = FindMember(accessor, "normalized");
+        view.Normalized = normalized && normalized->IsBool() && normalized->GetBool();
+
+        // Unsupported accessors are kept so indices stay valid, primitives using them fail to load
+        uint32_t elementSize = GetComponentSize(view.ComponentType) * view.ComponentCount;
+        if (elementSize == 0 || FindMember(accessor, "sparse")) {
+            view.Count = 0;
+            view.ComponentCount = 0;
+            outAccessors->push_back(view);
+            continue;
+        }
+
+        uint32_t bufferViewIndex = 0;
+        if (GetUint(accessor, "bufferView", &bufferViewIndex)) {
+            size_t bufferViewSize = 0;
+            uint32_t byteStride = 0;
+            const uint8_t *bufferViewData = _getBufferView(document, bufferViewIndex, &bufferViewSize, &byteStride);
+            if (!bufferViewData) {
+                return "Invalid buffer view for accessor " + std::to_string(i);
+            }
+
+            // Every element must lie within the buffer view
+            uint64_t byteOffset = GetUint64(accessor, "byteOffset", 0);
+            view.Stride = byteStride > 0 ? byteStride : elementSize;
+            uint64_t requiredSize = view.Count > 0 ? byteOffset + static_cast<uint64_t>(view.Count - 1) * view.Stride + elementSize : 0;
+            if (requiredSize > bufferViewSize) {
+                return "Accessor " + std::to_string(i) + " exceeds its buffer view";
+            }
+            view.Data = bufferViewData + byteOffset;
+        }
+        else {
+            view.Stride = elementSize;
+        }
+        outAccessors->push_back(view);
+    }
+    return "";
+}
+
+std::string ModelGltfLoader::_loadMeshes(rapidjson::Value const &document, std::vector<AccessorView> const &accessors) {
+    const rapidjson::Value *meshes = FindArray(document, "meshes");
+    if (!meshes) {
+        return "";
+    }
+
+    uint32_t materialCount = GetArraySize(document, "materials");
+    uint32_t skippedPrimitiveCount = 0;
+    m_meshes.reserve(meshes->Size());
+    for (rapidjson::SizeType i = 0; i < meshes->Size(); ++i) {
+        rapidjson::Value const &mesh = (*meshes)[i];
+        Mesh &newMesh = m_meshes.emplace_back();
+        newMesh.Name = GetString(mesh, "name");
+
+        const rapidjson::Value *primitives = FindArray(mesh, "primitives");
+        if (!primitives) {
+            continue;
+        }
+        for (rapidjson::SizeType p = 0; p < primitives->Size(); ++p) {
+            rapidjson::Value const &primitive = (*primitives)[p];
+            uint32_t mode = PRIMITIVE_MODE_TRIANGLES;
+            GetUint(primitive, "mode", &mode);
+            const rapidjson::Value *attributes = FindMember(primitive, "attributes");
+            uint32_t positionAccessor = 0;
+            if (mode != PRIMITIVE_MODE_TRIANGLES || !attributes || !GetUint(*attributes, "POSITION", &positionAccessor)) {
+                ++skippedPrimitiveCount;
+                continue;
+            }
+
+            Primitive newPrimitive{};
+            newPrimitive.MaterialId = -1;
+            uint32_t materialIndex = 0;
+            if (GetUint(primitive, "material", &materialIndex) && materialIndex < materialCount) {
+                newPrimitive.MaterialId = static_cast<int32_t>(materialIndex);
+            }
+
+            // Attributes must all have one element per vertex
+            struct { const char *Name; AccessorView *View; uint32_t MinComponents; } attributeViews[] = {
+                { "POSITION", &newPrimitive.Positions, 3 },
+                { "NORMAL", &newPrimitive.Normals, 3 },
+                { "TEXCOORD_0", &newPrimitive.TexCoords, 2 },
+                { "COLOR_0", &newPrimitive.Colors, 3 },
+            };
+            for (auto &attribute : attributeViews) {
+                uint32_t accessorIndex = 0;
+                if (!GetUint(*attributes, attribute.Name, &accessorIndex)) {
+                    continue;
+                }
+                if (accessorIndex >= accessors.size() || accessors[accessorIndex].ComponentCount < attribute.MinComponents ||
+                    accessors[accessorIndex].Count != accessors[positionAccessor].Count) {
+                    return "Unsupported " + std::string(attribute.Name) + " accessor in mesh " + std::to_string(i);
+                }
+                *attribute.View = accessors[accessorIndex];
+            }
+
+            uint32_t indexAccessor = 0;
+            if (GetUint(primitive, "indices", &indexAccessor)) {
+                if (indexAccessor >= accessors.size() || accessors[indexAccessor].ComponentCount != 1 ||
+                    accessors[indexAccessor].ComponentType == COMPONENT_TYPE_FLOAT) {
+                    return "Unsupported index accessor in mesh " + std::to_string(i);
+                }
+                newPrimitive.Indices = accessors[indexAccessor];
+            }
+
+            newMesh.Primitives.push_back(newPrimitive);
+        }
+    }
+
+    if (skippedPrimitiveCount > 0) {
+        LOG_VERBOSE("Skipped %u gltf primitives that are not triangle lists\n", skippedPrimitiveCount);
+    }
+    return "";
+}
+
+std::string ModelGltfLoader::_loadImages(rapidjson::Value const &document) {
+    const rapidjson::Value *images = FindArray(document, "images");
+    if (!images) {
+        return "";
+    }
+
+    m_images.reserve(images->Size());
+    for (rapidjson::SizeType i = 0; i < images->Size(); ++i) {
+        rapidjson::Value const &image = (*images)[i];
+        Image &newImage = m_images.emplace_back();
+        newImage.Data = nullptr;
+        newImage.DataSize = 0;
+        newImage.MimeType = GetString(image, "mimeType");
+
+        // Embedded images are either a buffer view or a data uri, anything else is a file next to the model
+        uint32_t bufferViewIndex = 0;
+        std::string uri = GetString(image, "uri");
+        if (GetUint(image, "bufferView", &bufferViewIndex)) {
+            uint32_t byteStride = 0;
+            newImage.Data = _getBufferView(document, bufferViewIndex, &newImage.DataSize, &byteStride);
+            if (!newImage.Data) {
+                return "Invalid buffer view for image " + std::to_string(i);
+            }
+        }
+        else if (!uri.empty()) {
+            auto &decoded = m_decodedData.emplace_back();
+            if (DecodeDataUri(uri, &decoded, &newImage.MimeType)) {
+                newImage.Data = decoded.data();
+                newImage.DataSize = decoded.size();
+            }
+            else {
+                m_decodedData.pop_back();
+                newImage.Uri = DecodeUri(uri);
+            }
+        }
+    }
+    return "";
+}
+
+std::string ModelGltfLoader::_loadMaterials(rapidjson::Value const &document) {
+    const rapidjson::Value *materials = FindArray(document, "materials");
+    if (!materials) {
+        return "";
+    }
+
+    const rapidjson::Value *textures = FindArray(document, "textures");
+    m_materials.reserve(materials->Size());
+    for (rapidjson::SizeType i = 0; i < materials->Size(); ++i) {
+        rapidjson::Value const &material = (*materials)[i];
+        Material &newMaterial = m_materials.emplace_back();
+        newMaterial.Name = GetString(material, "name");
+        newMaterial.BaseColorFactor = glm::vec4(1.0f);
+
+        // Only the base color of the metallic roughness model is used
+        const rapidjson::Value *pbr = FindMember(material, "pbrMetallicRoughness");
+        if (!pbr) {
+            continue;
+        }
+        GetFloats(*pbr, "baseColorFactor", &newMaterial.BaseColorFactor[0], 4);
+
+        const rapidjson::Value *baseColorTexture = FindMember(*pbr, "baseColorTexture");
+        uint32_t textureIndex = 0;
+        uint32_t imageIndex = 0;
+        if (baseColorTexture && textures && GetUint(*baseColorTexture, "index", &textureIndex) && textureIndex < textures->Size() &&
+            GetUint((*textures)[textureIndex], "source", &imageIndex) && imageIndex < m_images.size()) {
+            Image const &image = m_images[imageIndex];
+            newMaterial.DiffuseTexture = image.Data ? GetEmbeddedImageName(imageIndex) : image.Uri;
+        }
+    }
+    return "";
+}
+
+std::string ModelGltfLoader::_loadScene(rapidjson::Value const &document) {
+    const rapidjson::Value *scenes = FindArray(document, "scenes");
+    const rapidjson::Value *nodes = FindArray(document, "nodes");
+    uint32_t sceneIndex = 0;
+    GetUint(document, "scene", &sceneIndex);
+
+    // Without a scene to place them every mesh is shown once as is
+    if (!scenes || sceneIndex >= scenes->Size() || !nodes) {
+        for (uint32_t i = 0; i < static_cast<uint32_t>(m_meshes.size()); ++i) {
+            m_meshInstances.push_back({ i, glm::mat4x4(1.0f) });
+        }
+        return "";
+    }
+
+    // Walk the node hierarchy, nodes may only have one parent so each is visited at most once
+    struct PendingNode {
+        uint32_t NodeIndex;
+        glm::mat4x4 ParentTransform;
+    };
+    std::vector<PendingNode> pendingNodes;
+    std::vector<bool> visited(nodes->Size(), false);
+    const rapidjson::Value *rootNodes = FindArray((*scenes)[sceneIndex], "nodes");
+    if (rootNodes) {
+        for (rapidjson::SizeType i = rootNodes->Size(); i > 0; --i) {
+            if ((*rootNodes)[i - 1].IsUint()) {
+                pendingNodes.push_back({ (*rootNodes)[i - 1].GetUint(), glm::mat4x4(1.0f) });
+            }
+        }
+    }
+
+    while (!pendingNodes.empty()) {
+        PendingNode pending = pendingNodes.back();
+        pendingNodes.pop_back();
+        if (pending.NodeIndex >= nodes->Size() || visited[pending.NodeIndex]) {
+            return "Invalid node hierarchy";
+        }
+        visited[pending.NodeIndex] = true;
+
+        rapidjson::Value const &node = (*nodes)[pending.NodeIndex];
+        glm::mat4x4 transform = pending.ParentTransform * GetNodeTransform(node);
+        uint32_t meshIndex = 0;
+        if (GetUint(node, "mesh", &meshIndex) && meshIndex < m_meshes.size()) {
+            m_meshInstances.push_back({ meshIndex, transform });
+        }
+
+        const rapidjson::Value *children = FindArray(node, "children");
+        if (children) {
+            for (rapidjson::SizeType i = children->Size(); i > 0; --i) {
+                if ((*children)[i - 1].IsUint()) {
+                    pendingNodes.push_back({ (*children)[i - 1].GetUint(), transform });
+                }
+            }
+        }
+    }
+    return "";
+}
+
+} // namespace Graphics
@@ -0,0 +1,130 @@
+#pragma once
+#include "MemoryMappedFile.h"
+#include "rapidjson/document.h"
+
+namespace Graphics {
+
+// Loads glTF 2.0 (.gltf with external or embedded buffers, and binary .glb) models
+// The file and any external buffers stay mapped for the lifetime of the loader, accessors are exposed as strided views of
+// the mapped data so geometry is never parsed or copied by the loader itself
+// Only triangle list primitives are loaded, other primitive modes are skipped
+class ModelGltfLoader {
+public:
+    // Accessor component types, same values as glTF
+    enum ComponentType : uint32_t {
+        COMPONENT_TYPE_BYTE = 5120,
+        COMPONENT_TYPE_UNSIGNED_BYTE = 5121,
+        COMPONENT_TYPE_SHORT = 5122,
+        COMPONENT_TYPE_UNSIGNED_SHORT = 5123,
+        COMPONENT_TYPE_UNSIGNED_INT = 5125,
+        COMPONENT_TYPE_FLOAT = 5126
+    };
+
+    // Strided view of an accessor's elements
+    struct AccessorView {
+        const uint8_t *Data; // Null if the accessor has no buffer view, its elements are all zero
+        uint32_t Count;      // 0 if the attribute is not present
+        uint32_t Stride;
+        uint32_t ComponentType;
+        uint32_t ComponentCount;
+        bool Normalized;
+    };
+
+    // Triangle list drawn with a single material
+    struct Primitive {
+        AccessorView Positions;
+        AccessorView Normals;
+        AccessorView TexCoords; // First texture coordinate set
+        AccessorView Colors;    // First color set
+        AccessorView Indices;   // Count is 0 if the primitive is not indexed
+        int32_t MaterialId;     // -1 if unused
+    };
+
+    struct Mesh {
+        std::string Name;
+        std::vector<Primitive> Primitives;
+    };
+
+    // Mesh placed in the scene by a node, meshes used by several nodes have several instances
+    struct MeshInstance {
+        uint32_t MeshIndex;
+        glm::mat4x4 Transform; // Node to scene, in glTF's right handed, +Y up space
+    };
+
+    struct Material {
+        std::string Name;
+        std::string DiffuseTexture; // Relative to the file's directory or an embedded image name, empty if unused
+        glm::vec4 BaseColorFactor;
+    };
+
+    struct Image {
+        std::string Uri;     // Relative to the file's directory, empty if embedded
+        const uint8_t *Data; // Encoded image of embedded images, null otherwise
+        size_t DataSize;
+        std::string MimeType;
+    };
+
+public:
+    ModelGltfLoader();
+    ModelGltfLoader(ModelGltfLoader const &) = delete;
+    ModelGltfLoader &operator=(ModelGltfLoader const &) = delete;
+    ~ModelGltfLoader();
+
+    // Maps the file and its buffers and reads the json, returning an error string on failure
+    std::string Load(std::string const &filePath);
+
+    uint32_t GetMeshCount() const;
+    Mesh const &GetMesh(uint32_t meshIndex) const;
+
+    // Instances of the default scene, or of every mesh if the file has no scenes
+    uint32_t GetMeshInstanceCount() const;
+    const MeshInstance *GetMeshInstances() const;
+
+    uint32_t GetMaterialCount() const;
+    Material const &GetMaterial(uint32_t materialIndex) const;
+
+    uint32_t GetImageCount() const;
+    Image const &GetImage(uint32_t imageIndex) const;
+
+    // Converts elements to floats, normalized integers are mapped to [0, 1] or [-1, 1]
+    // Writes min(componentCount, view.ComponentCount) floats every dstStride bytes, other components are left untouched
+    static void ReadFloats(AccessorView const &view, uint32_t componentCount, void *dst, size_t dstStride);
+
+    // Converts indices to 32-bit and adds baseVertex
+    // Returns false if any index is not below vertexCount
+    static bool ReadIndices(AccessorView const &view, uint32_t vertexCount, uint32_t baseVertex, uint32_t *dst);
+
+    // Names embedded images in material textures so they can be told apart from paths
+    static std::string GetEmbeddedImageName(uint32_t imageIndex);
+    static bool ParseEmbeddedImageName(std::string const &name, uint32_t *outImageIndex);
+
+private:
+    // Bytes of a buffer, mapped from the file or decoded from a data uri
+    struct BufferData {
+        const uint8_t *Data;
+        size_t Size;
+    };
+
+    std::string _loadBuffers(rapidjson::Value const &document, std::filesystem::path const &directory, BufferData binaryChunk);
+    std::string _loadAccessors(rapidjson::Value const &document, std::vector<AccessorView> *outAccessors);
+    std::string _loadMeshes(rapidjson::Value const &document, std::vector<AccessorView> const &accessors);
+    std::string _loadMaterials(rapidjson::Value const &document);
+    std::string _loadImages(rapidjson::Value const &document);
+    std::string _loadScene(rapidjson::Value const &document);
+
+    // Byte range of a buffer view, null if the view is invalid
+    const uint8_t *_getBufferView(rapidjson::Value const &document, uint32_t bufferViewIndex, size_t *outSize, uint32_t *outStride) const;
+
+private:
+    MemoryMappedFile m_file;
+    std::vector<MemoryMappedFile> m_bufferFiles;
+    std::vector<std::vector<uint8_t>> m_decodedData; // Data uris
+    std::vector<BufferData> m_buffers;
+
+    std::vector<Mesh> m_meshes;
+    std::vector<MeshInstance> m_meshInstances;
+    std::vector<Material> m_materials;
+    std::vector<Image> m_images;
+};
+
+} // namespace Graphics
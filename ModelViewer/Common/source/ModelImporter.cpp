@@ -0,0 +1,548 @@
+#include "pch.h"
+#include "ModelImporter.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "IndexBufferCompactor.h"
+#include "TextureAtlasBuilder.h"
+#include "TextureContainerLoader.h"
+#include "MipmapGenerator.h"
+#include "ImageLoader.h"
+#include "MemoryMappedFile.h"
+#include "ExecutableDirectory.h"
+#include <map>
+#include "VertexQuantization.h"
+
+namespace Graphics {
+
+// Texture coordinates spanning more than this many texture repeats keep full floats
+// 16 bits over 8 repeats still resolves 1/8192 of the texture
+static const f32 MAX_COMPACT_TEXCOORD_EXTENT = 8.0f;
+
+// Each level of detail aims for half the triangles of the previous one, the chain stops early once simplification stalls
+static const f32 LOD_TRIANGLE_RATIO = 0.5f;
+static const f32 MIN_LOD_REDUCTION = 0.8f;
+
+// Attribute weights when simplifying, relative to moving a vertex by the size of the mesh
+static const f32 LOD_NORMAL_WEIGHT = 0.5f;
+static const f32 LOD_COLOR_WEIGHT = 0.5f;
+static const f32 LOD_TEXCOORD_WEIGHT = 1.0f;
+
+// Material textures up to this size are packed into atlas pages
+static const uint32_t MAX_ATLAS_TEXTURE_EXTENT = 256;
+
+// Texture coordinates this close outside [0, 1] still count as not repeating, exporters often overshoot by rounding
+static const f32 ATLAS_TEXCOORD_TOLERANCE = 1.0f / 1024.0f;
+
+// The compact layout is the compact color layout without the trailing color
+static_assert(sizeof(TexturedVertexCompact) == 16 && sizeof(TexturedVertexCompactColor) == 20, "Unexpected compact vertex size");
+static_assert(offsetof(TexturedVertexCompact, texCoord) == offsetof(TexturedVertexCompactColor, texCoord), "Compact layouts must share their leading members");
+
+const uint32_t ModelImporter::MAX_LOD_COUNT;
+
+bool operator==(TexturedVertex const &lhs, TexturedVertex const &rhs) {
+    return lhs.position == rhs.position &&
+        lhs.normal == rhs.normal &&
+        lhs.color == rhs.color &&
+        lhs.texCoord == rhs.texCoord;
+}
+
+ModelImporter::ModelImporter()
+  : m_optimize(true),
+    m_threadPool(nullptr) {
+}
+
+ModelImporter::~ModelImporter() {
+}
+
+void ModelImporter::SetOptimization(bool enable) {
+    m_optimize = enable;
+}
+
+void ModelImporter::SetThreadPool(ThreadPool *threadPool) {
+    m_threadPool = threadPool;
+}
+
+void ModelImporter::Import(const TexturedVertex *vertices, size_t vertexCount, const uint32_t *indices, uint32_t indexCount,
+                           const ModelObjLoader::SubMesh *subMeshes, uint32_t subMeshCount, Mesh *outMesh) const {
+    // Reorder for the vertex cache, overdraw and vertex fetch before anything is encoded
+    // Only triangle lists can be reordered, faces that were not triangulated are left as they are
+    std::vector<uint32_t> optimizedIndices;
+    std::vector<TexturedVertex> optimizedVertices;
+    if (m_optimize && indexCount % 3 == 0) {
+        OptimizeMesh(vertices, vertexCount, indices, indexCount, subMeshes, subMeshCount, &optimizedVertices, &optimizedIndices);
+        vertices = optimizedVertices.data();
+        vertexCount = optimizedVertices.size();
+        indices = optimizedIndices.data();
+    }
+
+    // Meshlets are built from the final triangle order, the vertex cache order keeps them compact
+    outMesh->Meshlets.clear();
+    if (indexCount % 3 == 0) {
+        BuildMeshlets(vertices, vertexCount, indices, subMeshes, subMeshCount, &outMesh->Meshlets);
+    }
+
+    // Coarser levels share the vertices and follow full detail in the indices
+    std::vector<uint32_t> lodIndices(indices, indices + indexCount);
+    std::vector<Lod> lods(1);
+    lods[0].SubMeshes.assign(subMeshes, subMeshes + subMeshCount);
+    lods[0].Error = 0.0f;
+    if (indexCount % 3 == 0) {
+        BuildLods(vertices, vertexCount, m_optimize, &lodIndices, &lods);
+    }
+
+    outMesh->Bounds = ModelMeshCache::ComputeBounds(vertices, vertexCount, sizeof(TexturedVertex), offsetof(TexturedVertex, position));
+    outMesh->Layout = EncodeVertices(vertices, vertexCount, outMesh->Bounds, &outMesh->TexCoordRange, &outMesh->VertexData);
+    outMesh->VertexCount = vertexCount;
+
+    // Re-encode every submesh of every level with the narrowest index type its vertices allow
+    IndexBufferCompactor indexCompactor;
+    indexCompactor.SetAllowSplit(true);
+    std::vector<uint32_t> rangeSourceFirstIndices;
+    outMesh->Lods.clear();
+    for (auto const &lod : lods) {
+        uint32_t firstRange = indexCompactor.GetRangeCount();
+        for (auto const &subMesh : lod.SubMeshes) {
+            indexCompactor.AddRange(lodIndices.data() + subMesh.IndexOffset, subMesh.IndexCount, subMesh.MaterialId);
+
+            // Ranges split from one submesh follow each other in the 32-bit indices
+            uint32_t sourceFirstIndex = subMesh.IndexOffset;
+            while (rangeSourceFirstIndices.size() < indexCompactor.GetRangeCount()) {
+                rangeSourceFirstIndices.push_back(sourceFirstIndex);
+                sourceFirstIndex += indexCompactor.GetRanges()[rangeSourceFirstIndices.size() - 1].IndexCount;
+            }
+        }
+        outMesh->Lods.push_back({ firstRange, indexCompactor.GetRangeCount() - firstRange, lod.Error, 0 });
+    }
+    LOG_VERBOSE("Compacted %zu indices from %zu to %zu bytes in %u ranges\n",
+        lodIndices.size(), lodIndices.size() * sizeof(uint32_t), indexCompactor.GetDataSize(), indexCompactor.GetRangeCount());
+
+    outMesh->IndexData.assign(indexCompactor.GetData(), indexCompactor.GetData() + indexCompactor.GetDataSize());
+    outMesh->SubMeshes.clear();
+    for (uint32_t i = 0; i < indexCompactor.GetRangeCount(); ++i) {
+        IndexBufferCompactor::Range const &range = indexCompactor.GetRanges()[i];
+        outMesh->SubMeshes.push_back({ range.FirstIndex, range.IndexCount, range.MaterialId, range.IndexSize, range.BaseVertex, rangeSourceFirstIndices[i] });
+    }
+}
+
+bool ModelImporter::BuildTextureAtlas(std::string const &filePath, ModelGltfLoader const &gltfLoader, TextureCompressor::BlockFormat pageFormat,
+                                      const TexturedVertex *vertices, size_t vertexCount, const uint32_t *indices, uint32_t indexCount,
+                                      const ModelObjLoader::SubMesh *subMeshes, uint32_t subMeshCount, std::vector<std::string> *materialTextures,
+                                      std::vector<TexturedVertex> *outVertices, std::vector<uint32_t> *outIndices, std::vector<ModelObjLoader::SubMesh> *outSubMeshes) const {
+    const uint32_t NOT_ATLASED = std::numeric_limits<uint32_t>::max();
+    const uint32_t UNCLAIMED = NOT_ATLASED - 1;
+    const uint32_t materialCount = static_cast<uint32_t>(materialTextures->size());
+
+    // Repeating textures cannot be packed, every submesh of a material must keep its texture coordinates within [0, 1]
+    std::vector<bool> materialInRange(materialCount, true);
+    for (uint32_t i = 0; i < subMeshCount; ++i) {
+        auto const &subMesh = subMeshes[i];
+        if (subMesh.MaterialId < 0 || static_cast<uint32_t>(subMesh.MaterialId) >= materialCount || !materialInRange[subMesh.MaterialId]) {
+            continue;
+        }
+        for (uint32_t j = subMesh.IndexOffset; j < subMesh.IndexOffset + subMesh.IndexCount; ++j) {
+            glm::vec2 const &texCoord = vertices[indices[j]].texCoord;
+            if (texCoord.x < -ATLAS_TEXCOORD_TOLERANCE || texCoord.x > 1.0f + ATLAS_TEXCOORD_TOLERANCE ||
+                texCoord.y < -ATLAS_TEXCOORD_TOLERANCE || texCoord.y > 1.0f + ATLAS_TEXCOORD_TOLERANCE) {
+                materialInRange[subMesh.MaterialId] = false;
+                break;
+            }
+        }
+    }
+
+    // Textures are resolved relative to the model as renderers load them, a texture is packed only if none of its materials repeat it
+    // Container files keep the levels they were stored with and are never packed
+    std::filesystem::path modelDirectory = std::filesystem::path(filePath).parent_path();
+    std::vector<std::string> texturePaths;
+    std::vector<bool> textureInRange;
+    std::vector<uint32_t> materialTextureIndices(materialCount, NOT_ATLASED);
+    std::map<std::string, uint32_t> textureIndices;
+    for (uint32_t i = 0; i < materialCount; ++i) {
+        std::string const &materialTexture = (*materialTextures)[i];
+        if (materialTexture.empty()) {
+            continue;
+        }
+        uint32_t imageIndex = 0;
+        std::string texturePath = ModelGltfLoader::ParseEmbeddedImageName(materialTexture, &imageIndex) ?
+            materialTexture : (modelDirectory / materialTexture).u8string();
+        auto inserted = textureIndices.emplace(texturePath, static_cast<uint32_t>(texturePaths.size()));
+        if (inserted.second) {
+            texturePaths.push_back(texturePath);
+            textureInRange.push_back(!TextureContainerLoader::IsContainerFile(texturePath));
+        }
+        materialTextureIndices[i] = inserted.first->second;
+        textureInRange[inserted.first->second] = textureInRange[inserted.first->second] && materialInRange[i];
+    }
+
+    std::filesystem::path exePath = GetExecutableDirectory();
+
+    auto getTextureSize = [pageFormat](uint32_t width, uint32_t height, uint32_t mipLevelCount) {
+        size_t size = 0;
+        for (uint32_t level = 0; level < mipLevelCount; ++level) {
+            size += TextureCompressor::GetCompressedSize(pageFormat, MipmapGenerator::GetLevelExtent(width, level),
+                                                                   MipmapGenerator::GetLevelExtent(height, level));
+        }
+        return size;
+    };
+
+    // Only small textures are decoded, their headers tell their size
+    TextureAtlasBuilder atlasBuilder;
+    atlasBuilder.SetBlockExtent(pageFormat != TextureCompressor::BLOCK_FORMAT_NONE ? 4 : 1);
+    std::vector<uint32_t> texturePlacements(texturePaths.size(), NOT_ATLASED);
+    uint32_t atlasedTextureCount = 0;
+    size_t sourceSize = 0;
+    for (size_t i = 0; i < texturePaths.size(); ++i) {
+        if (!textureInRange[i]) {
+            continue;
+        }
+
+        MemoryMappedFile textureFile;
+        const void *data = nullptr;
+        size_t dataSize = 0;
+        uint32_t imageIndex = 0;
+        if (ModelGltfLoader::ParseEmbeddedImageName(texturePaths[i], &imageIndex)) {
+            if (imageIndex >= gltfLoader.GetImageCount() || !gltfLoader.GetImage(imageIndex).Data) {
+                continue;
+            }
+            data = gltfLoader.GetImage(imageIndex).Data;
+            dataSize = gltfLoader.GetImage(imageIndex).DataSize;
+        }
+        else {
+            // Textures that fail to open are reported when the materials load
+            if (!textureFile.Open(exePath / std::filesystem::u8path(texturePaths[i]))) {
+                continue;
+            }
+            data = textureFile.GetData();
+            dataSize = textureFile.GetSize();
+        }
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t channels = 0;
+        if (!ImageLoader::GetImageInfo(data, dataSize, &width, &height, &channels) || std::max(width, height) > MAX_ATLAS_TEXTURE_EXTENT) {
+            continue;
+        }
+        ImageLoader imageLoader;
+        if (!imageLoader.LoadImageFromMemory(data, dataSize, 4)) {
+            continue;
+        }
+        texturePlacements[i] = atlasBuilder.AddTexture(imageLoader.GetData(), imageLoader.GetWidth(), imageLoader.GetHeight());
+        sourceSize += getTextureSize(width, height, MipmapGenerator::GetMipLevelCount(width, height));
+        ++atlasedTextureCount;
+    }
+
+    // A single texture saves no binds
+    if (atlasedTextureCount < 2) {
+        return false;
+    }
+    if (!atlasBuilder.Build()) {
+        LOG_ERROR("Unable to pack texture atlas for %s\n", filePath.c_str());
+        return false;
+    }
+
+    // Pages are saved as DDS files next to the model, their levels are loaded as stored
+    std::string modelName = std::filesystem::path(filePath).stem().u8string();
+    std::vector<std::string> pageTextures;
+    size_t pageSize = 0;
+    TextureCompressor compressor;
+    compressor.SetThreadPool(m_threadPool);
+    for (uint32_t page = 0; page < atlasBuilder.GetPageCount(); ++page) {
+        auto const &atlasPage = atlasBuilder.GetPage(page);
+        const void *pageData = atlasPage.Levels.data();
+        size_t pageDataSize = atlasPage.Levels.size();
+        std::vector<uint8_t> compressedLevels;
+        if (pageFormat != TextureCompressor::BLOCK_FORMAT_NONE) {
+            compressedLevels.resize(getTextureSize(atlasPage.Width, atlasPage.Height, atlasPage.MipLevelCount));
+            const uint8_t *levelPixels = atlasPage.Levels.data();
+            size_t compressedOffset = 0;
+            for (uint32_t level = 0; level < atlasPage.MipLevelCount; ++level) {
+                uint32_t levelWidth = MipmapGenerator::GetLevelExtent(atlasPage.Width, level);
+                uint32_t levelHeight = MipmapGenerator::GetLevelExtent(atlasPage.Height, level);
+                compressor.Compress(levelPixels, levelWidth, levelHeight, pageFormat, compressedLevels.data() + compressedOffset);
+                compressedOffset += TextureCompressor::GetCompressedSize(pageFormat, levelWidth, levelHeight);
+                levelPixels += MipmapGenerator::GetLevelSize(atlasPage.Width, atlasPage.Height, 4, level);
+            }
+            pageData = compressedLevels.data();
+            pageDataSize = compressedLevels.size();
+        }
+
+        std::string pageTexture = modelName + ".atlas" + std::to_string(page) + ".dds";
+        TextureContainerLoader pageWriter;
+        if (!pageWriter.SaveDds(exePath / modelDirectory / std::filesystem::u8path(pageTexture), pageFormat, true, atlasPage.Width, atlasPage.Height,
+                                atlasPage.MipLevelCount, pageData, pageDataSize, 0)) {
+            LOG_ERROR("Unable to write texture atlas page %s: %s\n", pageTexture.c_str(), pageWriter.GetLastError().c_str());
+            return false;
+        }
+        pageTextures.push_back(pageTexture);
+        pageSize += pageDataSize;
+    }
+
+    // Materials on a page take the page as their texture and are drawn as the page's first material
+    std::vector<int32_t> pageMaterials(pageTextures.size(), -1);
+    std::vector<uint32_t> materialPlacements(materialCount, NOT_ATLASED);
+    for (uint32_t i = 0; i < materialCount; ++i) {
+        if (materialTextureIndices[i] == NOT_ATLASED || texturePlacements[materialTextureIndices[i]] == NOT_ATLASED) {
+            continue;
+        }
+        uint32_t placement = texturePlacements[materialTextureIndices[i]];
+        uint32_t page = atlasBuilder.GetPlacement(placement).Page;
+        materialPlacements[i] = placement;
+        (*materialTextures)[i] = pageTextures[page];
+        if (pageMaterials[page] < 0) {
+            pageMaterials[page] = static_cast<int32_t>(i);
+        }
+    }
+    auto getPlacement = [&materialPlacements, NOT_ATLASED](int32_t materialId) {
+        return materialId >= 0 && static_cast<size_t>(materialId) < materialPlacements.size() ? materialPlacements[materialId] : NOT_ATLASED;
+    };
+
+    // A vertex has one set of texture coordinates, vertices shared by textures placed differently are duplicated
+    outVertices->assign(vertices, vertices + vertexCount);
+    outIndices->assign(indices, indices + indexCount);
+    std::vector<uint32_t> vertexPlacements(vertexCount, UNCLAIMED);
+    std::map<uint64_t, uint32_t> duplicateVertices; // Vertex and placement to the duplicate
+    for (uint32_t i = 0; i < subMeshCount; ++i) {
+        auto const &subMesh = subMeshes[i];
+        uint32_t placement = getPlacement(subMesh.MaterialId);
+        for (uint32_t j = subMesh.IndexOffset; j < subMesh.IndexOffset + subMesh.IndexCount; ++j) {
+            uint32_t vertex = indices[j];
+            if (vertexPlacements[vertex] == UNCLAIMED) {
+                vertexPlacements[vertex] = placement;
+            }
+            if (vertexPlacements[vertex] == placement) {
+                continue;
+            }
+            auto inserted = duplicateVertices.emplace((static_cast<uint64_t>(vertex) << 32) | placement, static_cast<uint32_t>(outVertices->size()));
+            if (inserted.second) {
+                outVertices->push_back(vertices[vertex]);
+                vertexPlacements.push_back(placement);
+            }
+            (*outIndices)[j] = inserted.first->second;
+        }
+    }
+    for (size_t i = 0; i < outVertices->size(); ++i) {
+        if (vertexPlacements[i] >= UNCLAIMED) {
+            continue;
+        }
+        glm::vec4 transform = atlasBuilder.GetTexCoordTransform(vertexPlacements[i]);
+        glm::vec2 &texCoord = (*outVertices)[i].texCoord;
+        texCoord = glm::clamp(texCoord, glm::vec2(0.0f), glm::vec2(1.0f)) * glm::vec2(transform.x, transform.y) + glm::vec2(transform.z, transform.w);
+    }
+
+    // Submeshes are regrouped by material so everything on a page is one submesh
+    std::vector<ModelObjLoader::SubMesh> pageSubMeshes(subMeshes, subMeshes + subMeshCount);
+    for (auto &subMesh : pageSubMeshes) {
+        uint32_t placement = getPlacement(subMesh.MaterialId);
+        if (placement != NOT_ATLASED) {
+            subMesh.MaterialId = pageMaterials[atlasBuilder.GetPlacement(placement).Page];
+        }
+    }
+    std::stable_sort(pageSubMeshes.begin(), pageSubMeshes.end(), [](auto const &lhs, auto const &rhs) {
+        return lhs.MaterialId < rhs.MaterialId;
+    });
+    std::vector<uint32_t> pageIndices;
+    pageIndices.reserve(indexCount);
+    outSubMeshes->clear();
+    for (auto const &subMesh : pageSubMeshes) {
+        if (!outSubMeshes->empty() && outSubMeshes->back().MaterialId == subMesh.MaterialId) {
+            outSubMeshes->back().IndexCount += subMesh.IndexCount;
+        }
+        else {
+            outSubMeshes->push_back({ static_cast<uint32_t>(pageIndices.size()), subMesh.IndexCount, subMesh.MaterialId });
+        }
+        pageIndices.insert(pageIndices.end(), outIndices->begin() + subMesh.IndexOffset, outIndices->begin() + subMesh.IndexOffset + subMesh.IndexCount);
+    }
+    outIndices->swap(pageIndices);
+
+    // Every distinct texture is a descriptor set, bound once per draw of the model
+    uint32_t textureCount = static_cast<uint32_t>(texturePaths.size());
+    uint32_t atlasTextureCount = textureCount - atlasedTextureCount + atlasBuilder.GetPageCount();
+    LOG_INFO("Texture atlas for %s: %u of %u textures packed into %u pages, %u to %u descriptor sets and binds, %u to %u submeshes, %.2f MB to %.2f MB of textures\n",
+        filePath.c_str(), atlasedTextureCount, textureCount, atlasBuilder.GetPageCount(), textureCount, atlasTextureCount, subMeshCount,
+        static_cast<uint32_t>(outSubMeshes->size()), sourceSize / (1024.0 * 1024.0), pageSize / (1024.0 * 1024.0));
+
+    return true;
+}
+
+ModelMeshCache::MeshData ModelImporter::GetCacheData(Mesh const &mesh, std::vector<std::string> const &materialTextures) {
+    ModelMeshCache::MeshData cacheData{};
+    cacheData.VertexLayout = mesh.Layout;
+    cacheData.VertexSize = GetVertexLayoutStride(mesh.Layout);
+    cacheData.VertexCount = mesh.VertexCount;
+    cacheData.VertexData = mesh.VertexData.data();
+    cacheData.IndexDataSize = mesh.IndexData.size();
+    cacheData.IndexData = mesh.IndexData.data();
+    cacheData.SubMeshCount = static_cast<uint32_t>(mesh.SubMeshes.size());
+    cacheData.SubMeshes = mesh.SubMeshes.data();
+    cacheData.MaterialCount = static_cast<uint32_t>(materialTextures.size());
+    cacheData.MaterialTextures = materialTextures.data();
+    cacheData.MeshBounds = mesh.Bounds;
+    cacheData.TexCoordRange = mesh.TexCoordRange;
+    cacheData.MeshletCount = static_cast<uint32_t>(mesh.Meshlets.size());
+    cacheData.Meshlets = mesh.Meshlets.data();
+    cacheData.LodCount = static_cast<uint32_t>(mesh.Lods.size());
+    cacheData.Lods = mesh.Lods.data();
+    return cacheData;
+}
+
+void ModelImporter::OptimizeMesh(const TexturedVertex *vertices, size_t vertexCount, const uint32_t *indices, uint32_t indexCount,
+                                 const ModelObjLoader::SubMesh *subMeshes, uint32_t subMeshCount,
+                                 std::vector<TexturedVertex> *outVertices, std::vector<uint32_t> *outIndices) {
+    outIndices->assign(indices, indices + indexCount);
+    uint32_t *optimizedIndices = outIndices->data();
+    auto before = AnalyzeVertexCache(optimizedIndices, indexCount, vertexCount);
+
+    // Triangles are only reordered within their submesh so material ranges stay intact
+    for (uint32_t i = 0; i < subMeshCount; ++i) {
+        uint32_t *subMeshIndices = optimizedIndices + subMeshes[i].IndexOffset;
+        OptimizeVertexCache(subMeshIndices, subMeshes[i].IndexCount, vertexCount);
+        OptimizeOverdraw(subMeshIndices, subMeshes[i].IndexCount, vertices, vertexCount, sizeof(TexturedVertex), offsetof(TexturedVertex, position));
+    }
+
+    std::vector<uint32_t> remap;
+    size_t usedVertexCount = OptimizeVertexFetchRemap(optimizedIndices, indexCount, vertexCount, &remap);
+    outVertices->resize(usedVertexCount);
+    RemapVertexData(outVertices->data(), vertices, vertexCount, sizeof(TexturedVertex), remap.data());
+
+    auto after = AnalyzeVertexCache(optimizedIndices, indexCount, usedVertexCount);
+    LOG_VERBOSE("Optimized %u triangles: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %zu unused vertices removed\n",
+        after.TriangleCount, before.ACMR, after.ACMR, before.ATVR, after.ATVR, vertexCount - usedVertexCount);
+}
+
+void ModelImporter::BuildMeshlets(const TexturedVertex *vertices, size_t vertexCount, const uint32_t *indices,
+                                  const ModelObjLoader::SubMesh *subMeshes, uint32_t subMeshCount, std::vector<Meshlet> *outMeshlets) {
+    MeshletBuilder meshletBuilder;
+    meshletBuilder.SetVertexData(vertices, vertexCount, sizeof(TexturedVertex), offsetof(TexturedVertex, position));
+    for (uint32_t i = 0; i < subMeshCount; ++i) {
+        meshletBuilder.AddRange(indices + subMeshes[i].IndexOffset, subMeshes[i].IndexOffset, subMeshes[i].IndexCount, subMeshes[i].MaterialId);
+    }
+    outMeshlets->assign(meshletBuilder.GetMeshlets(), meshletBuilder.GetMeshlets() + meshletBuilder.GetMeshletCount());
+
+    uint32_t coneCount = 0;
+    for (auto const &meshlet : *outMeshlets) {
+        coneCount += meshlet.ConeCutoff < 1.0f ? 1 : 0;
+    }
+    LOG_VERBOSE("Built %zu meshlets, %u with backface cones\n", outMeshlets->size(), coneCount);
+}
+
+void ModelImporter::BuildLods(const TexturedVertex *vertices, size_t vertexCount, bool optimize, std::vector<uint32_t> *indices, std::vector<Lod> *lods) {
+    MeshSimplifier simplifier;
+    simplifier.SetVertexData(vertices, vertexCount, sizeof(TexturedVertex), offsetof(TexturedVertex, position));
+    simplifier.AddAttribute(offsetof(TexturedVertex, normal), 3, LOD_NORMAL_WEIGHT);
+    simplifier.AddAttribute(offsetof(TexturedVertex, color), 3, LOD_COLOR_WEIGHT);
+    simplifier.AddAttribute(offsetof(TexturedVertex, texCoord), 2, LOD_TEXCOORD_WEIGHT);
+
+    // Each level simplifies the previous one so errors accumulate, submeshes are simplified separately to keep their materials
+    std::vector<uint32_t> simplifiedIndices;
+    while (lods->size() < MAX_LOD_COUNT) {
+        Lod const &previous = lods->back();
+        size_t previousIndexCount = 0;
+        for (auto const &subMesh : previous.SubMeshes) {
+            previousIndexCount += subMesh.IndexCount;
+        }
+
+        Lod lod;
+        size_t lodIndexCount = 0;
+        f32 maxError = 0.0f;
+        for (auto const &subMesh : previous.SubMeshes) {
+            size_t targetIndexCount = static_cast<size_t>(subMesh.IndexCount / 3 * LOD_TRIANGLE_RATIO) * 3;
+            maxError = std::max(maxError, simplifier.Simplify(indices->data() + subMesh.IndexOffset, subMesh.IndexCount, targetIndexCount, 1.0f, &simplifiedIndices));
+            if (simplifiedIndices.empty()) {
+                continue;
+            }
+
+            if (optimize) {
+                OptimizeVertexCache(simplifiedIndices.data(), simplifiedIndices.size(), vertexCount);
+            }
+
+            ModelObjLoader::SubMesh lodSubMesh = subMesh;
+            lodSubMesh.IndexOffset = static_cast<uint32_t>(indices->size());
+            lodSubMesh.IndexCount = static_cast<uint32_t>(simplifiedIndices.size());
+            indices->insert(indices->end(), simplifiedIndices.begin(), simplifiedIndices.end());
+            lod.SubMeshes.push_back(lodSubMesh);
+            lodIndexCount += simplifiedIndices.size();
+        }
+
+        // Levels that barely reduce the mesh cost memory without making draws cheaper
+        if (lod.SubMeshes.empty() || lodIndexCount > previousIndexCount * MIN_LOD_REDUCTION) {
+            indices->resize(indices->size() - lodIndexCount);
+            break;
+        }
+
+        lod.Error = previous.Error + maxError * simplifier.GetMeshExtent();
+        LOG_VERBOSE("Built LOD %zu with %zu triangles, error %f\n", lods->size(), lodIndexCount / 3, lod.Error);
+        lods->push_back(std::move(lod));
+    }
+}
+
+ModelImporter::VertexLayout ModelImporter::EncodeVertices(const TexturedVertex *vertices, size_t vertexCount, ModelMeshCache::Bounds const &bounds,
+                                                          glm::vec4 *outTexCoordRange, std::vector<uint8_t> *outVertexData) {
+    // Colors are 1 when the obj has none, only keep them when some differ
+    // Colors outside [0, 1] and widely repeating texture coordinates need the full layout
+    bool hasColor = false;
+    bool colorInRange = true;
+    glm::vec2 texCoordMin(std::numeric_limits<f32>::max());
+    glm::vec2 texCoordMax(std::numeric_limits<f32>::lowest());
+    for (size_t i = 0; i < vertexCount; ++i) {
+        TexturedVertex const &vertex = vertices[i];
+        hasColor |= vertex.color != glm::vec3(1.0f);
+        colorInRange &= glm::all(glm::greaterThanEqual(vertex.color, glm::vec3(0.0f))) && glm::all(glm::lessThanEqual(vertex.color, glm::vec3(1.0f)));
+        texCoordMin = glm::min(texCoordMin, vertex.texCoord);
+        texCoordMax = glm::max(texCoordMax, vertex.texCoord);
+    }
+    glm::vec2 texCoordExtent = texCoordMax - texCoordMin;
+
+    VertexLayout layout = VERTEX_LAYOUT_FULL;
+    *outTexCoordRange = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+    if (vertexCount > 0 && colorInRange && texCoordExtent.x <= MAX_COMPACT_TEXCOORD_EXTENT && texCoordExtent.y <= MAX_COMPACT_TEXCOORD_EXTENT) {
+        layout = hasColor ? VERTEX_LAYOUT_COMPACT_COLOR : VERTEX_LAYOUT_COMPACT;
+        *outTexCoordRange = glm::vec4(texCoordMin, texCoordExtent);
+    }
+
+    uint32_t vertexStride = GetVertexLayoutStride(layout);
+    outVertexData->resize(vertexCount * vertexStride);
+    if (layout == VERTEX_LAYOUT_FULL) {
+        memcpy(outVertexData->data(), vertices, outVertexData->size());
+        LOG_VERBOSE("Using full vertex layout, %zu bytes\n", outVertexData->size());
+        return layout;
+    }
+
+    glm::vec3 positionExtent = bounds.Max - bounds.Min;
+    uint8_t *out = outVertexData->data();
+    for (size_t i = 0; i < vertexCount; ++i, out += vertexStride) {
+        TexturedVertex const &vertex = vertices[i];
+
+        // Both compact layouts share the same leading members
+        TexturedVertexCompactColor compact{};
+        for (int axis = 0; axis < 3; ++axis) {
+            compact.position[axis] = EncodeRangeUnorm16(vertex.position[axis], bounds.Min[axis], positionExtent[axis]);
+        }
+        EncodeOctahedralSnorm16(vertex.normal, compact.normal);
+        compact.texCoord[0] = EncodeRangeUnorm16(vertex.texCoord.x, texCoordMin.x, texCoordExtent.x);
+        compact.texCoord[1] = EncodeRangeUnorm16(vertex.texCoord.y, texCoordMin.y, texCoordExtent.y);
+        for (int channel = 0; channel < 3; ++channel) {
+            compact.color[channel] = EncodeUnorm8(vertex.color[channel]);
+        }
+        compact.color[3] = 255;
+        memcpy(out, &compact, vertexStride);
+    }
+
+    LOG_VERBOSE("Using %s vertex layout, %zu bytes instead of %zu\n",
+        layout == VERTEX_LAYOUT_COMPACT_COLOR ? "compact color" : "compact", outVertexData->size(), vertexCount * sizeof(TexturedVertex));
+    return layout;
+}
+
+uint32_t ModelImporter::GetVertexLayoutStride(VertexLayout vertexLayout) {
+    switch (vertexLayout) {
+    case VERTEX_LAYOUT_FULL:
+        return sizeof(TexturedVertex);
+    case VERTEX_LAYOUT_COMPACT:
+        return sizeof(TexturedVertexCompact);
+    case VERTEX_LAYOUT_COMPACT_COLOR:
+        return sizeof(TexturedVertexCompactColor);
+    default:
+        ASSERT(false);
+        return 0;
+    }
+}
+
+} // namespace Graphics
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "ModelObjLoader.h"
+#include "MeshletBuilder.h"
+#include "ModelMeshCache.h"
+#include "ModelGltfLoader.h"
+#include "TextureCompressor.h"
+
+namespace Graphics {
+
+class ThreadPool;
+
+// Vertex every model format is imported to, in the engine's left handed space
+// Renderers upload it as is when a mesh needs full precision
+struct TexturedVertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec3 color;
+    glm::vec2 texCoord;
+};
+
+bool operator==(TexturedVertex const &lhs, TexturedVertex const &rhs);
+
+// Compact textured vertex for meshes without vertex colors (16 bytes)
+// Positions are normalized to the mesh bounds and texture coordinates to the mesh's texture coordinate range
+struct TexturedVertexCompact {
+    uint16_t position[4]; // unorm16, w is padding as 3 component 16-bit vertex formats are rarely supported
+    int16_t normal[2];    // Octahedral snorm16
+    uint16_t texCoord[2]; // unorm16
+};
+
+// Compact textured vertex with vertex colors (20 bytes)
+struct TexturedVertexCompactColor {
+    uint16_t position[4]; // unorm16, w is padding
+    int16_t normal[2];    // Octahedral snorm16
+    uint16_t texCoord[2]; // unorm16
+    uint8_t color[4];     // unorm8, alpha unused
+};
+
+// CPU side of importing a textured static model, after the source format is parsed into welded vertices and submeshes
+// None of the steps touch a graphics API, so imports can be run and checked without a device
+// Submeshes are contiguous ranges of the indices, one per material
+class ModelImporter {
+public:
+    // Vertex layout picked per mesh from the attributes it uses, stored in mesh caches
+    enum VertexLayout : uint32_t {
+        VERTEX_LAYOUT_FULL = 0,      // TexturedVertex
+        VERTEX_LAYOUT_COMPACT,       // TexturedVertexCompact
+        VERTEX_LAYOUT_COMPACT_COLOR, // TexturedVertexCompactColor
+
+        VERTEX_LAYOUT_COUNT
+    };
+
+    // Levels of detail BuildLods generates, including full detail
+    static const uint32_t MAX_LOD_COUNT = 5;
+
+    // Submeshes of one level of detail, offsets are into the indices of every level
+    struct Lod {
+        std::vector<ModelObjLoader::SubMesh> SubMeshes;
+        f32 Error; // In model units
+    };
+
+    // Imported mesh laid out as mesh caches store it and renderers upload it
+    struct Mesh {
+        VertexLayout Layout;
+        std::vector<uint8_t> VertexData;
+        size_t VertexCount;
+        std::vector<uint8_t> IndexData;                 // Ranges of 16 and 32-bit indices, see IndexBufferCompactor
+        std::vector<ModelMeshCache::SubMesh> SubMeshes; // One level of detail after another
+        std::vector<ModelMeshCache::Lod> Lods;          // From full detail to coarsest
+        std::vector<Meshlet> Meshlets;                  // Of full detail, sorted by FirstIndex
+        ModelMeshCache::Bounds Bounds;
+        glm::vec4 TexCoordRange;                        // Min (xy) and extent (zw) of the texture coordinates in compact layouts
+    };
+
+public:
+    ModelImporter();
+    ModelImporter(ModelImporter const &) = delete;
+    ModelImporter &operator=(ModelImporter const &) = delete;
+    ~ModelImporter();
+
+    // Reorders meshes for the vertex cache, overdraw and vertex fetch, on by default
+    void SetOptimization(bool enable);
+
+    // Compresses atlas pages on the pool's threads as well, without a pool only on the calling thread
+    void SetThreadPool(ThreadPool *threadPool);
+
+    // Packs material textures of up to 256 pixels into atlas pages and writes them next to the model as DDS files, renaming the materials' textures
+    // Pages are stored in pageFormat, textures whose coordinates leave [0, 1] repeat and are left as they are
+    // Returns the mesh with texture coordinates moved into the pages and one submesh per page, or false if nothing was packed
+    // Run it before Import, it moves texture coordinates
+    bool BuildTextureAtlas(std::string const &filePath, ModelGltfLoader const &gltfLoader, TextureCompressor::BlockFormat pageFormat,
+                           const TexturedVertex *vertices, size_t vertexCount, const uint32_t *indices, uint32_t indexCount,
+                           const ModelObjLoader::SubMesh *subMeshes, uint32_t subMeshCount, std::vector<std::string> *materialTextures,
+                           std::vector<TexturedVertex> *outVertices, std::vector<uint32_t> *outIndices, std::vector<ModelObjLoader::SubMesh> *outSubMeshes) const;
+
+    // Optimizes the mesh, builds its meshlets and levels of detail, encodes the vertices and compacts the indices
+    // Only triangle lists are reordered, split into meshlets and simplified, other meshes are encoded as they are
+    void Import(const TexturedVertex *vertices, size_t vertexCount, const uint32_t *indices, uint32_t indexCount,
+                const ModelObjLoader::SubMesh *subMeshes, uint32_t subMeshCount, Mesh *outMesh) const;
+
+    // Describes an imported mesh for ModelMeshCache::Save, the description points into the mesh
+    static ModelMeshCache::MeshData GetCacheData(Mesh const &mesh, std::vector<std::string> const &materialTextures);
+
+    // Copies the mesh reordered for the vertex cache and overdraw within each submesh, with vertices in first-use order
+    // Unused vertices are dropped, the triangles of each submesh stay the same
+    static void OptimizeMesh(const TexturedVertex *vertices, size_t vertexCount, const uint32_t *indices, uint32_t indexCount,
+                             const ModelObjLoader::SubMesh *subMeshes, uint32_t subMeshCount,
+                             std::vector<TexturedVertex> *outVertices, std::vector<uint32_t> *outIndices);
+
+    // Splits every submesh into meshlets for culling, in index order so they are sorted by FirstIndex
+    // Run it on the optimized mesh, the vertex cache order keeps meshlets compact
+    static void BuildMeshlets(const TexturedVertex *vertices, size_t vertexCount, const uint32_t *indices,
+                              const ModelObjLoader::SubMesh *subMeshes, uint32_t subMeshCount, std::vector<Meshlet> *outMeshlets);
+
+    // Simplifies the last level of lods into coarser ones, appending their indices, until MAX_LOD_COUNT or simplification stalls
+    // Start with full detail as the only level, coarser levels are reordered for the vertex cache if optimize is set
+    static void BuildLods(const TexturedVertex *vertices, size_t vertexCount, bool optimize, std::vector<uint32_t> *indices, std::vector<Lod> *lods);
+
+    // Picks the vertex layout for the welded vertices and encodes them into it
+    // Compact layouts store positions relative to bounds and texture coordinates relative to outTexCoordRange, min (xy) and extent (zw)
+    static VertexLayout EncodeVertices(const TexturedVertex *vertices, size_t vertexCount, ModelMeshCache::Bounds const &bounds,
+                                       glm::vec4 *outTexCoordRange, std::vector<uint8_t> *outVertexData);
+
+    static uint32_t GetVertexLayoutStride(VertexLayout vertexLayout);
+
+private:
+    bool m_optimize;
+    ThreadPool *m_threadPool;
+};
+
+} // namespace Graphics
@@ -0,0 +1,542 @@
+#include "pch.h"
+#include "ModelMeshCache.h"
+#include "ExecutableDirectory.h"
+#include "Hash.h"
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+namespace Graphics {
+
+namespace {
+
+const char CACHE_MAGIC[4] = { 'M', 'V', 'M', 'C' };
+const uint64_t SECTION_ALIGNMENT = 16;
+
+uint64_t AlignSection(uint64_t offset) {
+    return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+}
+
+// Returns true if [offset, offset + size) lies within a file of fileSize bytes
+bool SectionInFile(uint64_t offset, uint64_t size, uint64_t fileSize) {
+    return offset <= fileSize && size <= fileSize - offset;
+}
+
+// Largest of count indices, 0 if there are none
+template<class IndexType>
+uint64_t MaxIndex(const uint8_t *indexData, uint32_t count) {
+    const IndexType *indices = reinterpret_cast<const IndexType*>(indexData);
+    IndexType maxIndex = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        maxIndex = std::max(maxIndex, indices[i]);
+    }
+    return maxIndex;
+}
+
+} // namespace
+
+// On-disk header, followed by the source path, submesh ranges, LODs, material textures, meshlets, vertex data and index data
+// Material textures are stored as a uint32_t length followed by the characters
+struct ModelMeshCache::FileHeader {
+    char Magic[4];
+    uint32_t Version;
+    uint64_t FormatKey;
+
+    // Source key
+    uint64_t SourceSize;
+    int64_t SourceModifiedTime;
+    uint64_t SourceContentHash;
+    uint32_t SourcePathLength;
+
+    uint32_t SubMeshCount;
+    uint32_t LodCount;
+    uint32_t MaterialCount;
+    uint32_t VertexSize;
+    uint32_t VertexLayout;
+    uint32_t MeshletCount;
+    uint64_t VertexCount;
+    uint64_t IndexDataSize;
+    f32 BoundsMin[3];
+    f32 BoundsMax[3];
+    f32 TexCoordRange[4];
+
+    // Section offsets from the start of the file
+    uint64_t SourcePathOffset;
+    uint64_t SubMeshOffset;
+    uint64_t LodOffset;
+    uint64_t MaterialOffset;
+    uint64_t MaterialDataSize;
+    uint64_t MeshletOffset;
+    uint64_t VertexDataOffset;
+    uint64_t IndexDataOffset;
+};
+static_assert(sizeof(ModelMeshCache::SubMesh) == 24, "Cache submesh layout changed, bump ModelMeshCache::VERSION");
+static_assert(sizeof(ModelMeshCache::Lod) == 16, "Cache LOD layout changed, bump ModelMeshCache::VERSION");
+
+ModelMeshCache::ModelMeshCache()
+  : m_header(nullptr),
+    m_bounds{ glm::vec3(0.0f), glm::vec3(0.0f) } {
+}
+
+ModelMeshCache::~ModelMeshCache() {
+}
+
+std::string const &ModelMeshCache::GetLastError() const {
+    return m_lastError;
+}
+
+std::filesystem::path ModelMeshCache::GetCachePath(std::filesystem::path const &sourceFilePath) {
+    std::filesystem::path cachePath(sourceFilePath);
+    cachePath += ".mvcache";
+    return cachePath;
+}
+
+bool ModelMeshCache::Open(std::string const &sourceFilePath, uint64_t formatKey) {
+    Close();
+
+    std::filesystem::path sourcePath = _resolvePath(sourceFilePath);
+    std::filesystem::path cachePath = GetCachePath(sourcePath);
+
+    std::error_code errorCode;
+    if (!std::filesystem::exists(cachePath, errorCode)) {
+        m_lastError = "No cache for " + sourceFilePath;
+        return false;
+    }
+
+    if (!m_file.Open(cachePath)) {
+        m_lastError = m_file.GetLastError();
+        return false;
+    }
+
+    const uint8_t *fileData = m_file.GetData();
+    uint64_t fileSize = m_file.GetSize();
+    if (fileSize < sizeof(FileHeader)) {
+        m_lastError = "Cache file is truncated: " + cachePath.u8string();
+        Close();
+        return false;
+    }
+
+    const FileHeader *header = reinterpret_cast<const FileHeader*>(fileData);
+    if (memcmp(header->Magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header->Version != VERSION || header->FormatKey != formatKey) {
+        m_lastError = "Cache file is from a different version: " + cachePath.u8string();
+        Close();
+        return false;
+    }
+
+    // Validate the sections before touching any of them
+    if (header->VertexSize == 0 ||
+        header->VertexCount > fileSize / header->VertexSize ||
+        !SectionInFile(header->SourcePathOffset, header->SourcePathLength, fileSize) ||
+        !SectionInFile(header->SubMeshOffset, static_cast<uint64_t>(header->SubMeshCount) * sizeof(SubMesh), fileSize) ||
+        !SectionInFile(header->LodOffset, static_cast<uint64_t>(header->LodCount) * sizeof(Lod), fileSize) ||
+        !SectionInFile(header->MaterialOffset, header->MaterialDataSize, fileSize) ||
+        !SectionInFile(header->MeshletOffset, static_cast<uint64_t>(header->MeshletCount) * sizeof(Meshlet), fileSize) ||
+        !SectionInFile(header->VertexDataOffset, header->VertexCount * header->VertexSize, fileSize) ||
+        !SectionInFile(header->IndexDataOffset, header->IndexDataSize, fileSize)) {
+        m_lastError = "Cache file is corrupt: " + cachePath.u8string();
+        Close();
+        return false;
+    }
+
+    // Every submesh must reference index data within the index section
+    const SubMesh *subMeshes = reinterpret_cast<const SubMesh*>(fileData + header->SubMeshOffset);
+    for (uint32_t i = 0; i < header->SubMeshCount; ++i) {
+        SubMesh const &subMesh = subMeshes[i];
+        if ((subMesh.IndexSize != sizeof(uint16_t) && subMesh.IndexSize != sizeof(uint32_t)) ||
+            !SectionInFile(static_cast<uint64_t>(subMesh.IndexOffset) * subMesh.IndexSize, static_cast<uint64_t>(subMesh.IndexCount) * subMesh.IndexSize, header->IndexDataSize)) {
+            m_lastError = "Cache file is corrupt: " + cachePath.u8string();
+            Close();
+            return false;
+        }
+    }
+
+    // Every index must refer to a vertex in the vertex section once the submesh's base vertex is added
+    const uint8_t *indexData = fileData + header->IndexDataOffset;
+    for (uint32_t i = 0; i < header->SubMeshCount; ++i) {
+        SubMesh const &subMesh = subMeshes[i];
+        if (subMesh.IndexCount == 0) {
+            continue;
+        }
+        const uint8_t *subMeshIndices = indexData + static_cast<uint64_t>(subMesh.IndexOffset) * subMesh.IndexSize;
+        uint64_t maxIndex = subMesh.IndexSize == sizeof(uint16_t) ? MaxIndex<uint16_t>(subMeshIndices, subMesh.IndexCount) :
+                                                                    MaxIndex<uint32_t>(subMeshIndices, subMesh.IndexCount);
+        if (subMesh.BaseVertex + maxIndex >= header->VertexCount) {
+            m_lastError = "Cache file is corrupt: " + cachePath.u8string();
+            Close();
+            return false;
+        }
+    }
+
+    // Meshlets must be in order without overlapping and each one must lie within the submeshes it was built from
+    // Draws find a range's meshlets by binary search and draw their indices, so either would read past the range
+    std::vector<std::pair<uint64_t, uint64_t>> sourceRanges;
+    for (uint32_t i = 0; i < header->SubMeshCount; ++i) {
+        uint64_t sourceFirstIndex = subMeshes[i].SourceFirstIndex;
+        sourceRanges.emplace_back(sourceFirstIndex, sourceFirstIndex + subMeshes[i].IndexCount);
+    }
+    std::sort(sourceRanges.begin(), sourceRanges.end());
+    std::vector<std::pair<uint64_t, uint64_t>> mergedRanges;
+    for (auto const &range : sourceRanges) {
+        // Submeshes split for 16-bit indices are adjacent, meshlets may cross the split
+        if (!mergedRanges.empty() && range.first <= mergedRanges.back().second) {
+            mergedRanges.back().second = std::max(mergedRanges.back().second, range.second);
+        }
+        else {
+            mergedRanges.push_back(range);
+        }
+    }
+    const Meshlet *meshlets = reinterpret_cast<const Meshlet*>(fileData + header->MeshletOffset);
+    uint64_t previousEnd = 0;
+    size_t rangeIndex = 0;
+    for (uint32_t i = 0; i < header->MeshletCount; ++i) {
+        uint64_t start = meshlets[i].FirstIndex;
+        uint64_t end = start + static_cast<uint64_t>(meshlets[i].TriangleCount) * 3;
+        while (rangeIndex < mergedRanges.size() && mergedRanges[rangeIndex].second < end) {
+            ++rangeIndex;
+        }
+        if (start < previousEnd || end > std::numeric_limits<uint32_t>::max() ||
+            rangeIndex == mergedRanges.size() || mergedRanges[rangeIndex].first > start) {
+            m_lastError = "Cache file is corrupt: " + cachePath.u8string();
+            Close();
+            return false;
+        }
+        previousEnd = end;
+    }
+
+    // LODs must cover submeshes that exist
+    const Lod *lods = reinterpret_cast<const Lod*>(fileData + header->LodOffset);
+    for (uint32_t i = 0; i < header->LodCount; ++i) {
+        if (lods[i].FirstSubMesh > header->SubMeshCount || lods[i].SubMeshCount > header->SubMeshCount - lods[i].FirstSubMesh) {
+            m_lastError = "Cache file is corrupt: " + cachePath.u8string();
+            Close();
+            return false;
+        }
+    }
+
+    // Check the cache was built from this source file
+    std::string sourcePathString = sourcePath.u8string();
+    if (sourcePathString.size() != header->SourcePathLength ||
+        memcmp(sourcePathString.data(), fileData + header->SourcePathOffset, header->SourcePathLength) != 0) {
+        m_lastError = "Cache file belongs to a different source: " + cachePath.u8string();
+        Close();
+        return false;
+    }
+
+    // Size and time are cheap to check, only hash the contents if both match
+    SourceKey sourceKey;
+    if (!_readSourceKey(sourcePath, false, &sourceKey)) {
+        Close();
+        return false;
+    }
+    if (sourceKey.Size != header->SourceSize || sourceKey.ModifiedTime != header->SourceModifiedTime) {
+        m_lastError = "Cache file is stale: " + cachePath.u8string();
+        Close();
+        return false;
+    }
+    if (!_readSourceKey(sourcePath, true, &sourceKey)) {
+        Close();
+        return false;
+    }
+    if (sourceKey.ContentHash != header->SourceContentHash) {
+        m_lastError = "Cache file is stale: " + cachePath.u8string();
+        Close();
+        return false;
+    }
+
+    // Unpack material textures
+    const uint8_t *materialData = fileData + header->MaterialOffset;
+    uint64_t materialDataRemaining = header->MaterialDataSize;
+    bool materialsValid = true;
+    m_materialTextures.resize(header->MaterialCount);
+    for (auto &materialTexture : m_materialTextures) {
+        uint32_t length;
+        if (materialDataRemaining < sizeof(length)) {
+            materialsValid = false;
+            break;
+        }
+        memcpy(&length, materialData, sizeof(length));
+        materialData += sizeof(length);
+        materialDataRemaining -= sizeof(length);
+
+        if (materialDataRemaining < length) {
+            materialsValid = false;
+            break;
+        }
+        materialTexture.assign(reinterpret_cast<const char*>(materialData), length);
+        materialData += length;
+        materialDataRemaining -= length;
+    }
+    if (!materialsValid || materialDataRemaining != 0) {
+        m_lastError = "Cache file is corrupt: " + cachePath.u8string();
+        Close();
+        return false;
+    }
+
+    m_header = header;
+    m_bounds.Min = glm::vec3(header->BoundsMin[0], header->BoundsMin[1], header->BoundsMin[2]);
+    m_bounds.Max = glm::vec3(header->BoundsMax[0], header->BoundsMax[1], header->BoundsMax[2]);
+    m_lastError.clear();
+    return true;
+}
+
+void ModelMeshCache::Close() {
+    m_file.Close();
+    m_header = nullptr;
+    m_materialTextures.clear();
+    m_bounds.Min = glm::vec3(0.0f);
+    m_bounds.Max = glm::vec3(0.0f);
+}
+
+bool ModelMeshCache::Save(std::string const &sourceFilePath, uint64_t formatKey, MeshData const &meshData) {
+    ASSERT(meshData.VertexSize != 0);
+    ASSERT(meshData.VertexData || meshData.VertexCount == 0);
+    ASSERT(meshData.IndexData || meshData.IndexDataSize == 0);
+    ASSERT(meshData.SubMeshes || meshData.SubMeshCount == 0);
+    ASSERT(meshData.MaterialTextures || meshData.MaterialCount == 0);
+    ASSERT(meshData.Meshlets || meshData.MeshletCount == 0);
+    ASSERT(meshData.Lods || meshData.LodCount == 0);
+
+    std::filesystem::path sourcePath = _resolvePath(sourceFilePath);
+    std::filesystem::path cachePath = GetCachePath(sourcePath);
+
+    SourceKey sourceKey;
+    if (!_readSourceKey(sourcePath, true, &sourceKey)) {
+        return false;
+    }
+
+    std::string sourcePathString = sourcePath.u8string();
+
+    std::vector<uint8_t> materialData;
+    for (uint32_t i = 0; i < meshData.MaterialCount; ++i) {
+        std::string const &texture = meshData.MaterialTextures[i];
+        uint32_t length = static_cast<uint32_t>(texture.size());
+        const uint8_t *lengthBytes = reinterpret_cast<const uint8_t*>(&length);
+        materialData.insert(materialData.end(), lengthBytes, lengthBytes + sizeof(length));
+        materialData.insert(materialData.end(), texture.begin(), texture.end());
+    }
+
+    FileHeader header{};
+    memcpy(header.Magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.Version = VERSION;
+    header.FormatKey = formatKey;
+    header.SourceSize = sourceKey.Size;
+    header.SourceModifiedTime = sourceKey.ModifiedTime;
+    header.SourceContentHash = sourceKey.ContentHash;
+    header.SourcePathLength = static_cast<uint32_t>(sourcePathString.size());
+    header.SubMeshCount = meshData.SubMeshCount;
+    header.LodCount = meshData.LodCount;
+    header.MaterialCount = meshData.MaterialCount;
+    header.VertexSize = meshData.VertexSize;
+    header.VertexLayout = meshData.VertexLayout;
+    header.MeshletCount = meshData.MeshletCount;
+    header.VertexCount = meshData.VertexCount;
+    header.IndexDataSize = meshData.IndexDataSize;
+    for (int i = 0; i < 3; ++i) {
+        header.BoundsMin[i] = meshData.MeshBounds.Min[i];
+        header.BoundsMax[i] = meshData.MeshBounds.Max[i];
+    }
+    for (int i = 0; i < 4; ++i) {
+        header.TexCoordRange[i] = meshData.TexCoordRange[i];
+    }
+
+    // Sections are aligned so the mapped data can be used directly
+    header.SourcePathOffset = sizeof(FileHeader);
+    header.SubMeshOffset = AlignSection(header.SourcePathOffset + header.SourcePathLength);
+    header.LodOffset = AlignSection(header.SubMeshOffset + static_cast<uint64_t>(header.SubMeshCount) * sizeof(SubMesh));
+    header.MaterialOffset = AlignSection(header.LodOffset + static_cast<uint64_t>(header.LodCount) * sizeof(Lod));
+    header.MaterialDataSize = materialData.size();
+    header.MeshletOffset = AlignSection(header.MaterialOffset + header.MaterialDataSize);
+    header.VertexDataOffset = AlignSection(header.MeshletOffset + static_cast<uint64_t>(header.MeshletCount) * sizeof(Meshlet));
+    header.IndexDataOffset = AlignSection(header.VertexDataOffset + header.VertexCount * header.VertexSize);
+    uint64_t fileSize = header.IndexDataOffset + header.IndexDataSize;
+
+    // Write to a temporary file first so a partially written cache is never picked up
+    std::filesystem::path tempPath(cachePath);
+    tempPath += ".tmp";
+    {
+        std::ofstream cacheFile(tempPath, std::ios::binary | std::ios::trunc);
+        if (!cacheFile) {
+            m_lastError = "Unable to create cache file: " + tempPath.u8string();
+            return false;
+        }
+
+        const char padding[SECTION_ALIGNMENT] = {};
+        auto writeSection = [&](uint64_t offset, const void *data, uint64_t size) {
+            uint64_t position = static_cast<uint64_t>(cacheFile.tellp());
+            ASSERT(position <= offset);
+            cacheFile.write(padding, static_cast<std::streamsize>(offset - position));
+            cacheFile.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+        };
+
+        cacheFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writeSection(header.SourcePathOffset, sourcePathString.data(), header.SourcePathLength);
+        writeSection(header.SubMeshOffset, meshData.SubMeshes, static_cast<uint64_t>(header.SubMeshCount) * sizeof(SubMesh));
+        writeSection(header.LodOffset, meshData.Lods, static_cast<uint64_t>(header.LodCount) * sizeof(Lod));
+        writeSection(header.MaterialOffset, materialData.data(), header.MaterialDataSize);
+        writeSection(header.MeshletOffset, meshData.Meshlets, static_cast<uint64_t>(header.MeshletCount) * sizeof(Meshlet));
+        writeSection(header.VertexDataOffset, meshData.VertexData, header.VertexCount * header.VertexSize);
+        writeSection(header.IndexDataOffset, meshData.IndexData, header.IndexDataSize);
+
+        if (!cacheFile || static_cast<uint64_t>(cacheFile.tellp()) != fileSize) {
+            m_lastError = "Unable to write cache file: " + tempPath.u8string();
+            cacheFile.close();
+            std::error_code errorCode;
+            std::filesystem::remove(tempPath, errorCode);
+            return false;
+        }
+    }
+
+    // Replaces any existing cache
+    std::error_code errorCode;
+    std::filesystem::rename(tempPath, cachePath, errorCode);
+    if (errorCode) {
+        m_lastError = "Unable to replace cache file: " + cachePath.u8string() + " (" + errorCode.message() + ")";
+        std::filesystem::remove(tempPath, errorCode);
+        return false;
+    }
+
+    return true;
+}
+
+bool ModelMeshCache::IsOpen() const {
+    return m_header != nullptr;
+}
+
+uint32_t ModelMeshCache::GetVertexLayout() const {
+    ASSERT(m_header);
+    return m_header->VertexLayout;
+}
+
+uint32_t ModelMeshCache::GetVertexSize() const {
+    ASSERT(m_header);
+    return m_header->VertexSize;
+}
+
+uint64_t ModelMeshCache::GetVertexCount() const {
+    ASSERT(m_header);
+    return m_header->VertexCount;
+}
+
+const void *ModelMeshCache::GetVertexData() const {
+    ASSERT(m_header);
+    return m_file.GetData() + m_header->VertexDataOffset;
+}
+
+uint64_t ModelMeshCache::GetIndexDataSize() const {
+    ASSERT(m_header);
+    return m_header->IndexDataSize;
+}
+
+const void *ModelMeshCache::GetIndexData() const {
+    ASSERT(m_header);
+    return m_file.GetData() + m_header->IndexDataOffset;
+}
+
+uint32_t ModelMeshCache::GetSubMeshCount() const {
+    ASSERT(m_header);
+    return m_header->SubMeshCount;
+}
+
+const ModelMeshCache::SubMesh *ModelMeshCache::GetSubMeshes() const {
+    ASSERT(m_header);
+    return reinterpret_cast<const SubMesh*>(m_file.GetData() + m_header->SubMeshOffset);
+}
+
+uint32_t ModelMeshCache::GetMaterialCount() const {
+    ASSERT(m_header);
+    return m_header->MaterialCount;
+}
+
+std::string const &ModelMeshCache::GetMaterialTexture(uint32_t materialIndex) const {
+    return m_materialTextures[materialIndex];
+}
+
+uint32_t ModelMeshCache::GetLodCount() const {
+    ASSERT(m_header);
+    return m_header->LodCount;
+}
+
+const ModelMeshCache::Lod *ModelMeshCache::GetLods() const {
+    ASSERT(m_header);
+    return reinterpret_cast<const Lod*>(m_file.GetData() + m_header->LodOffset);
+}
+
+uint32_t ModelMeshCache::GetMeshletCount() const {
+    ASSERT(m_header);
+    return m_header->MeshletCount;
+}
+
+const Meshlet *ModelMeshCache::GetMeshlets() const {
+    ASSERT(m_header);
+    return reinterpret_cast<const Meshlet*>(m_file.GetData() + m_header->MeshletOffset);
+}
+
+ModelMeshCache::Bounds const &ModelMeshCache::GetBounds() const {
+    return m_bounds;
+}
+
+glm::vec4 ModelMeshCache::GetTexCoordRange() const {
+    ASSERT(m_header);
+    return glm::vec4(m_header->TexCoordRange[0], m_header->TexCoordRange[1], m_header->TexCoordRange[2], m_header->TexCoordRange[3]);
+}
+
+ModelMeshCache::Bounds ModelMeshCache::ComputeBounds(const void *vertexData, uint64_t vertexCount, uint32_t vertexSize, uint32_t positionOffset) {
+    Bounds bounds{ glm::vec3(0.0f), glm::vec3(0.0f) };
+    if (vertexCount == 0) {
+        return bounds;
+    }
+
+    bounds.Min = glm::vec3(std::numeric_limits<f32>::max());
+    bounds.Max = glm::vec3(std::numeric_limits<f32>::lowest());
+
+    const uint8_t *cur = reinterpret_cast<const uint8_t*>(vertexData) + positionOffset;
+    for (uint64_t i = 0; i < vertexCount; ++i, cur += vertexSize) {
+        glm::vec3 position;
+        memcpy(&position, cur, sizeof(position));
+        bounds.Min = glm::min(bounds.Min, position);
+        bounds.Max = glm::max(bounds.Max, position);
+    }
+
+    return bounds;
+}
+
+std::filesystem::path ModelMeshCache::_resolvePath(std::string const &sourceFilePath) {
+    std::filesystem::path exePath = GetExecutableDirectory();
+
+    exePath /= sourceFilePath;
+    return exePath.lexically_normal();
+}
+
+bool ModelMeshCache::_readSourceKey(std::filesystem::path const &sourcePath, bool computeHash, SourceKey *outKey) {
+    ASSERT(outKey);
+
+    std::error_code errorCode;
+    auto modifiedTime = std::filesystem::last_write_time(sourcePath, errorCode);
+    if (errorCode) {
+        m_lastError = "Unable to query source file: " + sourcePath.u8string();
+        return false;
+    }
+    uint64_t size = std::filesystem::file_size(sourcePath, errorCode);
+    if (errorCode) {
+        m_lastError = "Unable to query source file: " + sourcePath.u8string();
+        return false;
+    }
+
+    outKey->Size = size;
+    outKey->ModifiedTime = static_cast<int64_t>(modifiedTime.time_since_epoch().count());
+    outKey->ContentHash = 0;
+
+    if (computeHash) {
+        MemoryMappedFile sourceFile;
+        if (!sourceFile.Open(sourcePath)) {
+            m_lastError = sourceFile.GetLastError();
+            return false;
+        }
+        outKey->ContentHash = HashBytes64(sourceFile.GetData(), sourceFile.GetSize());
+    }
+
+    return true;
+}
+
+} // namespace Graphics
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "MemoryMappedFile.h"
+#include "MeshletBuilder.h"
+#include <filesystem>
+
+namespace Graphics {
+
+// Binary cache of a fully imported model
+// Stores the final deduplicated vertex and index streams so later loads can skip parsing the source file
+// The cache is written next to the source file and is keyed by the source path, modification time, size and content hash
+// Material libraries are not part of the key, so edits to a .mtl alone need the cache to be deleted
+// Any mismatch (or a different format version / vertex format key) makes the cache stale and it is rebuilt from the source
+class ModelMeshCache {
+public:
+    // Bump whenever the layout of the cache file changes
+    static const uint32_t VERSION = 7;
+
+    // Submeshes carry their own index size so ranges of 16 and 32-bit indices can share the index data
+    struct SubMesh {
+        uint32_t IndexOffset; // In units of IndexSize from the start of the index data
+        uint32_t IndexCount;
+        int32_t MaterialId;   // -1 if unused
+        uint32_t IndexSize;
+        uint32_t BaseVertex;  // Added to every index of the submesh
+        uint32_t SourceFirstIndex; // Position of the first index as if every submesh was 32-bit, which meshlets refer to
+    };
+
+    // Submeshes of one level of detail, stored one level after another starting with full detail
+    struct Lod {
+        uint32_t FirstSubMesh;
+        uint32_t SubMeshCount;
+        f32 Error; // In model units
+        uint32_t Reserved;
+    };
+
+    struct Bounds {
+        glm::vec3 Min;
+        glm::vec3 Max;
+    };
+
+    // Describes the data to store in the cache
+    struct MeshData {
+        uint32_t VertexLayout; // Identifies the encoding of the vertex data, defined by the code using the cache
+        uint32_t VertexSize;
+        uint64_t VertexCount;
+        const void *VertexData;
+        uint64_t IndexDataSize; // In bytes
+        const void *IndexData;
+        uint32_t SubMeshCount;
+        const SubMesh *SubMeshes;
+        uint32_t MaterialCount;
+        const std::string *MaterialTextures; // One per material id, empty if the material has no texture
+        Bounds MeshBounds;
+        glm::vec4 TexCoordRange; // Min (xy) and extent (zw) used to normalize texture coordinates, if the layout does
+        uint32_t MeshletCount;
+        const Meshlet *Meshlets; // FirstIndex counts indices of the submeshes in order, as if they were all 32-bit
+        uint32_t LodCount;
+        const Lod *Lods;
+    };
+
+public:
+    ModelMeshCache();
+    ModelMeshCache(ModelMeshCache const &) = delete;
+    ModelMeshCache &operator=(ModelMeshCache const &) = delete;
+    ~ModelMeshCache();
+
+    std::string const &GetLastError() const;
+
+    // Returns the path the cache for the given source file is stored at
+    static std::filesystem::path GetCachePath(std::filesystem::path const &sourceFilePath);
+
+    // Maps the cache of the given source file (relative to the executable)
+    // formatKey identifies the vertex format the data was built with, so different writers never share a cache
+    // Returns false if there is no cache or it is stale
+    bool Open(std::string const &sourceFilePath, uint64_t formatKey);
+    void Close();
+
+    // Writes a new cache for the given source file (relative to the executable)
+    bool Save(std::string const &sourceFilePath, uint64_t formatKey, MeshData const &meshData);
+
+    bool IsOpen() const;
+
+    uint32_t GetVertexLayout() const;
+    uint32_t GetVertexSize() const;
+    uint64_t GetVertexCount() const;
+    const void *GetVertexData() const;
+
+    uint64_t GetIndexDataSize() const;
+    const void *GetIndexData() const;
+
+    uint32_t GetSubMeshCount() const;
+    const SubMesh *GetSubMeshes() const;
+
+    uint32_t GetMaterialCount() const;
+    std::string const &GetMaterialTexture(uint32_t materialIndex) const;
+
+    uint32_t GetLodCount() const;
+    const Lod *GetLods() const;
+
+    uint32_t GetMeshletCount() const;
+    const Meshlet *GetMeshlets() const;
+
+    Bounds const &GetBounds() const;
+    glm::vec4 GetTexCoordRange() const;
+
+    // Computes the bounds of tightly packed vertices with a float3 position at positionOffset
+    static Bounds ComputeBounds(const void *vertexData, uint64_t vertexCount, uint32_t vertexSize, uint32_t positionOffset);
+
+private:
+    struct FileHeader;
+    struct SourceKey {
+        uint64_t Size;
+        int64_t ModifiedTime;
+        uint64_t ContentHash;
+    };
+
+    static std::filesystem::path _resolvePath(std::string const &sourceFilePath);
+    bool _readSourceKey(std::filesystem::path const &sourcePath, bool computeHash, SourceKey *outKey);
+
+private:
+    MemoryMappedFile m_file;
+    const FileHeader *m_header;
+    std::vector<std::string> m_materialTextures;
+    Bounds m_bounds;
+    std::string m_lastError;
+};
+
+} // namespace Graphics
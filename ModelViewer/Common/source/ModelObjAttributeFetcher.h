@@ -0,0 +1,41 @@
+#pragma once
+
+#include <tinyobjloader/tiny_obj_loader.h>
+
+namespace Graphics {
+
+// Implementation of ModelObjAttributeFetcher for fetching the attribute data vertex writers read
+// Shared by every loader that drives a ModelObjVertexWriter, the arrays use tinyobj's layout
+class ModelObjAttributeFetcher {
+public:
+    ModelObjAttributeFetcher() 
+      : Vertices(nullptr),
+        VertexWeights(nullptr),
+        Normals(nullptr),
+        TexCoords(nullptr),
+        TexCoordsW(nullptr),
+        Colors(nullptr),
+        Indices(nullptr),
+        MaterialIds(nullptr),
+        SmoothingGroupIds(nullptr) {
+    }
+
+    ~ModelObjAttributeFetcher() {
+    }
+
+    // Attribute Data
+    std::vector<float> *Vertices;
+    std::vector<float> *VertexWeights;
+    std::vector<float> *Normals;
+    std::vector<float> *TexCoords;
+    std::vector<float> *TexCoordsW;
+    std::vector<float> *Colors;
+    //TODO: skin weights
+
+    // Mesh Data
+    std::vector<tinyobj::index_t> *Indices;
+    std::vector<int> *MaterialIds;
+    std::vector<unsigned int> *SmoothingGroupIds;
+};
+
+} // namespace Graphics
@@ -1,69 +1,37 @@
 #include "pch.h"
 #include "ModelObjLoader.h"
+#include "ModelObjParallelParser.h"
+#include "ModelObjAttributeFetcher.h"
+#include "MemoryMappedFile.h"
+#include "ExecutableDirectory.h"
+#include "Hash.h"
 #include <filesystem>
-
-#pragma warning( push, 0 )
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tinyobjloader/tiny_obj_loader.h>
-#pragma warning( pop )
+#include <chrono>
+#include <cstring>
+#include <algorithm>
 
 namespace Graphics {
 
-// Local implementation of ModelObjAttributeFetcher for fetching the stored attribute data of loaded obj files
-class ModelObjAttributeFetcher {
-public:
-    ModelObjAttributeFetcher() 
-      : Vertices(nullptr),
-        VertexWeights(nullptr),
-        Normals(nullptr),
-        TexCoords(nullptr),
-        TexCoordsW(nullptr),
-        Colors(nullptr),
-        Indices(nullptr),
-        MaterialIds(nullptr),
-        SmoothingGroupIds(nullptr) {
-    }
-
-    ~ModelObjAttributeFetcher() {
-    }
-
-    // Attribute Data
-    std::vector<float> *Vertices;
-    std::vector<float> *VertexWeights;
-    std::vector<float> *Normals;
-    std::vector<float> *TexCoords;
-    std::vector<float> *TexCoordsW;
-    std::vector<float> *Colors;
-    //TODO: skin weights
-
-    // Mesh Data
-    std::vector<tinyobj::index_t> *Indices;
-    std::vector<int> *MaterialIds;
-    std::vector<unsigned int> *SmoothingGroupIds;
-};
-
 ModelObjLoader::ModelObjLoader()
-  : m_vertexSize(0),
+  : m_threadPool(nullptr),
+    m_vertexSize(0),
     m_indexSize(sizeof(uint32_t)) {
 }
 
 ModelObjLoader::~ModelObjLoader() {
 
 }
+
+void ModelObjLoader::SetThreadPool(ThreadPool *threadPool) {
+    m_threadPool = threadPool;
+}
+
 #pragma warning( push )
 #pragma warning( disable : 6011 )
 std::string ModelObjLoader::Load(std::string const &objFilePath, ModelObjVertexWriter *vertexWriter) {
     ASSERT(vertexWriter);
 
-#ifdef _WIN32
-    wchar_t cwd[MAX_PATH];
-    auto ret = GetModuleFileName(NULL, cwd, MAX_PATH);
-    ASSERT(ret != 0);
-    std::filesystem::path exePath(cwd);
-    exePath = exePath.parent_path();
-#else
-#error Not Supported
-#endif
+    std::filesystem::path exePath = GetExecutableDirectory();
 
     exePath /= objFilePath;
 
@@ -72,8 +40,37 @@ std::string ModelObjLoader::Load(std::string const &objFilePath, ModelObjVertexW
     std::vector<tinyobj::material_t> materials;
     std::string warn, err;
 
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, exePath.u8string().c_str())) {
-        return warn + err;
+    // Parsers read straight from the mapped file
+    MemoryMappedFile objFile;
+    if (!objFile.Open(exePath)) {
+        return objFile.GetLastError();
+    }
+    const char *objData = reinterpret_cast<const char*>(objFile.GetData());
+    std::string mtlBaseDir = exePath.parent_path().u8string();
+
+    if (m_threadPool) {
+        auto startTime = std::chrono::steady_clock::now();
+
+        ModelObjParallelParser parser(m_threadPool);
+        if (!parser.Parse(objData, objFile.GetSize(), mtlBaseDir, &attrib, &shapes, &materials, &warn, &err)) {
+            return warn + err;
+        }
+
+        f64 parseSeconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - startTime).count();
+        LOG_VERBOSE("Parsed %s (%.2f MB) in %.3f ms using %u chunks: %.1f MB/s\n",
+            objFilePath.c_str(),
+            objFile.GetSize() / (1024.0 * 1024.0),
+            parseSeconds * 1000.0,
+            parser.GetLastChunkCount(),
+            parseSeconds > 0.0 ? objFile.GetSize() / (1024.0 * 1024.0) / parseSeconds : 0.0);
+    }
+    else {
+        MemoryStreamBuffer objStreamBuffer(objData, objFile.GetSize());
+        std::istream objStream(&objStreamBuffer);
+        tinyobj::MaterialFileReader materialReader(mtlBaseDir + static_cast<char>(std::filesystem::path::preferred_separator));
+        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, &objStream, &materialReader)) {
+            return warn + err;
+        }
     }
 
     /* Initialize the vertex writer */
@@ -87,8 +84,21 @@ std::string ModelObjLoader::Load(std::string const &objFilePath, ModelObjVertexW
     m_vertexData.reserve(shapes.size());
     m_indexData.clear();
     m_indexData.reserve(shapes.size());
+    m_subMeshData.clear();
+    m_subMeshData.reserve(shapes.size());
     vertexWriter->m_boundVertexData = &m_vertexData;
     vertexWriter->m_boundIndexData = &m_indexData;
+    vertexWriter->m_boundSubMeshData = &m_subMeshData;
+    vertexWriter->m_appendToCurrentMesh = false;
+
+    // Material data
+    m_materials.clear();
+    m_materials.reserve(materials.size());
+    for (auto &material : materials) {
+        auto &newMaterial = m_materials.emplace_back();
+        newMaterial.Name = material.name;
+        newMaterial.DiffuseTexture = material.diffuse_texname;
+    }
 
     // Attribute data
     tempAttribFetcher.Vertices = &attrib.vertices;
@@ -100,6 +110,7 @@ std::string ModelObjLoader::Load(std::string const &objFilePath, ModelObjVertexW
     //TODO: skin weight
 
     /* Call the vertex writer to build each mesh */
+    auto writeStartTime = std::chrono::steady_clock::now();
     for (size_t i = 0; i < shapes.size(); ++i) {
         // Index data
         tempAttribFetcher.Indices = &shapes[i].mesh.indices;
@@ -113,12 +124,31 @@ std::string ModelObjLoader::Load(std::string const &objFilePath, ModelObjVertexW
         );
     }
 
+    // Writers that do not track materials draw each mesh as a whole
+    for (size_t i = 0; i < m_subMeshData.size(); ++i) {
+        if (m_subMeshData[i].empty() && !m_indexData[i].empty()) {
+            m_subMeshData[i].push_back({ 0, static_cast<uint32_t>(m_indexData[i].size() / m_indexSize), -1 });
+        }
+    }
+
+    if (m_vertexSize > 0 && m_indexSize > 0) {
+        size_t totalVertices = 0, totalIndices = 0;
+        for (size_t i = 0; i < m_vertexData.size(); ++i) {
+            totalVertices += m_vertexData[i].size() / m_vertexSize;
+            totalIndices += m_indexData[i].size() / m_indexSize;
+        }
+        f64 writeSeconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - writeStartTime).count();
+        LOG_VERBOSE("Built %zu meshes from %s in %.3f ms: %zu indices, %zu unique vertices\n",
+            m_vertexData.size(), objFilePath.c_str(), writeSeconds * 1000.0, totalIndices, totalVertices);
+    }
+
     // Try to clear up excess unused memory
     m_vertexData.shrink_to_fit();
     m_indexData.shrink_to_fit();
     for (size_t i = 0; i < m_vertexData.size(); ++i) {
         m_vertexData[i].shrink_to_fit();
         m_indexData[i].shrink_to_fit();
+        m_subMeshData[i].shrink_to_fit();
     }
 
     return "";
@@ -149,13 +179,61 @@ const void *ModelObjLoader::GetIndexData(uint32_t meshIndex) const {
     return m_indexData[meshIndex].data();
 }
 
+uint32_t ModelObjLoader::GetSubMeshCount(uint32_t meshIndex) const {
+    return static_cast<uint32_t>(m_subMeshData[meshIndex].size());
+}
+
+const ModelObjLoader::SubMesh *ModelObjLoader::GetSubMeshes(uint32_t meshIndex) const {
+    return m_subMeshData[meshIndex].data();
+}
+
+void ModelObjLoader::BatchSubMeshesByMaterial(uint32_t meshIndex) {
+    SubMeshArray &subMeshes = m_subMeshData[meshIndex];
+    DataBuffer &indexData = m_indexData[meshIndex];
+
+    SubMeshArray sortedSubMeshes(subMeshes);
+    std::stable_sort(sortedSubMeshes.begin(), sortedSubMeshes.end(), [](SubMesh const &lhs, SubMesh const &rhs) {
+        return lhs.MaterialId < rhs.MaterialId;
+    });
+
+    // Copy each range to its new position, merging ranges of the same material
+    DataBuffer batchedIndexData(indexData.size());
+    SubMeshArray batchedSubMeshes;
+    uint32_t indexOffset = 0;
+    for (auto &subMesh : sortedSubMeshes) {
+        memcpy(batchedIndexData.data() + static_cast<size_t>(indexOffset) * m_indexSize,
+            indexData.data() + static_cast<size_t>(subMesh.IndexOffset) * m_indexSize,
+            static_cast<size_t>(subMesh.IndexCount) * m_indexSize);
+
+        if (!batchedSubMeshes.empty() && batchedSubMeshes.back().MaterialId == subMesh.MaterialId) {
+            batchedSubMeshes.back().IndexCount += subMesh.IndexCount;
+        }
+        else {
+            batchedSubMeshes.push_back({ indexOffset, subMesh.IndexCount, subMesh.MaterialId });
+        }
+        indexOffset += subMesh.IndexCount;
+    }
+    ASSERT(static_cast<size_t>(indexOffset) * m_indexSize == indexData.size());
+
+    indexData.swap(batchedIndexData);
+    subMeshes.swap(batchedSubMeshes);
+}
+
+uint32_t ModelObjLoader::GetMaterialCount() const {
+    return static_cast<uint32_t>(m_materials.size());
+}
+
+ModelObjLoader::Material const &ModelObjLoader::GetMaterial(uint32_t materialIndex) const {
+    return m_materials[materialIndex];
+}
+
 ModelObjVertexWriter::ModelObjVertexWriter()
   : m_boundVertexData(nullptr),
     m_boundIndexData(nullptr),
+    m_boundSubMeshData(nullptr),
     m_attributeFetcher(nullptr),
-    m_uniqueVertices(1,
-        std::bind(&ModelObjVertexWriter::_vertexHashFunc, this, std::placeholders::_1),
-        std::bind(&ModelObjVertexWriter::_vertexCompFunc, this, std::placeholders::_1, std::placeholders::_2)) {
+    m_uniqueVertexSize(0),
+    m_appendToCurrentMesh(false) {
 }
 
 ModelObjVertexWriter::~ModelObjVertexWriter() {
@@ -170,26 +248,21 @@ uint32_t ModelObjVertexWriter::AddMesh(uint32_t maxDataSize) {
 
     auto &newMeshVertex = m_boundVertexData->emplace_back();
     auto &newMeshIndex = m_boundIndexData->emplace_back();
+    m_boundSubMeshData->emplace_back();
 
     newMeshVertex.reserve(maxDataSize);
     newMeshIndex.reserve((maxDataSize / GetVertexSize()) * GetIndexSize());
 
-    m_uniqueVertices.clear();
+    m_uniqueVertices.Clear();
+    m_uniqueVertexSize = GetVertexSize();
 
     return newIndex;
 }
 
 void ModelObjVertexWriter::ReserveCurrentMesh(uint32_t maxDataSize) {
+    // Unique vertices are tracked by index so they remain valid if the vertex data is re-allocated
     if (m_boundVertexData->back().capacity() < m_boundVertexData->back().size() + maxDataSize) {
         m_boundVertexData->back().reserve(m_boundVertexData->back().size() + maxDataSize);
-
-        // Vertex data will have been re-allocated so the current unique vertices keys are invalidated
-        m_uniqueVertices.clear();
-        uint32_t vertexSize = GetVertexSize();
-        uint32_t curIndex = 0;
-        for (size_t i = 0; i < m_boundVertexData->back().size(); i += vertexSize, ++curIndex) {
-            m_uniqueVertices[m_boundVertexData->back().data() + i] = curIndex;
-        }
     }
     m_boundIndexData->back().reserve((m_boundIndexData->back().size() + maxDataSize / GetVertexSize()) * GetIndexSize());
 }
@@ -203,14 +276,14 @@ uint32_t ModelObjVertexWriter::AddVertex(void *vertexData) {
     // Check if this is a new vertex or if it already exists in the buffer somewhere
     uint32_t newIndex;
     if (CheckForUniqueVertex()) {
-        auto foundUniqueVertexIt = m_uniqueVertices.find(vertexData);
-        if (foundUniqueVertexIt == m_uniqueVertices.end()) {
-            newIndex = static_cast<uint32_t>(vertexBuffer.size() / vertexSize);
+        uint32_t nextIndex = static_cast<uint32_t>(vertexBuffer.size() / vertexSize);
+        newIndex = m_uniqueVertices.FindOrInsert(HashVertex(vertexData), nextIndex, [&](uint32_t storedIndex) {
+            return CompareVertex(vertexBuffer.data() + (static_cast<size_t>(storedIndex) * vertexSize), vertexData);
+        });
+        if (newIndex == nextIndex) {
             vertexBuffer.insert(vertexBuffer.end(), vertexSize, 0);
-            memcpy(vertexBuffer.data() + (newIndex * vertexSize), vertexData, vertexSize);
-            foundUniqueVertexIt = m_uniqueVertices.insert(foundUniqueVertexIt, std::make_pair(reinterpret_cast<void*>(vertexBuffer.data() + (newIndex * vertexSize)), static_cast<uint32_t>(newIndex)));
+            memcpy(vertexBuffer.data() + (static_cast<size_t>(newIndex) * vertexSize), vertexData, vertexSize);
         }
-        newIndex = foundUniqueVertexIt->second;
     }
     else {
         newIndex = static_cast<uint32_t>(vertexBuffer.size() / vertexSize);
@@ -242,6 +315,22 @@ uint32_t ModelObjVertexWriter::AddVertex(void *vertexData) {
     return newIndex;
 }
 
+void ModelObjVertexWriter::AddSubMesh(uint32_t indexOffset, uint32_t indexCount, int materialId) {
+    if (indexCount == 0) {
+        return;
+    }
+
+    ModelObjLoader::SubMeshArray &subMeshes = m_boundSubMeshData->back();
+    if (!subMeshes.empty()) {
+        auto &lastSubMesh = subMeshes.back();
+        if (lastSubMesh.MaterialId == materialId && lastSubMesh.IndexOffset + lastSubMesh.IndexCount == indexOffset) {
+            lastSubMesh.IndexCount += indexCount;
+            return;
+        }
+    }
+    subMeshes.push_back({ indexOffset, indexCount, materialId });
+}
+
 f32 ModelObjVertexWriter::AttributeVertex(uint32_t i) {
     return m_attributeFetcher->Vertices->at(i);
 }
@@ -283,24 +372,48 @@ uint32_t ModelObjVertexWriter::FaceSmoothingGroupId(uint32_t i) {
     return m_attributeFetcher->SmoothingGroupIds->at(i);
 }
 
-bool ModelObjVertexWriter::CheckForUniqueVertex() const {
-    return false;
+static_assert(sizeof(tinyobj::index_t) == sizeof(int) * 3 &&
+    offsetof(tinyobj::index_t, vertex_index) == 0 &&
+    offsetof(tinyobj::index_t, normal_index) == sizeof(int) &&
+    offsetof(tinyobj::index_t, texcoord_index) == sizeof(int) * 2,
+    "RawIndexType must match tinyobj::index_t");
+
+ModelObjVertexWriter::AttributeArray ModelObjVertexWriter::AttributeVertices() const {
+    return { m_attributeFetcher->Vertices->data(), m_attributeFetcher->Vertices->size() };
+}
+
+ModelObjVertexWriter::AttributeArray ModelObjVertexWriter::AttributeNormals() const {
+    return { m_attributeFetcher->Normals->data(), m_attributeFetcher->Normals->size() };
 }
 
-size_t ModelObjVertexWriter::HashVertex(void*) const {
-    return 0;
+ModelObjVertexWriter::AttributeArray ModelObjVertexWriter::AttributeTexCoords() const {
+    return { m_attributeFetcher->TexCoords->data(), m_attributeFetcher->TexCoords->size() };
 }
 
-bool ModelObjVertexWriter::CompareVertex(void*, void*) const {
+ModelObjVertexWriter::AttributeArray ModelObjVertexWriter::AttributeColors() const {
+    return { m_attributeFetcher->Colors->data(), m_attributeFetcher->Colors->size() };
+}
+
+const ModelObjVertexWriter::RawIndexType *ModelObjVertexWriter::FaceIndices() const {
+    return reinterpret_cast<const RawIndexType*>(m_attributeFetcher->Indices->data());
+}
+
+const int *ModelObjVertexWriter::FaceMaterialIds() const {
+    return m_attributeFetcher->MaterialIds->data();
+}
+
+bool ModelObjVertexWriter::CheckForUniqueVertex() const {
     return false;
 }
 
-size_t ModelObjVertexWriter::_vertexHashFunc(void *vertexData) const {
-    return HashVertex(vertexData);
+size_t ModelObjVertexWriter::HashVertex(void *vertexData) const {
+    // Folding the high half in keeps every bit of the 64-bit hash where size_t is 32 bits, and changes nothing where it is 64
+    uint64_t hash = HashBytes64(vertexData, m_uniqueVertexSize);
+    return static_cast<size_t>(hash ^ (hash >> 32));
 }
 
-bool ModelObjVertexWriter::_vertexCompFunc(void *vertexDataLhs, void *vertexDataRhs) const {
-    return CompareVertex(vertexDataLhs, vertexDataRhs);
+bool ModelObjVertexWriter::CompareVertex(void *vertexDataLeft, void *vertexDataRight) const {
+    return memcmp(vertexDataLeft, vertexDataRight, m_uniqueVertexSize) == 0;
 }
 
 } // namespace Graphics
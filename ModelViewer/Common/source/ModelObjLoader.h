@@ -1,21 +1,40 @@
 #pragma once
-#include <unordered_map>
-#include <functional>
+#include "VertexWeldTable.h"
 
 namespace Graphics {
 
 class ModelObjVertexWriter;
 class ModelObjAttributeFetcher;
+class ThreadPool;
 
 class ModelObjLoader {
 public:
     typedef std::vector<uint8_t> DataBuffer;
     typedef std::vector<DataBuffer> MeshDataBuffer;
 
+    // Range of a mesh's index data drawn with a single material
+    struct SubMesh {
+        uint32_t IndexOffset;
+        uint32_t IndexCount;
+        int32_t MaterialId; // -1 if unused
+    };
+    typedef std::vector<SubMesh> SubMeshArray;
+    typedef std::vector<SubMeshArray> MeshSubMeshBuffer;
+
+    struct Material {
+        std::string Name;
+        std::string DiffuseTexture; // Relative to the obj file's directory, empty if unused
+    };
+
 public:
     ModelObjLoader();
     ~ModelObjLoader();
 
+    // When a thread pool is set, the obj file is parsed in parallel chunks across the pool's threads
+    // Otherwise the file is parsed on the calling thread
+    // Either way the resulting vertex and index data is identical
+    void SetThreadPool(ThreadPool *threadPool);
+
     std::string Load(std::string const &objFilePath, ModelObjVertexWriter *vertexWriter);
 
     uint32_t GetVertexSize() const;
@@ -26,13 +45,25 @@ public:
     uint32_t GetIndexCount(uint32_t meshIndex) const;
     const void *GetIndexData(uint32_t meshIndex) const;
 
-    //TODO: materials
+    // Submeshes are in the order they were written, usually one per shape and material
+    uint32_t GetSubMeshCount(uint32_t meshIndex) const;
+    const SubMesh *GetSubMeshes(uint32_t meshIndex) const;
+
+    // Reorders the mesh's index data so every material is contiguous, leaving one submesh per material
+    // Submeshes end up sorted by material id
+    void BatchSubMeshesByMaterial(uint32_t meshIndex);
+
+    uint32_t GetMaterialCount() const;
+    Material const &GetMaterial(uint32_t materialIndex) const;
 
 private:
+    ThreadPool *m_threadPool;
     uint32_t m_vertexSize;
     uint32_t m_indexSize;
     MeshDataBuffer m_vertexData;
     MeshDataBuffer m_indexData;
+    MeshSubMeshBuffer m_subMeshData;
+    std::vector<Material> m_materials;
 };
 
 class ModelObjVertexWriter {
@@ -44,6 +75,20 @@ protected:
         uint32_t TexCoordIndex;
     };
 
+    // Matches the layout of the parser's face indices so they can be read in place
+    // -1 means unused
+    struct RawIndexType {
+        int VertexIndex;
+        int NormalIndex;
+        int TexCoordIndex;
+    };
+
+    // Unchecked view of one of the obj file's attribute arrays
+    struct AttributeArray {
+        const f32 *Data;
+        size_t Count;
+    };
+
 public:
     ModelObjVertexWriter();
     ModelObjVertexWriter(ModelObjVertexWriter const &) = delete;
@@ -65,7 +110,7 @@ public:
 
     // Optional override
     // Return false if not using hashes to track unique vertices
-    // Otherwise return true and override HashVertex and CompareVertex
+    // Otherwise return true; HashVertex and CompareVertex default to hashing and comparing the raw vertex bytes
     virtual bool CheckForUniqueVertex() const;
     virtual size_t HashVertex(void *vertexData) const;
     virtual bool CompareVertex(void *vertexDataLeft, void *vertexDataRight) const;
@@ -81,6 +126,11 @@ public:
     // Adds a vertex to the last created mesh, returning the index of the (new) vertex
     virtual uint32_t AddVertex(void *vertexData);
 
+    // Marks a range of the last created mesh's indices as using the given material
+    // Adjacent ranges with the same material are merged
+    // Meshes without any submeshes get a single submesh covering all of their indices with no material
+    void AddSubMesh(uint32_t indexOffset, uint32_t indexCount, int materialId);
+
 protected:
     // Fetches the obj file's attribute data
     f32 AttributeVertex(uint32_t i);       // Corresponds to VertexIndex
@@ -96,16 +146,28 @@ protected:
     int FaceMaterialId(uint32_t i);            // One per triangle
     uint32_t FaceSmoothingGroupId(uint32_t i); // One per triangle (0 = unused)
 
+    // Raw access to the same data without bounds checks, for writers that process a whole mesh at once
+    AttributeArray AttributeVertices() const;
+    AttributeArray AttributeNormals() const;
+    AttributeArray AttributeTexCoords() const;
+    AttributeArray AttributeColors() const;
+    const RawIndexType *FaceIndices() const;
+    const int *FaceMaterialIds() const;
+
 protected:
     friend class ModelObjLoader;
+    friend class ModelScanLoader;
     ModelObjLoader::MeshDataBuffer *m_boundVertexData;
     ModelObjLoader::MeshDataBuffer *m_boundIndexData;
+    ModelObjLoader::MeshSubMeshBuffer *m_boundSubMeshData;
     ModelObjAttributeFetcher *m_attributeFetcher;
 
-private:
-    size_t _vertexHashFunc(void *vertexData) const;
-    bool _vertexCompFunc(void *vertexDataLhs, void *vertexDataRhs) const;
-    std::unordered_map<void*, uint32_t, std::function<size_t(void*)>, std::function<bool(void*, void*)>> m_uniqueVertices;
+    // Vertices of the current mesh, keyed by index into the mesh's vertex data
+    VertexWeldTable m_uniqueVertices;
+    uint32_t m_uniqueVertexSize;
+
+    // Set by loaders that write one mesh over several WriteMesh calls, so later calls append to the current mesh
+    bool m_appendToCurrentMesh;
 };
 
 } // namespace Graphics
@@ -0,0 +1,667 @@
+#include "pch.h"
+#include "ModelObjParallelParser.h"
+#include "ThreadPool.h"
+#include "MemoryMappedFile.h"
+
+#pragma warning( push, 0 )
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tinyobjloader/tiny_obj_loader.h>
+#pragma warning( pop )
+
+namespace Graphics {
+
+namespace {
+
+// A single face corner as it was written in the file
+// Relative (negative) indices cannot be resolved until the vertex counts of all previous chunks are known,
+// so they are stored as an offset from the start of the chunk
+struct ObjRawCorner {
+    enum RelativeFlags : uint8_t {
+        RELATIVE_VERTEX = 1 << 0,
+        RELATIVE_TEXCOORD = 1 << 1,
+        RELATIVE_NORMAL = 1 << 2,
+    };
+
+    int vertexIndex;
+    int texCoordIndex;
+    int normalIndex;
+    uint8_t relativeFlags;
+};
+
+// A line that changes the parser state (usemtl, mtllib, g, o, s)
+// These are replayed in order during the merge, before the face at faceIndex
+struct ObjStateCommand {
+    size_t faceIndex;
+    size_t lineNumber;
+    std::string line;
+};
+
+struct ObjChunk {
+    typedef std::vector<tinyobj::real_t> RealArray;
+
+    const char *begin;
+    const char *end;
+    size_t lineCount;
+
+    RealArray vertices;
+    RealArray vertexWeights;
+    RealArray normals;
+    RealArray texCoords;
+    RealArray colors;
+    bool foundAllColors;
+
+    std::vector<ObjRawCorner> corners;
+    std::vector<size_t> faceCornerOffsets;
+    std::vector<size_t> faceLineNumbers;
+    std::vector<size_t> zeroIndexFaces; // Faces that produce tinyobj's zero index warning, once per occurrence
+    std::vector<ObjStateCommand> commands;
+
+    // Set when the chunk contains something only tinyobj::LoadObj handles
+    bool requiresFallback;
+    bool failed;
+    size_t failedLineNumber;
+};
+
+// Make a face index zero based, matching tinyobj's fixIndex
+// Negative indices are made relative to the start of the chunk instead of resolved
+bool FixRawIndex(int idx, int localCount, bool allowZero, int *ret, bool *relative, bool *zeroFound) {
+    *relative = false;
+
+    if (idx > 0) {
+        *ret = idx - 1;
+        return true;
+    }
+
+    if (idx == 0) {
+        *zeroFound = true;
+        *ret = -1;
+        return allowZero;
+    }
+
+    *ret = localCount + idx;
+    *relative = true;
+    return true;
+}
+
+// Mirror of tinyobj's parseTriple
+bool ParseRawTriple(const char **token, ObjChunk &chunk, ObjRawCorner *ret, bool *zeroFound) {
+    int localVertexCount = static_cast<int>(chunk.vertices.size() / 3);
+    int localNormalCount = static_cast<int>(chunk.normals.size() / 3);
+    int localTexCoordCount = static_cast<int>(chunk.texCoords.size() / 2);
+
+    ObjRawCorner corner{ -1, -1, -1, 0 };
+    bool relative;
+
+    if (!FixRawIndex(atoi(*token), localVertexCount, false, &corner.vertexIndex, &relative, zeroFound)) {
+        return false;
+    }
+    corner.relativeFlags |= relative ? ObjRawCorner::RELATIVE_VERTEX : 0;
+
+    (*token) += strcspn((*token), "/ \t\r");
+    if ((*token)[0] != '/') {
+        *ret = corner;
+        return true;
+    }
+    (*token)++;
+
+    // i//k
+    if ((*token)[0] == '/') {
+        (*token)++;
+        if (!FixRawIndex(atoi(*token), localNormalCount, true, &corner.normalIndex, &relative, zeroFound)) {
+            return false;
+        }
+        corner.relativeFlags |= relative ? ObjRawCorner::RELATIVE_NORMAL : 0;
+        (*token) += strcspn((*token), "/ \t\r");
+        *ret = corner;
+        return true;
+    }
+
+    // i/j/k or i/j
+    if (!FixRawIndex(atoi(*token), localTexCoordCount, true, &corner.texCoordIndex, &relative, zeroFound)) {
+        return false;
+    }
+    corner.relativeFlags |= relative ? ObjRawCorner::RELATIVE_TEXCOORD : 0;
+
+    (*token) += strcspn((*token), "/ \t\r");
+    if ((*token)[0] != '/') {
+        *ret = corner;
+        return true;
+    }
+
+    // i/j/k
+    (*token)++;
+    if (!FixRawIndex(atoi(*token), localNormalCount, true, &corner.normalIndex, &relative, zeroFound)) {
+        return false;
+    }
+    corner.relativeFlags |= relative ? ObjRawCorner::RELATIVE_NORMAL : 0;
+    (*token) += strcspn((*token), "/ \t\r");
+
+    *ret = corner;
+    return true;
+}
+
+// Tokenizes a chunk and parses all of its numbers
+// The per-line logic follows tinyobj::LoadObj so that the merged result is identical
+void ParseChunk(ObjChunk &chunk) {
+    using namespace tinyobj;
+
+    std::string linebuf;
+    const char *cur = chunk.begin;
+    size_t lineNumber = 0;
+
+    while (cur < chunk.end) {
+        // Same line ending rules as tinyobj's safeGetline
+        const char *lineEnd = cur;
+        while (lineEnd < chunk.end && *lineEnd != '\n' && *lineEnd != '\r') {
+            ++lineEnd;
+        }
+        linebuf.assign(cur, lineEnd);
+        if (lineEnd < chunk.end && *lineEnd == '\r' && lineEnd + 1 < chunk.end && lineEnd[1] == '\n') {
+            cur = lineEnd + 2;
+        }
+        else {
+            cur = lineEnd + 1;
+        }
+
+        ++lineNumber;
+
+        if (linebuf.empty()) {
+            continue;
+        }
+
+        const char *token = linebuf.c_str();
+        token += strspn(token, " \t");
+
+        if (token[0] == '\0' || token[0] == '#') {
+            continue;
+        }
+
+        // vertex
+        if (token[0] == 'v' && IS_SPACE(token[1])) {
+            token += 2;
+            real_t x, y, z;
+            real_t r, g, b;
+
+            int numComponents = parseVertexWithColor(&x, &y, &z, &r, &g, &b, &token);
+            chunk.foundAllColors &= (numComponents == 6);
+
+            chunk.vertices.push_back(x);
+            chunk.vertices.push_back(y);
+            chunk.vertices.push_back(z);
+
+            // r = w, and initialized to 1.0 when `w` component is not found
+            chunk.vertexWeights.push_back(r);
+
+            // Vertex colors always use the default fallback
+            chunk.colors.push_back(r);
+            chunk.colors.push_back(g);
+            chunk.colors.push_back(b);
+            continue;
+        }
+
+        // normal
+        if (token[0] == 'v' && token[1] == 'n' && IS_SPACE(token[2])) {
+            token += 3;
+            real_t x, y, z;
+            parseReal3(&x, &y, &z, &token);
+            chunk.normals.push_back(x);
+            chunk.normals.push_back(y);
+            chunk.normals.push_back(z);
+            continue;
+        }
+
+        // texcoord
+        if (token[0] == 'v' && token[1] == 't' && IS_SPACE(token[2])) {
+            token += 3;
+            real_t x, y;
+            parseReal2(&x, &y, &token);
+            chunk.texCoords.push_back(x);
+            chunk.texCoords.push_back(y);
+            continue;
+        }
+
+        // skin weights, lines, points and tags are rare enough that they are left to tinyobj
+        if ((token[0] == 'v' && token[1] == 'w' && IS_SPACE(token[2])) ||
+            (token[0] == 'l' && IS_SPACE(token[1])) ||
+            (token[0] == 'p' && IS_SPACE(token[1])) ||
+            (token[0] == 't' && IS_SPACE(token[1]))) {
+            chunk.requiresFallback = true;
+            return;
+        }
+
+        // face
+        if (token[0] == 'f' && IS_SPACE(token[1])) {
+            token += 2;
+            token += strspn(token, " \t");
+
+            chunk.faceCornerOffsets.push_back(chunk.corners.size());
+            chunk.faceLineNumbers.push_back(lineNumber);
+
+            while (!IS_NEW_LINE(token[0])) {
+                ObjRawCorner corner;
+                bool zeroFound = false;
+                bool parsed = ParseRawTriple(&token, chunk, &corner, &zeroFound);
+                if (zeroFound) {
+                    chunk.zeroIndexFaces.push_back(chunk.faceCornerOffsets.size() - 1);
+                }
+                if (!parsed) {
+                    chunk.failed = true;
+                    chunk.failedLineNumber = lineNumber;
+                    return;
+                }
+                chunk.corners.push_back(corner);
+
+                size_t n = strspn(token, " \t\r");
+                token += n;
+            }
+            continue;
+        }
+
+        // State changes are applied during the merge
+        if ((0 == strncmp(token, "usemtl", 6)) ||
+            ((0 == strncmp(token, "mtllib", 6)) && IS_SPACE(token[6])) ||
+            (token[0] == 'g' && IS_SPACE(token[1])) ||
+            (token[0] == 'o' && IS_SPACE(token[1])) ||
+            (token[0] == 's' && IS_SPACE(token[1]))) {
+            chunk.commands.push_back({ chunk.faceCornerOffsets.size(), lineNumber, linebuf });
+            continue;
+        }
+
+        // Ignore unknown command.
+    }
+
+    chunk.lineCount = lineNumber;
+}
+
+} // namespace
+
+ModelObjParallelParser::ModelObjParallelParser(ThreadPool *threadPool)
+  : m_threadPool(threadPool),
+    m_minChunkSize(1024 * 1024),
+    m_lastChunkCount(0) {
+}
+
+ModelObjParallelParser::~ModelObjParallelParser() {
+}
+
+void ModelObjParallelParser::SetMinChunkSize(size_t minChunkSize) {
+    m_minChunkSize = std::max(minChunkSize, size_t(1));
+}
+
+size_t ModelObjParallelParser::GetMinChunkSize() const {
+    return m_minChunkSize;
+}
+
+uint32_t ModelObjParallelParser::GetLastChunkCount() const {
+    return m_lastChunkCount;
+}
+
+bool ModelObjParallelParser::Parse(
+  const char *data,
+  size_t dataSize,
+  std::string const &mtlBaseDir,
+  tinyobj::attrib_t *attrib,
+  std::vector<tinyobj::shape_t> *shapes,
+  std::vector<tinyobj::material_t> *materials,
+  std::string *warn,
+  std::string *err) {
+    using namespace tinyobj;
+
+    ASSERT(attrib);
+    ASSERT(shapes);
+
+    attrib->vertices.clear();
+    attrib->normals.clear();
+    attrib->texcoords.clear();
+    attrib->colors.clear();
+    shapes->clear();
+
+    std::string baseDir = mtlBaseDir;
+    if (!baseDir.empty()) {
+#ifndef _WIN32
+        const char dirsep = '/';
+#else
+        const char dirsep = '\\';
+#endif
+        if (baseDir[baseDir.length() - 1] != dirsep) {
+            baseDir += dirsep;
+        }
+    }
+    MaterialFileReader matFileReader(baseDir);
+
+#pragma region Split into chunks
+    uint32_t threadCount = m_threadPool ? m_threadPool->GetThreadCount() + 1 : 1;
+    size_t chunkCount = std::min(static_cast<size_t>(threadCount), std::max(dataSize / m_minChunkSize, size_t(1)));
+
+    std::vector<ObjChunk> chunks;
+    chunks.reserve(chunkCount);
+    const char *chunkBegin = data;
+    const char *dataEnd = data + dataSize;
+    for (size_t i = 1; i <= chunkCount && chunkBegin < dataEnd; ++i) {
+        // Chunks always end just after a '\n' so that no line (including "\r\n" endings) is split
+        const char *chunkEnd = dataEnd;
+        if (i != chunkCount) {
+            chunkEnd = std::max(data + (dataSize / chunkCount) * i, chunkBegin);
+            const char *newLine = reinterpret_cast<const char*>(memchr(chunkEnd, '\n', dataEnd - chunkEnd));
+            chunkEnd = newLine ? newLine + 1 : dataEnd;
+        }
+
+        ObjChunk &chunk = chunks.emplace_back();
+        chunk.begin = chunkBegin;
+        chunk.end = chunkEnd;
+        chunk.lineCount = 0;
+        chunk.foundAllColors = true;
+        chunk.requiresFallback = false;
+        chunk.failed = false;
+        chunk.failedLineNumber = 0;
+
+        chunkBegin = chunkEnd;
+    }
+    m_lastChunkCount = static_cast<uint32_t>(chunks.size());
+#pragma endregion
+
+#pragma region Parse chunks
+    if (m_threadPool && chunks.size() > 1) {
+        m_threadPool->ParallelFor(static_cast<uint32_t>(chunks.size()), [&chunks](uint32_t i) {
+            ParseChunk(chunks[i]);
+        });
+    }
+    else {
+        for (auto &chunk : chunks) {
+            ParseChunk(chunk);
+        }
+    }
+
+    for (auto &chunk : chunks) {
+        if (chunk.requiresFallback) {
+            MemoryStreamBuffer streamBuffer(data, dataSize);
+            std::istream stream(&streamBuffer);
+            m_lastChunkCount = 1;
+            return LoadObj(attrib, shapes, materials, warn, err, &stream, &matFileReader);
+        }
+    }
+#pragma endregion
+
+#pragma region Merge chunks
+    // From here on this follows tinyobj::LoadObj, replaying the chunks in file order
+    std::vector<real_t> v;
+    std::vector<real_t> vertexWeights;
+    std::vector<real_t> vn;
+    std::vector<real_t> vt;
+    std::vector<real_t> vc;
+    std::vector<tag_t> tags;
+    PrimGroup primGroup;
+    std::string name;
+
+    std::set<std::string> materialFilenames;
+    std::map<std::string, int> materialMap;
+    int material = -1;
+
+    unsigned int currentSmoothingId = 0;
+
+    int greatestVIdx = -1;
+    int greatestVnIdx = -1;
+    int greatestVtIdx = -1;
+
+    shape_t shape;
+
+    // Pre-size the attribute arrays, they are simply concatenated
+    size_t totalVertices = 0, totalNormals = 0, totalTexCoords = 0;
+    for (auto &chunk : chunks) {
+        totalVertices += chunk.vertices.size();
+        totalNormals += chunk.normals.size();
+        totalTexCoords += chunk.texCoords.size();
+    }
+    v.reserve(totalVertices);
+    vertexWeights.reserve(totalVertices / 3);
+    vc.reserve(totalVertices);
+    vn.reserve(totalNormals);
+    vt.reserve(totalTexCoords);
+
+    for (auto &chunk : chunks) {
+        v.insert(v.end(), chunk.vertices.begin(), chunk.vertices.end());
+        vertexWeights.insert(vertexWeights.end(), chunk.vertexWeights.begin(), chunk.vertexWeights.end());
+        vn.insert(vn.end(), chunk.normals.begin(), chunk.normals.end());
+        vt.insert(vt.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+        vc.insert(vc.end(), chunk.colors.begin(), chunk.colors.end());
+    }
+
+    size_t lineBase = 0;
+    int vertexBase = 0, normalBase = 0, texCoordBase = 0;
+    for (auto &chunk : chunks) {
+        size_t faceCount = chunk.faceCornerOffsets.size();
+        size_t commandIndex = 0;
+        size_t zeroIndexWarningIndex = 0;
+
+        for (size_t faceIndex = 0; faceIndex <= faceCount; ++faceIndex) {
+            // Apply any state changes that appear before this face
+            for (; commandIndex < chunk.commands.size() && chunk.commands[commandIndex].faceIndex == faceIndex; ++commandIndex) {
+                ObjStateCommand &command = chunk.commands[commandIndex];
+                size_t lineNumber = lineBase + command.lineNumber;
+                const char *token = command.line.c_str();
+                token += strspn(token, " \t");
+
+                // use mtl
+                if (0 == strncmp(token, "usemtl", 6)) {
+                    token += 6;
+                    std::string namebuf = parseString(&token);
+
+                    int newMaterialId = -1;
+                    auto it = materialMap.find(namebuf);
+                    if (it != materialMap.end()) {
+                        newMaterialId = it->second;
+                    }
+                    else if (warn) {
+                        (*warn) += "material [ '" + namebuf + "' ] not found in .mtl\n";
+                    }
+
+                    if (newMaterialId != material) {
+                        exportGroupsToShape(&shape, primGroup, tags, material, name, true, v, warn);
+                        primGroup.faceGroup.clear();
+                        material = newMaterialId;
+                    }
+                    continue;
+                }
+
+                // load mtl
+                if (0 == strncmp(token, "mtllib", 6)) {
+                    token += 7;
+
+                    std::vector<std::string> filenames;
+                    SplitString(std::string(token), ' ', '\\', filenames);
+
+                    if (filenames.empty()) {
+                        if (warn) {
+                            (*warn) += "Looks like empty filename for mtllib. Use default material (line " + toString(lineNumber) + ".)\n";
+                        }
+                    }
+                    else {
+                        bool found = false;
+                        for (size_t s = 0; s < filenames.size(); s++) {
+                            if (materialFilenames.count(filenames[s]) > 0) {
+                                found = true;
+                                continue;
+                            }
+
+                            std::string warnMtl;
+                            std::string errMtl;
+                            bool ok = matFileReader(filenames[s].c_str(), materials, &materialMap, &warnMtl, &errMtl);
+                            if (warn && !warnMtl.empty()) {
+                                (*warn) += warnMtl;
+                            }
+                            if (err && !errMtl.empty()) {
+                                (*err) += errMtl;
+                            }
+
+                            if (ok) {
+                                found = true;
+                                materialFilenames.insert(filenames[s]);
+                                break;
+                            }
+                        }
+
+                        if (!found && warn) {
+                            (*warn) += "Failed to load material file(s). Use default material.\n";
+                        }
+                    }
+                    continue;
+                }
+
+                // group name
+                if (token[0] == 'g') {
+                    exportGroupsToShape(&shape, primGroup, tags, material, name, true, v, warn);
+                    if (shape.mesh.indices.size() > 0) {
+                        shapes->push_back(shape);
+                    }
+                    shape = shape_t();
+                    primGroup.clear();
+
+                    std::vector<std::string> names;
+                    while (!IS_NEW_LINE(token[0])) {
+                        names.push_back(parseString(&token));
+                        token += strspn(token, " \t\r");
+                    }
+
+                    // names[0] must be 'g'
+                    if (names.size() < 2) {
+                        if (warn) {
+                            (*warn) += "Empty group name. line: " + toString(lineNumber) + "\n";
+                            name = "";
+                        }
+                    }
+                    else {
+                        std::stringstream ss;
+                        ss << names[1];
+                        for (size_t i = 2; i < names.size(); i++) {
+                            ss << " " << names[i];
+                        }
+                        name = ss.str();
+                    }
+                    continue;
+                }
+
+                // object name
+                if (token[0] == 'o') {
+                    exportGroupsToShape(&shape, primGroup, tags, material, name, true, v, warn);
+                    if (shape.mesh.indices.size() > 0 || shape.lines.indices.size() > 0 || shape.points.indices.size() > 0) {
+                        shapes->push_back(shape);
+                    }
+                    primGroup.clear();
+                    shape = shape_t();
+
+                    token += 2;
+                    name = token;
+                    continue;
+                }
+
+                // smoothing group id
+                if (token[0] == 's') {
+                    token += 2;
+                    token += strspn(token, " \t");
+
+                    if (token[0] == '\0') {
+                        continue;
+                    }
+                    if (token[0] == '\r' || token[1] == '\n') {
+                        continue;
+                    }
+
+                    if (strlen(token) >= 3 && token[0] == 'o' && token[1] == 'f' && token[2] == 'f') {
+                        currentSmoothingId = 0;
+                    }
+                    else {
+                        int smGroupId = parseInt(&token);
+                        currentSmoothingId = smGroupId < 0 ? 0 : static_cast<unsigned int>(smGroupId);
+                    }
+                    continue;
+                }
+            }
+
+            if (faceIndex == faceCount) {
+                break;
+            }
+
+            for (; zeroIndexWarningIndex < chunk.zeroIndexFaces.size() && chunk.zeroIndexFaces[zeroIndexWarningIndex] == faceIndex; ++zeroIndexWarningIndex) {
+                if (warn) {
+                    (*warn) += "A zero value index found (will have a value of -1 for normal and tex indices. Line " +
+                        toString(lineBase + chunk.faceLineNumbers[faceIndex]) + ").\n";
+                }
+            }
+
+            // Resolve the face indices now that the global attribute counts are known
+            size_t cornerBegin = chunk.faceCornerOffsets[faceIndex];
+            size_t cornerEnd = faceIndex + 1 < faceCount ? chunk.faceCornerOffsets[faceIndex + 1] : chunk.corners.size();
+
+            face_t face;
+            face.smoothing_group_id = currentSmoothingId;
+            face.vertex_indices.reserve(std::max(cornerEnd - cornerBegin, size_t(3)));
+
+            for (size_t i = cornerBegin; i < cornerEnd; ++i) {
+                const ObjRawCorner &corner = chunk.corners[i];
+                vertex_index_t vi(
+                    corner.vertexIndex + ((corner.relativeFlags & ObjRawCorner::RELATIVE_VERTEX) ? vertexBase : 0),
+                    corner.texCoordIndex + ((corner.relativeFlags & ObjRawCorner::RELATIVE_TEXCOORD) ? texCoordBase : 0),
+                    corner.normalIndex + ((corner.relativeFlags & ObjRawCorner::RELATIVE_NORMAL) ? normalBase : 0));
+
+                if ((corner.relativeFlags & ObjRawCorner::RELATIVE_VERTEX && vi.v_idx < 0) ||
+                    (corner.relativeFlags & ObjRawCorner::RELATIVE_TEXCOORD && vi.vt_idx < 0) ||
+                    (corner.relativeFlags & ObjRawCorner::RELATIVE_NORMAL && vi.vn_idx < 0)) {
+                    if (err) {
+                        (*err) += "Failed to parse `f' line (e.g. a zero value for vertex index or invalid relative vertex index). Line " +
+                            toString(lineBase + chunk.faceLineNumbers[faceIndex]) + ").\n";
+                    }
+                    return false;
+                }
+
+                greatestVIdx = std::max(greatestVIdx, vi.v_idx);
+                greatestVnIdx = std::max(greatestVnIdx, vi.vn_idx);
+                greatestVtIdx = std::max(greatestVtIdx, vi.vt_idx);
+
+                face.vertex_indices.push_back(vi);
+            }
+
+            primGroup.faceGroup.push_back(std::move(face));
+        }
+
+        if (chunk.failed) {
+            if (err) {
+                (*err) += "Failed to parse `f' line (e.g. a zero value for vertex index or invalid relative vertex index). Line " +
+                    toString(lineBase + chunk.failedLineNumber) + ").\n";
+            }
+            return false;
+        }
+
+        lineBase += chunk.lineCount;
+        vertexBase += static_cast<int>(chunk.vertices.size() / 3);
+        normalBase += static_cast<int>(chunk.normals.size() / 3);
+        texCoordBase += static_cast<int>(chunk.texCoords.size() / 2);
+    }
+
+    if (greatestVIdx >= static_cast<int>(v.size() / 3) && warn) {
+        (*warn) += "Vertex indices out of bounds (line " + toString(lineBase) + ".)\n\n";
+    }
+    if (greatestVnIdx >= static_cast<int>(vn.size() / 3) && warn) {
+        (*warn) += "Vertex normal indices out of bounds (line " + toString(lineBase) + ".)\n\n";
+    }
+    if (greatestVtIdx >= static_cast<int>(vt.size() / 2) && warn) {
+        (*warn) += "Vertex texcoord indices out of bounds (line " + toString(lineBase) + ".)\n\n";
+    }
+
+    bool ret = exportGroupsToShape(&shape, primGroup, tags, material, name, true, v, warn);
+    if (ret || shape.mesh.indices.size()) {
+        shapes->push_back(shape);
+    }
+    primGroup.clear();
+#pragma endregion
+
+    attrib->vertices.swap(v);
+    attrib->vertex_weights.swap(vertexWeights);
+    attrib->normals.swap(vn);
+    attrib->texcoords.swap(vt);
+    attrib->texcoord_ws.swap(vt);
+    attrib->colors.swap(vc);
+
+    return true;
+}
+
+} // namespace Graphics
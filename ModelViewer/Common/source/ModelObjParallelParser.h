@@ -0,0 +1,48 @@
+#pragma once
+
+#pragma warning( push, 0 )
+#include <tinyobjloader/tiny_obj_loader.h>
+#pragma warning( pop )
+
+namespace Graphics {
+
+class ThreadPool;
+
+// Multi-threaded replacement for tinyobj::LoadObj
+// The file is split into line-aligned chunks which are tokenized and have their numbers parsed in parallel
+// The chunks are then merged in file order using the same rules as tinyobj, so the output is identical to LoadObj
+// Files containing lines, points, tags or skin weights are handed to tinyobj::LoadObj directly
+class ModelObjParallelParser {
+public:
+    ModelObjParallelParser(ThreadPool *threadPool);
+    ModelObjParallelParser(ModelObjParallelParser const &) = delete;
+    ModelObjParallelParser &operator=(ModelObjParallelParser const &) = delete;
+    ~ModelObjParallelParser();
+
+    // Chunks smaller than this are not worth splitting across threads
+    // Default: 1MB
+    void SetMinChunkSize(size_t minChunkSize);
+    size_t GetMinChunkSize() const;
+
+    // Parses an in-memory obj file
+    // mtlBaseDir is the directory used to resolve mtllib files
+    bool Parse(
+        const char *data,
+        size_t dataSize,
+        std::string const &mtlBaseDir,
+        tinyobj::attrib_t *attrib,
+        std::vector<tinyobj::shape_t> *shapes,
+        std::vector<tinyobj::material_t> *materials,
+        std::string *warn,
+        std::string *err);
+
+    // Number of chunks the last Parse call was split into
+    uint32_t GetLastChunkCount() const;
+
+private:
+    ThreadPool *m_threadPool;
+    size_t m_minChunkSize;
+    uint32_t m_lastChunkCount;
+};
+
+} // namespace Graphics
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "ModelObjLoader.h"
+
+namespace Graphics {
+
+// Compile time specialized vertex writer
+// The vertex layout, attribute remapping and index width are fixed by the template, so the per-vertex work is
+// inlined into one loop that reads the attribute arrays directly and writes into preallocated output instead of
+// going through the virtual AddVertex path
+//
+// Derived must provide:
+//   static void BuildVertex(Corner const &corner, VertexType &vertex);
+// and may hide the following to change the defaults:
+//   static const bool COMBINE_MESHES = false; // Merge every shape into mesh 0
+//   static const bool WELD_VERTICES = true;   // Weld vertices with identical bytes together
+//
+// Missing attributes (eg. an obj without normals) are read as 0
+template<typename Derived, typename VertexType, typename IndexT = uint32_t>
+class ModelObjVertexWriterT : public ModelObjVertexWriter {
+public:
+    static const bool COMBINE_MESHES = false;
+    static const bool WELD_VERTICES = true;
+
+    // Attributes of a single face corner, as read from the obj file
+    struct Corner {
+        glm::vec3 Position;
+        glm::vec3 Normal;
+        glm::vec3 Color;
+        glm::vec2 TexCoord;
+    };
+
+public:
+    virtual uint32_t GetVertexSize() override final;
+    virtual uint32_t GetIndexSize() override final;
+    virtual bool CheckForUniqueVertex() const override final;
+    virtual void WriteMesh(uint32_t meshIndex, uint32_t meshFaceCount, uint32_t vertexIndexCount) override final;
+
+private:
+    // Number of corners built at once before being welded
+    static const uint32_t BLOCK_SIZE = 256;
+
+    static glm::vec3 _fetch3(AttributeArray const &attribute, int index);
+    static glm::vec2 _fetch2(AttributeArray const &attribute, int index);
+};
+
+} // namespace Graphics
+
+#include "ModelObjVertexWriterT.tpp"
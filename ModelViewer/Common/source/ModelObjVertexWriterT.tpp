@@ -0,0 +1,144 @@
+#include "ModelObjVertexWriterT.h"
+#include "Hash.h"
+#include <cstring>
+#include <limits>
+#include <algorithm>
+
+namespace Graphics {
+
+template<typename Derived, typename VertexType, typename IndexT>
+const uint32_t ModelObjVertexWriterT<Derived, VertexType, IndexT>::BLOCK_SIZE;
+
+template<typename Derived, typename VertexType, typename IndexT>
+uint32_t ModelObjVertexWriterT<Derived, VertexType, IndexT>::GetVertexSize() {
+    return sizeof(VertexType);
+}
+
+template<typename Derived, typename VertexType, typename IndexT>
+uint32_t ModelObjVertexWriterT<Derived, VertexType, IndexT>::GetIndexSize() {
+    return sizeof(IndexT);
+}
+
+template<typename Derived, typename VertexType, typename IndexT>
+bool ModelObjVertexWriterT<Derived, VertexType, IndexT>::CheckForUniqueVertex() const {
+    return Derived::WELD_VERTICES;
+}
+
+template<typename Derived, typename VertexType, typename IndexT>
+void ModelObjVertexWriterT<Derived, VertexType, IndexT>::WriteMesh(uint32_t meshIndex, uint32_t meshFaceCount, uint32_t vertexIndexCount) {
+    if (!m_appendToCurrentMesh && (!Derived::COMBINE_MESHES || meshIndex == 0)) {
+        AddMesh(0);
+    }
+
+    ModelObjLoader::DataBuffer &vertexBuffer = m_boundVertexData->back();
+    ModelObjLoader::DataBuffer &indexBuffer = m_boundIndexData->back();
+
+    // Reserve for every corner being unique, only the index data is written in full
+    size_t baseIndex = indexBuffer.size() / sizeof(IndexT);
+    size_t maxVertexDataSize = vertexBuffer.size() + static_cast<size_t>(vertexIndexCount) * sizeof(VertexType);
+    size_t indexDataSize = (baseIndex + vertexIndexCount) * sizeof(IndexT);
+    if (vertexBuffer.capacity() < maxVertexDataSize) {
+        vertexBuffer.reserve(std::max(maxVertexDataSize, vertexBuffer.capacity() * 2));
+    }
+    if (indexBuffer.capacity() < indexDataSize) {
+        indexBuffer.reserve(std::max(indexDataSize, indexBuffer.capacity() * 2));
+    }
+    indexBuffer.resize(indexDataSize);
+    IndexT *newIndices = reinterpret_cast<IndexT*>(indexBuffer.data()) + baseIndex;
+
+    AttributeArray positions = AttributeVertices();
+    AttributeArray normals = AttributeNormals();
+    AttributeArray texCoords = AttributeTexCoords();
+    AttributeArray colors = AttributeColors();
+    const RawIndexType *faceIndices = FaceIndices();
+    Derived *derived = static_cast<Derived*>(this);
+
+    // Corners are built a block at a time so the block stays in cache while it is welded
+    // The block is zeroed once so any padding in VertexType hashes and compares consistently
+    VertexType block[BLOCK_SIZE];
+    memset(block, 0, sizeof(block));
+
+    size_t vertexCount = vertexBuffer.size() / sizeof(VertexType);
+    for (uint32_t blockStart = 0; blockStart < vertexIndexCount; blockStart += BLOCK_SIZE) {
+        uint32_t blockCount = std::min(BLOCK_SIZE, vertexIndexCount - blockStart);
+        const RawIndexType *blockIndices = faceIndices + blockStart;
+
+        for (uint32_t i = 0; i < blockCount; ++i) {
+            RawIndexType const &faceIndex = blockIndices[i];
+
+            Corner corner;
+            corner.Position = _fetch3(positions, faceIndex.VertexIndex);
+            corner.Normal = _fetch3(normals, faceIndex.NormalIndex);
+            corner.Color = _fetch3(colors, faceIndex.VertexIndex);
+            corner.TexCoord = _fetch2(texCoords, faceIndex.TexCoordIndex);
+            derived->BuildVertex(corner, block[i]);
+        }
+
+        // Room for the whole block to be unique, trimmed again afterwards
+        vertexBuffer.resize((vertexCount + blockCount) * sizeof(VertexType));
+        VertexType *meshVertices = reinterpret_cast<VertexType*>(vertexBuffer.data());
+
+        if (!Derived::WELD_VERTICES) {
+            memcpy(meshVertices + vertexCount, block, blockCount * sizeof(VertexType));
+            for (uint32_t i = 0; i < blockCount; ++i) {
+                newIndices[blockStart + i] = static_cast<IndexT>(vertexCount + i);
+            }
+            vertexCount += blockCount;
+            continue;
+        }
+
+        for (uint32_t i = 0; i < blockCount; ++i) {
+            VertexType const &vertex = block[i];
+            uint32_t nextIndex = static_cast<uint32_t>(vertexCount);
+            uint32_t vertexIndex = m_uniqueVertices.FindOrInsert(HashBytes64(&vertex, sizeof(VertexType)), nextIndex, [&](uint32_t storedIndex) {
+                return memcmp(&meshVertices[storedIndex], &vertex, sizeof(VertexType)) == 0;
+            });
+
+            if (vertexIndex == nextIndex) {
+                memcpy(&meshVertices[vertexCount], &vertex, sizeof(VertexType));
+                ++vertexCount;
+            }
+            newIndices[blockStart + i] = static_cast<IndexT>(vertexIndex);
+        }
+        vertexBuffer.resize(vertexCount * sizeof(VertexType));
+    }
+    ASSERT(vertexCount <= static_cast<size_t>(std::numeric_limits<IndexT>::max()) + 1);
+
+    // Record a submesh for each run of faces sharing a material
+    const int *materialIds = FaceMaterialIds();
+    if (meshFaceCount == 0) {
+        return;
+    }
+    if (static_cast<size_t>(meshFaceCount) * 3 != vertexIndexCount) {
+        // Faces were not triangulated so indices cannot be mapped back to faces
+        AddSubMesh(static_cast<uint32_t>(baseIndex), vertexIndexCount, materialIds[0]);
+        return;
+    }
+    uint32_t runStart = 0;
+    for (uint32_t face = 1; face <= meshFaceCount; ++face) {
+        if (face == meshFaceCount || materialIds[face] != materialIds[runStart]) {
+            AddSubMesh(static_cast<uint32_t>(baseIndex + runStart * 3), (face - runStart) * 3, materialIds[runStart]);
+            runStart = face;
+        }
+    }
+}
+
+template<typename Derived, typename VertexType, typename IndexT>
+glm::vec3 ModelObjVertexWriterT<Derived, VertexType, IndexT>::_fetch3(AttributeArray const &attribute, int index) {
+    size_t offset = static_cast<size_t>(index) * 3;
+    if (index < 0 || offset + 2 >= attribute.Count) {
+        return glm::vec3(0.0f);
+    }
+    return glm::vec3(attribute.Data[offset + 0], attribute.Data[offset + 1], attribute.Data[offset + 2]);
+}
+
+template<typename Derived, typename VertexType, typename IndexT>
+glm::vec2 ModelObjVertexWriterT<Derived, VertexType, IndexT>::_fetch2(AttributeArray const &attribute, int index) {
+    size_t offset = static_cast<size_t>(index) * 2;
+    if (index < 0 || offset + 1 >= attribute.Count) {
+        return glm::vec2(0.0f);
+    }
+    return glm::vec2(attribute.Data[offset + 0], attribute.Data[offset + 1]);
+}
+
+} // namespace Graphics
@@ -0,0 +1,659 @@
+#include "pch.h"
+#include "ModelScanLoader.h"
+#include "ModelObjAttributeFetcher.h"
+#include "MemoryMappedFile.h"
+#include "ExecutableDirectory.h"
+#include "VertexWeldTable.h"
+#include "Hash.h"
+#include <filesystem>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+namespace Graphics {
+
+namespace {
+
+// Binary STL: 80 byte header, triangle count, then 50 byte triangles (normal, 3 corners, attribute byte count)
+const size_t STL_HEADER_SIZE = 80;
+const size_t STL_TRIANGLE_SIZE = 50;
+const size_t STL_CORNER_OFFSET = 12;
+
+enum PlyType : uint8_t {
+    PLY_TYPE_INT8 = 0,
+    PLY_TYPE_UINT8,
+    PLY_TYPE_INT16,
+    PLY_TYPE_UINT16,
+    PLY_TYPE_INT32,
+    PLY_TYPE_UINT32,
+    PLY_TYPE_FLOAT32,
+    PLY_TYPE_FLOAT64,
+
+    PLY_TYPE_COUNT
+};
+
+const uint32_t PLY_TYPE_SIZES[PLY_TYPE_COUNT] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+
+struct PlyProperty {
+    std::string Name;
+    PlyType Type;      // Item type of lists
+    PlyType CountType; // PLY_TYPE_COUNT if not a list
+};
+
+struct PlyElement {
+    std::string Name;
+    uint64_t Count;
+    std::vector<PlyProperty> Properties;
+};
+
+// Vertex properties read into the writer's attributes, in the order of the attribute's components
+enum PlyVertexSlot : uint32_t {
+    PLY_SLOT_POSITION = 0,
+    PLY_SLOT_NORMAL = 3,
+    PLY_SLOT_COLOR = 6,
+    PLY_SLOT_TEXCOORD = 9,
+
+    PLY_SLOT_COUNT = 11
+};
+
+PlyType ParsePlyType(std::string const &name) {
+    const char *TYPE_NAMES[][2] = {
+        { "char", "int8" }, { "uchar", "uint8" }, { "short", "int16" }, { "ushort", "uint16" },
+        { "int", "int32" }, { "uint", "uint32" }, { "float", "float32" }, { "double", "float64" },
+    };
+    for (uint32_t i = 0; i < PLY_TYPE_COUNT; ++i) {
+        if (name == TYPE_NAMES[i][0] || name == TYPE_NAMES[i][1]) {
+            return static_cast<PlyType>(i);
+        }
+    }
+    return PLY_TYPE_COUNT;
+}
+
+uint32_t GetPlyVertexSlot(std::string const &name) {
+    const std::pair<const char*, uint32_t> SLOT_NAMES[] = {
+        { "x", PLY_SLOT_POSITION + 0 }, { "y", PLY_SLOT_POSITION + 1 }, { "z", PLY_SLOT_POSITION + 2 },
+        { "nx", PLY_SLOT_NORMAL + 0 }, { "ny", PLY_SLOT_NORMAL + 1 }, { "nz", PLY_SLOT_NORMAL + 2 },
+        { "red", PLY_SLOT_COLOR + 0 }, { "green", PLY_SLOT_COLOR + 1 }, { "blue", PLY_SLOT_COLOR + 2 },
+        { "u", PLY_SLOT_TEXCOORD + 0 }, { "v", PLY_SLOT_TEXCOORD + 1 },
+        { "s", PLY_SLOT_TEXCOORD + 0 }, { "t", PLY_SLOT_TEXCOORD + 1 },
+        { "texture_u", PLY_SLOT_TEXCOORD + 0 }, { "texture_v", PLY_SLOT_TEXCOORD + 1 },
+    };
+    for (auto const &slotName : SLOT_NAMES) {
+        if (name == slotName.first) {
+            return slotName.second;
+        }
+    }
+    return PLY_SLOT_COUNT;
+}
+
+f64 ReadPlyValue(const uint8_t *data, PlyType type, bool bigEndian) {
+    uint8_t bytes[8];
+    uint32_t size = PLY_TYPE_SIZES[type];
+    memcpy(bytes, data, size);
+    if (bigEndian) {
+        std::reverse(bytes, bytes + size);
+    }
+
+    switch (type) {
+    case PLY_TYPE_INT8: { int8_t value; memcpy(&value, bytes, sizeof(value)); return value; }
+    case PLY_TYPE_UINT8: { uint8_t value; memcpy(&value, bytes, sizeof(value)); return value; }
+    case PLY_TYPE_INT16: { int16_t value; memcpy(&value, bytes, sizeof(value)); return value; }
+    case PLY_TYPE_UINT16: { uint16_t value; memcpy(&value, bytes, sizeof(value)); return value; }
+    case PLY_TYPE_INT32: { int32_t value; memcpy(&value, bytes, sizeof(value)); return value; }
+    case PLY_TYPE_UINT32: { uint32_t value; memcpy(&value, bytes, sizeof(value)); return value; }
+    case PLY_TYPE_FLOAT32: { f32 value; memcpy(&value, bytes, sizeof(value)); return value; }
+    case PLY_TYPE_FLOAT64: { f64 value; memcpy(&value, bytes, sizeof(value)); return value; }
+    default: return 0.0;
+    }
+}
+
+// Walks the records of an element whose records may contain lists
+// onList is called for every list with its item type, count and items and returns false to stop
+class PlyRecordReader {
+public:
+    PlyRecordReader(const uint8_t *data, size_t size, bool bigEndian)
+      : m_data(data),
+        m_size(size),
+        m_bigEndian(bigEndian) {
+    }
+
+    // Returns the offset after the record, or 0 if it runs past the end of the file
+    template<typename ListFunc>
+    size_t ReadRecord(PlyElement const &element, size_t offset, ListFunc const &onList) const {
+        for (uint32_t p = 0; p < static_cast<uint32_t>(element.Properties.size()); ++p) {
+            PlyProperty const &property = element.Properties[p];
+            if (property.CountType == PLY_TYPE_COUNT) {
+                offset += PLY_TYPE_SIZES[property.Type];
+                continue;
+            }
+
+            if (offset + PLY_TYPE_SIZES[property.CountType] > m_size) {
+                return 0;
+            }
+            f64 count = ReadPlyValue(m_data + offset, property.CountType, m_bigEndian);
+            offset += PLY_TYPE_SIZES[property.CountType];
+            if (count < 0.0 || count * PLY_TYPE_SIZES[property.Type] > static_cast<f64>(m_size - offset)) {
+                return 0;
+            }
+            onList(p, static_cast<uint32_t>(count), m_data + offset);
+            offset += static_cast<size_t>(count) * PLY_TYPE_SIZES[property.Type];
+        }
+        return offset <= m_size ? offset : 0;
+    }
+
+private:
+    const uint8_t *m_data;
+    size_t m_size;
+    bool m_bigEndian;
+};
+
+} // namespace
+
+ModelScanLoader::ModelScanLoader()
+  : m_blockSize(DEFAULT_BLOCK_SIZE),
+    m_vertexSize(0),
+    m_indexSize(sizeof(uint32_t)) {
+}
+
+ModelScanLoader::~ModelScanLoader() {
+}
+
+void ModelScanLoader::SetProgressCallback(ProgressCallback callback) {
+    m_progressCallback = std::move(callback);
+}
+
+void ModelScanLoader::SetBlockSize(uint32_t triangleCount) {
+    m_blockSize = std::max(triangleCount, 1u);
+}
+
+std::string ModelScanLoader::Load(std::string const &filePath, ModelObjVertexWriter *vertexWriter) {
+    ASSERT(vertexWriter);
+
+    std::filesystem::path exePath = GetExecutableDirectory();
+
+    exePath /= filePath;
+
+    auto startTime = std::chrono::steady_clock::now();
+    MemoryMappedFile file;
+    if (!file.Open(exePath)) {
+        return file.GetLastError();
+    }
+
+    // The writer reads the shared attributes directly, faces are only ever one block long
+    VertexAttributes attributes;
+    std::vector<float> unusedAttribute;
+    std::vector<tinyobj::index_t> blockIndices;
+    std::vector<int> blockMaterialIds;
+    std::vector<unsigned int> blockSmoothingGroupIds;
+
+    ModelObjAttributeFetcher attributeFetcher;
+    attributeFetcher.Vertices = &attributes.Positions;
+    attributeFetcher.VertexWeights = &unusedAttribute;
+    attributeFetcher.Normals = &attributes.Normals;
+    attributeFetcher.TexCoords = &attributes.TexCoords;
+    attributeFetcher.TexCoordsW = &unusedAttribute;
+    attributeFetcher.Colors = &attributes.Colors;
+    attributeFetcher.Indices = &blockIndices;
+    attributeFetcher.MaterialIds = &blockMaterialIds;
+    attributeFetcher.SmoothingGroupIds = &blockSmoothingGroupIds;
+
+    m_vertexSize = vertexWriter->GetVertexSize();
+    m_indexSize = vertexWriter->GetIndexSize();
+    m_vertexData.clear();
+    m_indexData.clear();
+    m_subMeshData.clear();
+    vertexWriter->m_attributeFetcher = &attributeFetcher;
+    vertexWriter->m_boundVertexData = &m_vertexData;
+    vertexWriter->m_boundIndexData = &m_indexData;
+    vertexWriter->m_boundSubMeshData = &m_subMeshData;
+    vertexWriter->m_appendToCurrentMesh = false;
+
+    // Every block after the first appends to the mesh the first one started
+    uint32_t blockCount = 0;
+    size_t triangleCount = 0;
+    auto writeBlock = [&](const uint32_t *corners, uint32_t blockTriangleCount) {
+        int texCoordIndexMask = attributes.TexCoords.empty() ? -1 : 0;
+        blockIndices.resize(static_cast<size_t>(blockTriangleCount) * 3);
+        for (size_t i = 0; i < blockIndices.size(); ++i) {
+            int index = static_cast<int>(corners[i]);
+            blockIndices[i] = { index, index, index | texCoordIndexMask };
+        }
+        blockMaterialIds.assign(blockTriangleCount, -1);
+        blockSmoothingGroupIds.assign(blockTriangleCount, 0);
+
+        vertexWriter->WriteMesh(blockCount, blockTriangleCount, blockTriangleCount * 3);
+        vertexWriter->m_appendToCurrentMesh = true;
+        ++blockCount;
+        triangleCount += blockTriangleCount;
+    };
+
+    bool isPly = file.GetSize() >= 3 && memcmp(file.GetData(), "ply", 3) == 0;
+    std::string error = isPly ? _readPly(file, &attributes, writeBlock) : _readStl(file, &attributes, writeBlock);
+    vertexWriter->m_appendToCurrentMesh = false;
+    vertexWriter->m_attributeFetcher = nullptr;
+    if (!error.empty()) {
+        return error + ": " + filePath;
+    }
+    if (m_vertexData.empty()) {
+        return "No triangles in " + filePath;
+    }
+
+    // Writers that do not track materials draw the mesh as a whole
+    if (m_subMeshData[0].empty() && !m_indexData[0].empty()) {
+        m_subMeshData[0].push_back({ 0, static_cast<uint32_t>(m_indexData[0].size() / m_indexSize), -1 });
+    }
+
+    f64 loadSeconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - startTime).count();
+    LOG_VERBOSE("Loaded %s (%.2f MB) in %.3f ms: %zu triangles, %zu vertices, %.1f MB/s, %.2f M triangles/s\n",
+        filePath.c_str(),
+        file.GetSize() / (1024.0 * 1024.0),
+        loadSeconds * 1000.0,
+        triangleCount,
+        m_vertexData[0].size() / m_vertexSize,
+        loadSeconds > 0.0 ? file.GetSize() / (1024.0 * 1024.0) / loadSeconds : 0.0,
+        loadSeconds > 0.0 ? triangleCount / 1000000.0 / loadSeconds : 0.0);
+
+    return "";
+}
+
+uint32_t ModelScanLoader::GetVertexSize() const {
+    return m_vertexSize;
+}
+
+uint32_t ModelScanLoader::GetVertexCount(uint32_t meshIndex) const {
+    return static_cast<uint32_t>(m_vertexData[meshIndex].size() / m_vertexSize);
+}
+
+const void *ModelScanLoader::GetVertexData(uint32_t meshIndex) const {
+    return m_vertexData[meshIndex].data();
+}
+
+uint32_t ModelScanLoader::GetIndexSize() const {
+    return m_indexSize;
+}
+
+uint32_t ModelScanLoader::GetIndexCount(uint32_t meshIndex) const {
+    return static_cast<uint32_t>(m_indexData[meshIndex].size() / m_indexSize);
+}
+
+const void *ModelScanLoader::GetIndexData(uint32_t meshIndex) const {
+    return m_indexData[meshIndex].data();
+}
+
+uint32_t ModelScanLoader::GetSubMeshCount(uint32_t meshIndex) const {
+    return static_cast<uint32_t>(m_subMeshData[meshIndex].size());
+}
+
+const ModelObjLoader::SubMesh *ModelScanLoader::GetSubMeshes(uint32_t meshIndex) const {
+    return m_subMeshData[meshIndex].data();
+}
+
+std::string ModelScanLoader::_readStl(MemoryMappedFile const &file, VertexAttributes *attributes, TriangleBlockFunc const &writeBlock) {
+    const uint8_t *data = file.GetData();
+    size_t fileSize = file.GetSize();
+    if (fileSize < STL_HEADER_SIZE + sizeof(uint32_t)) {
+        return "Truncated STL file";
+    }
+    uint32_t fileTriangleCount;
+    memcpy(&fileTriangleCount, data + STL_HEADER_SIZE, sizeof(fileTriangleCount));
+    size_t trianglesOffset = STL_HEADER_SIZE + sizeof(uint32_t);
+    if (fileSize != trianglesOffset + static_cast<size_t>(fileTriangleCount) * STL_TRIANGLE_SIZE) {
+        // ASCII files also start with "solid" but their size never matches the count
+        return memcmp(data, "solid", 5) == 0 ? "ASCII STL files are not supported" : "Truncated STL file";
+    }
+
+    // Corners are welded on their exact position, closed scans share each position between about six triangles
+    VertexWeldTable weldTable;
+    weldTable.Reserve(fileTriangleCount / 2);
+    attributes->Positions.reserve(static_cast<size_t>(fileTriangleCount / 2) * 3);
+    std::vector<uint32_t> corners(static_cast<size_t>(m_blockSize) * 3);
+    bool tooManyVertices = false;
+    auto weldBlock = [&](size_t firstTriangle, uint32_t blockTriangleCount) {
+        uint32_t keptTriangleCount = 0;
+        for (uint32_t t = 0; t < blockTriangleCount; ++t) {
+            const uint8_t *triangle = data + trianglesOffset + (firstTriangle + t) * STL_TRIANGLE_SIZE;
+            uint32_t *triangleCorners = &corners[keptTriangleCount * 3];
+            for (uint32_t c = 0; c < 3; ++c) {
+                glm::vec3 position;
+                memcpy(&position, triangle + STL_CORNER_OFFSET + c * sizeof(glm::vec3), sizeof(position));
+                position += glm::vec3(0.0f); // -0 welds with 0
+
+                uint32_t nextIndex = static_cast<uint32_t>(attributes->Positions.size() / 3);
+                uint32_t index = weldTable.FindOrInsert(HashBytes64(&position, sizeof(position)), nextIndex, [&](uint32_t storedIndex) {
+                    return memcmp(&attributes->Positions[static_cast<size_t>(storedIndex) * 3], &position, sizeof(position)) == 0;
+                });
+                if (index == nextIndex) {
+                    tooManyVertices |= nextIndex == static_cast<uint32_t>(std::numeric_limits<int>::max());
+                    attributes->Positions.insert(attributes->Positions.end(), { position.x, position.y, position.z });
+                }
+                triangleCorners[c] = index;
+            }
+
+            // Triangles collapsed by welding are dropped
+            if (triangleCorners[0] != triangleCorners[1] && triangleCorners[1] != triangleCorners[2] && triangleCorners[2] != triangleCorners[0]) {
+                ++keptTriangleCount;
+            }
+        }
+        return keptTriangleCount;
+    };
+
+    // First pass welds and sums face normals, the second looks the same corners up again and writes them
+    for (uint32_t pass = 0; pass < 2; ++pass) {
+        if (pass == 1) {
+            attributes->Normals.resize(attributes->Positions.size(), 0.0f);
+            attributes->Colors.assign(attributes->Positions.size(), 1.0f);
+            _normalizeNormals(attributes);
+        }
+
+        for (size_t firstTriangle = 0; firstTriangle < fileTriangleCount; firstTriangle += m_blockSize) {
+            uint32_t blockTriangleCount = static_cast<uint32_t>(std::min<size_t>(m_blockSize, fileTriangleCount - firstTriangle));
+            uint32_t keptTriangleCount = weldBlock(firstTriangle, blockTriangleCount);
+            if (tooManyVertices) {
+                return "Too many vertices in STL file";
+            }
+
+            if (pass == 0) {
+                attributes->Normals.resize(attributes->Positions.size(), 0.0f);
+                _accumulateNormals(attributes, corners.data(), keptTriangleCount);
+            }
+            else if (keptTriangleCount > 0) {
+                writeBlock(corners.data(), keptTriangleCount);
+            }
+            _reportProgress(trianglesOffset + (firstTriangle + blockTriangleCount) * STL_TRIANGLE_SIZE, fileSize, pass);
+        }
+    }
+    return "";
+}
+
+std::string ModelScanLoader::_readPly(MemoryMappedFile const &file, VertexAttributes *attributes, TriangleBlockFunc const &writeBlock) {
+    const uint8_t *data = file.GetData();
+    size_t fileSize = file.GetSize();
+
+    // Text header, one declaration per line
+    const char END_HEADER[] = "end_header";
+    const char *text = reinterpret_cast<const char*>(data);
+    const char *headerEnd = std::search(text, text + fileSize, END_HEADER, END_HEADER + sizeof(END_HEADER) - 1);
+    const char *dataStart = std::find(headerEnd, text + fileSize, '\n');
+    if (dataStart == text + fileSize) {
+        return "Invalid PLY header";
+    }
+    ++dataStart;
+
+    bool bigEndian = false;
+    bool hasFormat = false;
+    std::vector<PlyElement> elements;
+    std::string header(text, headerEnd);
+    size_t lineStart = 0;
+    while (lineStart < header.size()) {
+        size_t lineEnd = header.find('\n', lineStart);
+        if (lineEnd == std::string::npos) {
+            lineEnd = header.size();
+        }
+        std::vector<std::string> tokens;
+        size_t tokenStart = header.find_first_not_of(" \t\r", lineStart);
+        while (tokenStart < lineEnd) {
+            size_t tokenEnd = std::min(header.find_first_of(" \t\r\n", tokenStart), lineEnd);
+            tokens.push_back(header.substr(tokenStart, tokenEnd - tokenStart));
+            tokenStart = header.find_first_not_of(" \t\r", tokenEnd);
+        }
+        lineStart = lineEnd + 1;
+
+        if (tokens.empty()) {
+            continue;
+        }
+        if (tokens[0] == "format" && tokens.size() >= 2) {
+            if (tokens[1] != "binary_little_endian" && tokens[1] != "binary_big_endian") {
+                return "Only binary PLY files are supported";
+            }
+            bigEndian = tokens[1] == "binary_big_endian";
+            hasFormat = true;
+        }
+        else if (tokens[0] == "element" && tokens.size() == 3) {
+            elements.push_back({ tokens[1], std::stoull(tokens[2]), {} });
+        }
+        else if (tokens[0] == "property" && !elements.empty()) {
+            PlyProperty property;
+            if (tokens.size() == 5 && tokens[1] == "list") {
+                property = { tokens[4], ParsePlyType(tokens[3]), ParsePlyType(tokens[2]) };
+                if (property.Type == PLY_TYPE_COUNT || property.CountType == PLY_TYPE_COUNT) {
+                    return "Unknown PLY property type";
+                }
+            }
+            else if (tokens.size() == 3) {
+                property = { tokens[2], ParsePlyType(tokens[1]), PLY_TYPE_COUNT };
+                if (property.Type == PLY_TYPE_COUNT) {
+                    return "Unknown PLY property type";
+                }
+            }
+            else {
+                return "Invalid PLY property";
+            }
+            elements.back().Properties.push_back(property);
+        }
+    }
+    if (!hasFormat) {
+        return "Invalid PLY header";
+    }
+
+    // Vertices are read into the shared attributes, faces have their indices checked and their normals summed
+    // Other elements are skipped
+    PlyRecordReader recordReader(data, fileSize, bigEndian);
+    size_t offset = static_cast<size_t>(dataStart - text);
+    size_t vertexCount = 0;
+    bool hasVertices = false;
+    bool computeNormals = true;
+    size_t faceOffset = 0;
+    const PlyElement *faceElement = nullptr;
+    uint32_t faceIndexProperty = 0;
+    std::vector<uint32_t> corners;
+    corners.reserve(static_cast<size_t>(m_blockSize) * 3);
+    for (auto const &element : elements) {
+        bool hasLists = std::any_of(element.Properties.begin(), element.Properties.end(), [](PlyProperty const &property) {
+            return property.CountType != PLY_TYPE_COUNT;
+        });
+
+        if (element.Name == "vertex" && !hasVertices) {
+            if (hasLists) {
+                return "PLY vertices with list properties are not supported";
+            }
+            if (element.Count >= static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+                return "Too many vertices in PLY file";
+            }
+
+            uint32_t slotOffsets[PLY_SLOT_COUNT];
+            PlyType slotTypes[PLY_SLOT_COUNT];
+            std::fill(slotTypes, slotTypes + PLY_SLOT_COUNT, PLY_TYPE_COUNT);
+            uint32_t stride = 0;
+            for (auto const &property : element.Properties) {
+                uint32_t slot = GetPlyVertexSlot(property.Name);
+                if (slot < PLY_SLOT_COUNT) {
+                    slotOffsets[slot] = stride;
+                    slotTypes[slot] = property.Type;
+                }
+                stride += PLY_TYPE_SIZES[property.Type];
+            }
+            if (slotTypes[PLY_SLOT_POSITION + 0] == PLY_TYPE_COUNT || slotTypes[PLY_SLOT_POSITION + 1] == PLY_TYPE_COUNT ||
+                slotTypes[PLY_SLOT_POSITION + 2] == PLY_TYPE_COUNT) {
+                return "PLY vertices have no position";
+            }
+            vertexCount = static_cast<size_t>(element.Count);
+            if (vertexCount * stride > fileSize - offset) {
+                return "Truncated PLY file";
+            }
+
+            // Attributes are only kept if the file has all of their components
+            bool hasNormals = slotTypes[PLY_SLOT_NORMAL + 0] != PLY_TYPE_COUNT && slotTypes[PLY_SLOT_NORMAL + 1] != PLY_TYPE_COUNT &&
+                              slotTypes[PLY_SLOT_NORMAL + 2] != PLY_TYPE_COUNT;
+            bool hasColors = slotTypes[PLY_SLOT_COLOR + 0] != PLY_TYPE_COUNT && slotTypes[PLY_SLOT_COLOR + 1] != PLY_TYPE_COUNT &&
+                             slotTypes[PLY_SLOT_COLOR + 2] != PLY_TYPE_COUNT;
+            bool hasTexCoords = slotTypes[PLY_SLOT_TEXCOORD + 0] != PLY_TYPE_COUNT && slotTypes[PLY_SLOT_TEXCOORD + 1] != PLY_TYPE_COUNT;
+            computeNormals = !hasNormals;
+            attributes->Positions.resize(vertexCount * 3);
+            attributes->Normals.assign(vertexCount * 3, 0.0f);
+            attributes->Colors.assign(vertexCount * 3, 1.0f);
+            if (hasTexCoords) {
+                attributes->TexCoords.resize(vertexCount * 2);
+            }
+
+            struct SlotRange {
+                uint32_t FirstSlot;
+                uint32_t ComponentCount;
+                bool Present;
+                float *Destination;
+            };
+            SlotRange slotRanges[] = {
+                { PLY_SLOT_POSITION, 3, true, attributes->Positions.data() },
+                { PLY_SLOT_NORMAL, 3, hasNormals, attributes->Normals.data() },
+                { PLY_SLOT_COLOR, 3, hasColors, attributes->Colors.data() },
+                { PLY_SLOT_TEXCOORD, 2, hasTexCoords, attributes->TexCoords.data() },
+            };
+            for (size_t firstVertex = 0; firstVertex < vertexCount; firstVertex += m_blockSize) {
+                size_t blockEnd = std::min(firstVertex + m_blockSize, vertexCount);
+                for (size_t v = firstVertex; v < blockEnd; ++v) {
+                    const uint8_t *record = data + offset + v * stride;
+                    for (auto const &range : slotRanges) {
+                        if (!range.Present) {
+                            continue;
+                        }
+                        for (uint32_t c = 0; c < range.ComponentCount; ++c) {
+                            uint32_t slot = range.FirstSlot + c;
+                            f64 value = ReadPlyValue(record + slotOffsets[slot], slotTypes[slot], bigEndian);
+
+                            // Integer colors are stored as 0 to the type's maximum
+                            if (range.FirstSlot == PLY_SLOT_COLOR && slotTypes[slot] == PLY_TYPE_UINT8) {
+                                value /= 255.0;
+                            }
+                            else if (range.FirstSlot == PLY_SLOT_COLOR && slotTypes[slot] == PLY_TYPE_UINT16) {
+                                value /= 65535.0;
+                            }
+                            range.Destination[v * range.ComponentCount + c] = static_cast<float>(value);
+                        }
+                    }
+                }
+                _reportProgress(offset + blockEnd * stride, fileSize, 0);
+            }
+            offset += vertexCount * stride;
+            hasVertices = true;
+            continue;
+        }
+
+        // Faces are polygons of vertex indices, turned into triangle fans
+        uint32_t indexProperty = static_cast<uint32_t>(element.Properties.size());
+        for (uint32_t p = 0; p < static_cast<uint32_t>(element.Properties.size()); ++p) {
+            PlyProperty const &property = element.Properties[p];
+            if (property.CountType != PLY_TYPE_COUNT && (property.Name == "vertex_indices" || property.Name == "vertex_index")) {
+                indexProperty = p;
+            }
+        }
+        bool isFaces = element.Name == "face" && !faceElement && indexProperty < element.Properties.size();
+        if (isFaces) {
+            if (!hasVertices) {
+                return "PLY faces before vertices are not supported";
+            }
+            faceElement = &element;
+            faceIndexProperty = indexProperty;
+            faceOffset = offset;
+        }
+
+        bool validIndices = true;
+        for (uint64_t r = 0; r < element.Count; ++r) {
+            offset = recordReader.ReadRecord(element, offset, [&](uint32_t property, uint32_t count, const uint8_t *items) {
+                if (!isFaces || property != indexProperty) {
+                    return;
+                }
+                PlyType indexType = element.Properties[property].Type;
+                uint32_t indexSize = PLY_TYPE_SIZES[indexType];
+                for (uint32_t i = 0; i < count; ++i) {
+                    f64 index = ReadPlyValue(items + i * indexSize, indexType, bigEndian);
+                    validIndices &= index >= 0.0 && index < static_cast<f64>(vertexCount);
+                }
+                if (computeNormals && validIndices) {
+                    for (uint32_t i = 2; i < count; ++i) {
+                        corners.push_back(static_cast<uint32_t>(ReadPlyValue(items, indexType, bigEndian)));
+                        corners.push_back(static_cast<uint32_t>(ReadPlyValue(items + (i - 1) * indexSize, indexType, bigEndian)));
+                        corners.push_back(static_cast<uint32_t>(ReadPlyValue(items + i * indexSize, indexType, bigEndian)));
+                    }
+                }
+            });
+            if (offset == 0) {
+                return "Truncated PLY file";
+            }
+            if (!validIndices) {
+                return "PLY face index out of range";
+            }
+            if (corners.size() >= static_cast<size_t>(m_blockSize) * 3) {
+                _accumulateNormals(attributes, corners.data(), static_cast<uint32_t>(corners.size() / 3));
+                corners.clear();
+                _reportProgress(offset, fileSize, 0);
+            }
+        }
+        if (!corners.empty()) {
+            _accumulateNormals(attributes, corners.data(), static_cast<uint32_t>(corners.size() / 3));
+            corners.clear();
+        }
+    }
+    if (!faceElement) {
+        return "No faces in PLY file";
+    }
+    if (computeNormals) {
+        _normalizeNormals(attributes);
+    }
+
+    // Second pass over the faces only, every index was checked by the first
+    offset = faceOffset;
+    PlyType indexType = faceElement->Properties[faceIndexProperty].Type;
+    uint32_t indexSize = PLY_TYPE_SIZES[indexType];
+    for (uint64_t r = 0; r < faceElement->Count; ++r) {
+        offset = recordReader.ReadRecord(*faceElement, offset, [&](uint32_t property, uint32_t count, const uint8_t *items) {
+            if (property != faceIndexProperty) {
+                return;
+            }
+            for (uint32_t i = 2; i < count; ++i) {
+                corners.push_back(static_cast<uint32_t>(ReadPlyValue(items, indexType, bigEndian)));
+                corners.push_back(static_cast<uint32_t>(ReadPlyValue(items + (i - 1) * indexSize, indexType, bigEndian)));
+                corners.push_back(static_cast<uint32_t>(ReadPlyValue(items + i * indexSize, indexType, bigEndian)));
+            }
+        });
+        if (corners.size() >= static_cast<size_t>(m_blockSize) * 3 || (r + 1 == faceElement->Count && !corners.empty())) {
+            writeBlock(corners.data(), static_cast<uint32_t>(corners.size() / 3));
+            corners.clear();
+            _reportProgress(offset - faceOffset, fileSize - faceOffset, 1);
+        }
+    }
+    return "";
+}
+
+void ModelScanLoader::_reportProgress(size_t bytesRead, size_t fileSize, uint32_t pass) {
+    if (m_progressCallback && fileSize > 0) {
+        m_progressCallback((static_cast<f32>(pass) + static_cast<f32>(static_cast<f64>(bytesRead) / fileSize)) * 0.5f);
+    }
+}
+
+void ModelScanLoader::_accumulateNormals(VertexAttributes *attributes, const uint32_t *corners, uint32_t triangleCount) {
+    // Unnormalized face normals are twice the triangle's area, weighting larger faces more
+    glm::vec3 *positions = reinterpret_cast<glm::vec3*>(attributes->Positions.data());
+    glm::vec3 *normals = reinterpret_cast<glm::vec3*>(attributes->Normals.data());
+    for (uint32_t t = 0; t < triangleCount; ++t) {
+        uint32_t a = corners[t * 3 + 0];
+        uint32_t b = corners[t * 3 + 1];
+        uint32_t c = corners[t * 3 + 2];
+        glm::vec3 faceNormal = glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+        normals[a] += faceNormal;
+        normals[b] += faceNormal;
+        normals[c] += faceNormal;
+    }
+}
+
+void ModelScanLoader::_normalizeNormals(VertexAttributes *attributes) {
+    glm::vec3 *normals = reinterpret_cast<glm::vec3*>(attributes->Normals.data());
+    size_t vertexCount = attributes->Normals.size() / 3;
+    for (size_t i = 0; i < vertexCount; ++i) {
+        f32 length = glm::length(normals[i]);
+        if (length > 0.0f) {
+            normals[i] /= length;
+        }
+    }
+}
+
+} // namespace Graphics
@@ -0,0 +1,78 @@
+#pragma once
+#include "ModelObjLoader.h"
+#include <functional>
+
+namespace Graphics {
+
+class MemoryMappedFile;
+
+// Loads binary PLY and STL files, the formats scanners export, through the same vertex writers as ModelObjLoader
+// The mapped file is read in two passes of fixed-size blocks: the first gathers the shared vertex attributes, the second
+// hands the triangles to the writer one block at a time, so memory holds the vertices and the writer's output but never
+// a copy of the file's faces
+// STL stores every triangle's corners separately, they are welded by position with a hash table
+// Vertex normals missing from the file are computed from the faces, weighted by area
+// Every file becomes a single mesh with a single submesh and no materials
+class ModelScanLoader {
+public:
+    // Called with the fraction of the file processed so far, on the loading thread
+    typedef std::function<void(f32)> ProgressCallback;
+
+    // Triangles handed to the writer per block
+    static const uint32_t DEFAULT_BLOCK_SIZE = 65536;
+
+public:
+    ModelScanLoader();
+    ModelScanLoader(ModelScanLoader const &) = delete;
+    ModelScanLoader &operator=(ModelScanLoader const &) = delete;
+    ~ModelScanLoader();
+
+    void SetProgressCallback(ProgressCallback callback);
+    void SetBlockSize(uint32_t triangleCount);
+
+    // Files starting with "ply" are read as PLY, anything else as binary STL
+    std::string Load(std::string const &filePath, ModelObjVertexWriter *vertexWriter);
+
+    uint32_t GetVertexSize() const;
+    uint32_t GetVertexCount(uint32_t meshIndex) const;
+    const void *GetVertexData(uint32_t meshIndex) const;
+
+    uint32_t GetIndexSize() const;
+    uint32_t GetIndexCount(uint32_t meshIndex) const;
+    const void *GetIndexData(uint32_t meshIndex) const;
+
+    uint32_t GetSubMeshCount(uint32_t meshIndex) const;
+    const ModelObjLoader::SubMesh *GetSubMeshes(uint32_t meshIndex) const;
+
+private:
+    // Shared vertex attributes read by the writer, in the layout of ModelObjAttributeFetcher
+    struct VertexAttributes {
+        std::vector<float> Positions;
+        std::vector<float> Normals;
+        std::vector<float> TexCoords;
+        std::vector<float> Colors;
+    };
+
+    // Called by the format readers for every block of triangles, corners index the vertex attributes
+    typedef std::function<void(const uint32_t *corners, uint32_t triangleCount)> TriangleBlockFunc;
+
+    std::string _readStl(MemoryMappedFile const &file, VertexAttributes *attributes, TriangleBlockFunc const &writeBlock);
+    std::string _readPly(MemoryMappedFile const &file, VertexAttributes *attributes, TriangleBlockFunc const &writeBlock);
+
+    void _reportProgress(size_t bytesRead, size_t fileSize, uint32_t pass);
+
+    static void _accumulateNormals(VertexAttributes *attributes, const uint32_t *corners, uint32_t triangleCount);
+    static void _normalizeNormals(VertexAttributes *attributes);
+
+private:
+    ProgressCallback m_progressCallback;
+    uint32_t m_blockSize;
+
+    uint32_t m_vertexSize;
+    uint32_t m_indexSize;
+    ModelObjLoader::MeshDataBuffer m_vertexData;
+    ModelObjLoader::MeshDataBuffer m_indexData;
+    ModelObjLoader::MeshSubMeshBuffer m_subMeshData;
+};
+
+} // namespace Graphics
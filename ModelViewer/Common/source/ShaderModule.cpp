@@ -1,6 +1,6 @@
 #include "pch.h"
 #include "ShaderModule.h"
-#include <fstream>
+#include "ExecutableDirectory.h"
 #include <filesystem>
 
 namespace Graphics {
@@ -49,37 +49,21 @@ bool ShaderModule::CreateFromSpirv(std::string const &shaderFile) {
 }
 
 const uint8_t *ShaderModule::GetData() const {
-    return m_data.data();
+    return m_file.GetData();
 }
 
 size_t ShaderModule::GetDataSize() const {
-    return m_data.size();
+    return m_file.GetSize();
 }
 
 bool ShaderModule::_readFileToData(std::string const &filepath) {
-#ifdef _WIN32
-    wchar_t cwd[MAX_PATH];
-    auto ret = GetModuleFileName(NULL, cwd, MAX_PATH);
-    ASSERT(ret != 0);
-    std::filesystem::path exePath(cwd);
-    exePath = exePath.parent_path();
-#else
-#error Not Supported
-#endif
-
-    std::ifstream file(exePath /= filepath, std::ios_base::ate | std::ios_base::binary);
-
-    if (!file.is_open()) {
-        m_lastError = "Unable to open file";
+    std::filesystem::path exePath = GetExecutableDirectory();
+
+    if (!m_file.Open(exePath /= filepath)) {
+        m_lastError = m_file.GetLastError();
         return false;
     }
 
-    size_t fileSize = (size_t)file.tellg();
-    m_data.resize(fileSize);
-    file.seekg(0);
-    file.read(reinterpret_cast<char *>(m_data.data()), fileSize);
-
-    file.close();
     m_lastError.clear();
 
     return true;
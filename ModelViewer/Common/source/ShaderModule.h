@@ -1,11 +1,10 @@
 #pragma once
 
+#include "MemoryMappedFile.h"
+
 namespace Graphics {
 
 class ShaderModule {
-public:
-    typedef std::vector<uint8_t> DataArray;
-
 public:
     ShaderModule();
     ShaderModule(ShaderModule const &) = delete;
@@ -25,7 +24,8 @@ private:
     bool _readFileToData(std::string const &filepath);
 
 private:
-    DataArray m_data;
+    // Shader code is used straight from the mapped file, which is page aligned as required for SPIR-V
+    MemoryMappedFile m_file;
     std::string m_lastError;
 
 };
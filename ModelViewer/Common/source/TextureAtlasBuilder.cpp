@@ -0,0 +1,191 @@
+#include "pch.h"
+#include "TextureAtlasBuilder.h"
+#include "MipmapGenerator.h"
+#include <algorithm>
+#include <cstring>
+
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "stb/stb_rect_pack.h"
+
+namespace Graphics {
+
+namespace {
+
+const uint32_t DEFAULT_PAGE_EXTENT = 2048;
+const uint32_t DEFAULT_MIP_LEVEL_COUNT = 3;
+const uint32_t CHANNELS = 4;
+
+} // namespace
+
+TextureAtlasBuilder::TextureAtlasBuilder()
+  : m_pageExtent(DEFAULT_PAGE_EXTENT),
+    m_mipLevelCount(DEFAULT_MIP_LEVEL_COUNT),
+    m_blockExtent(1) {
+}
+
+TextureAtlasBuilder::~TextureAtlasBuilder() {
+}
+
+void TextureAtlasBuilder::SetPageExtent(uint32_t pageExtent) {
+    m_pageExtent = pageExtent;
+}
+
+void TextureAtlasBuilder::SetMipLevelCount(uint32_t mipLevelCount) {
+    ASSERT(mipLevelCount > 0);
+    m_mipLevelCount = mipLevelCount;
+}
+
+void TextureAtlasBuilder::SetBlockExtent(uint32_t blockExtent) {
+    ASSERT(blockExtent > 0);
+    m_blockExtent = blockExtent;
+}
+
+uint32_t TextureAtlasBuilder::AddTexture(const void *pixels, uint32_t width, uint32_t height) {
+    ASSERT(pixels && width > 0 && height > 0);
+
+    auto &texture = m_textures.emplace_back();
+    texture.Width = width;
+    texture.Height = height;
+    const uint8_t *source = reinterpret_cast<const uint8_t*>(pixels);
+    texture.Pixels.assign(source, source + size_t(width) * height * CHANNELS);
+    return static_cast<uint32_t>(m_textures.size() - 1);
+}
+
+bool TextureAtlasBuilder::Build() {
+    m_pages.clear();
+    m_placements.assign(m_textures.size(), Placement{});
+
+    // Cells are packed in units of their alignment, so every packed position is aligned
+    const uint32_t alignment = m_blockExtent << (m_mipLevelCount - 1);
+    const uint32_t gutter = 1u << (m_mipLevelCount - 1);
+    const int pageUnits = static_cast<int>(m_pageExtent / alignment);
+
+    std::vector<stbrp_rect> remaining(m_textures.size());
+    for (size_t i = 0; i < m_textures.size(); ++i) {
+        stbrp_rect &rect = remaining[i];
+        rect = stbrp_rect{};
+        rect.id = static_cast<int>(i);
+        rect.w = static_cast<stbrp_coord>(_getCellExtent(m_textures[i].Width) / alignment);
+        rect.h = static_cast<stbrp_coord>(_getCellExtent(m_textures[i].Height) / alignment);
+        if (rect.w > pageUnits || rect.h > pageUnits) {
+            return false;
+        }
+    }
+
+    // Each page takes every cell that still fits, the rest go on to the next page
+    std::vector<stbrp_node> nodes(pageUnits);
+    std::vector<stbrp_rect> unpacked;
+    while (!remaining.empty()) {
+        stbrp_context context;
+        stbrp_init_target(&context, pageUnits, pageUnits, nodes.data(), pageUnits);
+        stbrp_pack_rects(&context, remaining.data(), static_cast<int>(remaining.size()));
+
+        uint32_t pageIndex = static_cast<uint32_t>(m_pages.size());
+        Page &page = m_pages.emplace_back();
+        page.Width = 0;
+        page.Height = 0;
+        unpacked.clear();
+        for (auto const &rect : remaining) {
+            if (!rect.was_packed) {
+                unpacked.push_back(rect);
+                continue;
+            }
+            SourceTexture const &texture = m_textures[rect.id];
+            uint32_t cellX = static_cast<uint32_t>(rect.x) * alignment;
+            uint32_t cellY = static_cast<uint32_t>(rect.y) * alignment;
+            m_placements[rect.id] = { pageIndex, cellX + gutter, cellY + gutter, texture.Width, texture.Height };
+            page.Width = std::max(page.Width, cellX + static_cast<uint32_t>(rect.w) * alignment);
+            page.Height = std::max(page.Height, cellY + static_cast<uint32_t>(rect.h) * alignment);
+        }
+        if (unpacked.size() == remaining.size()) {
+            return false;
+        }
+        remaining.swap(unpacked);
+    }
+
+    // Trimmed pages stay a multiple of the alignment, so every level halves them exactly
+    for (auto &page : m_pages) {
+        page.MipLevelCount = std::min(m_mipLevelCount, MipmapGenerator::GetMipLevelCount(page.Width, page.Height));
+        page.Levels.assign(MipmapGenerator::GetLevelsSize(page.Width, page.Height, CHANNELS, 0, page.MipLevelCount), 0);
+    }
+    for (uint32_t i = 0; i < static_cast<uint32_t>(m_textures.size()); ++i) {
+        if (!_fillCell(i, m_placements[i].X - gutter, m_placements[i].Y - gutter)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+uint32_t TextureAtlasBuilder::GetPageCount() const {
+    return static_cast<uint32_t>(m_pages.size());
+}
+
+TextureAtlasBuilder::Page const &TextureAtlasBuilder::GetPage(uint32_t page) const {
+    return m_pages[page];
+}
+
+TextureAtlasBuilder::Placement const &TextureAtlasBuilder::GetPlacement(uint32_t texture) const {
+    return m_placements[texture];
+}
+
+glm::vec4 TextureAtlasBuilder::GetTexCoordTransform(uint32_t texture) const {
+    Placement const &placement = m_placements[texture];
+    Page const &page = m_pages[placement.Page];
+    f32 pageWidth = static_cast<f32>(page.Width);
+    f32 pageHeight = static_cast<f32>(page.Height);
+    return glm::vec4(placement.Width / pageWidth, placement.Height / pageHeight, placement.X / pageWidth, placement.Y / pageHeight);
+}
+
+uint32_t TextureAtlasBuilder::_getCellExtent(uint32_t extent) const {
+    const uint32_t alignment = m_blockExtent << (m_mipLevelCount - 1);
+    const uint32_t gutter = 1u << (m_mipLevelCount - 1);
+    return (extent + 2 * gutter + alignment - 1) / alignment * alignment;
+}
+
+bool TextureAtlasBuilder::_fillCell(uint32_t texture, uint32_t cellX, uint32_t cellY) {
+    SourceTexture const &source = m_textures[texture];
+    Page &page = m_pages[m_placements[texture].Page];
+    const int32_t gutter = 1 << (m_mipLevelCount - 1);
+    const uint32_t cellWidth = _getCellExtent(source.Width);
+    const uint32_t cellHeight = _getCellExtent(source.Height);
+
+    // Gutters and alignment padding repeat the nearest edge texel, as clamped addressing would
+    std::vector<uint8_t> cell(size_t(cellWidth) * cellHeight * CHANNELS);
+    for (uint32_t y = 0; y < cellHeight; ++y) {
+        int32_t sourceY = std::clamp(static_cast<int32_t>(y) - gutter, 0, static_cast<int32_t>(source.Height) - 1);
+        const uint8_t *sourceRow = source.Pixels.data() + size_t(sourceY) * source.Width * CHANNELS;
+        uint8_t *cellRow = cell.data() + size_t(y) * cellWidth * CHANNELS;
+        for (uint32_t x = 0; x < cellWidth; ++x) {
+            int32_t sourceX = std::clamp(static_cast<int32_t>(x) - gutter, 0, static_cast<int32_t>(source.Width) - 1);
+            memcpy(cellRow + size_t(x) * CHANNELS, sourceRow + size_t(sourceX) * CHANNELS, CHANNELS);
+        }
+    }
+
+    // Textures are sRGB color, as everywhere else textures are loaded
+    std::vector<uint8_t> cellLevels(MipmapGenerator::GetLevelsSize(cellWidth, cellHeight, CHANNELS, 1, page.MipLevelCount - 1));
+    MipmapGenerator mipmapGenerator;
+    if (page.MipLevelCount > 1 && !mipmapGenerator.Generate(cell.data(), cellWidth, cellHeight, CHANNELS, true, page.MipLevelCount, cellLevels.data())) {
+        return false;
+    }
+
+    size_t pageLevelOffset = 0;
+    const uint8_t *levelPixels = cell.data();
+    for (uint32_t level = 0; level < page.MipLevelCount; ++level) {
+        uint32_t pageLevelWidth = MipmapGenerator::GetLevelExtent(page.Width, level);
+        uint32_t levelWidth = cellWidth >> level;
+        uint32_t levelHeight = cellHeight >> level;
+        uint32_t levelX = cellX >> level;
+        uint32_t levelY = cellY >> level;
+        for (uint32_t row = 0; row < levelHeight; ++row) {
+            memcpy(page.Levels.data() + pageLevelOffset + (size_t(levelY + row) * pageLevelWidth + levelX) * CHANNELS,
+                   levelPixels + size_t(row) * levelWidth * CHANNELS, size_t(levelWidth) * CHANNELS);
+        }
+        pageLevelOffset += MipmapGenerator::GetLevelSize(page.Width, page.Height, CHANNELS, level);
+        levelPixels = level == 0 ? cellLevels.data() : levelPixels + MipmapGenerator::GetLevelSize(cellWidth, cellHeight, CHANNELS, level);
+    }
+
+    return true;
+}
+
+} // namespace Graphics
@@ -0,0 +1,80 @@
+#pragma once
+
+namespace Graphics {
+
+// Packs small 8-bit RGBA textures into atlas pages with stb_rect_pack
+// Each texture gets a cell with a gutter of its own edge texels around it, cells are aligned so that every level of a page
+//   halves whole cells. Levels are generated per cell and pages stop at the last level where cells are still whole, so
+//   filtering never blends neighbouring textures at any level
+class TextureAtlasBuilder {
+public:
+    struct Placement {
+        uint32_t Page;
+        uint32_t X; // First texel of the texture in the page, gutters excluded
+        uint32_t Y;
+        uint32_t Width;
+        uint32_t Height;
+    };
+
+    struct Page {
+        uint32_t Width;
+        uint32_t Height;
+        uint32_t MipLevelCount;
+        std::vector<uint8_t> Levels; // RGBA, every level one after another starting with the largest
+    };
+
+public:
+    TextureAtlasBuilder();
+    TextureAtlasBuilder(TextureAtlasBuilder const &) = delete;
+    TextureAtlasBuilder &operator=(TextureAtlasBuilder const &) = delete;
+    ~TextureAtlasBuilder();
+
+    // Largest width and height of a page, 2048 by default
+    // Pages are trimmed to the cells packed into them
+    void SetPageExtent(uint32_t pageExtent);
+
+    // Levels every page holds, 3 by default
+    // Gutters are 1 << (levels - 1) texels wide so the last level still has one texel of gutter around each texture
+    void SetMipLevelCount(uint32_t mipLevelCount);
+
+    // Set to 4 for pages that are block compressed afterwards so cells start on a block at every level, 1 by default
+    void SetBlockExtent(uint32_t blockExtent);
+
+    // Copies width * height RGBA pixels, returns the index of the texture's placement
+    uint32_t AddTexture(const void *pixels, uint32_t width, uint32_t height);
+
+    // Packs the added textures and fills the pages
+    // Returns false if a texture and its gutter do not fit an empty page
+    bool Build();
+
+    uint32_t GetPageCount() const;
+    Page const &GetPage(uint32_t page) const;
+    Placement const &GetPlacement(uint32_t texture) const;
+
+    // Scale (xy) and offset (zw) that map texture coordinates in [0, 1] of a texture to its page
+    glm::vec4 GetTexCoordTransform(uint32_t texture) const;
+
+private:
+    struct SourceTexture {
+        uint32_t Width;
+        uint32_t Height;
+        std::vector<uint8_t> Pixels;
+    };
+
+    // Cell extent of a texture extent, gutters and alignment included
+    uint32_t _getCellExtent(uint32_t extent) const;
+
+    // Generates the levels of a texture's cell and copies them into its page
+    bool _fillCell(uint32_t texture, uint32_t cellX, uint32_t cellY);
+
+private:
+    uint32_t m_pageExtent;
+    uint32_t m_mipLevelCount;
+    uint32_t m_blockExtent;
+
+    std::vector<SourceTexture> m_textures;
+    std::vector<Placement> m_placements;
+    std::vector<Page> m_pages;
+};
+
+} // namespace Graphics
@@ -0,0 +1,575 @@
+#include "pch.h"
+#include "TextureCompressor.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#define STB_DXT_IMPLEMENTATION
+#include "stb/stb_dxt.h"
+
+namespace Graphics {
+
+namespace {
+
+// Interpolation weights of 2, 3 and 4-bit BC7 indices, out of 64
+const int32_t BC7_WEIGHTS2[4] = { 0, 21, 43, 64 };
+const int32_t BC7_WEIGHTS3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+const int32_t BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Endpoints of a BC7 mode 6 block, 7 bits per channel and a lowest bit shared by the channels of each endpoint
+struct Bc7Mode6Endpoints {
+    uint8_t Color[2][4];
+    uint8_t PBit[2];
+};
+
+// Color or alpha of a BC7 mode 4 or 5 block, each on its own line with its own indices
+struct Bc7Line {
+    uint8_t Endpoints[2][4]; // Quantized to the mode's endpoint bits, only the line's channels are used
+    uint8_t Indices[16];
+    uint32_t Error; // Summed squared error over the line's channels
+};
+
+// Layout of a BC7 block storing color and alpha on separate lines
+struct Bc7SeparateAlphaMode {
+    uint32_t Mode;
+    uint32_t IndexMode; // Mode 4 only, 1 swaps which line gets the 3-bit indices
+    uint32_t ColorBits;
+    uint32_t ColorIndexBits;
+    uint32_t AlphaBits;
+    uint32_t AlphaIndexBits;
+};
+// Mode 5 first, it wins most blocks and is the only one tried without high quality
+const Bc7SeparateAlphaMode BC7_SEPARATE_ALPHA_MODES[] = {
+    { 5, 0, 7, 2, 8, 2 },
+    { 4, 0, 5, 2, 6, 3 },
+    { 4, 1, 5, 3, 6, 2 },
+};
+
+const int32_t *GetBc7Weights(uint32_t indexBits) {
+    return indexBits == 2 ? BC7_WEIGHTS2 : indexBits == 3 ? BC7_WEIGHTS3 : BC7_WEIGHTS4;
+}
+
+// Expands an endpoint channel to 8 bits by repeating its top bits, as the decoder does
+int32_t UnquantizeBc7Channel(int32_t value, uint32_t bits) {
+    return (value << (8 - bits)) | (value >> (2 * bits - 8));
+}
+
+// Copies a 4x4 block of RGBA pixels, repeating the last row and column past the edges of the image
+void GatherBlock(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, uint8_t outBlock[64]) {
+    for (uint32_t y = 0; y < 4; ++y) {
+        uint32_t sourceY = std::min(blockY * 4 + y, height - 1);
+        for (uint32_t x = 0; x < 4; ++x) {
+            uint32_t sourceX = std::min(blockX * 4 + x, width - 1);
+            memcpy(outBlock + (y * 4 + x) * 4, pixels + (static_cast<size_t>(sourceY) * width + sourceX) * 4, 4);
+        }
+    }
+}
+
+// Quantizes an endpoint to 7 bits per channel with the given lowest bit, returns the squared error
+f32 QuantizeEndpoint(glm::vec4 const &color, uint8_t pBit, uint8_t outColor[4]) {
+    f32 error = 0.0f;
+    for (uint32_t c = 0; c < 4; ++c) {
+        f32 value = std::clamp(color[c], 0.0f, 255.0f);
+        int32_t quantized = std::clamp(static_cast<int32_t>((value - pBit) * 0.5f + 0.5f), 0, 127);
+        f32 delta = static_cast<f32>((quantized << 1) | pBit) - value;
+        outColor[c] = static_cast<uint8_t>(quantized);
+        error += delta * delta;
+    }
+    return error;
+}
+
+// Quantizes both endpoints, picking the lowest bits that fit them best unless forced
+void QuantizeEndpoints(glm::vec4 const &color0, glm::vec4 const &color1, int32_t forcedPBits, Bc7Mode6Endpoints *outEndpoints) {
+    glm::vec4 const *colors[2] = { &color0, &color1 };
+    for (uint32_t e = 0; e < 2; ++e) {
+        if (forcedPBits >= 0) {
+            outEndpoints->PBit[e] = static_cast<uint8_t>((forcedPBits >> e) & 1);
+            QuantizeEndpoint(*colors[e], outEndpoints->PBit[e], outEndpoints->Color[e]);
+            continue;
+        }
+
+        uint8_t quantized[2][4];
+        f32 error0 = QuantizeEndpoint(*colors[e], 0, quantized[0]);
+        f32 error1 = QuantizeEndpoint(*colors[e], 1, quantized[1]);
+        outEndpoints->PBit[e] = error1 < error0 ? 1 : 0;
+        memcpy(outEndpoints->Color[e], quantized[outEndpoints->PBit[e]], 4);
+    }
+}
+
+// Picks the closest of the 16 interpolated colors for every pixel, returns the summed squared error
+uint32_t SelectIndices(const uint8_t block[64], Bc7Mode6Endpoints const &endpoints, uint8_t outIndices[16]) {
+    int32_t palette[16][4];
+    for (uint32_t c = 0; c < 4; ++c) {
+        int32_t color0 = (endpoints.Color[0][c] << 1) | endpoints.PBit[0];
+        int32_t color1 = (endpoints.Color[1][c] << 1) | endpoints.PBit[1];
+        for (uint32_t i = 0; i < 16; ++i) {
+            palette[i][c] = ((64 - BC7_WEIGHTS4[i]) * color0 + BC7_WEIGHTS4[i] * color1 + 32) >> 6;
+        }
+    }
+
+    // The palette lies on a line, so only the entries next to a pixel's projection onto it can be closest
+    int32_t axis[4];
+    int32_t axisLengthSquared = 0;
+    for (uint32_t c = 0; c < 4; ++c) {
+        axis[c] = palette[15][c] - palette[0][c];
+        axisLengthSquared += axis[c] * axis[c];
+    }
+    f32 projectionScale = axisLengthSquared > 0 ? 15.0f / axisLengthSquared : 0.0f;
+
+    uint32_t totalError = 0;
+    for (uint32_t p = 0; p < 16; ++p) {
+        const uint8_t *pixel = block + p * 4;
+        int32_t projection = 0;
+        for (uint32_t c = 0; c < 4; ++c) {
+            projection += (pixel[c] - palette[0][c]) * axis[c];
+        }
+        int32_t nearest = std::clamp(static_cast<int32_t>(projection * projectionScale + 0.5f), 0, 15);
+
+        uint32_t bestError = std::numeric_limits<uint32_t>::max();
+        for (int32_t i = std::max(nearest - 1, 0); i <= std::min(nearest + 1, 15); ++i) {
+            int32_t dr = palette[i][0] - pixel[0];
+            int32_t dg = palette[i][1] - pixel[1];
+            int32_t db = palette[i][2] - pixel[2];
+            int32_t da = palette[i][3] - pixel[3];
+            uint32_t error = static_cast<uint32_t>(dr * dr + dg * dg + db * db + da * da);
+            if (error < bestError) {
+                bestError = error;
+                outIndices[p] = static_cast<uint8_t>(i);
+            }
+        }
+        totalError += bestError;
+    }
+    return totalError;
+}
+
+// Endpoints along the principal axis of the block's colors, spanning every pixel
+void FitPrincipalAxis(const uint8_t block[64], glm::vec4 *outColor0, glm::vec4 *outColor1) {
+    glm::vec4 mean(0.0f);
+    glm::vec4 minColor(255.0f);
+    glm::vec4 maxColor(0.0f);
+    for (uint32_t p = 0; p < 16; ++p) {
+        glm::vec4 color(block[p * 4 + 0], block[p * 4 + 1], block[p * 4 + 2], block[p * 4 + 3]);
+        mean += color;
+        minColor = glm::min(minColor, color);
+        maxColor = glm::max(maxColor, color);
+    }
+    mean /= 16.0f;
+
+    glm::mat4 covariance(0.0f);
+    for (uint32_t p = 0; p < 16; ++p) {
+        glm::vec4 delta = glm::vec4(block[p * 4 + 0], block[p * 4 + 1], block[p * 4 + 2], block[p * 4 + 3]) - mean;
+        covariance += glm::outerProduct(delta, delta);
+    }
+
+    // Power iteration from the bounding box diagonal
+    glm::vec4 axis = maxColor - minColor;
+    for (uint32_t i = 0; i < 8; ++i) {
+        glm::vec4 next = covariance * axis;
+        f32 length = glm::length(next);
+        if (length < 1e-6f) {
+            break;
+        }
+        axis = next / length;
+    }
+
+    f32 axisLength = glm::length(axis);
+    if (axisLength < 1e-6f) {
+        *outColor0 = mean;
+        *outColor1 = mean;
+        return;
+    }
+    axis /= axisLength;
+
+    f32 minT = std::numeric_limits<f32>::max();
+    f32 maxT = std::numeric_limits<f32>::lowest();
+    for (uint32_t p = 0; p < 16; ++p) {
+        glm::vec4 delta = glm::vec4(block[p * 4 + 0], block[p * 4 + 1], block[p * 4 + 2], block[p * 4 + 3]) - mean;
+        f32 t = glm::dot(delta, axis);
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+    *outColor0 = mean + axis * minT;
+    *outColor1 = mean + axis * maxT;
+}
+
+// Least squares endpoints for the given indices, returns false if the indices do not constrain both endpoints
+bool RefitEndpoints(const uint8_t block[64], const uint8_t indices[16], const int32_t *weights, glm::vec4 *outColor0, glm::vec4 *outColor1) {
+    f32 a = 0.0f, b = 0.0f, c = 0.0f;
+    glm::vec4 rhs0(0.0f), rhs1(0.0f);
+    for (uint32_t p = 0; p < 16; ++p) {
+        f32 t = weights[indices[p]] / 64.0f;
+        glm::vec4 color(block[p * 4 + 0], block[p * 4 + 1], block[p * 4 + 2], block[p * 4 + 3]);
+        a += (1.0f - t) * (1.0f - t);
+        b += (1.0f - t) * t;
+        c += t * t;
+        rhs0 += (1.0f - t) * color;
+        rhs1 += t * color;
+    }
+
+    f32 determinant = a * c - b * b;
+    if (std::abs(determinant) < 1e-6f) {
+        return false;
+    }
+    *outColor0 = glm::clamp((c * rhs0 - b * rhs1) / determinant, 0.0f, 255.0f);
+    *outColor1 = glm::clamp((a * rhs1 - b * rhs0) / determinant, 0.0f, 255.0f);
+    return true;
+}
+
+// Packs the endpoints and indices of a mode 6 block, lowest bit first
+void WriteBc7Mode6Block(Bc7Mode6Endpoints endpoints, uint8_t indices[16], uint8_t outBlock[16]) {
+    // The first index is stored without its top bit, which the endpoint order makes 0
+    if (indices[0] & 8) {
+        std::swap(endpoints.Color[0], endpoints.Color[1]);
+        std::swap(endpoints.PBit[0], endpoints.PBit[1]);
+        for (uint32_t p = 0; p < 16; ++p) {
+            indices[p] = static_cast<uint8_t>(15 - indices[p]);
+        }
+    }
+
+    uint64_t bits[2] = { 0, 0 };
+    uint32_t position = 0;
+    auto write = [&bits, &position](uint32_t value, uint32_t bitCount) {
+        for (uint32_t i = 0; i < bitCount; ++i, ++position) {
+            bits[position / 64] |= static_cast<uint64_t>((value >> i) & 1) << (position % 64);
+        }
+    };
+
+    write(1 << 6, 7);
+    for (uint32_t c = 0; c < 4; ++c) {
+        write(endpoints.Color[0][c], 7);
+        write(endpoints.Color[1][c], 7);
+    }
+    write(endpoints.PBit[0], 1);
+    write(endpoints.PBit[1], 1);
+    write(indices[0], 3);
+    for (uint32_t p = 1; p < 16; ++p) {
+        write(indices[p], 4);
+    }
+    ASSERT(position == 128);
+
+    for (uint32_t i = 0; i < 16; ++i) {
+        outBlock[i] = static_cast<uint8_t>(bits[i / 8] >> ((i % 8) * 8));
+    }
+}
+
+// Returns the summed squared error of the block
+uint32_t EncodeBc7Mode6Block(const uint8_t block[64], bool highQuality, uint8_t outBlock[16]) {
+    glm::vec4 color0, color1;
+    FitPrincipalAxis(block, &color0, &color1);
+
+    Bc7Mode6Endpoints bestEndpoints;
+    uint8_t bestIndices[16];
+    QuantizeEndpoints(color0, color1, -1, &bestEndpoints);
+    uint32_t bestError = SelectIndices(block, bestEndpoints, bestIndices);
+
+    // Alternate between fitting endpoints to the indices and picking indices for the endpoints while the error drops
+    glm::vec4 bestColor0 = color0, bestColor1 = color1;
+    uint32_t refinements = highQuality ? 4 : 1;
+    for (uint32_t i = 0; i < refinements && bestError > 0; ++i) {
+        if (!RefitEndpoints(block, bestIndices, BC7_WEIGHTS4, &color0, &color1)) {
+            break;
+        }
+        Bc7Mode6Endpoints endpoints;
+        uint8_t indices[16];
+        QuantizeEndpoints(color0, color1, -1, &endpoints);
+        uint32_t error = SelectIndices(block, endpoints, indices);
+        if (error >= bestError) {
+            break;
+        }
+        bestEndpoints = endpoints;
+        memcpy(bestIndices, indices, sizeof(indices));
+        bestError = error;
+        bestColor0 = color0;
+        bestColor1 = color1;
+    }
+
+    // The lowest bits that fit each endpoint best are not always the best pair for the whole block
+    if (highQuality) {
+        for (int32_t pBits = 0; pBits < 4 && bestError > 0; ++pBits) {
+            Bc7Mode6Endpoints endpoints;
+            uint8_t indices[16];
+            QuantizeEndpoints(bestColor0, bestColor1, pBits, &endpoints);
+            uint32_t error = SelectIndices(block, endpoints, indices);
+            if (error < bestError) {
+                bestEndpoints = endpoints;
+                memcpy(bestIndices, indices, sizeof(indices));
+                bestError = error;
+            }
+        }
+    }
+
+    WriteBc7Mode6Block(bestEndpoints, bestIndices, outBlock);
+    return bestError;
+}
+
+// Picks the closest interpolated value for every pixel, sets the line's indices and error
+// Channels outside the line are zero in both the block and the endpoints so they add nothing
+void SelectLineIndices(const uint8_t block[64], uint32_t endpointBits, uint32_t indexBits, Bc7Line *line) {
+    const int32_t *weights = GetBc7Weights(indexBits);
+    int32_t levelCount = 1 << indexBits;
+    int32_t palette[8][4];
+    for (uint32_t c = 0; c < 4; ++c) {
+        int32_t color0 = UnquantizeBc7Channel(line->Endpoints[0][c], endpointBits);
+        int32_t color1 = UnquantizeBc7Channel(line->Endpoints[1][c], endpointBits);
+        for (int32_t i = 0; i < levelCount; ++i) {
+            palette[i][c] = ((64 - weights[i]) * color0 + weights[i] * color1 + 32) >> 6;
+        }
+    }
+
+    // Same projection onto the palette's line as SelectIndices
+    int32_t axis[4];
+    int32_t axisLengthSquared = 0;
+    for (uint32_t c = 0; c < 4; ++c) {
+        axis[c] = palette[levelCount - 1][c] - palette[0][c];
+        axisLengthSquared += axis[c] * axis[c];
+    }
+    f32 projectionScale = axisLengthSquared > 0 ? (levelCount - 1.0f) / axisLengthSquared : 0.0f;
+
+    line->Error = 0;
+    for (uint32_t p = 0; p < 16; ++p) {
+        const uint8_t *pixel = block + p * 4;
+        int32_t projection = 0;
+        for (uint32_t c = 0; c < 4; ++c) {
+            projection += (pixel[c] - palette[0][c]) * axis[c];
+        }
+        int32_t nearest = std::clamp(static_cast<int32_t>(projection * projectionScale + 0.5f), 0, levelCount - 1);
+
+        uint32_t bestError = std::numeric_limits<uint32_t>::max();
+        for (int32_t i = std::max(nearest - 1, 0); i <= std::min(nearest + 1, levelCount - 1); ++i) {
+            uint32_t error = 0;
+            for (uint32_t c = 0; c < 4; ++c) {
+                int32_t delta = palette[i][c] - pixel[c];
+                error += static_cast<uint32_t>(delta * delta);
+            }
+            if (error < bestError) {
+                bestError = error;
+                line->Indices[p] = static_cast<uint8_t>(i);
+            }
+        }
+        line->Error += bestError;
+    }
+}
+
+void QuantizeLineEndpoint(glm::vec4 const &color, uint32_t endpointBits, uint8_t outEndpoint[4]) {
+    int32_t maxValue = (1 << endpointBits) - 1;
+    for (uint32_t c = 0; c < 4; ++c) {
+        f32 value = std::clamp(color[c], 0.0f, 255.0f);
+        outEndpoint[c] = static_cast<uint8_t>(std::clamp(static_cast<int32_t>(value * maxValue / 255.0f + 0.5f), 0, maxValue));
+    }
+}
+
+// Quantizes a line fitted to the block to the mode's bits and refines it like mode 6
+// The block holds only the line's channels, the others are zero
+void EncodeLine(const uint8_t lineBlock[64], glm::vec4 color0, glm::vec4 color1, uint32_t endpointBits, uint32_t indexBits, uint32_t refinements, Bc7Line *outLine) {
+    QuantizeLineEndpoint(color0, endpointBits, outLine->Endpoints[0]);
+    QuantizeLineEndpoint(color1, endpointBits, outLine->Endpoints[1]);
+    SelectLineIndices(lineBlock, endpointBits, indexBits, outLine);
+
+    for (uint32_t i = 0; i < refinements && outLine->Error > 0; ++i) {
+        if (!RefitEndpoints(lineBlock, outLine->Indices, GetBc7Weights(indexBits), &color0, &color1)) {
+            break;
+        }
+        Bc7Line line;
+        QuantizeLineEndpoint(color0, endpointBits, line.Endpoints[0]);
+        QuantizeLineEndpoint(color1, endpointBits, line.Endpoints[1]);
+        SelectLineIndices(lineBlock, endpointBits, indexBits, &line);
+        if (line.Error >= outLine->Error) {
+            break;
+        }
+        *outLine = line;
+    }
+}
+
+// Packs a mode 4 or 5 block, lowest bit first, without rotating channels
+void WriteBc7SeparateAlphaBlock(Bc7SeparateAlphaMode const &mode, Bc7Line color, Bc7Line alpha, uint8_t outBlock[16]) {
+    // The first index of each line is stored without its top bit, which the endpoint order makes 0
+    Bc7Line *lines[2] = { &color, &alpha };
+    uint32_t indexBits[2] = { mode.ColorIndexBits, mode.AlphaIndexBits };
+    for (uint32_t l = 0; l < 2; ++l) {
+        uint32_t levelCount = 1u << indexBits[l];
+        if (lines[l]->Indices[0] >= levelCount / 2) {
+            std::swap(lines[l]->Endpoints[0], lines[l]->Endpoints[1]);
+            for (uint32_t p = 0; p < 16; ++p) {
+                lines[l]->Indices[p] = static_cast<uint8_t>(levelCount - 1 - lines[l]->Indices[p]);
+            }
+        }
+    }
+
+    uint64_t bits[2] = { 0, 0 };
+    uint32_t position = 0;
+    auto write = [&bits, &position](uint32_t value, uint32_t bitCount) {
+        for (uint32_t i = 0; i < bitCount; ++i, ++position) {
+            bits[position / 64] |= static_cast<uint64_t>((value >> i) & 1) << (position % 64);
+        }
+    };
+
+    write(1 << mode.Mode, mode.Mode + 1);
+    write(0, 2); // Rotation
+    if (mode.Mode == 4) {
+        write(mode.IndexMode, 1);
+    }
+    for (uint32_t c = 0; c < 3; ++c) {
+        write(color.Endpoints[0][c], mode.ColorBits);
+        write(color.Endpoints[1][c], mode.ColorBits);
+    }
+    write(alpha.Endpoints[0][3], mode.AlphaBits);
+    write(alpha.Endpoints[1][3], mode.AlphaBits);
+
+    // The 2-bit indices come first
+    if (mode.IndexMode == 1) {
+        std::swap(lines[0], lines[1]);
+        std::swap(indexBits[0], indexBits[1]);
+    }
+    for (uint32_t l = 0; l < 2; ++l) {
+        write(lines[l]->Indices[0], indexBits[l] - 1);
+        for (uint32_t p = 1; p < 16; ++p) {
+            write(lines[l]->Indices[p], indexBits[l]);
+        }
+    }
+    ASSERT(position == 128);
+
+    for (uint32_t i = 0; i < 16; ++i) {
+        outBlock[i] = static_cast<uint8_t>(bits[i / 8] >> ((i % 8) * 8));
+    }
+}
+
+void EncodeBc7Block(const uint8_t block[64], bool highQuality, uint8_t outBlock[16]) {
+    uint32_t bestError = EncodeBc7Mode6Block(block, highQuality, outBlock);
+
+    // Mode 6 spends its shared indices on color and alpha together, blocks whose alpha varies may keep more of both
+    // with alpha on a line of its own
+    uint8_t minAlpha = 255, maxAlpha = 0;
+    for (uint32_t p = 0; p < 16; ++p) {
+        minAlpha = std::min(minAlpha, block[p * 4 + 3]);
+        maxAlpha = std::max(maxAlpha, block[p * 4 + 3]);
+    }
+    if (minAlpha == maxAlpha || bestError == 0) {
+        return;
+    }
+
+    // Both lines are fitted once and only quantized per mode
+    uint8_t colorBlock[64];
+    uint8_t alphaBlock[64] = {};
+    memcpy(colorBlock, block, sizeof(colorBlock));
+    for (uint32_t p = 0; p < 16; ++p) {
+        colorBlock[p * 4 + 3] = 0;
+        alphaBlock[p * 4 + 3] = block[p * 4 + 3];
+    }
+    glm::vec4 color0, color1;
+    FitPrincipalAxis(colorBlock, &color0, &color1);
+    glm::vec4 alpha0(0.0f, 0.0f, 0.0f, minAlpha);
+    glm::vec4 alpha1(0.0f, 0.0f, 0.0f, maxAlpha);
+
+    uint32_t refinements = highQuality ? 4 : 1;
+    uint32_t modeCount = highQuality ? static_cast<uint32_t>(std::size(BC7_SEPARATE_ALPHA_MODES)) : 1;
+    for (uint32_t m = 0; m < modeCount; ++m) {
+        Bc7SeparateAlphaMode const &mode = BC7_SEPARATE_ALPHA_MODES[m];
+        Bc7Line color, alpha;
+        EncodeLine(colorBlock, color0, color1, mode.ColorBits, mode.ColorIndexBits, refinements, &color);
+        EncodeLine(alphaBlock, alpha0, alpha1, mode.AlphaBits, mode.AlphaIndexBits, refinements, &alpha);
+        if (color.Error + alpha.Error < bestError) {
+            bestError = color.Error + alpha.Error;
+            WriteBc7SeparateAlphaBlock(mode, color, alpha, outBlock);
+        }
+    }
+}
+
+} // namespace
+
+TextureCompressor::TextureCompressor()
+  : m_threadPool(nullptr),
+    m_highQuality(true) {
+}
+
+TextureCompressor::~TextureCompressor() {
+}
+
+void TextureCompressor::SetThreadPool(ThreadPool *threadPool) {
+    m_threadPool = threadPool;
+}
+
+void TextureCompressor::SetHighQuality(bool enable) {
+    m_highQuality = enable;
+}
+
+void TextureCompressor::Compress(const void *pixels, uint32_t width, uint32_t height, BlockFormat format, void *outBlocks) const {
+    ASSERT(pixels && outBlocks);
+    ASSERT(format < BLOCK_FORMAT_COUNT);
+
+    if (format == BLOCK_FORMAT_NONE) {
+        memcpy(outBlocks, pixels, GetCompressedSize(format, width, height));
+        return;
+    }
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    const uint8_t *source = reinterpret_cast<const uint8_t*>(pixels);
+    uint8_t *destination = reinterpret_cast<uint8_t*>(outBlocks);
+    uint32_t blockRowCount = (height + 3) / 4;
+    if (m_threadPool && blockRowCount > 1) {
+        m_threadPool->ParallelFor(blockRowCount, [this, source, width, height, format, destination](uint32_t blockRow) {
+            _compressBlockRow(source, width, height, format, blockRow, destination);
+        });
+    }
+    else {
+        for (uint32_t blockRow = 0; blockRow < blockRowCount; ++blockRow) {
+            _compressBlockRow(source, width, height, format, blockRow, destination);
+        }
+    }
+}
+
+uint32_t TextureCompressor::GetBlockSize(BlockFormat format) {
+    switch (format) {
+    case BLOCK_FORMAT_NONE:
+        return 4;
+    case BLOCK_FORMAT_BC1:
+        return 8;
+    case BLOCK_FORMAT_BC3:
+    case BLOCK_FORMAT_BC7:
+        return 16;
+    default:
+        ASSERT(false);
+        return 0;
+    }
+}
+
+size_t TextureCompressor::GetCompressedSize(BlockFormat format, uint32_t width, uint32_t height) {
+    if (format == BLOCK_FORMAT_NONE) {
+        return static_cast<size_t>(width) * height * GetBlockSize(format);
+    }
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * GetBlockSize(format);
+}
+
+void TextureCompressor::_compressBlockRow(const uint8_t *pixels, uint32_t width, uint32_t height, BlockFormat format, uint32_t blockRow, uint8_t *outBlocks) const {
+    uint32_t blockSize = GetBlockSize(format);
+    uint32_t blockCountX = (width + 3) / 4;
+    uint8_t *out = outBlocks + static_cast<size_t>(blockRow) * blockCountX * blockSize;
+    int stbMode = m_highQuality ? STB_DXT_HIGHQUAL : STB_DXT_NORMAL;
+
+    uint8_t block[64];
+    for (uint32_t blockX = 0; blockX < blockCountX; ++blockX, out += blockSize) {
+        GatherBlock(pixels, width, height, blockX, blockRow, block);
+        switch (format) {
+        case BLOCK_FORMAT_BC1:
+            // stb_dxt needs a constant alpha when it is not stored
+            for (uint32_t p = 0; p < 16; ++p) {
+                block[p * 4 + 3] = 255;
+            }
+            stb_compress_dxt_block(out, block, 0, stbMode);
+            break;
+        case BLOCK_FORMAT_BC3:
+            stb_compress_dxt_block(out, block, 1, stbMode);
+            break;
+        case BLOCK_FORMAT_BC7:
+            EncodeBc7Block(block, m_highQuality, out);
+            break;
+        default:
+            ASSERT(false);
+            break;
+        }
+    }
+}
+
+} // namespace Graphics
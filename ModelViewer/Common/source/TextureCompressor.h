@@ -0,0 +1,51 @@
+#pragma once
+
+namespace Graphics {
+
+class ThreadPool;
+
+// Compresses 8-bit RGBA images into 4x4 pixel blocks for the GPU
+// BC1 and BC3 use stb_dxt, BC7 uses one line per block without partitions: mode 6 with 16 levels shared by RGBA, or modes 4
+// and 5 with alpha on its own line where the alpha varies, whichever fits the block best (mode 5 only without high quality)
+// This suits photographic textures and alpha well but is weaker than a full multi-partition encoder on blocks with several
+// distinct colors
+// Rows of blocks are encoded in parallel on the thread pool, if one is set
+class TextureCompressor {
+public:
+    enum BlockFormat : uint32_t {
+        BLOCK_FORMAT_NONE = 0, // Uncompressed RGBA, 4 bytes per pixel
+        BLOCK_FORMAT_BC1,      // RGB, 8 bytes per block
+        BLOCK_FORMAT_BC3,      // RGB with separate alpha, 16 bytes per block
+        BLOCK_FORMAT_BC7,      // RGBA, 16 bytes per block
+
+        BLOCK_FORMAT_COUNT
+    };
+
+public:
+    TextureCompressor();
+    TextureCompressor(TextureCompressor const &) = delete;
+    TextureCompressor &operator=(TextureCompressor const &) = delete;
+    ~TextureCompressor();
+
+    void SetThreadPool(ThreadPool *threadPool);
+
+    // Runs extra refinement passes, on by default
+    void SetHighQuality(bool enable);
+
+    // Compresses width * height RGBA pixels into GetCompressedSize bytes at outBlocks
+    // Images that are not a multiple of 4 in size are padded by repeating their last row and column
+    void Compress(const void *pixels, uint32_t width, uint32_t height, BlockFormat format, void *outBlocks) const;
+
+    // Bytes per block, or per pixel for BLOCK_FORMAT_NONE
+    static uint32_t GetBlockSize(BlockFormat format);
+    static size_t GetCompressedSize(BlockFormat format, uint32_t width, uint32_t height);
+
+private:
+    void _compressBlockRow(const uint8_t *pixels, uint32_t width, uint32_t height, BlockFormat format, uint32_t blockRow, uint8_t *outBlocks) const;
+
+private:
+    ThreadPool *m_threadPool;
+    bool m_highQuality;
+};
+
+} // namespace Graphics
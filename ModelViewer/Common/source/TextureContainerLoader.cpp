@@ -0,0 +1,506 @@
+#include "pch.h"
+#include "TextureContainerLoader.h"
+#include "ExecutableDirectory.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace Graphics {
+
+namespace {
+
+// DDS, all values little endian
+const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+const uint32_t DDS_FOURCC_DXT1 = 0x31545844;
+const uint32_t DDS_FOURCC_DXT5 = 0x35545844;
+const uint32_t DDS_FOURCC_DX10 = 0x30315844;
+
+const uint32_t DDSD_CAPS = 0x1;
+const uint32_t DDSD_HEIGHT = 0x2;
+const uint32_t DDSD_WIDTH = 0x4;
+const uint32_t DDSD_PIXELFORMAT = 0x1000;
+const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+const uint32_t DDSD_LINEARSIZE = 0x80000;
+const uint32_t DDSCAPS_COMPLEX = 0x8;
+const uint32_t DDSCAPS_TEXTURE = 0x1000;
+const uint32_t DDSCAPS_MIPMAP = 0x400000;
+const uint32_t DDSCAPS2_CUBEMAP = 0x200;
+const uint32_t DDSCAPS2_VOLUME = 0x200000;
+const uint32_t DDPF_ALPHAPIXELS = 0x1;
+const uint32_t DDPF_FOURCC = 0x4;
+const uint32_t DDPF_RGB = 0x40;
+const uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+const uint32_t DXGI_FORMAT_R8G8B8A8_UNORM = 28;
+const uint32_t DXGI_FORMAT_R8G8B8A8_UNORM_SRGB = 29;
+const uint32_t DXGI_FORMAT_BC1_UNORM = 71;
+const uint32_t DXGI_FORMAT_BC1_UNORM_SRGB = 72;
+const uint32_t DXGI_FORMAT_BC3_UNORM = 77;
+const uint32_t DXGI_FORMAT_BC3_UNORM_SRGB = 78;
+const uint32_t DXGI_FORMAT_BC7_UNORM = 98;
+const uint32_t DXGI_FORMAT_BC7_UNORM_SRGB = 99;
+
+// Marks the reserved words of DDS files written as caches, followed by the source key
+const uint32_t DDS_CACHE_TAG = 0x4354564D; // "MVTC"
+
+struct DdsPixelFormat {
+    uint32_t Size;
+    uint32_t Flags;
+    uint32_t FourCC;
+    uint32_t RgbBitCount;
+    uint32_t RBitMask;
+    uint32_t GBitMask;
+    uint32_t BBitMask;
+    uint32_t ABitMask;
+};
+
+struct DdsHeader {
+    uint32_t Size;
+    uint32_t Flags;
+    uint32_t Height;
+    uint32_t Width;
+    uint32_t PitchOrLinearSize;
+    uint32_t Depth;
+    uint32_t MipMapCount;
+    uint32_t Reserved1[11];
+    DdsPixelFormat PixelFormat;
+    uint32_t Caps;
+    uint32_t Caps2;
+    uint32_t Caps3;
+    uint32_t Caps4;
+    uint32_t Reserved2;
+};
+static_assert(sizeof(DdsHeader) == 124, "DDS header must match the file layout");
+
+struct DdsHeaderDx10 {
+    uint32_t DxgiFormat;
+    uint32_t ResourceDimension;
+    uint32_t MiscFlag;
+    uint32_t ArraySize;
+    uint32_t MiscFlags2;
+};
+
+// KTX2, all values little endian
+const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+// VkFormat values, Common does not depend on the Vulkan headers
+const uint32_t VK_FORMAT_VALUE_R8G8B8A8_UNORM = 37;
+const uint32_t VK_FORMAT_VALUE_R8G8B8A8_SRGB = 43;
+const uint32_t VK_FORMAT_VALUE_BC1_RGB_UNORM_BLOCK = 131;
+const uint32_t VK_FORMAT_VALUE_BC1_RGB_SRGB_BLOCK = 132;
+const uint32_t VK_FORMAT_VALUE_BC1_RGBA_UNORM_BLOCK = 133;
+const uint32_t VK_FORMAT_VALUE_BC1_RGBA_SRGB_BLOCK = 134;
+const uint32_t VK_FORMAT_VALUE_BC3_UNORM_BLOCK = 137;
+const uint32_t VK_FORMAT_VALUE_BC3_SRGB_BLOCK = 138;
+const uint32_t VK_FORMAT_VALUE_BC7_UNORM_BLOCK = 145;
+const uint32_t VK_FORMAT_VALUE_BC7_SRGB_BLOCK = 146;
+
+struct Ktx2Header {
+    uint8_t Identifier[12];
+    uint32_t VkFormat;
+    uint32_t TypeSize;
+    uint32_t PixelWidth;
+    uint32_t PixelHeight;
+    uint32_t PixelDepth;
+    uint32_t LayerCount;
+    uint32_t FaceCount;
+    uint32_t LevelCount;
+    uint32_t SupercompressionScheme;
+    uint32_t DfdByteOffset;
+    uint32_t DfdByteLength;
+    uint32_t KvdByteOffset;
+    uint32_t KvdByteLength;
+    uint64_t SgdByteOffset;
+    uint64_t SgdByteLength;
+};
+static_assert(sizeof(Ktx2Header) == 80, "KTX2 header must match the file layout");
+
+struct Ktx2LevelIndex {
+    uint64_t ByteOffset;
+    uint64_t ByteLength;
+    uint64_t UncompressedByteLength;
+};
+
+bool GetDxgiFormat(uint32_t dxgiFormat, TextureCompressor::BlockFormat *outFormat, bool *outSrgb) {
+    switch (dxgiFormat) {
+    case DXGI_FORMAT_R8G8B8A8_UNORM:
+    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        *outFormat = TextureCompressor::BLOCK_FORMAT_NONE;
+        break;
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+        *outFormat = TextureCompressor::BLOCK_FORMAT_BC1;
+        break;
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+        *outFormat = TextureCompressor::BLOCK_FORMAT_BC3;
+        break;
+    case DXGI_FORMAT_BC7_UNORM:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:
+        *outFormat = TextureCompressor::BLOCK_FORMAT_BC7;
+        break;
+    default:
+        return false;
+    }
+    *outSrgb = dxgiFormat == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB || dxgiFormat == DXGI_FORMAT_BC1_UNORM_SRGB ||
+               dxgiFormat == DXGI_FORMAT_BC3_UNORM_SRGB || dxgiFormat == DXGI_FORMAT_BC7_UNORM_SRGB;
+    return true;
+}
+
+uint32_t GetDxgiFormatValue(TextureCompressor::BlockFormat format, bool srgb) {
+    switch (format) {
+    case TextureCompressor::BLOCK_FORMAT_NONE:
+        return srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+    case TextureCompressor::BLOCK_FORMAT_BC1:
+        return srgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+    case TextureCompressor::BLOCK_FORMAT_BC3:
+        return srgb ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+    case TextureCompressor::BLOCK_FORMAT_BC7:
+        return srgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+    default:
+        ASSERT(false);
+        return 0;
+    }
+}
+
+bool GetKtx2Format(uint32_t vkFormat, TextureCompressor::BlockFormat *outFormat, bool *outSrgb) {
+    switch (vkFormat) {
+    case VK_FORMAT_VALUE_R8G8B8A8_UNORM:
+    case VK_FORMAT_VALUE_R8G8B8A8_SRGB:
+        *outFormat = TextureCompressor::BLOCK_FORMAT_NONE;
+        break;
+    case VK_FORMAT_VALUE_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_VALUE_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_VALUE_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_VALUE_BC1_RGBA_SRGB_BLOCK:
+        *outFormat = TextureCompressor::BLOCK_FORMAT_BC1;
+        break;
+    case VK_FORMAT_VALUE_BC3_UNORM_BLOCK:
+    case VK_FORMAT_VALUE_BC3_SRGB_BLOCK:
+        *outFormat = TextureCompressor::BLOCK_FORMAT_BC3;
+        break;
+    case VK_FORMAT_VALUE_BC7_UNORM_BLOCK:
+    case VK_FORMAT_VALUE_BC7_SRGB_BLOCK:
+        *outFormat = TextureCompressor::BLOCK_FORMAT_BC7;
+        break;
+    default:
+        return false;
+    }
+    *outSrgb = vkFormat == VK_FORMAT_VALUE_R8G8B8A8_SRGB || vkFormat == VK_FORMAT_VALUE_BC1_RGB_SRGB_BLOCK ||
+               vkFormat == VK_FORMAT_VALUE_BC1_RGBA_SRGB_BLOCK || vkFormat == VK_FORMAT_VALUE_BC3_SRGB_BLOCK ||
+               vkFormat == VK_FORMAT_VALUE_BC7_SRGB_BLOCK;
+    return true;
+}
+
+const char *GetBlockFormatName(TextureCompressor::BlockFormat format) {
+    switch (format) {
+    case TextureCompressor::BLOCK_FORMAT_BC1:
+        return "bc1";
+    case TextureCompressor::BLOCK_FORMAT_BC3:
+        return "bc3";
+    case TextureCompressor::BLOCK_FORMAT_BC7:
+        return "bc7";
+    default:
+        return "rgba";
+    }
+}
+
+} // namespace
+
+TextureContainerLoader::TextureContainerLoader()
+  : m_data(nullptr),
+    m_format(TextureCompressor::BLOCK_FORMAT_NONE),
+    m_srgb(false),
+    m_sourceKey(0) {
+}
+
+TextureContainerLoader::~TextureContainerLoader() {
+}
+
+std::string const &TextureContainerLoader::GetLastError() const {
+    return m_lastError;
+}
+
+bool TextureContainerLoader::IsContainerFile(std::string const &filePath) {
+    std::string extension = std::filesystem::u8path(filePath).extension().u8string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(tolower(c)); });
+    return extension == ".dds" || extension == ".ktx2";
+}
+
+bool TextureContainerLoader::LoadFromFile(std::string const &filePath) {
+    std::filesystem::path exePath = GetExecutableDirectory();
+
+    if (!m_file.Open(exePath /= filePath)) {
+        m_lastError = m_file.GetLastError();
+        return false;
+    }
+
+    return LoadFromMemory(m_file.GetData(), m_file.GetSize());
+}
+
+bool TextureContainerLoader::LoadFromMemory(const void *data, size_t dataSize) {
+    m_data = nullptr;
+    m_mipLevels.clear();
+    m_sourceKey = 0;
+
+    const uint8_t *bytes = reinterpret_cast<const uint8_t*>(data);
+    uint32_t magic = 0;
+    if (dataSize >= sizeof(magic)) {
+        memcpy(&magic, bytes, sizeof(magic));
+    }
+
+    bool parsed = false;
+    if (magic == DDS_MAGIC) {
+        parsed = _parseDds(bytes, dataSize);
+    }
+    else if (dataSize >= sizeof(KTX2_IDENTIFIER) && memcmp(bytes, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0) {
+        parsed = _parseKtx2(bytes, dataSize);
+    }
+    else {
+        m_lastError = "Not a DDS or KTX2 file";
+    }
+
+    if (!parsed) {
+        m_mipLevels.clear();
+        return false;
+    }
+
+    m_data = bytes;
+    m_lastError.clear();
+    return true;
+}
+
+TextureCompressor::BlockFormat TextureContainerLoader::GetFormat() const {
+    return m_format;
+}
+
+bool TextureContainerLoader::IsSrgb() const {
+    return m_srgb;
+}
+
+uint32_t TextureContainerLoader::GetWidth() const {
+    return m_mipLevels.empty() ? 0 : m_mipLevels[0].Width;
+}
+
+uint32_t TextureContainerLoader::GetHeight() const {
+    return m_mipLevels.empty() ? 0 : m_mipLevels[0].Height;
+}
+
+uint32_t TextureContainerLoader::GetMipLevelCount() const {
+    return static_cast<uint32_t>(m_mipLevels.size());
+}
+
+TextureContainerLoader::MipLevel const &TextureContainerLoader::GetMipLevel(uint32_t level) const {
+    ASSERT(level < m_mipLevels.size());
+    return m_mipLevels[level];
+}
+
+const uint8_t *TextureContainerLoader::GetData() const {
+    return m_data;
+}
+
+uint64_t TextureContainerLoader::GetSourceKey() const {
+    return m_sourceKey;
+}
+
+std::filesystem::path TextureContainerLoader::GetCachePath(std::filesystem::path const &sourceFilePath, TextureCompressor::BlockFormat format) {
+    std::filesystem::path cachePath(sourceFilePath);
+    cachePath += ".";
+    cachePath += GetBlockFormatName(format);
+    cachePath += ".dds";
+    return cachePath;
+}
+
+bool TextureContainerLoader::SaveDds(std::filesystem::path const &filePath, TextureCompressor::BlockFormat format, bool srgb, uint32_t width, uint32_t height,
+                                     uint32_t mipLevelCount, const void *data, size_t dataSize, uint64_t sourceKey) {
+    ASSERT(format < TextureCompressor::BLOCK_FORMAT_COUNT);
+    ASSERT(mipLevelCount > 0);
+    ASSERT(data || dataSize == 0);
+
+    DdsHeader header{};
+    header.Size = sizeof(DdsHeader);
+    header.Flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE | (mipLevelCount > 1 ? DDSD_MIPMAPCOUNT : 0);
+    header.Height = height;
+    header.Width = width;
+    header.PitchOrLinearSize = static_cast<uint32_t>(TextureCompressor::GetCompressedSize(format, width, height));
+    header.MipMapCount = mipLevelCount;
+    if (sourceKey != 0) {
+        header.Reserved1[0] = DDS_CACHE_TAG;
+        header.Reserved1[1] = static_cast<uint32_t>(sourceKey);
+        header.Reserved1[2] = static_cast<uint32_t>(sourceKey >> 32);
+    }
+    header.PixelFormat.Size = sizeof(DdsPixelFormat);
+    header.PixelFormat.Flags = DDPF_FOURCC;
+    header.PixelFormat.FourCC = DDS_FOURCC_DX10;
+    header.Caps = DDSCAPS_TEXTURE | (mipLevelCount > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+    DdsHeaderDx10 headerDx10{};
+    headerDx10.DxgiFormat = GetDxgiFormatValue(format, srgb);
+    headerDx10.ResourceDimension = DDS_DIMENSION_TEXTURE2D;
+    headerDx10.ArraySize = 1;
+
+    // Write to a temporary file first so a partially written file is never picked up
+    std::filesystem::path tempPath(filePath);
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            m_lastError = "Unable to create texture file: " + tempPath.u8string();
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(&headerDx10), sizeof(headerDx10));
+        file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(dataSize));
+        if (!file) {
+            m_lastError = "Unable to write texture file: " + tempPath.u8string();
+            file.close();
+            std::error_code errorCode;
+            std::filesystem::remove(tempPath, errorCode);
+            return false;
+        }
+    }
+
+    std::error_code errorCode;
+    std::filesystem::rename(tempPath, filePath, errorCode);
+    if (errorCode) {
+        m_lastError = "Unable to replace texture file: " + filePath.u8string() + " (" + errorCode.message() + ")";
+        std::filesystem::remove(tempPath, errorCode);
+        return false;
+    }
+
+    return true;
+}
+
+bool TextureContainerLoader::_parseDds(const uint8_t *data, size_t dataSize) {
+    DdsHeader header;
+    size_t offset = sizeof(DDS_MAGIC);
+    if (dataSize < offset + sizeof(header)) {
+        m_lastError = "DDS file is truncated";
+        return false;
+    }
+    memcpy(&header, data + offset, sizeof(header));
+    offset += sizeof(header);
+
+    if (header.Size != sizeof(DdsHeader) || header.PixelFormat.Size != sizeof(DdsPixelFormat)) {
+        m_lastError = "DDS header is corrupt";
+        return false;
+    }
+    if ((header.Caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME)) != 0) {
+        m_lastError = "Only 2D DDS textures are supported";
+        return false;
+    }
+
+    DdsPixelFormat const &pixelFormat = header.PixelFormat;
+    if ((pixelFormat.Flags & DDPF_FOURCC) != 0 && pixelFormat.FourCC == DDS_FOURCC_DX10) {
+        DdsHeaderDx10 headerDx10;
+        if (dataSize < offset + sizeof(headerDx10)) {
+            m_lastError = "DDS file is truncated";
+            return false;
+        }
+        memcpy(&headerDx10, data + offset, sizeof(headerDx10));
+        offset += sizeof(headerDx10);
+
+        if (headerDx10.ResourceDimension != DDS_DIMENSION_TEXTURE2D || headerDx10.ArraySize > 1) {
+            m_lastError = "Only 2D DDS textures with one layer are supported";
+            return false;
+        }
+        if (!GetDxgiFormat(headerDx10.DxgiFormat, &m_format, &m_srgb)) {
+            m_lastError = "Unsupported DDS format " + std::to_string(headerDx10.DxgiFormat);
+            return false;
+        }
+    }
+    else if ((pixelFormat.Flags & DDPF_FOURCC) != 0 && (pixelFormat.FourCC == DDS_FOURCC_DXT1 || pixelFormat.FourCC == DDS_FOURCC_DXT5)) {
+        // Legacy headers do not say whether colors are sRGB, material textures are
+        m_format = pixelFormat.FourCC == DDS_FOURCC_DXT1 ? TextureCompressor::BLOCK_FORMAT_BC1 : TextureCompressor::BLOCK_FORMAT_BC3;
+        m_srgb = true;
+    }
+    else if ((pixelFormat.Flags & DDPF_RGB) != 0 && (pixelFormat.Flags & DDPF_ALPHAPIXELS) != 0 && pixelFormat.RgbBitCount == 32 &&
+             pixelFormat.RBitMask == 0x000000FF && pixelFormat.GBitMask == 0x0000FF00 && pixelFormat.BBitMask == 0x00FF0000 && pixelFormat.ABitMask == 0xFF000000) {
+        m_format = TextureCompressor::BLOCK_FORMAT_NONE;
+        m_srgb = true;
+    }
+    else {
+        m_lastError = "Unsupported DDS pixel format";
+        return false;
+    }
+
+    m_sourceKey = header.Reserved1[0] == DDS_CACHE_TAG ? (static_cast<uint64_t>(header.Reserved1[2]) << 32) | header.Reserved1[1] : 0;
+
+    uint32_t mipLevelCount = (header.Flags & DDSD_MIPMAPCOUNT) != 0 ? std::max(header.MipMapCount, 1u) : 1;
+    return _setSequentialLevels(header.Width, header.Height, mipLevelCount, offset, dataSize);
+}
+
+bool TextureContainerLoader::_parseKtx2(const uint8_t *data, size_t dataSize) {
+    Ktx2Header header;
+    if (dataSize < sizeof(header)) {
+        m_lastError = "KTX2 file is truncated";
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+
+    if (header.PixelWidth == 0 || header.PixelHeight == 0 || header.PixelDepth > 1 || header.LayerCount > 1 || header.FaceCount != 1) {
+        m_lastError = "Only 2D KTX2 textures with one layer and face are supported";
+        return false;
+    }
+    if (header.SupercompressionScheme != 0) {
+        m_lastError = "Supercompressed KTX2 files are not supported";
+        return false;
+    }
+    if (!GetKtx2Format(header.VkFormat, &m_format, &m_srgb)) {
+        m_lastError = "Unsupported KTX2 format " + std::to_string(header.VkFormat);
+        return false;
+    }
+
+    // A level count of 0 asks for mips to be generated at runtime, only the base level is stored
+    uint32_t mipLevelCount = std::max(header.LevelCount, 1u);
+    if (mipLevelCount > 32 || dataSize < sizeof(header) + mipLevelCount * sizeof(Ktx2LevelIndex)) {
+        m_lastError = "KTX2 level index is corrupt";
+        return false;
+    }
+
+    // Levels are stored smallest first but indexed largest first
+    m_mipLevels.resize(mipLevelCount);
+    for (uint32_t level = 0; level < mipLevelCount; ++level) {
+        Ktx2LevelIndex levelIndex;
+        memcpy(&levelIndex, data + sizeof(header) + level * sizeof(Ktx2LevelIndex), sizeof(levelIndex));
+
+        MipLevel &mipLevel = m_mipLevels[level];
+        mipLevel.Width = std::max(header.PixelWidth >> level, 1u);
+        mipLevel.Height = std::max(header.PixelHeight >> level, 1u);
+        mipLevel.Offset = static_cast<size_t>(levelIndex.ByteOffset);
+        mipLevel.Size = TextureCompressor::GetCompressedSize(m_format, mipLevel.Width, mipLevel.Height);
+        if (levelIndex.ByteLength < mipLevel.Size || levelIndex.ByteOffset > dataSize || dataSize - levelIndex.ByteOffset < mipLevel.Size) {
+            m_lastError = "KTX2 level " + std::to_string(level) + " is truncated";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool TextureContainerLoader::_setSequentialLevels(uint32_t width, uint32_t height, uint32_t mipLevelCount, size_t firstOffset, size_t dataSize) {
+    if (width == 0 || height == 0 || mipLevelCount > 32) {
+        m_lastError = "Texture size is invalid";
+        return false;
+    }
+
+    m_mipLevels.resize(mipLevelCount);
+    size_t offset = firstOffset;
+    for (uint32_t level = 0; level < mipLevelCount; ++level) {
+        MipLevel &mipLevel = m_mipLevels[level];
+        mipLevel.Width = std::max(width >> level, 1u);
+        mipLevel.Height = std::max(height >> level, 1u);
+        mipLevel.Offset = offset;
+        mipLevel.Size = TextureCompressor::GetCompressedSize(m_format, mipLevel.Width, mipLevel.Height);
+        if (dataSize - offset < mipLevel.Size) {
+            m_lastError = "Texture level " + std::to_string(level) + " is truncated";
+            return false;
+        }
+        offset += mipLevel.Size;
+    }
+
+    return true;
+}
+
+} // namespace Graphics
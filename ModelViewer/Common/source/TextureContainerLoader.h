@@ -0,0 +1,73 @@
+#pragma once
+
+#include "MemoryMappedFile.h"
+#include "TextureCompressor.h"
+#include <filesystem>
+
+namespace Graphics {
+
+// Reads 2D textures with their mip chains from DDS and KTX2 files, either block-compressed or RGBA
+// Levels are read straight from the mapped file, so uploading them takes a single copy into staging memory
+// Only BC1, BC3, BC7 and R8G8B8A8 textures with one layer and face are supported, KTX2 supercompression is not
+// Textures compressed on import are cached as DDS files next to their source, keyed by the source's content hash
+class TextureContainerLoader {
+public:
+    struct MipLevel {
+        uint32_t Width;
+        uint32_t Height;
+        size_t Offset; // From GetData
+        size_t Size;
+    };
+
+public:
+    TextureContainerLoader();
+    TextureContainerLoader(TextureContainerLoader const &) = delete;
+    TextureContainerLoader &operator=(TextureContainerLoader const &) = delete;
+    ~TextureContainerLoader();
+
+    std::string const &GetLastError() const;
+
+    // Files ending in .dds or .ktx2
+    static bool IsContainerFile(std::string const &filePath);
+
+    // Maps the file (relative to the executable) and keeps it mapped until the next load
+    bool LoadFromFile(std::string const &filePath);
+
+    // The data must stay valid while the loader is used
+    bool LoadFromMemory(const void *data, size_t dataSize);
+
+    TextureCompressor::BlockFormat GetFormat() const;
+    bool IsSrgb() const;
+    uint32_t GetWidth() const;
+    uint32_t GetHeight() const;
+    uint32_t GetMipLevelCount() const;
+    MipLevel const &GetMipLevel(uint32_t level) const;
+    const uint8_t *GetData() const;
+
+    // Key of the source a cached texture was compressed from, 0 for files that are not caches
+    uint64_t GetSourceKey() const;
+
+    // Returns the path the compressed cache of a source image is stored at
+    static std::filesystem::path GetCachePath(std::filesystem::path const &sourceFilePath, TextureCompressor::BlockFormat format);
+
+    // Writes a DDS file with a DX10 header, data holds every mip level one after another starting with the largest
+    // A non-zero sourceKey marks the file as the cache of that source
+    bool SaveDds(std::filesystem::path const &filePath, TextureCompressor::BlockFormat format, bool srgb, uint32_t width, uint32_t height,
+                 uint32_t mipLevelCount, const void *data, size_t dataSize, uint64_t sourceKey);
+
+private:
+    bool _parseDds(const uint8_t *data, size_t dataSize);
+    bool _parseKtx2(const uint8_t *data, size_t dataSize);
+    bool _setSequentialLevels(uint32_t width, uint32_t height, uint32_t mipLevelCount, size_t firstOffset, size_t dataSize);
+
+private:
+    MemoryMappedFile m_file;
+    const uint8_t *m_data;
+    TextureCompressor::BlockFormat m_format;
+    bool m_srgb;
+    std::vector<MipLevel> m_mipLevels;
+    uint64_t m_sourceKey;
+    std::string m_lastError;
+};
+
+} // namespace Graphics
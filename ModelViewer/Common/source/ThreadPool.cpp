@@ -0,0 +1,136 @@
+#include "pch.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <memory>
+
+namespace Graphics {
+
+ThreadPool::ThreadPool()
+  : m_activeTaskCount(0),
+    m_shutdown(false) {
+}
+
+ThreadPool::~ThreadPool() {
+    Finalize();
+}
+
+void ThreadPool::Initialize(uint32_t threadCount) {
+    ASSERT(m_threads.empty());
+
+    if (threadCount == 0) {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    m_shutdown = false;
+    m_threads.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i) {
+        m_threads.emplace_back(&ThreadPool::_workerLoop, this);
+    }
+}
+
+void ThreadPool::Finalize() {
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_shutdown = true;
+    }
+    m_taskAvailable.notify_all();
+
+    for (auto &thread : m_threads) {
+        thread.join();
+    }
+    m_threads.clear();
+}
+
+uint32_t ThreadPool::GetThreadCount() const {
+    return static_cast<uint32_t>(m_threads.size());
+}
+
+void ThreadPool::Enqueue(Task task) {
+    if (m_threads.empty()) {
+        task();
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_tasks.emplace_back(std::move(task));
+    }
+    m_taskAvailable.notify_one();
+}
+
+void ThreadPool::WaitIdle() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_tasksFinished.wait(lock, [this]() { return m_tasks.empty() && m_activeTaskCount == 0; });
+}
+
+void ThreadPool::ParallelFor(uint32_t count, ParallelTask const &task) {
+    if (count == 0) {
+        return;
+    }
+
+    // Work is claimed through a shared counter so that helper tasks which start late (or never start because every
+    // worker is busy) do not stall the caller; the caller keeps claiming work until none is left
+    struct SharedState {
+        std::atomic<uint32_t> nextIndex;
+        std::atomic<uint32_t> finishedCount;
+        std::mutex mutex;
+        std::condition_variable finished;
+        ParallelTask const *task;
+        uint32_t count;
+    };
+    auto state = std::make_shared<SharedState>();
+    state->nextIndex = 0;
+    state->finishedCount = 0;
+    state->task = &task;
+    state->count = count;
+
+    auto runTasks = [](SharedState *sharedState) {
+        for (uint32_t i = sharedState->nextIndex++; i < sharedState->count; i = sharedState->nextIndex++) {
+            (*sharedState->task)(i);
+            if (++sharedState->finishedCount == sharedState->count) {
+                std::unique_lock<std::mutex> lock(sharedState->mutex);
+                sharedState->finished.notify_all();
+            }
+        }
+    };
+
+    uint32_t helperCount = std::min(GetThreadCount(), count - 1);
+    for (uint32_t i = 0; i < helperCount; ++i) {
+        Enqueue([state, runTasks]() { runTasks(state.get()); });
+    }
+
+    runTasks(state.get());
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&state]() { return state->finishedCount == state->count; });
+}
+
+void ThreadPool::_workerLoop() {
+    for (;;) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_taskAvailable.wait(lock, [this]() { return m_shutdown || !m_tasks.empty(); });
+            if (m_tasks.empty()) {
+                // Shutting down and no more work left
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+            ++m_activeTaskCount;
+        }
+
+        task();
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            --m_activeTaskCount;
+            if (m_tasks.empty() && m_activeTaskCount == 0) {
+                m_tasksFinished.notify_all();
+            }
+        }
+    }
+}
+
+} // namespace Graphics
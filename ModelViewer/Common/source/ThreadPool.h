@@ -0,0 +1,59 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+
+namespace Graphics {
+
+// Fixed size pool of worker threads for splitting up CPU heavy work such as model parsing and image decoding
+class ThreadPool {
+public:
+    typedef std::function<void()> Task;
+    typedef std::function<void(uint32_t)> ParallelTask;
+
+public:
+    ThreadPool();
+    ThreadPool(ThreadPool const &) = delete;
+    ThreadPool &operator=(ThreadPool const &) = delete;
+    ~ThreadPool();
+
+    // Starts the worker threads
+    // A threadCount of 0 uses one thread per hardware thread
+    void Initialize(uint32_t threadCount = 0);
+
+    // Waits for all queued tasks to finish then joins the worker threads
+    void Finalize();
+
+    uint32_t GetThreadCount() const;
+
+    // Queues a task to run on a worker thread
+    // If the pool has no threads, the task is run immediately on the calling thread
+    void Enqueue(Task task);
+
+    // Blocks until all queued tasks have finished
+    void WaitIdle();
+
+    // Runs task(i) for every i in [0, count) and blocks until all have finished
+    // The calling thread also executes tasks, so this is safe to call from inside a worker thread
+    void ParallelFor(uint32_t count, ParallelTask const &task);
+
+private:
+    void _workerLoop();
+
+private:
+    typedef std::vector<std::thread> ThreadArray;
+    typedef std::deque<Task> TaskQueue;
+
+    ThreadArray m_threads;
+    TaskQueue m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_taskAvailable;
+    std::condition_variable m_tasksFinished;
+    uint32_t m_activeTaskCount;
+    bool m_shutdown;
+};
+
+} // namespace Graphics
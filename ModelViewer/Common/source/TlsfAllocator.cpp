@@ -0,0 +1,321 @@
+#include "pch.h"
+#include "TlsfAllocator.h"
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace Graphics {
+
+namespace {
+
+// Free remainders below this stay part of the allocation instead of becoming a range of their own
+const uint64_t MIN_SPLIT_SIZE = 16;
+
+// Index of the highest set bit, value must not be 0
+uint32_t HighestBit(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return index;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+// Index of the lowest set bit, value must not be 0
+uint32_t LowestBit(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return index;
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace
+
+TlsfAllocator::TlsfAllocator()
+  : m_size(0),
+    m_usedSize(0),
+    m_allocationCount(0),
+    m_freeBlockCount(0),
+    m_flBitmap(0),
+    m_slBitmaps{} {
+    Initialize(0);
+}
+
+TlsfAllocator::~TlsfAllocator() {
+}
+
+void TlsfAllocator::Initialize(uint64_t size) {
+    m_size = size;
+    m_usedSize = 0;
+    m_allocationCount = 0;
+    m_freeBlockCount = 0;
+    m_blocks.clear();
+    m_unusedBlocks.clear();
+    m_flBitmap = 0;
+    std::fill(std::begin(m_slBitmaps), std::end(m_slBitmaps), 0);
+    for (auto &lists : m_freeLists) {
+        for (auto &list : lists) {
+            list = INVALID_HANDLE;
+        }
+    }
+
+    if (size > 0) {
+        uint32_t index = _newBlock();
+        m_blocks[index] = { 0, size, INVALID_HANDLE, INVALID_HANDLE, INVALID_HANDLE, INVALID_HANDLE, false };
+        _insertFreeBlock(index);
+    }
+}
+
+TlsfAllocator::Handle TlsfAllocator::Allocate(uint64_t size, uint64_t alignment) {
+    ASSERT(size > 0);
+    ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    uint32_t index = _findFit(size, alignment);
+    if (index == INVALID_HANDLE) {
+        return INVALID_HANDLE;
+    }
+    _removeFreeBlock(index);
+
+    // Alignment padding in front becomes a free range of its own, the range before is in use so there is nothing to merge
+    uint64_t padding = AlignUp(m_blocks[index].Offset, alignment) - m_blocks[index].Offset;
+    if (padding > 0) {
+        uint32_t front = index;
+        index = _split(front, padding);
+        _insertFreeBlock(front);
+    }
+
+    // Same for the remainder, the range after is in use as well
+    if (m_blocks[index].Size - size >= MIN_SPLIT_SIZE) {
+        _insertFreeBlock(_split(index, size));
+    }
+
+    ++m_allocationCount;
+    m_usedSize += m_blocks[index].Size;
+    return index;
+}
+
+void TlsfAllocator::Free(Handle handle) {
+    ASSERT(handle < m_blocks.size() && !m_blocks[handle].Free);
+
+    --m_allocationCount;
+    m_usedSize -= m_blocks[handle].Size;
+
+    uint32_t index = handle;
+    uint32_t prev = m_blocks[index].PrevPhysical;
+    if (prev != INVALID_HANDLE && m_blocks[prev].Free) {
+        _removeFreeBlock(prev);
+        _mergeNext(prev);
+        index = prev;
+    }
+    uint32_t next = m_blocks[index].NextPhysical;
+    if (next != INVALID_HANDLE && m_blocks[next].Free) {
+        _removeFreeBlock(next);
+        _mergeNext(index);
+    }
+    _insertFreeBlock(index);
+}
+
+uint64_t TlsfAllocator::GetOffset(Handle handle) const {
+    ASSERT(handle < m_blocks.size());
+    return m_blocks[handle].Offset;
+}
+
+uint64_t TlsfAllocator::GetSize(Handle handle) const {
+    ASSERT(handle < m_blocks.size());
+    return m_blocks[handle].Size;
+}
+
+uint64_t TlsfAllocator::GetSize() const {
+    return m_size;
+}
+
+bool TlsfAllocator::IsEmpty() const {
+    return m_allocationCount == 0;
+}
+
+TlsfAllocator::Stats TlsfAllocator::GetStats() const {
+    Stats stats{};
+    stats.Size = m_size;
+    stats.UsedSize = m_usedSize;
+    stats.AllocationCount = m_allocationCount;
+    stats.FreeRangeCount = m_freeBlockCount;
+
+    // Only the highest non-empty list can hold the largest range, but its ranges differ in size
+    if (m_flBitmap) {
+        uint32_t fl = HighestBit(m_flBitmap);
+        uint32_t sl = HighestBit(m_slBitmaps[fl]);
+        for (uint32_t index = m_freeLists[fl][sl]; index != INVALID_HANDLE; index = m_blocks[index].NextFree) {
+            stats.LargestFreeRange = std::max(stats.LargestFreeRange, m_blocks[index].Size);
+        }
+    }
+
+    return stats;
+}
+
+f32 TlsfAllocator::GetFragmentation(Stats const &stats) {
+    uint64_t freeSize = stats.Size - stats.UsedSize;
+    if (freeSize == 0) {
+        return 0.0f;
+    }
+    return 1.0f - static_cast<f32>(static_cast<f64>(stats.LargestFreeRange) / freeSize);
+}
+
+void TlsfAllocator::_getListIndices(uint64_t size, uint32_t *outFl, uint32_t *outSl) {
+    // Sizes below SL_COUNT get a list each, above that every power of 2 is split into SL_COUNT lists
+    if (size < SL_COUNT) {
+        *outFl = 0;
+        *outSl = static_cast<uint32_t>(size);
+        return;
+    }
+    uint32_t highestBit = HighestBit(size);
+    *outFl = highestBit - SL_BITS + 1;
+    *outSl = static_cast<uint32_t>(size >> (highestBit - SL_BITS)) - SL_COUNT;
+}
+
+uint32_t TlsfAllocator::_findFreeBlock(uint32_t fl, uint32_t sl) const {
+    uint32_t slBitmap = m_slBitmaps[fl] & (~0u << sl);
+    if (!slBitmap) {
+        uint64_t flBitmap = fl + 1 < 64 ? m_flBitmap & (~0ull << (fl + 1)) : 0;
+        if (!flBitmap) {
+            return INVALID_HANDLE;
+        }
+        fl = LowestBit(flBitmap);
+        slBitmap = m_slBitmaps[fl];
+    }
+    return m_freeLists[fl][LowestBit(slBitmap)];
+}
+
+uint32_t TlsfAllocator::_findFit(uint64_t size, uint64_t alignment) const {
+    // Every range in a list of a larger size than size rounded up to the next list holds size
+    auto findLarger = [this](uint64_t size) {
+        if (size >= SL_COUNT) {
+            if (size > std::numeric_limits<uint64_t>::max() / 2) {
+                return INVALID_HANDLE;
+            }
+            size += (uint64_t(1) << (HighestBit(size) - SL_BITS)) - 1;
+        }
+        uint32_t fl, sl;
+        _getListIndices(size, &fl, &sl);
+        return fl < FL_COUNT ? _findFreeBlock(fl, sl) : INVALID_HANDLE;
+    };
+
+    // Most ranges are aligned well enough already, the first fit is only given up if its padding does not leave room
+    uint32_t index = findLarger(size);
+    if (index != INVALID_HANDLE) {
+        Block const &block = m_blocks[index];
+        if (AlignUp(block.Offset, alignment) + size <= block.Offset + block.Size) {
+            return index;
+        }
+    }
+    if (alignment > 1 && size <= std::numeric_limits<uint64_t>::max() - alignment) {
+        index = findLarger(size + alignment - 1);
+        if (index != INVALID_HANDLE) {
+            return index;
+        }
+    }
+
+    // Ranges in the list size itself falls in are only walked when nothing larger is left, as when the memory is almost full
+    uint32_t fl, sl;
+    _getListIndices(size, &fl, &sl);
+    for (index = m_freeLists[fl][sl]; index != INVALID_HANDLE; index = m_blocks[index].NextFree) {
+        Block const &block = m_blocks[index];
+        if (AlignUp(block.Offset, alignment) + size <= block.Offset + block.Size) {
+            return index;
+        }
+    }
+    return INVALID_HANDLE;
+}
+
+void TlsfAllocator::_insertFreeBlock(uint32_t index) {
+    Block &block = m_blocks[index];
+    uint32_t fl, sl;
+    _getListIndices(block.Size, &fl, &sl);
+
+    block.Free = true;
+    block.PrevFree = INVALID_HANDLE;
+    block.NextFree = m_freeLists[fl][sl];
+    if (block.NextFree != INVALID_HANDLE) {
+        m_blocks[block.NextFree].PrevFree = index;
+    }
+    m_freeLists[fl][sl] = index;
+    m_flBitmap |= uint64_t(1) << fl;
+    m_slBitmaps[fl] |= 1u << sl;
+    ++m_freeBlockCount;
+}
+
+void TlsfAllocator::_removeFreeBlock(uint32_t index) {
+    Block &block = m_blocks[index];
+    ASSERT(block.Free);
+    uint32_t fl, sl;
+    _getListIndices(block.Size, &fl, &sl);
+
+    if (block.PrevFree != INVALID_HANDLE) {
+        m_blocks[block.PrevFree].NextFree = block.NextFree;
+    }
+    else {
+        m_freeLists[fl][sl] = block.NextFree;
+        if (block.NextFree == INVALID_HANDLE) {
+            m_slBitmaps[fl] &= ~(1u << sl);
+            if (!m_slBitmaps[fl]) {
+                m_flBitmap &= ~(uint64_t(1) << fl);
+            }
+        }
+    }
+    if (block.NextFree != INVALID_HANDLE) {
+        m_blocks[block.NextFree].PrevFree = block.PrevFree;
+    }
+    block.Free = false;
+    --m_freeBlockCount;
+}
+
+uint32_t TlsfAllocator::_split(uint32_t index, uint64_t size) {
+    ASSERT(size < m_blocks[index].Size);
+
+    // Records are only referenced after _newBlock, it may move them
+    uint32_t rest = _newBlock();
+    Block &block = m_blocks[index];
+    Block &restBlock = m_blocks[rest];
+    restBlock = { block.Offset + size, block.Size - size, index, block.NextPhysical, INVALID_HANDLE, INVALID_HANDLE, false };
+    if (block.NextPhysical != INVALID_HANDLE) {
+        m_blocks[block.NextPhysical].PrevPhysical = rest;
+    }
+    block.NextPhysical = rest;
+    block.Size = size;
+    return rest;
+}
+
+void TlsfAllocator::_mergeNext(uint32_t index) {
+    Block &block = m_blocks[index];
+    uint32_t next = block.NextPhysical;
+    Block const &nextBlock = m_blocks[next];
+    ASSERT(block.Offset + block.Size == nextBlock.Offset);
+
+    block.Size += nextBlock.Size;
+    block.NextPhysical = nextBlock.NextPhysical;
+    if (block.NextPhysical != INVALID_HANDLE) {
+        m_blocks[block.NextPhysical].PrevPhysical = index;
+    }
+    m_unusedBlocks.push_back(next);
+}
+
+uint32_t TlsfAllocator::_newBlock() {
+    if (!m_unusedBlocks.empty()) {
+        uint32_t index = m_unusedBlocks.back();
+        m_unusedBlocks.pop_back();
+        return index;
+    }
+    m_blocks.emplace_back();
+    return static_cast<uint32_t>(m_blocks.size() - 1);
+}
+
+} // namespace Graphics
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <limits>
+
+namespace Graphics {
+
+// Two level segregated fit allocator over a range of offsets, allocating and freeing take constant time
+// Only the bookkeeping lives here, the range itself can be anything such as a block of device memory
+// Free ranges are binned by size in power of 2 classes split into 32 linear subclasses, adjacent free ranges are merged
+//   as soon as they are freed
+class TlsfAllocator {
+public:
+    typedef uint32_t Handle;
+    static const Handle INVALID_HANDLE = std::numeric_limits<uint32_t>::max();
+
+    struct Stats {
+        uint64_t Size;
+        uint64_t UsedSize;         // Held by allocations, remainders too small to split off included
+        uint32_t AllocationCount;
+        uint32_t FreeRangeCount;
+        uint64_t LargestFreeRange;
+    };
+
+public:
+    TlsfAllocator();
+    TlsfAllocator(TlsfAllocator const &) = delete;
+    TlsfAllocator &operator=(TlsfAllocator const &) = delete;
+    ~TlsfAllocator();
+
+    // Manages the offsets [0, size), discards every previous allocation
+    void Initialize(uint64_t size);
+
+    // Returns INVALID_HANDLE if no free range fits, alignment must be a power of 2
+    Handle Allocate(uint64_t size, uint64_t alignment);
+    void Free(Handle handle);
+
+    uint64_t GetOffset(Handle handle) const;
+    uint64_t GetSize(Handle handle) const;
+
+    uint64_t GetSize() const;
+    bool IsEmpty() const;
+    Stats GetStats() const;
+
+    // 0 while the free space is a single range, towards 1 the more of it is split into ranges smaller than the largest
+    static f32 GetFragmentation(Stats const &stats);
+
+private:
+    static const uint32_t SL_BITS = 5;
+    static const uint32_t SL_COUNT = 1 << SL_BITS;
+    static const uint32_t FL_COUNT = 64 - SL_BITS + 1;
+
+    // Ranges are records in m_blocks linked by index, both in offset order and in their free list
+    struct Block {
+        uint64_t Offset;
+        uint64_t Size;
+        uint32_t PrevPhysical;
+        uint32_t NextPhysical;
+        uint32_t PrevFree;
+        uint32_t NextFree;
+        bool Free;
+    };
+
+    // Free list of the size class a range of size belongs to
+    static void _getListIndices(uint64_t size, uint32_t *outFl, uint32_t *outSl);
+
+    // First free range of a list at least as large as fl/sl, INVALID_HANDLE if there is none
+    uint32_t _findFreeBlock(uint32_t fl, uint32_t sl) const;
+
+    // Free range that holds size bytes at alignment
+    uint32_t _findFit(uint64_t size, uint64_t alignment) const;
+
+    void _insertFreeBlock(uint32_t index);
+    void _removeFreeBlock(uint32_t index);
+
+    // Splits the range after size bytes and returns the new record for the rest
+    uint32_t _split(uint32_t index, uint64_t size);
+
+    // Merges the range after index into index and recycles its record
+    void _mergeNext(uint32_t index);
+
+    uint32_t _newBlock();
+
+private:
+    uint64_t m_size;
+    uint64_t m_usedSize;
+    uint32_t m_allocationCount;
+    uint32_t m_freeBlockCount;
+
+    std::vector<Block> m_blocks;
+    std::vector<uint32_t> m_unusedBlocks;
+
+    uint64_t m_flBitmap;
+    uint32_t m_slBitmaps[FL_COUNT];
+    uint32_t m_freeLists[FL_COUNT][SL_COUNT];
+};
+
+} // namespace Graphics
@@ -0,0 +1,69 @@
+#include "pch.h"
+#include "VertexQuantization.h"
+#include <cmath>
+
+namespace Graphics {
+
+namespace {
+
+int16_t EncodeSnorm16(f32 value) {
+    value = glm::clamp(value, -1.0f, 1.0f);
+    return static_cast<int16_t>(std::lround(value * 32767.0f));
+}
+
+f32 DecodeSnorm16(int16_t value) {
+    return glm::max(static_cast<f32>(value) / 32767.0f, -1.0f);
+}
+
+f32 SignNotZero(f32 value) {
+    return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+} // namespace
+
+uint16_t EncodeUnorm16(f32 value) {
+    value = glm::clamp(value, 0.0f, 1.0f);
+    return static_cast<uint16_t>(std::lround(value * 65535.0f));
+}
+
+uint8_t EncodeUnorm8(f32 value) {
+    value = glm::clamp(value, 0.0f, 1.0f);
+    return static_cast<uint8_t>(std::lround(value * 255.0f));
+}
+
+uint16_t EncodeRangeUnorm16(f32 value, f32 minValue, f32 extent) {
+    if (extent <= 0.0f) {
+        return 0;
+    }
+    return EncodeUnorm16((value - minValue) / extent);
+}
+
+void EncodeOctahedralSnorm16(glm::vec3 const &normal, int16_t out[2]) {
+    f32 sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (sum == 0.0f) {
+        out[0] = 0;
+        out[1] = 0;
+        return;
+    }
+
+    // Project onto the octahedron, folding the lower hemisphere over the upper one
+    glm::vec2 projected(normal.x / sum, normal.y / sum);
+    if (normal.z < 0.0f) {
+        projected = glm::vec2(
+            (1.0f - std::abs(projected.y)) * SignNotZero(projected.x),
+            (1.0f - std::abs(projected.x)) * SignNotZero(projected.y));
+    }
+    out[0] = EncodeSnorm16(projected.x);
+    out[1] = EncodeSnorm16(projected.y);
+}
+
+glm::vec3 DecodeOctahedralSnorm16(const int16_t encoded[2]) {
+    glm::vec3 normal(DecodeSnorm16(encoded[0]), DecodeSnorm16(encoded[1]), 0.0f);
+    normal.z = 1.0f - std::abs(normal.x) - std::abs(normal.y);
+    f32 fold = glm::max(-normal.z, 0.0f);
+    normal.x += normal.x >= 0.0f ? -fold : fold;
+    normal.y += normal.y >= 0.0f ? -fold : fold;
+    return glm::normalize(normal);
+}
+
+} // namespace Graphics
@@ -0,0 +1,21 @@
+#pragma once
+
+namespace Graphics {
+
+// Helpers to pack vertex attributes into compact GPU formats
+// Results match the Vulkan UNORM/SNORM conversion rules so the shader reads them back with the fixed function fetch
+
+// Maps [0, 1] to a 16 or 8-bit unsigned normalized value, clamping values outside the range
+uint16_t EncodeUnorm16(f32 value);
+uint8_t EncodeUnorm8(f32 value);
+
+// Maps value from [minValue, minValue + extent] to a 16-bit unsigned normalized value
+// A zero extent maps everything to 0
+uint16_t EncodeRangeUnorm16(f32 value, f32 minValue, f32 extent);
+
+// Octahedral encoding of a unit vector into two 16-bit signed normalized values
+// A zero vector encodes to (0, 0), which decodes to +Z
+void EncodeOctahedralSnorm16(glm::vec3 const &normal, int16_t out[2]);
+glm::vec3 DecodeOctahedralSnorm16(const int16_t encoded[2]);
+
+} // namespace Graphics
@@ -0,0 +1,70 @@
+#include "pch.h"
+#include "VertexWeldTable.h"
+
+namespace Graphics {
+
+VertexWeldTable::VertexWeldTable()
+  : m_mask(0),
+    m_count(0),
+    m_probeCount(0) {
+}
+
+VertexWeldTable::~VertexWeldTable() {
+}
+
+void VertexWeldTable::Clear() {
+    for (auto &slot : m_slots) {
+        slot.Index = INVALID_INDEX;
+    }
+    m_count = 0;
+    m_probeCount = 0;
+}
+
+void VertexWeldTable::Reserve(size_t vertexCount) {
+    size_t slotCount = 64;
+    while (slotCount * 3 < vertexCount * 4) {
+        slotCount *= 2;
+    }
+    if (slotCount > m_slots.size()) {
+        _rehash(slotCount);
+    }
+}
+
+size_t VertexWeldTable::GetCount() const {
+    return m_count;
+}
+
+size_t VertexWeldTable::GetCapacity() const {
+    return m_slots.size() * 3 / 4;
+}
+
+uint64_t VertexWeldTable::GetProbeCount() const {
+    return m_probeCount;
+}
+
+uint32_t VertexWeldTable::_foldHash(uint64_t hash) {
+    return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+void VertexWeldTable::_rehash(size_t slotCount) {
+    ASSERT((slotCount & (slotCount - 1)) == 0);
+
+    std::vector<Slot> oldSlots(slotCount, Slot{ 0, INVALID_INDEX });
+    oldSlots.swap(m_slots);
+    m_mask = slotCount - 1;
+
+    // Stored hashes are enough to place the entries again
+    for (auto &oldSlot : oldSlots) {
+        if (oldSlot.Index == INVALID_INDEX) {
+            continue;
+        }
+
+        size_t slotIndex = oldSlot.Hash & m_mask;
+        while (m_slots[slotIndex].Index != INVALID_INDEX) {
+            slotIndex = (slotIndex + 1) & m_mask;
+        }
+        m_slots[slotIndex] = oldSlot;
+    }
+}
+
+} // namespace Graphics
@@ -0,0 +1,54 @@
+#pragma once
+
+namespace Graphics {
+
+// Flat open addressing hash set used to weld identical vertices together
+// Entries store the 32-bit index of a vertex in an external vertex buffer along with its hash,
+// so the table never needs to touch the vertices again when it grows and stays valid when the vertex buffer reallocates
+class VertexWeldTable {
+public:
+    static const uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+public:
+    VertexWeldTable();
+    VertexWeldTable(VertexWeldTable const &) = delete;
+    VertexWeldTable &operator=(VertexWeldTable const &) = delete;
+    ~VertexWeldTable();
+
+    // Removes all entries, keeping the allocated slots
+    void Clear();
+
+    // Makes room for vertexCount entries without further growth
+    void Reserve(size_t vertexCount);
+
+    // Returns the index of a stored vertex equal to the new vertex
+    // If there is none, newIndex is stored and returned; the caller is then responsible for writing the vertex at newIndex
+    // isEqual(uint32_t storedIndex) must return true if the vertex at storedIndex is equal to the new vertex
+    template<typename EqualFunc>
+    uint32_t FindOrInsert(uint64_t hash, uint32_t newIndex, EqualFunc const &isEqual);
+
+    size_t GetCount() const;
+    size_t GetCapacity() const;
+
+    // Total number of extra slots visited by lookups since the last Clear
+    uint64_t GetProbeCount() const;
+
+private:
+    struct Slot {
+        uint32_t Hash;
+        uint32_t Index;
+    };
+
+    static uint32_t _foldHash(uint64_t hash);
+    void _rehash(size_t slotCount);
+
+private:
+    std::vector<Slot> m_slots;
+    size_t m_mask;
+    size_t m_count;
+    uint64_t m_probeCount;
+};
+
+} // namespace Graphics
+
+#include "VertexWeldTable.tpp"
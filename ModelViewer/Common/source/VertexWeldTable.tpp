@@ -0,0 +1,35 @@
+#include "VertexWeldTable.h"
+
+namespace Graphics {
+
+template<typename EqualFunc>
+uint32_t VertexWeldTable::FindOrInsert(uint64_t hash, uint32_t newIndex, EqualFunc const &isEqual) {
+    ASSERT(newIndex != INVALID_INDEX);
+
+    // Keep the load factor under 3/4
+    if ((m_count + 1) * 4 > m_slots.size() * 3) {
+        _rehash(m_slots.empty() ? 64 : m_slots.size() * 2);
+    }
+
+    uint32_t foldedHash = _foldHash(hash);
+    size_t slotIndex = foldedHash & m_mask;
+    for (;;) {
+        Slot &slot = m_slots[slotIndex];
+        if (slot.Index == INVALID_INDEX) {
+            slot.Hash = foldedHash;
+            slot.Index = newIndex;
+            ++m_count;
+            return newIndex;
+        }
+
+        // Only compare the vertices when the stored hashes match
+        if (slot.Hash == foldedHash && isEqual(slot.Index)) {
+            return slot.Index;
+        }
+
+        slotIndex = (slotIndex + 1) & m_mask;
+        ++m_probeCount;
+    }
+}
+
+} // namespace Graphics
@@ -17,10 +17,12 @@ layout(location = 3) in vec2 inTexCoord;
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec3 fragNormal;
 layout(location = 2) out vec2 fragTexCoord;
+layout(location = 3) flat out uint fragTextureIndex; // Slot of the draw's texture in the bindless texture set
 
 void main() {
     gl_Position = ubo.viewProj * pushConstants.modelMatrix * vec4(inPosition, 1.0);
     fragColor = inColor;
     fragNormal = normalize(pushConstants.normalMatrix * vec4(inNormal, 0.0)).xyz;
     fragTexCoord = inTexCoord;
+    fragTextureIndex = uint(gl_InstanceIndex);
 }
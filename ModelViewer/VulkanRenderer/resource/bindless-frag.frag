@@ -0,0 +1,18 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Fragment shader for the bindless path, where every texture of the scene is in one partially bound array
+// The texture's slot comes from the draw's first instance, it is the same for the whole draw so no nonuniformEXT is needed
+
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragNormal;
+layout(location = 2) in vec2 fragTexCoord;
+layout(location = 3) flat in uint fragTextureIndex;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = vec4(fragColor * texture(textures[fragTextureIndex], fragTexCoord).rgb, 1.0);
+}
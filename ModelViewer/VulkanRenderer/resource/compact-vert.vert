@@ -0,0 +1,47 @@
+#version 450
+
+// Vertex shader for the compact textured vertex layouts
+// Positions are normalized to the mesh bounds, which the model matrix maps back to model space
+// Compiled a second time with VERTEX_COLOR defined for the layout that keeps vertex colors
+
+layout(push_constant) uniform PushConstants {
+    layout(offset=0) mat4 modelMatrix;
+    layout(offset=64) mat3x4 normalMatrix;
+    layout(offset=112) vec4 texCoordRange; // Min (xy) and extent (zw)
+} pushConstants;
+
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 viewProj;
+} ubo;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec2 inNormal;
+#ifdef VERTEX_COLOR
+layout(location = 2) in vec3 inColor;
+#endif
+layout(location = 3) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragNormal;
+layout(location = 2) out vec2 fragTexCoord;
+layout(location = 3) flat out uint fragTextureIndex; // Slot of the draw's texture in the bindless texture set
+
+vec3 decodeOctahedral(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -fold : fold;
+    normal.y += normal.y >= 0.0 ? -fold : fold;
+    return normalize(normal);
+}
+
+void main() {
+    gl_Position = ubo.viewProj * pushConstants.modelMatrix * vec4(inPosition, 1.0);
+#ifdef VERTEX_COLOR
+    fragColor = inColor;
+#else
+    fragColor = vec3(1.0);
+#endif
+    fragNormal = normalize(pushConstants.normalMatrix * decodeOctahedral(inNormal)).xyz;
+    fragTexCoord = pushConstants.texCoordRange.xy + inTexCoord * pushConstants.texCoordRange.zw;
+    fragTextureIndex = uint(gl_InstanceIndex);
+}
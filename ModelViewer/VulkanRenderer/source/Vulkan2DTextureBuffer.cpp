@@ -2,17 +2,58 @@
 #include "Vulkan2DTextureBuffer.h"
 #include "VulkanRendererImpl.h"
 #include "VulkanCommandBuffer.h"
+#include "VulkanFeaturesDefines.h"
 
 #include "ImageLoader.h"
+#include "TextureContainerLoader.h"
+#include "MipmapGenerator.h"
+#include "MemoryMappedFile.h"
+#include "ExecutableDirectory.h"
+#include "Hash.h"
 
 namespace Vulkan {
 
+namespace {
+
+VkBufferImageCopy GetLevelCopyRegion(size_t bufferOffset, uint32_t mipLevel, uint32_t width, uint32_t height) {
+    VkBufferImageCopy region{};
+    region.bufferOffset = bufferOffset;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = mipLevel;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = { 0, 0, 0 };
+    region.imageExtent = { width, height, 1 };
+    return region;
+}
+
+// Levels this size and smaller make up the mip tail of streaming textures, which is always resident
+const uint32_t STREAMING_TAIL_EXTENT = 64;
+
+} // namespace
+
 Vulkan2DTextureBuffer::Vulkan2DTextureBuffer(RendererImpl *renderer)
   : m_renderer(renderer),
     m_imageBuffer(renderer),
     m_stagingBuffer(renderer),
     m_imageView(VK_NULL_HANDLE),
-    m_transferSemaphore(VK_NULL_HANDLE) {
+    m_transferSemaphore(VK_NULL_HANDLE),
+    m_flushed(false),
+    m_blockCompression(Graphics::TextureCompressor::BLOCK_FORMAT_NONE),
+    m_mipLevels(0),
+    m_generateMipsOnDevice(false),
+    m_streaming(false),
+    m_hostLevelsSize(0),
+    m_hostFirstLevel(0),
+    m_residentLevel(0),
+    m_residencyVersion(0),
+    m_pendingImageBuffer(renderer),
+    m_pendingImageView(VK_NULL_HANDLE),
+    m_pendingLevel(0),
+    m_pendingFrame(0),
+    m_streamingPending(false) {
     ASSERT(renderer);
 }
 
@@ -20,6 +61,10 @@ Vulkan2DTextureBuffer::~Vulkan2DTextureBuffer() {
     if (m_imageView) {
         vkDestroyImageView(m_renderer->GetDevice(), m_imageView, VK_NULL_HANDLE);
     }
+    if (m_pendingImageView) {
+        vkDestroyImageView(m_renderer->GetDevice(), m_pendingImageView, VK_NULL_HANDLE);
+    }
+    ReleaseRetiredImages(std::numeric_limits<uint64_t>::max());
     if (m_transferSemaphore) {
         vkDestroySemaphore(m_renderer->GetDevice(), m_transferSemaphore, VK_NULL_HANDLE);
     }
@@ -30,9 +75,29 @@ Vulkan2DTextureBuffer::Vulkan2DTextureBuffer(Vulkan2DTextureBuffer &&other) noex
     m_imageBuffer(std::move(other.m_imageBuffer)),
     m_stagingBuffer(std::move(other.m_stagingBuffer)),
     m_imageView(other.m_imageView),
-    m_transferSemaphore(other.m_transferSemaphore) {
+    m_transferSemaphore(other.m_transferSemaphore),
+    m_flushed(other.m_flushed),
+    m_blockCompression(other.m_blockCompression),
+    m_mipLevels(other.m_mipLevels),
+    m_generateMipsOnDevice(other.m_generateMipsOnDevice),
+    m_copyRegions(std::move(other.m_copyRegions)),
+    m_streaming(other.m_streaming),
+    m_hostLevels(std::move(other.m_hostLevels)),
+    m_hostLevelRegions(std::move(other.m_hostLevelRegions)),
+    m_hostLevelsSize(other.m_hostLevelsSize),
+    m_hostFirstLevel(other.m_hostFirstLevel),
+    m_levelFilePath(std::move(other.m_levelFilePath)),
+    m_residentLevel(other.m_residentLevel),
+    m_residencyVersion(other.m_residencyVersion),
+    m_pendingImageBuffer(std::move(other.m_pendingImageBuffer)),
+    m_pendingImageView(other.m_pendingImageView),
+    m_pendingLevel(other.m_pendingLevel),
+    m_pendingFrame(other.m_pendingFrame),
+    m_streamingPending(other.m_streamingPending),
+    m_retiredImages(std::move(other.m_retiredImages)) {
     other.m_imageView = VK_NULL_HANDLE;
     other.m_transferSemaphore = VK_NULL_HANDLE;
+    other.m_pendingImageView = VK_NULL_HANDLE;
 }
 
 Vulkan2DTextureBuffer &Vulkan2DTextureBuffer::operator=(Vulkan2DTextureBuffer &&other) noexcept {
@@ -41,27 +106,96 @@ Vulkan2DTextureBuffer &Vulkan2DTextureBuffer::operator=(Vulkan2DTextureBuffer &&
     m_stagingBuffer = std::move(other.m_stagingBuffer);
     m_imageView = other.m_imageView;
     m_transferSemaphore = other.m_transferSemaphore;
+    m_flushed = other.m_flushed;
+    m_blockCompression = other.m_blockCompression;
+    m_mipLevels = other.m_mipLevels;
+    m_generateMipsOnDevice = other.m_generateMipsOnDevice;
+    m_copyRegions = std::move(other.m_copyRegions);
+    m_streaming = other.m_streaming;
+    m_hostLevels = std::move(other.m_hostLevels);
+    m_hostLevelRegions = std::move(other.m_hostLevelRegions);
+    m_hostLevelsSize = other.m_hostLevelsSize;
+    m_hostFirstLevel = other.m_hostFirstLevel;
+    m_levelFilePath = std::move(other.m_levelFilePath);
+    m_residentLevel = other.m_residentLevel;
+    m_residencyVersion = other.m_residencyVersion;
+    m_pendingImageBuffer = std::move(other.m_pendingImageBuffer);
+    m_pendingImageView = other.m_pendingImageView;
+    m_pendingLevel = other.m_pendingLevel;
+    m_pendingFrame = other.m_pendingFrame;
+    m_streamingPending = other.m_streamingPending;
+    m_retiredImages = std::move(other.m_retiredImages);
     other.m_imageView = VK_NULL_HANDLE;
     other.m_transferSemaphore = VK_NULL_HANDLE;
+    other.m_pendingImageView = VK_NULL_HANDLE;
     return *this;
 }
 
+void Vulkan2DTextureBuffer::SetBlockCompression(Graphics::TextureCompressor::BlockFormat format) {
+    ASSERT(format < Graphics::TextureCompressor::BLOCK_FORMAT_COUNT);
+    m_blockCompression = format;
+}
+
 Graphics::GraphicsError Vulkan2DTextureBuffer::LoadImageFromFile(std::string const &filePath) {
-    Graphics::ImageLoader imageLoader;
-    if (!imageLoader.LoadImageFromFile(filePath, 4)) {
-        return Graphics::GraphicsError::FILE_LOAD_ERROR;
+    if (Graphics::TextureContainerLoader::IsContainerFile(filePath)) {
+        Graphics::TextureContainerLoader containerLoader;
+        if (!containerLoader.LoadFromFile(filePath)) {
+            LOG_ERROR("Failed to load texture %s: %s\n", filePath.c_str(), containerLoader.GetLastError().c_str());
+            return Graphics::GraphicsError::FILE_LOAD_ERROR;
+        }
+        m_levelFilePath = filePath;
+        return _loadContainer(containerLoader);
     }
 
-    return _createVkImage(&imageLoader);
+    if (m_blockCompression != Graphics::TextureCompressor::BLOCK_FORMAT_NONE && _getBlockVkFormat(m_blockCompression, true) != VK_FORMAT_UNDEFINED) {
+        std::filesystem::path exePath = Graphics::GetExecutableDirectory();
+
+        Graphics::MemoryMappedFile sourceFile;
+        if (!sourceFile.Open(exePath / std::filesystem::u8path(filePath))) {
+            LOG_ERROR("Failed to load texture %s: %s\n", filePath.c_str(), sourceFile.GetLastError().c_str());
+            return Graphics::GraphicsError::FILE_LOAD_ERROR;
+        }
+
+        // A key of 0 marks DDS files that are not caches
+        uint64_t sourceKey = std::max(Graphics::HashBytes64(sourceFile.GetData(), sourceFile.GetSize()), uint64_t(1));
+
+        // Reuse the compressed version from an earlier run unless the source has changed since
+        std::filesystem::path cachePath = Graphics::TextureContainerLoader::GetCachePath(exePath / std::filesystem::u8path(filePath), m_blockCompression);
+        std::error_code errorCode;
+        if (std::filesystem::exists(cachePath, errorCode)) {
+            Graphics::TextureContainerLoader cacheLoader;
+            if (cacheLoader.LoadFromFile(cachePath.u8string()) && cacheLoader.GetSourceKey() == sourceKey && cacheLoader.GetFormat() == m_blockCompression &&
+                cacheLoader.GetMipLevelCount() == _getMipLevelCount(cacheLoader.GetWidth(), cacheLoader.GetHeight())) {
+                m_levelFilePath = cachePath.u8string();
+                return _loadContainer(cacheLoader);
+            }
+            LOG_VERBOSE("Texture cache %s is stale, compressing again\n", cachePath.u8string().c_str());
+        }
+
+        return _loadCompressed(sourceFile.GetData(), sourceFile.GetSize(), &cachePath, sourceKey);
+    }
+
+    // Pixels are decoded straight into the staging buffer
+    Graphics::ImageLoader imageLoader;
+    Graphics::GraphicsError err = Graphics::GraphicsError::OK;
+    bool loaded = imageLoader.LoadImageFromFile(filePath, 4, std::bind(&Vulkan2DTextureBuffer::_createStagingDestination, this,
+        std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, &err));
+
+    return _finishStaging(loaded, imageLoader, err);
 }
 
 Graphics::GraphicsError Vulkan2DTextureBuffer::LoadImageFromMemory(void *data, size_t dataSize) {
-    Graphics::ImageLoader imageLoader;
-    if (!imageLoader.LoadImageFromMemory(data, dataSize, 4)) {
-        return Graphics::GraphicsError::FILE_LOAD_ERROR;
+    // Embedded images have no file to keep a cache next to, so they are compressed on every load
+    if (m_blockCompression != Graphics::TextureCompressor::BLOCK_FORMAT_NONE && _getBlockVkFormat(m_blockCompression, true) != VK_FORMAT_UNDEFINED) {
+        return _loadCompressed(data, dataSize, nullptr, 0);
     }
 
-    return _createVkImage(&imageLoader);
+    Graphics::ImageLoader imageLoader;
+    Graphics::GraphicsError err = Graphics::GraphicsError::OK;
+    bool loaded = imageLoader.LoadImageFromMemory(data, dataSize, 4, std::bind(&Vulkan2DTextureBuffer::_createStagingDestination, this,
+        std::placeholders::_1, std::placeholders::_2, std::placeholders::_3, std::placeholders::_4, &err));
+
+    return _finishStaging(loaded, imageLoader, err);
 }
 
 VkImage Vulkan2DTextureBuffer::GetDeviceImage() const {
@@ -73,47 +207,202 @@ VkImageView Vulkan2DTextureBuffer::GetDeviceImageView() const {
 }
 
 void Vulkan2DTextureBuffer::SetMipLevels(uint32_t mipLevels) {
-    m_imageBuffer.SetMipLevels(mipLevels);
+    m_mipLevels = mipLevels;
+}
+
+void Vulkan2DTextureBuffer::SetStreaming(bool enable) {
+    m_streaming = enable;
+}
+
+bool Vulkan2DTextureBuffer::IsStreaming() const {
+    return m_streaming;
 }
 
 Graphics::GraphicsError Vulkan2DTextureBuffer::FlushTextureToDevice() {
+    if (m_flushed) {
+        return Graphics::GraphicsError::OK;
+    }
+    m_flushed = true;
+
+    // Streaming textures start with only their mip tail, finer levels are uploaded when they are needed
+    if (m_streaming) {
+        m_hostLevelRegions.swap(m_copyRegions);
+        m_hostLevelsSize = m_hostLevels.size();
+        m_residentLevel = GetTailLevel();
+        auto err = _stageStreamedLevels(m_residentLevel, &m_imageBuffer, &m_imageView);
+        if (err != Graphics::GraphicsError::OK) {
+            return err;
+        }
+
+        // Finer levels are read from the file again when they are streamed
+        if (!m_levelFilePath.empty()) {
+            ReleaseHostLevels(m_residentLevel);
+        }
+    }
+
+    return _registerTransfers(&m_imageBuffer);
+}
+
+void Vulkan2DTextureBuffer::ClearHostResources() {
+    // Nothing to do, staging buffer is automatically cleaned up after transfer
+    // Streaming textures keep their host levels to stream from
+}
+
+VkExtent2D Vulkan2DTextureBuffer::GetBaseExtent() const {
+    // The device image of a streaming texture only starts at the resident level
+    if (m_streaming && !m_hostLevelRegions.empty()) {
+        return { m_hostLevelRegions[0].imageExtent.width, m_hostLevelRegions[0].imageExtent.height };
+    }
+    VkExtent3D extents = m_imageBuffer.GetExtents();
+    return { extents.width, extents.height };
+}
+
+uint32_t Vulkan2DTextureBuffer::GetMipLevelCount() const {
+    return m_streaming ? static_cast<uint32_t>(m_hostLevelRegions.size()) : m_imageBuffer.GetMipLevels();
+}
+
+uint32_t Vulkan2DTextureBuffer::GetResidentLevel() const {
+    return m_residentLevel;
+}
+
+uint32_t Vulkan2DTextureBuffer::GetTailLevel() const {
+    if (!m_streaming) {
+        return 0;
+    }
+
+    uint32_t level = 0;
+    while (level + 1 < m_hostLevelRegions.size() &&
+           std::max(m_hostLevelRegions[level].imageExtent.width, m_hostLevelRegions[level].imageExtent.height) > STREAMING_TAIL_EXTENT) {
+        ++level;
+    }
+    return level;
+}
+
+VkDeviceSize Vulkan2DTextureBuffer::GetLevelsSize(uint32_t firstLevel) const {
+    // Levels are packed down to the smallest, so the ones wanted run to the end
+    if (!m_streaming || firstLevel >= m_hostLevelRegions.size()) {
+        return 0;
+    }
+    return m_hostLevelsSize - m_hostLevelRegions[firstLevel].bufferOffset;
+}
+
+uint32_t Vulkan2DTextureBuffer::GetResidencyVersion() const {
+    return m_residencyVersion;
+}
+
+bool Vulkan2DTextureBuffer::IsStreamingPending() const {
+    return m_streamingPending;
+}
+
+Graphics::GraphicsError Vulkan2DTextureBuffer::StreamLevels(uint32_t firstLevel, uint64_t frame) {
+    ASSERT(m_streaming && m_flushed);
+    if (m_hostLevelRegions.empty()) {
+        return Graphics::GraphicsError::OK;
+    }
+
+    firstLevel = std::min(std::max(firstLevel, GetFinestLevel()), static_cast<uint32_t>(m_hostLevelRegions.size()) - 1);
+    if (m_streamingPending || firstLevel == m_residentLevel) {
+        return Graphics::GraphicsError::OK;
+    }
+
+    auto err = _stageStreamedLevels(firstLevel, &m_pendingImageBuffer, &m_pendingImageView);
+    if (err != Graphics::GraphicsError::OK) {
+        return err;
+    }
+
+    err = _registerTransfers(&m_pendingImageBuffer);
+    if (err != Graphics::GraphicsError::OK) {
+        m_stagingBuffer.Clear();
+        vkDestroyImageView(m_renderer->GetDevice(), m_pendingImageView, VK_NULL_HANDLE);
+        m_pendingImageView = VK_NULL_HANDLE;
+        m_pendingImageBuffer.Clear();
+        return err;
+    }
+
+    m_pendingLevel = firstLevel;
+    m_pendingFrame = frame;
+    m_streamingPending = true;
+    return Graphics::GraphicsError::OK;
+}
+
+void Vulkan2DTextureBuffer::ReleaseRetiredImages(uint64_t lastCompletedFrame) {
+    auto it = std::remove_if(m_retiredImages.begin(), m_retiredImages.end(), [this, lastCompletedFrame](RetiredImage &retiredImage) {
+        if (retiredImage.Frame > lastCompletedFrame) {
+            return false;
+        }
+        vkDestroyImageView(m_renderer->GetDevice(), retiredImage.ImageView, VK_NULL_HANDLE);
+        retiredImage.ImageView = VK_NULL_HANDLE;
+        retiredImage.ImageBuffer.Clear();
+        return true;
+    });
+    m_retiredImages.erase(it, m_retiredImages.end());
+}
+
+VkDeviceSize Vulkan2DTextureBuffer::GetHostSize() const {
+    return m_hostLevels.size();
+}
+
+uint32_t Vulkan2DTextureBuffer::GetFinestLevel() const {
+    return m_levelFilePath.empty() ? m_hostFirstLevel : 0;
+}
+
+void Vulkan2DTextureBuffer::ReleaseHostLevels(uint32_t firstLevel) {
+    ASSERT(m_streaming && m_flushed);
+    firstLevel = std::min(firstLevel, GetTailLevel());
+    if (firstLevel <= m_hostFirstLevel) {
+        return;
+    }
+
+    // Copied into a vector of its own, erasing from the front would keep the whole allocation
+    size_t releasedSize = static_cast<size_t>(m_hostLevelRegions[firstLevel].bufferOffset - m_hostLevelRegions[m_hostFirstLevel].bufferOffset);
+    m_hostLevels = std::vector<uint8_t>(m_hostLevels.begin() + releasedSize, m_hostLevels.end());
+    m_hostFirstLevel = firstLevel;
+}
+
+Graphics::GraphicsError Vulkan2DTextureBuffer::_registerTransfers(VulkanImageBuffer *imageBuffer) {
     // Determine if there is a transfer queue to use
     if (!VK_BUFFERS_FORCE_NO_TRANSFER_QUEUE && (m_renderer->GetQueueIndex(RendererImpl::QUEUE_GRAPHICS) != m_renderer->GetQueueIndex(RendererImpl::QUEUE_TRANSFER))) {
         // Unique transfer queue so need to do:
         //   copy -> queue ownership transfer -> layout transitions on separate queues
 
         // Need a semaphore for syncing transfer and layout transition
-        VkSemaphoreCreateInfo semaphoreInfo{};
-        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-        if (vkCreateSemaphore(m_renderer->GetDevice(), &semaphoreInfo, VK_NULL_HANDLE, &m_transferSemaphore) != VK_SUCCESS) {
-            return Graphics::GraphicsError::INITIALIZATION_FAILED;
+        // The graphics queue only takes the image over with the last round of the copy
+        bool lastRound = m_stagingBuffer.IsLastRound();
+        if (lastRound) {
+            VkSemaphoreCreateInfo semaphoreInfo{};
+            semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+            if (vkCreateSemaphore(m_renderer->GetDevice(), &semaphoreInfo, VK_NULL_HANDLE, &m_transferSemaphore) != VK_SUCCESS) {
+                return Graphics::GraphicsError::INITIALIZATION_FAILED;
+            }
         }
 
         // Register transfer functions for both transfer and graphics queues
         m_renderer->RegisterTransfer(
             RendererImpl::QUEUE_TRANSFER,
             1,
-            std::bind(&Vulkan2DTextureBuffer::_beginTransferQueueCommand, this, m_imageBuffer.GetExtents(), &m_stagingBuffer, &m_imageBuffer, std::placeholders::_1),
-            std::bind(&Vulkan2DTextureBuffer::_endTransferQueueCommand, this, &m_stagingBuffer, std::placeholders::_1),
-            std::bind(&Vulkan2DTextureBuffer::_errorTransferQueueCommand, this, &m_stagingBuffer)
+            std::bind(&Vulkan2DTextureBuffer::_beginTransferQueueCommand, this, imageBuffer, std::placeholders::_1),
+            std::bind(&Vulkan2DTextureBuffer::_endTransferQueueCommand, this, imageBuffer, std::placeholders::_1),
+            std::bind(&Vulkan2DTextureBuffer::_errorTransferQueueCommand, this)
 
         );
-        m_renderer->RegisterTransfer(
-            RendererImpl::QUEUE_GRAPHICS,
-            1,
-            std::bind(&Vulkan2DTextureBuffer::_beginGraphicsQueueCommand, this, &m_imageBuffer, std::placeholders::_1),
-            std::bind(&Vulkan2DTextureBuffer::_endGraphicsQueueCommand, this, std::placeholders::_1),
-            std::bind(&Vulkan2DTextureBuffer::_errorGraphicsQueueCommand, this)
-        );
+        if (lastRound) {
+            m_renderer->RegisterTransfer(
+                RendererImpl::QUEUE_GRAPHICS,
+                1,
+                std::bind(&Vulkan2DTextureBuffer::_beginGraphicsQueueCommand, this, imageBuffer, std::placeholders::_1),
+                std::bind(&Vulkan2DTextureBuffer::_endGraphicsQueueCommand, this, std::placeholders::_1),
+                std::bind(&Vulkan2DTextureBuffer::_errorGraphicsQueueCommand, this)
+            );
+        }
     }
     else {
         // No transfer queue so just use graphics queue without additional syncing needed
         m_renderer->RegisterTransfer(
             RendererImpl::QUEUE_GRAPHICS,
             1,
-            std::bind(&Vulkan2DTextureBuffer::_beginTransferQueueCommand, this, m_imageBuffer.GetExtents(), &m_stagingBuffer, &m_imageBuffer, std::placeholders::_1),
-            std::bind(&Vulkan2DTextureBuffer::_endTransferQueueCommand, this, &m_stagingBuffer, std::placeholders::_1),
-            std::bind(&Vulkan2DTextureBuffer::_errorTransferQueueCommand, this, &m_stagingBuffer)
+            std::bind(&Vulkan2DTextureBuffer::_beginTransferQueueCommand, this, imageBuffer, std::placeholders::_1),
+            std::bind(&Vulkan2DTextureBuffer::_endTransferQueueCommand, this, imageBuffer, std::placeholders::_1),
+            std::bind(&Vulkan2DTextureBuffer::_errorTransferQueueCommand, this)
 
         );
     }
@@ -121,80 +410,353 @@ Graphics::GraphicsError Vulkan2DTextureBuffer::FlushTextureToDevice() {
     return Graphics::GraphicsError::OK;
 }
 
-void Vulkan2DTextureBuffer::ClearHostResources() {
-    // Nothing to do, staging buffer is automatically cleaned up after transfer
+
+void *Vulkan2DTextureBuffer::_createStagingDestination(uint32_t width, uint32_t height, uint32_t channels, size_t stagingSize, Graphics::GraphicsError *outErr) {
+    // Images are always decoded to RGBA
+    if (channels != 4) {
+        *outErr = Graphics::GraphicsError::UNSUPPORTED_FORMAT;
+        return nullptr;
+    }
+
+    VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+    uint32_t mipLevelCount = _getMipLevelCount(width, height);
+    m_generateMipsOnDevice = !m_streaming && mipLevelCount > 1 && _supportsLinearBlit(format);
+    m_copyRegions.assign(1, GetLevelCopyRegion(0, 0, width, height));
+
+    // Levels the device cannot blit are resized on the CPU into staging memory after the decoded image
+    // Level sizes are whole 4-byte texels, so packing them keeps every offset aligned for the copy
+    if (!m_generateMipsOnDevice) {
+        size_t levelOffset = (stagingSize + 3) & ~size_t(3);
+        for (uint32_t level = 1; level < mipLevelCount; ++level) {
+            m_copyRegions.emplace_back(GetLevelCopyRegion(levelOffset, level, Graphics::MipmapGenerator::GetLevelExtent(width, level),
+                                                          Graphics::MipmapGenerator::GetLevelExtent(height, level)));
+            levelOffset += Graphics::MipmapGenerator::GetLevelSize(width, height, channels, level);
+        }
+        stagingSize = std::max(stagingSize, levelOffset);
+    }
+
+    *outErr = _createVkImage(format, width, height, mipLevelCount, stagingSize);
+    if (*outErr != Graphics::GraphicsError::OK) {
+        m_copyRegions.clear();
+        return nullptr;
+    }
+    return _getStagingMemory();
+}
+
+Graphics::GraphicsError Vulkan2DTextureBuffer::_finishStaging(bool loaded, Graphics::ImageLoader const &imageLoader, Graphics::GraphicsError err) {
+    if (!loaded) {
+        m_stagingBuffer.Clear();
+        return err != Graphics::GraphicsError::OK ? err : Graphics::GraphicsError::FILE_LOAD_ERROR;
+    }
+
+    if (m_copyRegions.size() > 1) {
+        uint8_t *staging = _getStagingMemory();
+        Graphics::MipmapGenerator mipmapGenerator;
+        mipmapGenerator.SetThreadPool(m_renderer->GetWorkerThreadPool());
+        if (!mipmapGenerator.Generate(staging, imageLoader.GetWidth(), imageLoader.GetHeight(), imageLoader.GetChannels(), true,
+                                      static_cast<uint32_t>(m_copyRegions.size()), staging + m_copyRegions[1].bufferOffset)) {
+            LOG_ERROR("Failed to generate texture mip levels\n");
+            m_stagingBuffer.Clear();
+            return Graphics::GraphicsError::INITIALIZATION_FAILED;
+        }
+    }
+
+    return Graphics::GraphicsError::OK;
+}
+
+Graphics::GraphicsError Vulkan2DTextureBuffer::_loadCompressed(const void *data, size_t dataSize, std::filesystem::path const *cachePath, uint64_t sourceKey) {
+    // The compressor reads whole block rows, so the image is decoded aside rather than into staging memory
+    Graphics::ImageLoader imageLoader;
+    if (!imageLoader.LoadImageFromMemory(data, dataSize, 4)) {
+        LOG_ERROR("Failed to decode texture: %s\n", imageLoader.GetLastError().c_str());
+        return Graphics::GraphicsError::FILE_LOAD_ERROR;
+    }
+
+    // Block formats cannot be blitted, so every level is resized on the CPU and compressed
+    uint32_t width = imageLoader.GetWidth();
+    uint32_t height = imageLoader.GetHeight();
+    uint32_t mipLevelCount = _getMipLevelCount(width, height);
+    Graphics::MipmapGenerator mipmapGenerator;
+    mipmapGenerator.SetThreadPool(m_renderer->GetWorkerThreadPool());
+    std::vector<uint8_t> levels(Graphics::MipmapGenerator::GetLevelsSize(width, height, 4, 1, mipLevelCount - 1));
+    if (!mipmapGenerator.Generate(imageLoader.GetData(), width, height, 4, true, mipLevelCount, levels.data())) {
+        LOG_ERROR("Failed to generate texture mip levels\n");
+        return Graphics::GraphicsError::INITIALIZATION_FAILED;
+    }
+
+    // Compressed levels are packed one after another, block sizes keep every offset aligned for the copy
+    m_generateMipsOnDevice = false;
+    m_copyRegions.clear();
+    size_t compressedSize = 0;
+    for (uint32_t level = 0; level < mipLevelCount; ++level) {
+        uint32_t levelWidth = Graphics::MipmapGenerator::GetLevelExtent(width, level);
+        uint32_t levelHeight = Graphics::MipmapGenerator::GetLevelExtent(height, level);
+        m_copyRegions.emplace_back(GetLevelCopyRegion(compressedSize, level, levelWidth, levelHeight));
+        compressedSize += Graphics::TextureCompressor::GetCompressedSize(m_blockCompression, levelWidth, levelHeight);
+    }
+
+    auto err = _createVkImage(_getBlockVkFormat(m_blockCompression, true), width, height, mipLevelCount, compressedSize);
+    if (err != Graphics::GraphicsError::OK) {
+        m_copyRegions.clear();
+        return err;
+    }
+
+    // Blocks are written straight into the staging buffer, or host memory for streaming textures
+    Graphics::TextureCompressor compressor;
+    compressor.SetThreadPool(m_renderer->GetWorkerThreadPool());
+    uint8_t *staging = _getStagingMemory();
+    const uint8_t *levelPixels = reinterpret_cast<const uint8_t*>(imageLoader.GetData());
+    for (uint32_t level = 0; level < mipLevelCount; ++level) {
+        VkBufferImageCopy const &region = m_copyRegions[level];
+        compressor.Compress(levelPixels, region.imageExtent.width, region.imageExtent.height, m_blockCompression, staging + region.bufferOffset);
+        levelPixels = level == 0 ? levels.data() : levelPixels + Graphics::MipmapGenerator::GetLevelSize(width, height, 4, level);
+    }
+
+    if (cachePath) {
+        // Failing to write the cache only costs compressing again next time
+        Graphics::TextureContainerLoader cacheWriter;
+        if (!cacheWriter.SaveDds(*cachePath, m_blockCompression, true, width, height, mipLevelCount, staging, compressedSize, sourceKey)) {
+            LOG_ERROR("Failed to write texture cache %s: %s\n", cachePath->u8string().c_str(), cacheWriter.GetLastError().c_str());
+        }
+        else {
+            m_levelFilePath = cachePath->u8string();
+        }
+    }
+
+    return Graphics::GraphicsError::OK;
 }
 
-Graphics::GraphicsError Vulkan2DTextureBuffer::_createVkImage(Graphics::ImageLoader *loader) {
-    m_imageBuffer.SetExtents(loader->GetWidth(), loader->GetHeight(), loader->GetDepth());
+Graphics::GraphicsError Vulkan2DTextureBuffer::_loadContainer(Graphics::TextureContainerLoader const &containerLoader) {
+    VkFormat format = _getBlockVkFormat(containerLoader.GetFormat(), containerLoader.IsSrgb());
+    if (format == VK_FORMAT_UNDEFINED) {
+        LOG_ERROR("Texture format is not supported by the device\n");
+        return Graphics::GraphicsError::UNSUPPORTED_FORMAT;
+    }
+
+    // Levels are packed one after another, their sizes are whole blocks so every offset stays aligned for the copy
+    uint32_t mipLevelCount = containerLoader.GetMipLevelCount();
+    m_generateMipsOnDevice = false;
+    m_copyRegions.clear();
+    size_t stagingSize = 0;
+    for (uint32_t level = 0; level < mipLevelCount; ++level) {
+        auto &mipLevel = containerLoader.GetMipLevel(level);
+        m_copyRegions.emplace_back(GetLevelCopyRegion(stagingSize, level, mipLevel.Width, mipLevel.Height));
+        stagingSize += mipLevel.Size;
+    }
+
+    auto err = _createVkImage(format, containerLoader.GetWidth(), containerLoader.GetHeight(), mipLevelCount, stagingSize);
+    if (err != Graphics::GraphicsError::OK) {
+        m_copyRegions.clear();
+        return err;
+    }
+
+    uint8_t *staging = _getStagingMemory();
+    for (uint32_t level = 0; level < mipLevelCount; ++level) {
+        auto &mipLevel = containerLoader.GetMipLevel(level);
+        memcpy(staging + m_copyRegions[level].bufferOffset, containerLoader.GetData() + mipLevel.Offset, mipLevel.Size);
+    }
 
-    switch (loader->GetChannels()) {
-    case 1:
-        m_imageBuffer.SetFormat(VK_FORMAT_R8_SRGB);
+    return Graphics::GraphicsError::OK;
+}
+
+VkFormat Vulkan2DTextureBuffer::_getBlockVkFormat(Graphics::TextureCompressor::BlockFormat format, bool srgb) {
+    VkFormat vkFormat;
+    switch (format) {
+    case Graphics::TextureCompressor::BLOCK_FORMAT_NONE:
+        vkFormat = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
         break;
-    case 2:
-        m_imageBuffer.SetFormat(VK_FORMAT_R8G8_SRGB);
+    case Graphics::TextureCompressor::BLOCK_FORMAT_BC1:
+        vkFormat = srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
         break;
-    case 3:
-        m_imageBuffer.SetFormat(VK_FORMAT_R8G8B8_SRGB);
+    case Graphics::TextureCompressor::BLOCK_FORMAT_BC3:
+        vkFormat = srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
         break;
-    case 4:
-        m_imageBuffer.SetFormat(VK_FORMAT_R8G8B8A8_SRGB);
+    case Graphics::TextureCompressor::BLOCK_FORMAT_BC7:
+        vkFormat = srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
         break;
     default:
-        return Graphics::GraphicsError::UNSUPPORTED_FORMAT;
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    if (format != Graphics::TextureCompressor::BLOCK_FORMAT_NONE &&
+        !m_renderer->GetPhysicalDevice()->SupportsFeature(FEATURE_TEXTURE_COMPRESSION_BC, m_renderer->GetRequirements())) {
+        return VK_FORMAT_UNDEFINED;
+    }
+    if (!m_imageBuffer.IsFormatSupported(vkFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)) {
+        return VK_FORMAT_UNDEFINED;
+    }
+    return vkFormat;
+}
+
+uint32_t Vulkan2DTextureBuffer::_getMipLevelCount(uint32_t width, uint32_t height) const {
+    uint32_t fullChainLevelCount = Graphics::MipmapGenerator::GetMipLevelCount(width, height);
+    return m_mipLevels == 0 ? fullChainLevelCount : std::min(m_mipLevels, fullChainLevelCount);
+}
+
+bool Vulkan2DTextureBuffer::_supportsLinearBlit(VkFormat format) const {
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(m_renderer->GetPhysicalDevice()->GetDevice(), format, &properties);
+
+    VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (properties.optimalTilingFeatures & requiredFeatures) == requiredFeatures;
+}
+
+Graphics::GraphicsError Vulkan2DTextureBuffer::_createVkImage(VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels, size_t stagingSize) {
+    m_imageBuffer.SetExtents(width, height, 1);
+    m_imageBuffer.SetFormat(format);
+    m_imageBuffer.SetMipLevels(mipLevels);
+
+    // Streaming textures keep their levels on the host, the device only gets the levels that are resident
+    if (m_streaming) {
+        m_hostLevels.resize(stagingSize);
+        return Graphics::GraphicsError::OK;
     }
 
-    // Create the VkImage
-    auto err = m_imageBuffer.Initialize(VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, nullptr, 0);
+    auto err = _createDeviceImage(&m_imageBuffer, &m_imageView);
+    if (err != Graphics::GraphicsError::OK) {
+        return err;
+    }
+
+    return _createStagingBuffer(stagingSize);
+}
+
+Graphics::GraphicsError Vulkan2DTextureBuffer::_createDeviceImage(VulkanImageBuffer *imageBuffer, VkImageView *outImageView) {
+    // Create the VkImage, levels blitted on the device are also read by transfers
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    if (m_generateMipsOnDevice) {
+        usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+    auto err = imageBuffer->Initialize(usage, nullptr, 0);
     if (err != Graphics::GraphicsError::OK) {
         return err;
     }
 
-    err = m_imageBuffer.Allocate(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    err = imageBuffer->Allocate(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
     if (err != Graphics::GraphicsError::OK) {
         return err;
     }
 
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    viewInfo.image = m_imageBuffer.GetVkImage();
+    viewInfo.image = imageBuffer->GetVkImage();
     viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    viewInfo.format = m_imageBuffer.GetFormat();
+    viewInfo.format = imageBuffer->GetFormat();
     viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    viewInfo.subresourceRange.baseMipLevel = 0; //TODO:
-    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = imageBuffer->GetMipLevels();
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = 1;
-    if (vkCreateImageView(m_renderer->GetDevice(), &viewInfo, nullptr, &m_imageView) != VK_SUCCESS) {
+    if (vkCreateImageView(m_renderer->GetDevice(), &viewInfo, nullptr, outImageView) != VK_SUCCESS) {
         return Graphics::GraphicsError::INITIALIZATION_FAILED;
     }
 
-    // Create and copy into staging buffer
-    VkDeviceSize memorySize = loader->GetWidth() * loader->GetHeight() * loader->GetDepth() * loader->GetChannels();
+    return Graphics::GraphicsError::OK;
+}
+
+Graphics::GraphicsError Vulkan2DTextureBuffer::_createStagingBuffer(size_t stagingSize) {
+    // The image is decoded or compressed into one chunk, in the staging ring unless it is larger than the whole ring
     m_stagingBuffer.Clear();
-    m_stagingBuffer.Initialize(memorySize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, nullptr, 0);
-    m_stagingBuffer.Allocate(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    VkDeviceSize chunkSize = stagingSize;
+    return m_stagingBuffer.Allocate(&chunkSize, 1);
+}
+
+uint8_t *Vulkan2DTextureBuffer::_getStagingMemory() {
+    if (m_streaming) {
+        return m_hostLevels.data();
+    }
+    return m_stagingBuffer.GetChunk(0).MappedMemory;
+}
+
+Graphics::GraphicsError Vulkan2DTextureBuffer::_stageStreamedLevels(uint32_t firstLevel, VulkanImageBuffer *imageBuffer, VkImageView *outImageView) {
+    ASSERT(firstLevel >= GetFinestLevel());
 
-    void *mappedMemory = m_stagingBuffer.GetMappedMemory();
-    if (!mappedMemory) {
+    // The file is mapped again for every upload of released levels, it must still hold the levels it was loaded with
+    Graphics::TextureContainerLoader levelFile;
+    if (firstLevel < m_hostFirstLevel) {
+        bool sameLevels = levelFile.LoadFromFile(m_levelFilePath) && levelFile.GetMipLevelCount() == m_hostLevelRegions.size();
+        for (uint32_t level = firstLevel; sameLevels && level < m_hostFirstLevel; ++level) {
+            auto &mipLevel = levelFile.GetMipLevel(level);
+            sameLevels = mipLevel.Width == m_hostLevelRegions[level].imageExtent.width && mipLevel.Height == m_hostLevelRegions[level].imageExtent.height &&
+                         mipLevel.Size == m_hostLevelRegions[level + 1].bufferOffset - m_hostLevelRegions[level].bufferOffset;
+        }
+        if (!sameLevels) {
+            LOG_ERROR("Failed to stream texture levels from %s, the file has changed since it was loaded\n", m_levelFilePath.c_str());
+            return Graphics::GraphicsError::FILE_LOAD_ERROR;
+        }
+    }
+
+    VkBufferImageCopy const &firstRegion = m_hostLevelRegions[firstLevel];
+    imageBuffer->SetExtents(firstRegion.imageExtent.width, firstRegion.imageExtent.height, 1);
+    imageBuffer->SetFormat(m_imageBuffer.GetFormat());
+    imageBuffer->SetMipLevels(static_cast<uint32_t>(m_hostLevelRegions.size()) - firstLevel);
+
+    auto err = _createDeviceImage(imageBuffer, outImageView);
+    if (err == Graphics::GraphicsError::OK) {
+        // Each level is copied with a region of its own, so only levels need to stay in one piece
+        std::vector<VkDeviceSize> levelSizes;
+        for (size_t level = firstLevel; level < m_hostLevelRegions.size(); ++level) {
+            VkDeviceSize levelEnd = level + 1 < m_hostLevelRegions.size() ? m_hostLevelRegions[level + 1].bufferOffset : m_hostLevelsSize;
+            levelSizes.push_back(levelEnd - m_hostLevelRegions[level].bufferOffset);
+        }
         m_stagingBuffer.Clear();
-        return Graphics::GraphicsError::INITIALIZATION_FAILED;
+        err = m_stagingBuffer.Allocate(levelSizes.data(), levelSizes.size());
+    }
+    if (err != Graphics::GraphicsError::OK) {
+        if (*outImageView) {
+            vkDestroyImageView(m_renderer->GetDevice(), *outImageView, VK_NULL_HANDLE);
+            *outImageView = VK_NULL_HANDLE;
+        }
+        imageBuffer->Clear();
+        return err;
+    }
+
+    // The image's levels are renumbered from the first one
+    m_copyRegions.clear();
+    for (uint32_t level = firstLevel; level < m_hostLevelRegions.size(); ++level) {
+        auto const &chunk = m_stagingBuffer.GetChunk(level - firstLevel);
+        VkBufferImageCopy region = m_hostLevelRegions[level];
+        const uint8_t *levelData = level < m_hostFirstLevel ? levelFile.GetData() + levelFile.GetMipLevel(level).Offset :
+            m_hostLevels.data() + (region.bufferOffset - m_hostLevelRegions[m_hostFirstLevel].bufferOffset);
+        memcpy(chunk.MappedMemory, levelData, static_cast<size_t>(chunk.Size));
+        region.bufferOffset = chunk.SourceOffset;
+        region.imageSubresource.mipLevel -= firstLevel;
+        m_copyRegions.push_back(region);
     }
-    memcpy(mappedMemory, loader->GetData(), memorySize);
-    m_stagingBuffer.UnmapMemory();
 
     return Graphics::GraphicsError::OK;
 }
 
-Graphics::GraphicsError Vulkan2DTextureBuffer::_beginTransferQueueCommand(VkExtent3D extents, VulkanBuffer *srcBuffer, VulkanImageBuffer *dstBuffer, VulkanCommandBuffer *commandBuffer) {
+void Vulkan2DTextureBuffer::_finishStreamedUpload(bool succeeded) {
+    // The first upload of a streaming texture goes straight into the resident image
+    if (!m_streamingPending) {
+        return;
+    }
+    m_streamingPending = false;
+
+    if (!succeeded) {
+        vkDestroyImageView(m_renderer->GetDevice(), m_pendingImageView, VK_NULL_HANDLE);
+        m_pendingImageView = VK_NULL_HANDLE;
+        m_pendingImageBuffer.Clear();
+        return;
+    }
+
+    // Frames in flight may still read the replaced image
+    m_retiredImages.push_back(RetiredImage{ std::move(m_imageBuffer), m_imageView, m_pendingFrame });
+    m_imageBuffer = std::move(m_pendingImageBuffer);
+    m_imageView = m_pendingImageView;
+    m_pendingImageView = VK_NULL_HANDLE;
+    m_residentLevel = m_pendingLevel;
+    ++m_residencyVersion;
+}
+
+Graphics::GraphicsError Vulkan2DTextureBuffer::_beginTransferQueueCommand(VulkanImageBuffer *dstBuffer, VulkanCommandBuffer *commandBuffer) {
     auto err = commandBuffer->BeginCommandBuffer();
     if (err != Graphics::GraphicsError::OK) {
-        srcBuffer->Clear();
+        m_stagingBuffer.Clear();
         return err;
     }
 
-    // Layout transition VK_IMAGE_LAYOUT_UNDEFINED -> VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+    // Layout transition VK_IMAGE_LAYOUT_UNDEFINED -> VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, later rounds copy into the levels as they are
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.srcAccessMask = 0;
@@ -205,100 +767,207 @@ Graphics::GraphicsError Vulkan2DTextureBuffer::_beginTransferQueueCommand(VkExte
     barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     barrier.image = dstBuffer->GetVkImage();
     barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0; //TODO:
-    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = dstBuffer->GetMipLevels();
     barrier.subresourceRange.baseArrayLayer = 0;
     barrier.subresourceRange.layerCount = 1;
 
-    vkCmdPipelineBarrier(
-        commandBuffer->GetVkCommandBuffer(),
-        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-        0,
-        0, nullptr,
-        0, nullptr,
-        1, &barrier
-    );
-
-    // Copy command
-    VkBufferImageCopy region{};
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
-    region.imageOffset = { 0, 0, 0 };
-    region.imageExtent = extents;
+    if (m_stagingBuffer.IsFirstRound()) {
+        vkCmdPipelineBarrier(
+            commandBuffer->GetVkCommandBuffer(),
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0,
+            0, nullptr,
+            0, nullptr,
+            1, &barrier
+        );
+    }
 
-    vkCmdCopyBufferToImage(
-        commandBuffer->GetVkCommandBuffer(),
-        srcBuffer->GetVkBuffer(),
-        dstBuffer->GetVkImage(),
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        1,
-        &region
-    );
+    // Copy the levels staged for this round in one command, a round is empty while other uploads fill the staging ring
+    std::vector<VkBufferImageCopy> copyRegions;
+    for (size_t i = 0; i < m_stagingBuffer.GetRoundChunkCount(); ++i) {
+        auto const &chunk = m_stagingBuffer.GetRoundChunk(i);
+        for (auto const &region : m_copyRegions) {
+            if (region.bufferOffset >= chunk.SourceOffset && region.bufferOffset < chunk.SourceOffset + chunk.Size) {
+                copyRegions.push_back(region);
+                copyRegions.back().bufferOffset += chunk.BufferOffset - chunk.SourceOffset;
+            }
+        }
+    }
+    if (!copyRegions.empty()) {
+        vkCmdCopyBufferToImage(
+            commandBuffer->GetVkCommandBuffer(),
+            m_stagingBuffer.GetVkBuffer(),
+            dstBuffer->GetVkImage(),
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            static_cast<uint32_t>(copyRegions.size()),
+            copyRegions.data()
+        );
+    }
 
-    // If this is on graphics queue, just transition to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-    // If this is on transfer queue, need to start ownership transfer to graphics queue
-    // Note: The barrier is the same regardless if just transitioning layout or if also releasing ownership
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    // The image stays a transfer destination until the last round
+    bool lastRound = m_stagingBuffer.IsLastRound();
+    bool onGraphicsQueue = VK_BUFFERS_FORCE_NO_TRANSFER_QUEUE || commandBuffer->GetQueue() == RendererImpl::QUEUE_GRAPHICS;
+    if (lastRound && m_generateMipsOnDevice && onGraphicsQueue) {
+        _recordMipBlits(dstBuffer, commandBuffer);
+    }
+    else if (lastRound) {
+        // If this is on graphics queue, just transition to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+        // If this is on transfer queue, need to start ownership transfer to graphics queue
+        // Note: The barrier is the same regardless if just transitioning layout or if also releasing ownership
+        // Levels blitted after the transfer stay transfer destinations, the graphics queue transitions them once written
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = m_generateMipsOnDevice ? 0 : VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = m_generateMipsOnDevice ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 #if VK_BUFFERS_FORCE_NO_TRANSFER_QUEUE
-    barrier.srcQueueFamilyIndex = m_renderer->GetQueueIndex(RendererImpl::QUEUE_GRAPHICS);
+        barrier.srcQueueFamilyIndex = m_renderer->GetQueueIndex(RendererImpl::QUEUE_GRAPHICS);
 #else
-    barrier.srcQueueFamilyIndex = m_renderer->GetQueueIndex(RendererImpl::QUEUE_TRANSFER);
+        barrier.srcQueueFamilyIndex = m_renderer->GetQueueIndex(RendererImpl::QUEUE_TRANSFER);
 #endif
-    barrier.dstQueueFamilyIndex = m_renderer->GetQueueIndex(RendererImpl::QUEUE_GRAPHICS);
+        barrier.dstQueueFamilyIndex = m_renderer->GetQueueIndex(RendererImpl::QUEUE_GRAPHICS);
 
-    // Technically dstStageMask is ignored when releasing ownership but validation will still complain about
-    //   the transfer queue not supporting the fragment shader stage so this should be set to 0 for a release
-    VkPipelineStageFlags dstStage = 0;
-    if (VK_BUFFERS_FORCE_NO_TRANSFER_QUEUE || commandBuffer->GetQueue() == RendererImpl::QUEUE_GRAPHICS) {
-        dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        // Technically dstStageMask is ignored when releasing ownership but validation will still complain about
+        //   the transfer queue not supporting the fragment shader stage so this should be set to 0 for a release
+        VkPipelineStageFlags dstStage = 0;
+        if (onGraphicsQueue) {
+            dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        }
+        vkCmdPipelineBarrier(
+            commandBuffer->GetVkCommandBuffer(),
+            VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage,
+            0,
+            0, nullptr,
+            0, nullptr,
+            1, &barrier
+        );
     }
-    vkCmdPipelineBarrier(
-        commandBuffer->GetVkCommandBuffer(),
-        VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage,
-        0,
-        0, nullptr,
-        0, nullptr,
-        1, &barrier
-    );
 
-    if (!VK_BUFFERS_FORCE_NO_TRANSFER_QUEUE && commandBuffer->GetQueue() == RendererImpl::QUEUE_TRANSFER) {
+    if (!VK_BUFFERS_FORCE_NO_TRANSFER_QUEUE && commandBuffer->GetQueue() == RendererImpl::QUEUE_TRANSFER && lastRound) {
         // Need to sync transfer and graphics queues
         commandBuffer->AddSignalSemaphore(m_transferSemaphore);
     }
 
     err = commandBuffer->EndCommandBuffer();
     if (err != Graphics::GraphicsError::OK) {
-        srcBuffer->Clear();
+        m_stagingBuffer.Clear();
         return err;
     }
 
     err = commandBuffer->Submit();
     if (err != Graphics::GraphicsError::OK) {
-        srcBuffer->Clear();
+        m_stagingBuffer.Clear();
         return err;
     }
 
     return Graphics::GraphicsError::OK;
 }
 
-Graphics::GraphicsError Vulkan2DTextureBuffer::_endTransferQueueCommand(VulkanBuffer *stagingBuffer, VulkanCommandBuffer *commandBuffer) {
+void Vulkan2DTextureBuffer::_recordMipBlits(VulkanImageBuffer *dstBuffer, VulkanCommandBuffer *commandBuffer) {
+    VkExtent3D extents = dstBuffer->GetExtents();
+    uint32_t mipLevels = dstBuffer->GetMipLevels();
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = dstBuffer->GetVkImage();
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    // Linear blits of sRGB images filter in linear space
+    for (uint32_t level = 1; level < mipLevels; ++level) {
+        // The previous level becomes the source once it is written
+        barrier.subresourceRange.baseMipLevel = level - 1;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        vkCmdPipelineBarrier(
+            commandBuffer->GetVkCommandBuffer(),
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0,
+            0, nullptr,
+            0, nullptr,
+            1, &barrier
+        );
+
+        VkImageBlit blit{};
+        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel = level - 1;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount = 1;
+        blit.srcOffsets[1] = { static_cast<int32_t>(std::max(extents.width >> (level - 1), 1u)), static_cast<int32_t>(std::max(extents.height >> (level - 1), 1u)), 1 };
+        blit.dstSubresource = blit.srcSubresource;
+        blit.dstSubresource.mipLevel = level;
+        blit.dstOffsets[1] = { static_cast<int32_t>(std::max(extents.width >> level, 1u)), static_cast<int32_t>(std::max(extents.height >> level, 1u)), 1 };
+        vkCmdBlitImage(
+            commandBuffer->GetVkCommandBuffer(),
+            dstBuffer->GetVkImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            dstBuffer->GetVkImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            1, &blit,
+            VK_FILTER_LINEAR
+        );
+    }
+
+    // Every level becomes readable in one batch, the sources from VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL and the last level from
+    //   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+    VkImageMemoryBarrier barriers[2] = { barrier, barrier };
+    uint32_t barrierCount = 0;
+    if (mipLevels > 1) {
+        VkImageMemoryBarrier &sourcesBarrier = barriers[barrierCount++];
+        sourcesBarrier.subresourceRange.baseMipLevel = 0;
+        sourcesBarrier.subresourceRange.levelCount = mipLevels - 1;
+        sourcesBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        sourcesBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        sourcesBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        sourcesBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    }
+    VkImageMemoryBarrier &lastLevelBarrier = barriers[barrierCount++];
+    lastLevelBarrier.subresourceRange.baseMipLevel = mipLevels - 1;
+    lastLevelBarrier.subresourceRange.levelCount = 1;
+    lastLevelBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    lastLevelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    lastLevelBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    lastLevelBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(
+        commandBuffer->GetVkCommandBuffer(),
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        barrierCount, barriers
+    );
+}
+
+Graphics::GraphicsError Vulkan2DTextureBuffer::_endTransferQueueCommand(VulkanImageBuffer *dstBuffer, VulkanCommandBuffer *commandBuffer) {
     VkFence waitFence = commandBuffer->GetWaitFence();
     vkWaitForFences(m_renderer->GetDevice(), 1, &waitFence, true, std::numeric_limits<uint64_t>::max());
 
-    stagingBuffer->Clear();
+    if (!m_stagingBuffer.IsLastRound()) {
+        m_stagingBuffer.NextRound();
+        auto err = _registerTransfers(dstBuffer);
+        if (err != Graphics::GraphicsError::OK) {
+            m_stagingBuffer.Clear();
+            _finishStreamedUpload(false);
+        }
+        return err;
+    }
+
+    m_stagingBuffer.Clear();
+
+    // Without a transfer queue the upload is done, otherwise the graphics queue still has to acquire the image
+    if (VK_BUFFERS_FORCE_NO_TRANSFER_QUEUE || commandBuffer->GetQueue() == RendererImpl::QUEUE_GRAPHICS) {
+        _finishStreamedUpload(true);
+    }
     return Graphics::GraphicsError::OK;
 }
 
-void Vulkan2DTextureBuffer::_errorTransferQueueCommand(VulkanBuffer *stagingBuffer) {
-    stagingBuffer->Clear();
+void Vulkan2DTextureBuffer::_errorTransferQueueCommand() {
+    m_stagingBuffer.Clear();
+    _finishStreamedUpload(false);
 }
 
 Graphics::GraphicsError Vulkan2DTextureBuffer::_beginGraphicsQueueCommand(VulkanImageBuffer *dstBuffer, VulkanCommandBuffer *commandBuffer) {
@@ -307,22 +976,23 @@ Graphics::GraphicsError Vulkan2DTextureBuffer::_beginGraphicsQueueCommand(Vulkan
         return err;
     }
 
-    // Sync with the transfer
-    commandBuffer->AddWaitSemaphore(m_transferSemaphore, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    // Sync with the transfer, levels blitted from the copied one are needed by the blits instead of shaders
+    VkPipelineStageFlags dstStage = m_generateMipsOnDevice ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    commandBuffer->AddWaitSemaphore(m_transferSemaphore, dstStage);
 
     // Acquire ownership
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.dstAccessMask = m_generateMipsOnDevice ? VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT : VK_ACCESS_SHADER_READ_BIT;
     barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.newLayout = m_generateMipsOnDevice ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
     barrier.srcQueueFamilyIndex = m_renderer->GetQueueIndex(RendererImpl::QUEUE_TRANSFER);
     barrier.dstQueueFamilyIndex = m_renderer->GetQueueIndex(RendererImpl::QUEUE_GRAPHICS);
     barrier.image = dstBuffer->GetVkImage();
     barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0; //TODO:
-    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = dstBuffer->GetMipLevels();
     barrier.subresourceRange.baseArrayLayer = 0;
     barrier.subresourceRange.layerCount = 1;
     vkCmdPipelineBarrier(
@@ -334,6 +1004,10 @@ Graphics::GraphicsError Vulkan2DTextureBuffer::_beginGraphicsQueueCommand(Vulkan
         1, &barrier
     );
 
+    if (m_generateMipsOnDevice) {
+        _recordMipBlits(dstBuffer, commandBuffer);
+    }
+
     err = commandBuffer->EndCommandBuffer();
     if (err != Graphics::GraphicsError::OK) {
         return err;
@@ -351,12 +1025,17 @@ Graphics::GraphicsError Vulkan2DTextureBuffer::_endGraphicsQueueCommand(VulkanCo
     VkFence waitFence = commandBuffer->GetWaitFence();
     vkWaitForFences(m_renderer->GetDevice(), 1, &waitFence, true, std::numeric_limits<uint64_t>::max());
 
+    // Streamed uploads create a new semaphore each time
     vkDestroySemaphore(m_renderer->GetDevice(), m_transferSemaphore, VK_NULL_HANDLE);
+    m_transferSemaphore = VK_NULL_HANDLE;
+    _finishStreamedUpload(true);
     return Graphics::GraphicsError::OK;
 }
 
 void Vulkan2DTextureBuffer::_errorGraphicsQueueCommand() {
     vkDestroySemaphore(m_renderer->GetDevice(), m_transferSemaphore, VK_NULL_HANDLE);
+    m_transferSemaphore = VK_NULL_HANDLE;
+    _finishStreamedUpload(false);
 }
 
 } // namespace Vulkan
@@ -1,11 +1,15 @@
 #pragma once
 
 #include "VulkanBuffer.h"
+#include "VulkanStagingBuffer.h"
 #include "VulkanImageBuffer.h"
+#include "TextureCompressor.h"
+#include <filesystem>
 
 namespace Graphics {
 
 class ImageLoader;
+class TextureContainerLoader;
 
 } // namespace Graphics
 
@@ -26,23 +30,106 @@ public:
     Vulkan2DTextureBuffer(Vulkan2DTextureBuffer &&other) noexcept;
     Vulkan2DTextureBuffer &operator=(Vulkan2DTextureBuffer &&other) noexcept;
 
+    // Images are compressed on load when the device supports the format, BLOCK_FORMAT_NONE by default
+    // Images loaded from files keep their compressed version in a DDS cache next to them
+    void SetBlockCompression(Graphics::TextureCompressor::BlockFormat format);
+
+    // .dds and .ktx2 files are uploaded as stored with their mip chain, other images are decoded
     Graphics::GraphicsError LoadImageFromFile(std::string const &filePath);
     Graphics::GraphicsError LoadImageFromMemory(void *data, size_t dataSize);
 
     VkImage GetDeviceImage() const;
     VkImageView GetDeviceImageView() const;
 
+    // Levels generated for decoded images, clamped to the full chain down to 1x1, 0 (the default) for the full chain
+    // Levels are blitted on the device when the format supports linear blits, otherwise they are resized on the CPU
+    // .dds and .ktx2 files keep the levels they store
     void SetMipLevels(uint32_t mipLevels);
 
+    // Streaming textures only upload their mip tail, the levels of 64 pixels and less, on flush
+    // Finer levels are made resident later by StreamLevels, usually driven by a VulkanTextureStreamer
+    // Levels of streaming textures are always generated on the CPU
+    // Textures read from a .dds or .ktx2 file or a DDS cache only keep their mip tail in host memory and read finer levels
+    //   from the file when streaming them, others keep every level in host memory, about 1.33x the size of level 0
+    void SetStreaming(bool enable);
+    bool IsStreaming() const;
+
+    // Only the first call uploads, textures shared by several models are flushed by each of them
     Graphics::GraphicsError FlushTextureToDevice();
     void ClearHostResources();
 
+    // Size of level 0 and the number of levels, resident or not, valid once flushed
+    VkExtent2D GetBaseExtent() const;
+    uint32_t GetMipLevelCount() const;
+
+    // Levels from the resident level down to the smallest are on the device, always 0 for textures that do not stream
+    uint32_t GetResidentLevel() const;
+    uint32_t GetTailLevel() const;
+
+    // Bytes levels [firstLevel, GetMipLevelCount()) take together
+    VkDeviceSize GetLevelsSize(uint32_t firstLevel) const;
+
+    // Changes whenever a streamed upload replaces the device image, descriptor sets written before then must be written again
+    uint32_t GetResidencyVersion() const;
+    bool IsStreamingPending() const;
+
+    // Uploads levels [firstLevel, GetMipLevelCount()) into a new image that replaces the resident one once the upload finishes
+    // Frames still in flight may read the replaced image, so it is kept until ReleaseRetiredImages is called past frame
+    // Only one upload runs at a time, calls while one is pending are ignored
+    Graphics::GraphicsError StreamLevels(uint32_t firstLevel, uint64_t frame);
+
+    // Destroys the images replaced in or before lastCompletedFrame
+    void ReleaseRetiredImages(uint64_t lastCompletedFrame);
+
+    // Bytes of levels a streaming texture keeps in host memory to stream from
+    VkDeviceSize GetHostSize() const;
+
+    // Finest level StreamLevels can make resident, levels finer than it are neither in host memory nor in a file
+    uint32_t GetFinestLevel() const;
+
+    // Frees the host memory of levels finer than firstLevel, clamped to the mip tail
+    // Textures with a file to read them from stream them as before, others can no longer make them resident
+    void ReleaseHostLevels(uint32_t firstLevel);
+
 private:
-    Graphics::GraphicsError _createVkImage(Graphics::ImageLoader *loader);
+    // Creates the image and a mapped staging buffer for the loader to decode into
+    void *_createStagingDestination(uint32_t width, uint32_t height, uint32_t channels, size_t stagingSize, Graphics::GraphicsError *outErr);
+    Graphics::GraphicsError _finishStaging(bool loaded, Graphics::ImageLoader const &imageLoader, Graphics::GraphicsError err);
+
+    // Decodes the image and compresses it straight into the staging buffer
+    Graphics::GraphicsError _loadCompressed(const void *data, size_t dataSize, std::filesystem::path const *cachePath, uint64_t sourceKey);
+    Graphics::GraphicsError _loadContainer(Graphics::TextureContainerLoader const &containerLoader);
+
+    // Returns VK_FORMAT_UNDEFINED if the device cannot sample the format
+    VkFormat _getBlockVkFormat(Graphics::TextureCompressor::BlockFormat format, bool srgb);
+
+    uint32_t _getMipLevelCount(uint32_t width, uint32_t height) const;
+    bool _supportsLinearBlit(VkFormat format) const;
+
+    // Creates the image with its view and stagingSize bytes of staging memory in one chunk
+    // Streaming textures only get host memory to stage into, their images are created per upload
+    Graphics::GraphicsError _createVkImage(VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels, size_t stagingSize);
+    Graphics::GraphicsError _createDeviceImage(VulkanImageBuffer *imageBuffer, VkImageView *outImageView);
+    Graphics::GraphicsError _createStagingBuffer(size_t stagingSize);
+    uint8_t *_getStagingMemory();
+
+    // Creates an image holding levels [firstLevel, GetMipLevelCount()) and copies them into staging, a chunk per level
+    // Levels no longer in host memory are read from m_levelFilePath
+    Graphics::GraphicsError _stageStreamedLevels(uint32_t firstLevel, VulkanImageBuffer *imageBuffer, VkImageView *outImageView);
+
+    // Swaps in the pending image of a streamed upload, or drops it if the upload failed
+    void _finishStreamedUpload(bool succeeded);
+
+    Graphics::GraphicsError _registerTransfers(VulkanImageBuffer *imageBuffer);
+
+    Graphics::GraphicsError _beginTransferQueueCommand(VulkanImageBuffer *dstBuffer, VulkanCommandBuffer *commandBuffer);
 
-    Graphics::GraphicsError _beginTransferQueueCommand(VkExtent3D extents, VulkanBuffer *srcBuffer, VulkanImageBuffer *dstBuffer, VulkanCommandBuffer *commandBuffer);
-    Graphics::GraphicsError _endTransferQueueCommand(VulkanBuffer *stagingBuffer, VulkanCommandBuffer *commandBuffer);
-    void _errorTransferQueueCommand(VulkanBuffer *stagingBuffer);
+    // Blits every level from the one before it on a graphics queue, then makes all levels readable by shaders
+    // Expects every level in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL with level 0 written
+    void _recordMipBlits(VulkanImageBuffer *dstBuffer, VulkanCommandBuffer *commandBuffer);
+    // Registers the next round while levels are left in staging, only the last round hands the image over to be read
+    Graphics::GraphicsError _endTransferQueueCommand(VulkanImageBuffer *dstBuffer, VulkanCommandBuffer *commandBuffer);
+    void _errorTransferQueueCommand();
     Graphics::GraphicsError _beginGraphicsQueueCommand(VulkanImageBuffer *dstBuffer, VulkanCommandBuffer *commandBuffer);
     Graphics::GraphicsError _endGraphicsQueueCommand(VulkanCommandBuffer *commandBuffer);
     void _errorGraphicsQueueCommand();
@@ -51,9 +138,36 @@ private:
 
     RendererImpl *m_renderer;
     VulkanImageBuffer m_imageBuffer;
-    VulkanBuffer m_stagingBuffer;
+    VulkanStagingBuffer m_stagingBuffer; // Levels of the upload in progress
     VkImageView m_imageView;
     VkSemaphore m_transferSemaphore;
+    bool m_flushed;
+    Graphics::TextureCompressor::BlockFormat m_blockCompression;
+    uint32_t m_mipLevels;        // Requested by SetMipLevels
+    bool m_generateMipsOnDevice; // Only level 0 is staged, the others are blitted from it after the copy
+    std::vector<VkBufferImageCopy> m_copyRegions; // One per mip level, offsets are from the start of the upload
+
+    // Image replaced by a streamed upload, destroyed once the frames that may read it are done
+    struct RetiredImage {
+        VulkanImageBuffer ImageBuffer;
+        VkImageView ImageView;
+        uint64_t Frame;
+    };
+
+    bool m_streaming;
+    std::vector<uint8_t> m_hostLevels;                 // Levels [m_hostFirstLevel, GetMipLevelCount()) of a streaming texture
+    std::vector<VkBufferImageCopy> m_hostLevelRegions; // One per mip level, offsets are as if every level was packed in m_hostLevels
+    VkDeviceSize m_hostLevelsSize;                     // Of every level packed together
+    uint32_t m_hostFirstLevel;
+    std::string m_levelFilePath; // .dds or .ktx2 file holding the same levels, empty if there is none
+    uint32_t m_residentLevel;
+    uint32_t m_residencyVersion;
+    VulkanImageBuffer m_pendingImageBuffer;
+    VkImageView m_pendingImageView;
+    uint32_t m_pendingLevel;
+    uint64_t m_pendingFrame;
+    bool m_streamingPending;
+    std::vector<RetiredImage> m_retiredImages;
 
 };
 
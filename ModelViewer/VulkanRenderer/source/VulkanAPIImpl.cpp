@@ -334,6 +334,10 @@ Graphics::GraphicsError APIImpl::_populateFeatureList(Graphics::RendererRequirem
             }
             else if (feature == FEATURE_SAMPLER_ANISOTROPY) {
             }
+            else if (feature == FEATURE_TEXTURE_COMPRESSION_BC) {
+            }
+            else if (feature == FEATURE_DESCRIPTOR_INDEXING) {
+            }
             else {
                 ERROR_MSG(L"Unknown feature name: %hs", feature.c_str());
             }
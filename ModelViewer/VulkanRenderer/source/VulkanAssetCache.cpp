@@ -0,0 +1,267 @@
+#include "pch.h"
+#include "VulkanAssetCache.h"
+#include "VulkanRendererImpl.h"
+
+#include "MemoryMappedFile.h"
+#include "ExecutableDirectory.h"
+#include "ImageBatchLoader.h"
+#include "TextureContainerLoader.h"
+#include "Hash.h"
+
+#include <filesystem>
+#include <tuple>
+#include <cstring>
+
+namespace Vulkan {
+
+static const char *ASSET_TYPE_NAMES[VulkanAssetCache::ASSET_TYPE_COUNT] = { "meshes", "textures", "samplers" };
+
+static const size_t DEFAULT_DECODE_MEMORY_BUDGET = 256 * 1024 * 1024;
+
+// Set in the variant of streaming textures, above the compression format
+static const uint64_t TEXTURE_VARIANT_STREAMING = uint64_t(1) << 32;
+
+bool VulkanAssetCache::AssetKey::operator<(AssetKey const &other) const {
+    return std::tie(Type, ContentHash, Variant, Path, Settings) < std::tie(other.Type, other.ContentHash, other.Variant, other.Path, other.Settings);
+}
+
+VulkanAssetCache::VulkanAssetCache(RendererImpl *renderer)
+  : m_renderer(renderer),
+    m_generation(0),
+    m_stats{},
+    m_decodeMemoryBudget(DEFAULT_DECODE_MEMORY_BUDGET) {
+    ASSERT(renderer);
+}
+
+VulkanAssetCache::~VulkanAssetCache() {
+    // Holders still alive would release into a destroyed cache
+    for (uint32_t i = 0; i < ASSET_TYPE_COUNT; ++i) {
+        ASSERT(m_stats[i].LiveCount == 0);
+    }
+}
+
+Graphics::GraphicsError VulkanAssetCache::AcquireTexture(std::string const &filePath, Graphics::TextureCompressor::BlockFormat compression, bool streaming,
+                                                         std::shared_ptr<Vulkan2DTextureBuffer> *outTexture) {
+    AssetKey key;
+    auto err = GetFileKey(filePath, &key);
+    if (err != Graphics::GraphicsError::OK) {
+        return err;
+    }
+    key.Type = ASSET_TYPE_TEXTURE;
+    key.Variant = _getTextureVariant(compression, streaming);
+
+    return Acquire<Vulkan2DTextureBuffer>(key, [this, &filePath, compression, streaming](Vulkan2DTextureBuffer **outAsset, VkDeviceSize *outDeviceMemorySize) {
+        auto *texture = new Vulkan2DTextureBuffer(m_renderer);
+        texture->SetBlockCompression(compression);
+        texture->SetStreaming(streaming);
+        auto err = texture->LoadImageFromFile(filePath);
+        if (err != Graphics::GraphicsError::OK) {
+            delete texture;
+            return err;
+        }
+        *outAsset = texture;
+        *outDeviceMemorySize = GetDeviceMemorySize(texture->GetDeviceImage());
+        return Graphics::GraphicsError::OK;
+    }, outTexture);
+}
+
+Graphics::GraphicsError VulkanAssetCache::AcquireTexture(const void *data, size_t dataSize, Graphics::TextureCompressor::BlockFormat compression, bool streaming,
+                                                         std::shared_ptr<Vulkan2DTextureBuffer> *outTexture) {
+    // Images in memory have no path, identical images are shared wherever they come from
+    AssetKey key{ ASSET_TYPE_TEXTURE, std::string(), Graphics::HashBytes64(data, dataSize), _getTextureVariant(compression, streaming) };
+
+    return Acquire<Vulkan2DTextureBuffer>(key, [this, data, dataSize, compression, streaming](Vulkan2DTextureBuffer **outAsset, VkDeviceSize *outDeviceMemorySize) {
+        auto *texture = new Vulkan2DTextureBuffer(m_renderer);
+        texture->SetBlockCompression(compression);
+        texture->SetStreaming(streaming);
+        auto err = texture->LoadImageFromMemory(const_cast<void*>(data), dataSize);
+        if (err != Graphics::GraphicsError::OK) {
+            delete texture;
+            return err;
+        }
+        *outAsset = texture;
+        *outDeviceMemorySize = GetDeviceMemorySize(texture->GetDeviceImage());
+        return Graphics::GraphicsError::OK;
+    }, outTexture);
+}
+
+void VulkanAssetCache::AcquireTextures(std::vector<TextureSource> const &sources, Graphics::TextureCompressor::BlockFormat compression, bool streaming,
+                                       TextureLoadedFunc const &onLoaded) {
+    std::vector<size_t> memoryEstimates(sources.size());
+    for (size_t i = 0; i < sources.size(); ++i) {
+        memoryEstimates[i] = _estimateTextureMemory(sources[i]);
+    }
+
+    Graphics::ImageBatchLoader batchLoader;
+    batchLoader.SetThreadPool(m_renderer->GetWorkerThreadPool());
+    batchLoader.SetMemoryBudget(m_decodeMemoryBudget);
+    batchLoader.Run(memoryEstimates, [this, &sources, compression, streaming, &onLoaded](uint32_t index) {
+        TextureSource const &source = sources[index];
+        std::shared_ptr<Vulkan2DTextureBuffer> texture;
+        Graphics::GraphicsError err;
+        if (source.Data) {
+            err = AcquireTexture(source.Data, source.DataSize, compression, streaming, &texture);
+        }
+        else {
+            err = AcquireTexture(source.FilePath, compression, streaming, &texture);
+        }
+        onLoaded(index, err, texture);
+    });
+
+    LOG_VERBOSE("Loaded %zu textures with at most %zu bytes of decodes in flight\n", sources.size(), batchLoader.GetPeakMemory());
+}
+
+void VulkanAssetCache::SetDecodeMemoryBudget(size_t memoryBudget) {
+    m_decodeMemoryBudget = memoryBudget;
+}
+
+Graphics::GraphicsError VulkanAssetCache::AcquireSampler(VulkanSampler const &settings, std::shared_ptr<VulkanSampler> *outSampler) {
+    ASSERT(!settings.GetVkSampler());
+    VkSamplerCreateInfo properties = settings.GetProperties();
+    AssetKey key{ ASSET_TYPE_SAMPLER, std::string(), 0, 0, _getSamplerSettings(properties) };
+    key.Variant = Graphics::HashBytes64(key.Settings.data(), key.Settings.size() * sizeof(uint64_t));
+
+    return Acquire<VulkanSampler>(key, [this, properties](VulkanSampler **outAsset, VkDeviceSize *outDeviceMemorySize) {
+        auto *sampler = new VulkanSampler(m_renderer);
+        sampler->SetProperties(properties);
+        auto err = sampler->Initialize();
+        if (err != Graphics::GraphicsError::OK) {
+            delete sampler;
+            return err;
+        }
+        *outAsset = sampler;
+        *outDeviceMemorySize = 0;
+        return Graphics::GraphicsError::OK;
+    }, outSampler);
+}
+
+Graphics::GraphicsError VulkanAssetCache::AcquireDefaultSampler(std::shared_ptr<VulkanSampler> *outSampler) {
+    return AcquireSampler(VulkanSampler(m_renderer), outSampler);
+}
+
+Graphics::GraphicsError VulkanAssetCache::GetFileKey(std::string const &filePath, AssetKey *outKey) {
+    ASSERT(outKey);
+
+    // Paths are relative to the executable like in the loaders
+    std::filesystem::path exePath = Graphics::GetExecutableDirectory();
+
+    // The same file reached through different relative paths or links is one asset
+    std::error_code errorCode;
+    std::filesystem::path canonicalPath = std::filesystem::weakly_canonical(exePath / std::filesystem::u8path(filePath), errorCode);
+    if (errorCode) {
+        return Graphics::GraphicsError::FILE_LOAD_ERROR;
+    }
+
+    Graphics::MemoryMappedFile file;
+    if (!file.Open(canonicalPath)) {
+        return Graphics::GraphicsError::FILE_LOAD_ERROR;
+    }
+
+    outKey->Path = canonicalPath.u8string();
+    outKey->ContentHash = Graphics::HashBytes64(file.GetData(), file.GetSize());
+    return Graphics::GraphicsError::OK;
+}
+
+VkDeviceSize VulkanAssetCache::GetDeviceMemorySize(VkBuffer buffer) const {
+    if (!buffer) {
+        return 0;
+    }
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(m_renderer->GetDevice(), buffer, &memoryRequirements);
+    return memoryRequirements.size;
+}
+
+VkDeviceSize VulkanAssetCache::GetDeviceMemorySize(VkImage image) const {
+    if (!image) {
+        return 0;
+    }
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(m_renderer->GetDevice(), image, &memoryRequirements);
+    return memoryRequirements.size;
+}
+
+VulkanAssetCache::Stats VulkanAssetCache::GetStats(AssetType type) const {
+    ASSERT(type < ASSET_TYPE_COUNT);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats[type];
+}
+
+void VulkanAssetCache::LogStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (uint32_t i = 0; i < ASSET_TYPE_COUNT; ++i) {
+        Stats const &stats = m_stats[i];
+        LOG_INFO("Asset cache %s: %llu hits, %llu misses, %u live using %.2f MB, %.2f MB reused\n", ASSET_TYPE_NAMES[i],
+            static_cast<unsigned long long>(stats.Hits), static_cast<unsigned long long>(stats.Misses), stats.LiveCount,
+            stats.DeviceMemorySize / (1024.0 * 1024.0), stats.DeviceMemoryReused / (1024.0 * 1024.0));
+    }
+    // Counts samplers created outside the cache too
+    LOG_INFO("Live sampler objects: %u\n", VulkanSampler::GetLiveCount());
+}
+
+void VulkanAssetCache::_release(AssetKey const &key, uint64_t generation, VkDeviceSize deviceMemorySize) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    --m_stats[key.Type].LiveCount;
+    m_stats[key.Type].DeviceMemorySize -= deviceMemorySize;
+
+    // The entry may already belong to a newer asset created while this one was being released
+    auto it = m_entries.find(key);
+    if (it != m_entries.end() && it->second.Generation == generation) {
+        m_entries.erase(it);
+    }
+}
+
+size_t VulkanAssetCache::_estimateTextureMemory(TextureSource const &source) {
+    if (source.Data) {
+        return Graphics::ImageBatchLoader::EstimateDecodeMemory(source.Data, source.DataSize, 4);
+    }
+
+    std::filesystem::path exePath = Graphics::GetExecutableDirectory();
+
+    Graphics::MemoryMappedFile file;
+    if (!file.Open(exePath / std::filesystem::u8path(source.FilePath))) {
+        return 0;
+    }
+
+    // Containers are copied to staging as stored
+    if (Graphics::TextureContainerLoader::IsContainerFile(source.FilePath)) {
+        return file.GetSize();
+    }
+    return Graphics::ImageBatchLoader::EstimateDecodeMemory(file.GetData(), file.GetSize(), 4);
+}
+
+uint64_t VulkanAssetCache::_getTextureVariant(Graphics::TextureCompressor::BlockFormat compression, bool streaming) {
+    return compression | (streaming ? TEXTURE_VARIANT_STREAMING : 0);
+}
+
+std::vector<uint64_t> VulkanAssetCache::_getSamplerSettings(VkSamplerCreateInfo const &properties) {
+    ASSERT(!properties.pNext);
+
+    // Fields are taken one by one, the padding between them is not part of the settings
+    // Enums are signed, so they are widened explicitly
+    auto floatBits = [](float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return uint64_t(bits);
+    };
+    return {
+        properties.flags,
+        uint64_t(properties.magFilter),
+        uint64_t(properties.minFilter),
+        uint64_t(properties.mipmapMode),
+        uint64_t(properties.addressModeU),
+        uint64_t(properties.addressModeV),
+        uint64_t(properties.addressModeW),
+        floatBits(properties.mipLodBias),
+        properties.anisotropyEnable,
+        floatBits(properties.maxAnisotropy),
+        properties.compareEnable,
+        uint64_t(properties.compareOp),
+        floatBits(properties.minLod),
+        floatBits(properties.maxLod),
+        uint64_t(properties.borderColor),
+        properties.unnormalizedCoordinates
+    };
+}
+
+} // namespace Vulkan
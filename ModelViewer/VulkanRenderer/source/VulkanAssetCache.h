@@ -0,0 +1,134 @@
+#pragma once
+
+#include "Vulkan2DTextureBuffer.h"
+#include "VulkanSampler.h"
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+namespace Vulkan {
+
+class RendererImpl;
+
+// Renderer wide registry of device resources loaded from files, shared between every object that uses the same source
+// Assets are handed out as shared pointers and the cache only keeps weak references, so an asset's device memory is freed
+// as soon as its last holder releases it
+// Safe to use from worker threads, only the creation of an asset runs outside the cache's lock
+class VulkanAssetCache {
+public:
+    enum AssetType : uint32_t {
+        ASSET_TYPE_MESH = 0,
+        ASSET_TYPE_TEXTURE,
+        ASSET_TYPE_SAMPLER,
+
+        ASSET_TYPE_COUNT
+    };
+
+    // Identifies an asset by its source and the settings it was created with
+    struct AssetKey {
+        AssetType Type;
+        std::string Path;               // Canonical source path, empty for assets created from memory
+        uint64_t ContentHash;           // Hash of the source bytes, so edited files are not mistaken for the cached version
+        uint64_t Variant;               // Hash of the settings the asset was created with
+        std::vector<uint64_t> Settings; // The settings themselves where their hash could collide, only compared when Variant is equal
+
+        bool operator<(AssetKey const &other) const;
+    };
+
+    struct Stats {
+        uint64_t Hits;
+        uint64_t Misses;
+        uint32_t LiveCount;
+        VkDeviceSize DeviceMemorySize;   // Held by live assets
+        VkDeviceSize DeviceMemoryReused; // Handed out by hits instead of being allocated again
+    };
+
+    // Creates the asset on a miss and reports the device memory it holds
+    template<class AssetClass>
+    using CreateFunc = std::function<Graphics::GraphicsError(AssetClass **outAsset, VkDeviceSize *outDeviceMemorySize)>;
+
+    // Image file, or image in memory if Data is set
+    struct TextureSource {
+        std::string FilePath;
+        const void *Data;
+        size_t DataSize;
+    };
+
+    // Receives each texture of a batch as soon as it is staged, on the worker thread that loaded it
+    typedef std::function<void(uint32_t index, Graphics::GraphicsError err, std::shared_ptr<Vulkan2DTextureBuffer> const &texture)> TextureLoadedFunc;
+
+public:
+    VulkanAssetCache(RendererImpl *renderer);
+    VulkanAssetCache(VulkanAssetCache const &) = delete;
+    VulkanAssetCache &operator=(VulkanAssetCache const &) = delete;
+    ~VulkanAssetCache();
+
+    // Returns the live asset for key, or creates it with create
+    // Requests for a key that is still being created wait for it instead of creating it twice
+    // Failed creations are not cached, the next request tries again
+    template<class AssetClass>
+    Graphics::GraphicsError Acquire(AssetKey const &key, CreateFunc<AssetClass> const &create, std::shared_ptr<AssetClass> *outAsset);
+
+    // Textures are decoded and staged on a miss, their holders flush them to the device
+    // Each block compression format is a separate asset of the same source, and so are streaming textures
+    Graphics::GraphicsError AcquireTexture(std::string const &filePath, Graphics::TextureCompressor::BlockFormat compression, bool streaming,
+                                           std::shared_ptr<Vulkan2DTextureBuffer> *outTexture);
+    Graphics::GraphicsError AcquireTexture(const void *data, size_t dataSize, Graphics::TextureCompressor::BlockFormat compression, bool streaming,
+                                           std::shared_ptr<Vulkan2DTextureBuffer> *outTexture);
+
+    // Acquires a batch of textures, decoding them in parallel on the renderer's worker threads
+    // Decodes in flight are kept under the decode memory budget, estimated from the image headers
+    // Blocks until every texture has been handed to onLoaded, failures are reported there too
+    void AcquireTextures(std::vector<TextureSource> const &sources, Graphics::TextureCompressor::BlockFormat compression, bool streaming, TextureLoadedFunc const &onLoaded);
+
+    // Bytes that texture decodes in flight may use together, 256MB by default
+    void SetDecodeMemoryBudget(size_t memoryBudget);
+
+    // Sampler created with the settings of an uninitialized sampler, requests with equal settings share one sampler
+    Graphics::GraphicsError AcquireSampler(VulkanSampler const &settings, std::shared_ptr<VulkanSampler> *outSampler);
+
+    // Sampler with VulkanSampler's default settings
+    Graphics::GraphicsError AcquireDefaultSampler(std::shared_ptr<VulkanSampler> *outSampler);
+
+    // Fills the path and content hash of a key for a file
+    // Returns FILE_LOAD_ERROR if the file cannot be read
+    static Graphics::GraphicsError GetFileKey(std::string const &filePath, AssetKey *outKey);
+
+    VkDeviceSize GetDeviceMemorySize(VkBuffer buffer) const;
+    VkDeviceSize GetDeviceMemorySize(VkImage image) const;
+
+    Stats GetStats(AssetType type) const;
+    void LogStats() const;
+
+private:
+    struct Entry {
+        std::weak_ptr<void> Asset;
+        bool Creating;
+        VkDeviceSize DeviceMemorySize;
+        uint64_t Generation; // Tells a released asset's entry apart from a newer one created under the same key
+    };
+
+    void _release(AssetKey const &key, uint64_t generation, VkDeviceSize deviceMemorySize);
+
+    // Host memory a texture takes while it is loaded, 0 if it cannot be read
+    static size_t _estimateTextureMemory(TextureSource const &source);
+
+    static uint64_t _getTextureVariant(Graphics::TextureCompressor::BlockFormat compression, bool streaming);
+
+    // Every setting in a sampler's create info
+    static std::vector<uint64_t> _getSamplerSettings(VkSamplerCreateInfo const &properties);
+
+private:
+    RendererImpl *m_renderer;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_creationFinished;
+    std::map<AssetKey, Entry> m_entries;
+    uint64_t m_generation;
+    Stats m_stats[ASSET_TYPE_COUNT];
+    size_t m_decodeMemoryBudget;
+};
+
+} // namespace Vulkan
+
+#include "VulkanAssetCache.tpp"
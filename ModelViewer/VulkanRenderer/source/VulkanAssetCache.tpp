@@ -0,0 +1,66 @@
+#include "VulkanAssetCache.h"
+
+namespace Vulkan {
+
+template<class AssetClass>
+Graphics::GraphicsError VulkanAssetCache::Acquire(AssetKey const &key, CreateFunc<AssetClass> const &create, std::shared_ptr<AssetClass> *outAsset) {
+    ASSERT(key.Type < ASSET_TYPE_COUNT);
+    ASSERT(outAsset);
+
+    // Handles are only assigned outside the lock, releasing the caller's previous asset takes the lock too
+    std::shared_ptr<void> asset;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(key);
+    while (it != m_entries.end() && it->second.Creating) {
+        m_creationFinished.wait(lock);
+        it = m_entries.find(key);
+    }
+    if (it != m_entries.end()) {
+        // An expired entry belongs to an asset that is being released, it is replaced below
+        asset = it->second.Asset.lock();
+        if (asset) {
+            ++m_stats[key.Type].Hits;
+            m_stats[key.Type].DeviceMemoryReused += it->second.DeviceMemorySize;
+            lock.unlock();
+
+            *outAsset = std::static_pointer_cast<AssetClass>(asset);
+            return Graphics::GraphicsError::OK;
+        }
+    }
+
+    ++m_stats[key.Type].Misses;
+    uint64_t generation = ++m_generation;
+    m_entries[key] = { std::weak_ptr<void>(), true, 0, generation };
+    lock.unlock();
+
+    AssetClass *createdAsset = nullptr;
+    VkDeviceSize deviceMemorySize = 0;
+    auto err = create(&createdAsset, &deviceMemorySize);
+
+    lock.lock();
+    if (err != Graphics::GraphicsError::OK) {
+        ASSERT(!createdAsset);
+        m_entries.erase(key);
+        m_creationFinished.notify_all();
+        return err;
+    }
+    ASSERT(createdAsset);
+
+    std::shared_ptr<AssetClass> handle(createdAsset, [this, key, generation, deviceMemorySize](AssetClass *releasedAsset) {
+        _release(key, generation, deviceMemorySize);
+        delete releasedAsset;
+    });
+    Entry &entry = m_entries[key];
+    entry.Asset = handle;
+    entry.Creating = false;
+    entry.DeviceMemorySize = deviceMemorySize;
+    ++m_stats[key.Type].LiveCount;
+    m_stats[key.Type].DeviceMemorySize += deviceMemorySize;
+    m_creationFinished.notify_all();
+    lock.unlock();
+
+    *outAsset = std::move(handle);
+    return Graphics::GraphicsError::OK;
+}
+
+} // namespace Vulkan
@@ -0,0 +1,117 @@
+#include "pch.h"
+#include "VulkanBindlessTextureSet.h"
+#include "VulkanRendererImpl.h"
+
+namespace Vulkan {
+
+VulkanBindlessTextureSet::VulkanBindlessTextureSet(RendererImpl *renderer, uint32_t framesInFlight)
+  : m_renderer(renderer),
+    m_framesInFlight(framesInFlight),
+    m_frame(0),
+    m_slotCount(0),
+    m_layout(renderer),
+    m_pool(renderer),
+    m_descriptorSet(renderer) {
+    ASSERT(renderer);
+}
+
+VulkanBindlessTextureSet::~VulkanBindlessTextureSet() {
+}
+
+Graphics::GraphicsError VulkanBindlessTextureSet::Initialize(uint32_t maxSlotCount) {
+    ASSERT(m_slotCount == 0);
+
+    // Combined image samplers count against both the sampler and the sampled image limits
+    VkPhysicalDeviceDescriptorIndexingProperties const &limits = m_renderer->GetPhysicalDevice()->GetDescriptorIndexingProperties();
+    m_slotCount = std::min({ maxSlotCount,
+        limits.maxDescriptorSetUpdateAfterBindSamplers, limits.maxDescriptorSetUpdateAfterBindSampledImages,
+        limits.maxPerStageDescriptorUpdateAfterBindSamplers, limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+        limits.maxPerStageUpdateAfterBindResources });
+    if (m_slotCount == 0) {
+        return Graphics::GraphicsError::DESCRIPTOR_SET_CREATE_ERROR;
+    }
+
+    // Slots that were never written are not read, and every write happens while the set is bound by frames in flight
+    m_layout.AddCombinedImageSampler(0, m_slotCount, VK_SHADER_STAGE_FRAGMENT_BIT);
+    m_layout.SetBindingFlags(0, VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT);
+    auto err = m_layout.Initialize();
+    if (err != Graphics::GraphicsError::OK) {
+        return err;
+    }
+
+    m_pool.AddDescriptorLayout(&m_layout, 1);
+    err = m_pool.Initialize();
+    if (err != Graphics::GraphicsError::OK) {
+        return err;
+    }
+
+    m_descriptorSet.SetDescriptorSetLayout(&m_layout);
+    VulkanDescriptorSetInstance *descriptorSets[] = { &m_descriptorSet };
+    err = m_pool.AllocateDescriptorSet(countof(descriptorSets), descriptorSets);
+    if (err != Graphics::GraphicsError::OK) {
+        return err;
+    }
+
+    m_freeSlots.resize(m_slotCount);
+    for (uint32_t i = 0; i < m_slotCount; ++i) {
+        m_freeSlots[i] = m_slotCount - 1 - i;
+    }
+
+    return Graphics::GraphicsError::OK;
+}
+
+uint32_t VulkanBindlessTextureSet::AllocateSlot() {
+    if (m_freeSlots.empty()) {
+        return INVALID_SLOT;
+    }
+    uint32_t slot = m_freeSlots.back();
+    m_freeSlots.pop_back();
+    return slot;
+}
+
+void VulkanBindlessTextureSet::FreeSlot(uint32_t slot) {
+    ASSERT(slot < m_slotCount);
+    m_retiredSlots.push_back({ slot, m_frame });
+}
+
+void VulkanBindlessTextureSet::WriteSlot(uint32_t slot, VkImageView imageView, VkSampler sampler) {
+    ASSERT(slot < m_slotCount);
+
+    // The set's only write is reused for every slot
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView = imageView;
+    imageInfo.sampler = sampler;
+    m_descriptorSet.UpdateDescriptorWrite(0, &imageInfo, slot, 1);
+    m_descriptorSet.SetInternalDescriptorSet(m_descriptorSet.GetVkDescriptorSet());
+}
+
+void VulkanBindlessTextureSet::Update() {
+    ++m_frame;
+
+    // Slots are written during the early update, before the frame that reuses them waits on its fence,
+    //   so the frame that freed a slot must be done one frame earlier than a fence wait would tell
+    auto it = std::remove_if(m_retiredSlots.begin(), m_retiredSlots.end(), [this](RetiredSlot const &retiredSlot) {
+        if (retiredSlot.Frame + m_framesInFlight >= m_frame) {
+            return false;
+        }
+        m_freeSlots.push_back(retiredSlot.Slot);
+        return true;
+    });
+    m_retiredSlots.erase(it, m_retiredSlots.end());
+}
+
+VulkanDescriptorSetLayout *VulkanBindlessTextureSet::GetDescriptorSetLayout() {
+    return &m_layout;
+}
+
+VkDescriptorSet VulkanBindlessTextureSet::GetVkDescriptorSet() const {
+    return m_descriptorSet.GetVkDescriptorSet();
+}
+
+uint32_t VulkanBindlessTextureSet::GetSlotCount() const {
+    return m_slotCount;
+}
+
+} // namespace Vulkan
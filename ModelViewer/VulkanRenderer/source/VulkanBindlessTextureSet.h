@@ -0,0 +1,63 @@
+#pragma once
+
+#include "VulkanDescriptorSetLayout.h"
+#include "VulkanDescriptorSetInstance.h"
+#include "VulkanDescriptorSetAllocator.h"
+
+namespace Vulkan {
+
+class RendererImpl;
+
+// One descriptor set with a large array of combined image samplers that textured draws index into, so the set is bound once
+//   per pipeline bind rather than once per texture
+// The array is partially bound and updated after bind, slots can be written while frames in flight read other slots
+// Freed slots are only handed out again once every frame in flight that may have read them is done
+class VulkanBindlessTextureSet {
+public:
+    static const uint32_t INVALID_SLOT = std::numeric_limits<uint32_t>::max();
+
+public:
+    VulkanBindlessTextureSet(RendererImpl *renderer, uint32_t framesInFlight);
+    VulkanBindlessTextureSet(VulkanBindlessTextureSet const &) = delete;
+    VulkanBindlessTextureSet &operator=(VulkanBindlessTextureSet const &) = delete;
+    ~VulkanBindlessTextureSet();
+
+    // Creates the set with maxSlotCount slots, or fewer if the device's update after bind limits are lower
+    // Requires the DESCRIPTOR_INDEXING feature
+    Graphics::GraphicsError Initialize(uint32_t maxSlotCount);
+
+    // Returns INVALID_SLOT once every slot is taken
+    uint32_t AllocateSlot();
+    void FreeSlot(uint32_t slot);
+
+    // Points a slot at an image, frames still in flight must not be reading the slot
+    void WriteSlot(uint32_t slot, VkImageView imageView, VkSampler sampler);
+
+    // Counts frames so freed slots can be reused, call once per frame
+    void Update();
+
+    VulkanDescriptorSetLayout *GetDescriptorSetLayout();
+    VkDescriptorSet GetVkDescriptorSet() const;
+    uint32_t GetSlotCount() const;
+
+private:
+    struct RetiredSlot {
+        uint32_t Slot;
+        uint64_t Frame; // Last frame that may have read the slot
+    };
+
+private:
+    RendererImpl *m_renderer;
+    uint32_t m_framesInFlight;
+    uint64_t m_frame;
+    uint32_t m_slotCount;
+
+    VulkanDescriptorSetLayout m_layout;
+    VulkanDescriptorSetAllocator m_pool;
+    VulkanDescriptorSetInstance m_descriptorSet;
+
+    std::vector<uint32_t> m_freeSlots; // Taken from the back, starting with slot 0
+    std::vector<RetiredSlot> m_retiredSlots;
+};
+
+} // namespace Vulkan
@@ -7,8 +7,7 @@ namespace Vulkan {
 VulkanBuffer::VulkanBuffer(RendererImpl *renderer)
   : m_renderer(renderer),
     m_vkBuffer(VK_NULL_HANDLE),
-    m_vkMemory(VK_NULL_HANDLE),
-    m_mappedMemory(nullptr) {
+    m_allocation{} {
     ASSERT(renderer);
 }
 
@@ -19,21 +18,17 @@ VulkanBuffer::~VulkanBuffer() {
 VulkanBuffer::VulkanBuffer(VulkanBuffer &&other) noexcept
   : m_renderer(other.m_renderer),
     m_vkBuffer(other.m_vkBuffer),
-    m_vkMemory(other.m_vkMemory),
-    m_mappedMemory(other.m_mappedMemory) {
+    m_allocation(other.m_allocation) {
     other.m_vkBuffer = VK_NULL_HANDLE;
-    other.m_vkMemory = VK_NULL_HANDLE;
-    other.m_mappedMemory = nullptr;
+    other.m_allocation = {};
 }
 
 VulkanBuffer &VulkanBuffer::operator=(VulkanBuffer &&other) noexcept {
     m_renderer = other.m_renderer;
     m_vkBuffer = other.m_vkBuffer;
-    m_vkMemory = other.m_vkMemory;
-    m_mappedMemory = other.m_mappedMemory;
+    m_allocation = other.m_allocation;
     other.m_vkBuffer = VK_NULL_HANDLE;
-    other.m_vkMemory = VK_NULL_HANDLE;
-    other.m_mappedMemory = nullptr;
+    other.m_allocation = {};
 
     return *this;
 }
@@ -56,25 +51,20 @@ Graphics::GraphicsError VulkanBuffer::Initialize(VkDeviceSize size, VkBufferUsag
 }
 
 Graphics::GraphicsError VulkanBuffer::Allocate(VkMemoryPropertyFlags properties) {
-    if (m_vkMemory) {
+    if (m_allocation.Memory) {
         return Graphics::GraphicsError::OK;
     }
 
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(m_renderer->GetDevice(), m_vkBuffer, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    if (m_renderer->GetMemoryTypeIndex(memRequirements.memoryTypeBits, properties, 0, &allocInfo.memoryTypeIndex) != Graphics::GraphicsError::OK) {
+    VulkanMemoryAllocator *allocator = m_renderer->GetMemoryAllocator();
+    if (allocator->Allocate(memRequirements, properties, VulkanMemoryAllocator::RESOURCE_TYPE_LINEAR, &m_allocation) != Graphics::GraphicsError::OK) {
         return Graphics::GraphicsError::INITIALIZATION_FAILED;
     }
 
-    if (vkAllocateMemory(m_renderer->GetDevice(), &allocInfo, nullptr, &m_vkMemory) != VK_SUCCESS) {
-        return Graphics::GraphicsError::INITIALIZATION_FAILED;
-    }
-
-    if (vkBindBufferMemory(m_renderer->GetDevice(), m_vkBuffer, m_vkMemory, 0) != VK_SUCCESS) {
+    if (vkBindBufferMemory(m_renderer->GetDevice(), m_vkBuffer, m_allocation.Memory, m_allocation.Offset) != VK_SUCCESS) {
+        allocator->Free(&m_allocation);
         return Graphics::GraphicsError::INITIALIZATION_FAILED;
     }
 
@@ -82,22 +72,7 @@ Graphics::GraphicsError VulkanBuffer::Allocate(VkMemoryPropertyFlags properties)
 }
 
 void *VulkanBuffer::GetMappedMemory() {
-    if (!m_mappedMemory) {
-        VkMemoryRequirements memRequirements;
-        vkGetBufferMemoryRequirements(m_renderer->GetDevice(), m_vkBuffer, &memRequirements);
-        if (vkMapMemory(m_renderer->GetDevice(), m_vkMemory, 0, memRequirements.size, 0, &m_mappedMemory) != VK_SUCCESS) {
-            return nullptr;
-        }
-    }
-
-    return m_mappedMemory;
-}
-
-void VulkanBuffer::UnmapMemory() {
-    if (m_mappedMemory) {
-        vkUnmapMemory(m_renderer->GetDevice(), m_vkMemory);
-        m_mappedMemory = nullptr;
-    }
+    return m_allocation.MappedMemory;
 }
 
 VkBuffer &VulkanBuffer::GetVkBuffer() {
@@ -105,20 +80,20 @@ VkBuffer &VulkanBuffer::GetVkBuffer() {
 }
 
 VkDeviceMemory &VulkanBuffer::GetVkDeviceMemory() {
-    return m_vkMemory;
+    return m_allocation.Memory;
 }
 
-void VulkanBuffer::Clear() {
-    UnmapMemory();
+VkDeviceSize VulkanBuffer::GetMemoryOffset() const {
+    return m_allocation.Offset;
+}
 
-    if (m_vkMemory) {
-        vkFreeMemory(m_renderer->GetDevice(), m_vkMemory, VK_NULL_HANDLE);
-        m_vkMemory = VK_NULL_HANDLE;
-    }
+void VulkanBuffer::Clear() {
+    // The buffer goes first so that its range is never bound to two buffers at once
     if (m_vkBuffer) {
         vkDestroyBuffer(m_renderer->GetDevice(), m_vkBuffer, VK_NULL_HANDLE);
         m_vkBuffer = VK_NULL_HANDLE;
     }
+    m_renderer->GetMemoryAllocator()->Free(&m_allocation);
 }
 
 } // namespace Vulkan
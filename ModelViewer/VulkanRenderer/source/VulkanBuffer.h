@@ -1,5 +1,7 @@
 #pragma once
 
+#include "VulkanMemoryAllocator.h"
+
 namespace Vulkan {
 
 class RendererImpl;
@@ -17,19 +19,19 @@ public:
     Graphics::GraphicsError Initialize(VkDeviceSize size, VkBufferUsageFlags usage, uint32_t *queueFamilies, uint32_t queueFamilyCount);
     Graphics::GraphicsError Allocate(VkMemoryPropertyFlags properties); // No device memory is allocated until this is called
 
+    // Host visible memory stays mapped for as long as it is allocated
     void *GetMappedMemory();
-    void UnmapMemory();
 
     VkBuffer &GetVkBuffer();
     VkDeviceMemory &GetVkDeviceMemory();
+    VkDeviceSize GetMemoryOffset() const;
 
     void Clear();
 
 private:
     RendererImpl *m_renderer;
     VkBuffer m_vkBuffer;
-    VkDeviceMemory m_vkMemory;
-    void *m_mappedMemory;
+    VulkanMemoryAllocator::Allocation m_allocation;
 };
 
 } // namespace Vulkan
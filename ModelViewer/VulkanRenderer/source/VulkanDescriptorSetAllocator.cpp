@@ -8,7 +8,8 @@ namespace Vulkan {
 
 VulkanDescriptorSetAllocator::VulkanDescriptorSetAllocator(RendererImpl *renderer)
   : m_renderer(renderer),
-    m_expectedAllocs(0) {
+    m_expectedAllocs(0),
+    m_poolFlags(0) {
     ASSERT(renderer);
 }
 
@@ -21,6 +22,9 @@ void VulkanDescriptorSetAllocator::AddDescriptorLayout(VulkanDescriptorSetLayout
     size_t firstIndex = m_descriptorPoolSizes.size();
     m_descriptorPoolSizes.insert(m_descriptorPoolSizes.end(), requirements.begin(), requirements.end());
     m_expectedAllocs += allocCount;
+    if (layout->IsUpdateAfterBind()) {
+        m_poolFlags |= VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    }
 
     for (size_t i = firstIndex; i < m_descriptorPoolSizes.size(); ++i) {
         m_descriptorPoolSizes[i].descriptorCount *= allocCount;
@@ -109,6 +113,7 @@ Graphics::GraphicsError VulkanDescriptorSetAllocator::_getFreePool() {
     VkDescriptorPool newPool;
     VkDescriptorPoolCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    createInfo.flags = m_poolFlags;
     createInfo.maxSets = m_expectedAllocs;
     createInfo.poolSizeCount = static_cast<uint32_t>(m_descriptorPoolSizes.size());
     createInfo.pPoolSizes = m_descriptorPoolSizes.data();
@@ -16,6 +16,7 @@ public:
     VulkanDescriptorSetAllocator &operator=(VulkanDescriptorSetAllocator const &) = delete;
     ~VulkanDescriptorSetAllocator();
 
+    // Pools are created update after bind if any added layout is
     void AddDescriptorLayout(VulkanDescriptorSetLayout *layout, uint32_t allocCount = DEFAULT_ALLOC_COUNT);
 
     Graphics::GraphicsError Initialize();
@@ -45,6 +46,7 @@ private:
 
     std::vector<VkDescriptorPoolSize> m_descriptorPoolSizes;
     uint32_t m_expectedAllocs;
+    VkDescriptorPoolCreateFlags m_poolFlags;
     
     // Kept in object to avoid reallocating the vector each allocation
     std::vector<VkDescriptorSetLayout> m_setLayouts;
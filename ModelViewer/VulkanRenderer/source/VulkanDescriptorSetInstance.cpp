@@ -96,10 +96,18 @@ void VulkanDescriptorSetInstance::UpdateDescriptorWrite(uint32_t writeIndex, con
 }
 
 void VulkanDescriptorSetInstance::UpdateDescriptorWrite(uint32_t writeIndex, const VkDescriptorImageInfo *imageInfo, uint32_t arrayElement, uint32_t descriptorCount) {
+    auto &writeDescriptor = m_writeDescriptors[writeIndex];
+
+    // Images of streaming textures are rewritten often, so the info of an earlier write of the same size is reused
+    if (writeDescriptor.pImageInfo && writeDescriptor.descriptorCount == descriptorCount) {
+        memcpy(const_cast<VkDescriptorImageInfo*>(writeDescriptor.pImageInfo), imageInfo, sizeof(VkDescriptorImageInfo) * descriptorCount);
+        writeDescriptor.dstArrayElement = arrayElement;
+        return;
+    }
+
     auto newInfo = m_writeInfos.emplace_back(new uint8_t[sizeof(VkDescriptorImageInfo) * descriptorCount]);
     memcpy(newInfo, imageInfo, sizeof(VkDescriptorImageInfo) * descriptorCount);
 
-    auto &writeDescriptor = m_writeDescriptors[writeIndex];
     writeDescriptor.dstArrayElement = arrayElement;
     writeDescriptor.descriptorCount = descriptorCount;
     writeDescriptor.pImageInfo = reinterpret_cast<VkDescriptorImageInfo*>(newInfo);
@@ -118,11 +126,23 @@ void VulkanDescriptorSetInstance::UpdateDescriptorWrite(uint32_t writeIndex, con
 Graphics::GraphicsError VulkanDescriptorSetInstance::SetInternalDescriptorSet(VkDescriptorSet vkDescriptorSet) {
     m_vkDescriptorSet = vkDescriptorSet;
 
+    bool allWritten = true;
     for (auto &writeDescriptor : m_writeDescriptors) {
         writeDescriptor.dstSet = m_vkDescriptorSet;
+        allWritten = allWritten && _hasDescriptor(writeDescriptor);
     }
 
-    vkUpdateDescriptorSets(m_renderer->GetDevice(), static_cast<uint32_t>(m_writeDescriptors.size()), m_writeDescriptors.data(), 0, VK_NULL_HANDLE);
+    if (allWritten) {
+        vkUpdateDescriptorSets(m_renderer->GetDevice(), static_cast<uint32_t>(m_writeDescriptors.size()), m_writeDescriptors.data(), 0, VK_NULL_HANDLE);
+    }
+    else {
+        // Default writes of bindings that were never given a descriptor are skipped, partially bound bindings may stay empty
+        for (auto &writeDescriptor : m_writeDescriptors) {
+            if (_hasDescriptor(writeDescriptor)) {
+                vkUpdateDescriptorSets(m_renderer->GetDevice(), 1, &writeDescriptor, 0, VK_NULL_HANDLE);
+            }
+        }
+    }
 
     return Graphics::GraphicsError::OK;
 }
@@ -135,6 +155,10 @@ const VkDescriptorSet &VulkanDescriptorSetInstance::GetVkDescriptorSet() const {
     return m_vkDescriptorSet;
 }
 
+bool VulkanDescriptorSetInstance::_hasDescriptor(VkWriteDescriptorSet const &writeDescriptor) {
+    return writeDescriptor.pBufferInfo || writeDescriptor.pImageInfo || writeDescriptor.pTexelBufferView;
+}
+
 const VkDescriptorSetLayoutBinding *VulkanDescriptorSetInstance::_findBinding(uint32_t binding) {
     auto &layoutBindings = m_descriptorSetLayout->GetBindings();
     auto foundBinding = std::find_if(layoutBindings.begin(), layoutBindings.end(),
@@ -38,6 +38,7 @@ public:
 
     // Will set and update the descriptor set according to the VkWriteDescriptorSet that have been set
     // Descriptor sets cannot be freed so this must be called each time the associated descriptor set pool is reset to re-initialize the descriptor set
+    // Default writes that were never updated with a descriptor are skipped
     Graphics::GraphicsError SetInternalDescriptorSet(VkDescriptorSet vkDescriptorSet);
 
     VulkanDescriptorSetLayout *GetDescriptorSetLayout() const;
@@ -45,6 +46,7 @@ public:
 
 private:
     const VkDescriptorSetLayoutBinding *_findBinding(uint32_t binding);
+    static bool _hasDescriptor(VkWriteDescriptorSet const &writeDescriptor);
 
 private:
     RendererImpl *m_renderer;
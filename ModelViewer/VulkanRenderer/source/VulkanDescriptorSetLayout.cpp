@@ -23,6 +23,7 @@ void VulkanDescriptorSetLayout::AddUniformBuffer(uint32_t binding, uint32_t coun
     newBinding.descriptorCount = count;
     newBinding.stageFlags = shaderStages;
     newBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    m_bindingFlags.push_back(0);
 }
 
 void VulkanDescriptorSetLayout::AddCombinedImageSampler(uint32_t binding, uint32_t count, VkShaderStageFlags shaderStages) {
@@ -31,6 +32,15 @@ void VulkanDescriptorSetLayout::AddCombinedImageSampler(uint32_t binding, uint32
     newBinding.descriptorCount = count;
     newBinding.stageFlags = shaderStages;
     newBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    m_bindingFlags.push_back(0);
+}
+
+void VulkanDescriptorSetLayout::SetBindingFlags(uint32_t binding, VkDescriptorBindingFlags flags) {
+    auto foundBinding = std::find_if(m_bindings.begin(), m_bindings.end(), [binding](auto &layoutBinding) { return layoutBinding.binding == binding; });
+    ASSERT(foundBinding != m_bindings.end());
+    if (foundBinding != m_bindings.end()) {
+        m_bindingFlags[foundBinding - m_bindings.begin()] = flags;
+    }
 }
 
 int VulkanDescriptorSetLayout::_descriptorTypeToKeyIndex(VkDescriptorType descriptorType) {
@@ -79,16 +89,30 @@ Graphics::GraphicsError VulkanDescriptorSetLayout::Initialize() {
     createInfo.bindingCount = static_cast<uint32_t>(m_bindings.size());
     createInfo.pBindings = m_bindings.data();
 
+    // Binding flags are only chained when some binding has them
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount = static_cast<uint32_t>(m_bindingFlags.size());
+    bindingFlagsInfo.pBindingFlags = m_bindingFlags.data();
+    if (std::any_of(m_bindingFlags.begin(), m_bindingFlags.end(), [](VkDescriptorBindingFlags flags) { return flags != 0; })) {
+        createInfo.pNext = &bindingFlagsInfo;
+    }
+    if (IsUpdateAfterBind()) {
+        createInfo.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    }
+
     if (vkCreateDescriptorSetLayout(m_renderer->GetDevice(), &createInfo, VK_NULL_HANDLE, &m_vkLayout) != VK_SUCCESS) {
         return Graphics::GraphicsError::DESCRIPTOR_SET_CREATE_ERROR;
     }
 
     for (auto &binding : m_bindings) {
         // Assuming no more than 255 bindings of the same type
-        ASSERT(binding.descriptorCount < std::numeric_limits<uint8_t>::max());
+        // Arrays of descriptors only count once, bindless arrays are far larger than that
+        int keyIndex = _descriptorTypeToKeyIndex(binding.descriptorType);
+        ASSERT(m_key[keyIndex] < std::numeric_limits<uint8_t>::max());
 
         // Update the unique key for this layout
-        ++m_key[_descriptorTypeToKeyIndex(binding.descriptorType)];
+        ++m_key[keyIndex];
 
         // Create the memory requirements for this layout
         m_memoryRequirements.push_back({ binding.descriptorType, binding.descriptorCount });
@@ -113,4 +137,10 @@ const VulkanDescriptorSetLayout::BindingsArray &VulkanDescriptorSetLayout::GetBi
     return m_bindings;
 }
 
+bool VulkanDescriptorSetLayout::IsUpdateAfterBind() const {
+    return std::any_of(m_bindingFlags.begin(), m_bindingFlags.end(), [](VkDescriptorBindingFlags flags) {
+        return (flags & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT) != 0;
+    });
+}
+
 } // namespace Vulkan
@@ -23,6 +23,10 @@ public:
     void AddUniformBuffer(uint32_t binding, uint32_t count, VkShaderStageFlags shaderStages);
     void AddCombinedImageSampler(uint32_t binding, uint32_t count, VkShaderStageFlags shaderStages);
 
+    // Sets VkDescriptorBindingFlags of an added binding, requires the descriptor indexing features for the flags
+    // Layouts with an update after bind binding can only be allocated from update after bind pools
+    void SetBindingFlags(uint32_t binding, VkDescriptorBindingFlags flags);
+
     // Once a layout has been successfully initialized, Initialize can no longer be called
     Graphics::GraphicsError Initialize();
 
@@ -30,6 +34,7 @@ public:
     const KeyType &GetLayoutKey() const;
     const MemoryRequirements &GetMemoryRequirements() const;
     const BindingsArray &GetBindings() const;
+    bool IsUpdateAfterBind() const;
 
 private:
     int _descriptorTypeToKeyIndex(VkDescriptorType descriptorType);
@@ -39,6 +44,7 @@ private:
     VkDescriptorSetLayout m_vkLayout;
 
     BindingsArray m_bindings;
+    std::vector<VkDescriptorBindingFlags> m_bindingFlags; // One per binding
     KeyType m_key;
     MemoryRequirements m_memoryRequirements;
 
@@ -35,6 +35,8 @@ static char const *FEATURE_SUPPORTS_TRANSFER_OPERATIONS = "TRANSFER_OPERATIONS";
 
 // Optional features
 static char const *FEATURE_SAMPLER_ANISOTROPY = "SAMPLER_ANISOTROPY";
+static char const *FEATURE_TEXTURE_COMPRESSION_BC = "TEXTURE_COMPRESSION_BC";
+static char const *FEATURE_DESCRIPTOR_INDEXING = "DESCRIPTOR_INDEXING"; // Bindless textures
 
 // List of validation layers that will be enabled if validation is enabled
 static char const *VALIDATION_LAYERS[] = {
@@ -10,7 +10,7 @@ VulkanImageBuffer::VulkanImageBuffer(RendererImpl *renderer)
   : m_renderer(renderer),
     m_imageProperties{},
     m_vkImage(VK_NULL_HANDLE),
-    m_vkMemory(VK_NULL_HANDLE) {
+    m_allocation{} {
     ASSERT(renderer);
 
     m_imageProperties.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -30,18 +30,18 @@ VulkanImageBuffer::VulkanImageBuffer(VulkanImageBuffer &&other) noexcept
   : m_renderer(other.m_renderer),
     m_imageProperties(other.m_imageProperties),
     m_vkImage(other.m_vkImage),
-    m_vkMemory(other.m_vkMemory) {
+    m_allocation(other.m_allocation) {
     other.m_vkImage = VK_NULL_HANDLE;
-    other.m_vkMemory = VK_NULL_HANDLE;
+    other.m_allocation = {};
 }
 
 VulkanImageBuffer &VulkanImageBuffer::operator=(VulkanImageBuffer &&other) noexcept {
     m_renderer = other.m_renderer;
     m_imageProperties = other.m_imageProperties;
     m_vkImage = other.m_vkImage;
-    m_vkMemory = other.m_vkMemory;
+    m_allocation = other.m_allocation;
     other.m_vkImage = VK_NULL_HANDLE;
-    other.m_vkMemory = VK_NULL_HANDLE;
+    other.m_allocation = {};
 
     return *this;
 }
@@ -139,25 +139,21 @@ Graphics::GraphicsError VulkanImageBuffer::Initialize(VkImageUsageFlags usage, u
 }
 
 Graphics::GraphicsError VulkanImageBuffer::Allocate(VkMemoryPropertyFlags properties) {
-    if (m_vkMemory) {
+    if (m_allocation.Memory) {
         return Graphics::GraphicsError::OK;
     }
 
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(m_renderer->GetDevice(), m_vkImage, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    if (m_renderer->GetMemoryTypeIndex(memRequirements.memoryTypeBits, properties, 0, &allocInfo.memoryTypeIndex) != Graphics::GraphicsError::OK) {
+    VulkanMemoryAllocator *allocator = m_renderer->GetMemoryAllocator();
+    auto resourceType = m_imageProperties.tiling == VK_IMAGE_TILING_LINEAR ? VulkanMemoryAllocator::RESOURCE_TYPE_LINEAR : VulkanMemoryAllocator::RESOURCE_TYPE_OPTIMAL;
+    if (allocator->Allocate(memRequirements, properties, resourceType, &m_allocation) != Graphics::GraphicsError::OK) {
         return Graphics::GraphicsError::INITIALIZATION_FAILED;
     }
 
-    if (vkAllocateMemory(m_renderer->GetDevice(), &allocInfo, nullptr, &m_vkMemory) != VK_SUCCESS) {
-        return Graphics::GraphicsError::INITIALIZATION_FAILED;
-    }
-
-    if (vkBindImageMemory(m_renderer->GetDevice(), m_vkImage, m_vkMemory, 0) != VK_SUCCESS) {
+    if (vkBindImageMemory(m_renderer->GetDevice(), m_vkImage, m_allocation.Memory, m_allocation.Offset) != VK_SUCCESS) {
+        allocator->Free(&m_allocation);
         return Graphics::GraphicsError::INITIALIZATION_FAILED;
     }
 
@@ -169,18 +165,19 @@ VkImage VulkanImageBuffer::GetVkImage() const {
 }
 
 VkDeviceMemory VulkanImageBuffer::GetVkDeviceMemory() const {
-    return m_vkMemory;
+    return m_allocation.Memory;
+}
+
+VkDeviceSize VulkanImageBuffer::GetMemoryOffset() const {
+    return m_allocation.Offset;
 }
 
 void VulkanImageBuffer::Clear() {
-    if (m_vkMemory) {
-        vkFreeMemory(m_renderer->GetDevice(), m_vkMemory, VK_NULL_HANDLE);
-        m_vkMemory = VK_NULL_HANDLE;
-    }
     if (m_vkImage) {
         vkDestroyImage(m_renderer->GetDevice(), m_vkImage, VK_NULL_HANDLE);
         m_vkImage = VK_NULL_HANDLE;
     }
+    m_renderer->GetMemoryAllocator()->Free(&m_allocation);
 }
 
 bool VulkanImageBuffer::IsFormatSupported(VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage) {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "VulkanBuffer.h"
+#include "VulkanMemoryAllocator.h"
 
 namespace Vulkan {
 
@@ -57,6 +58,7 @@ public:
 
     VkImage GetVkImage() const;
     VkDeviceMemory GetVkDeviceMemory() const;
+    VkDeviceSize GetMemoryOffset() const;
 
     void Clear();
 
@@ -67,7 +69,7 @@ private:
     RendererImpl *m_renderer;
     VkImageCreateInfo m_imageProperties;
     VkImage m_vkImage;
-    VkDeviceMemory m_vkMemory;
+    VulkanMemoryAllocator::Allocation m_allocation;
 
 };
 
@@ -0,0 +1,221 @@
+#include "pch.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanRendererImpl.h"
+#include "VulkanErrorToGraphicsError.h"
+
+namespace Vulkan {
+
+static const VkDeviceSize DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024;
+
+// Heaps up to this size get blocks of an eighth of the heap instead, so a few blocks do not take all of it
+static const VkDeviceSize SMALL_HEAP_SIZE = 1024 * 1024 * 1024;
+
+static const f64 MB = 1024.0 * 1024.0;
+
+VulkanMemoryAllocator::VulkanMemoryAllocator(RendererImpl *renderer)
+  : m_renderer(renderer),
+    m_memoryProperties{},
+    m_blockSizes{},
+    m_separateResourceTypes(true),
+    m_deviceMemoryCount(0) {
+    ASSERT(renderer);
+}
+
+VulkanMemoryAllocator::~VulkanMemoryAllocator() {
+    ASSERT(m_deviceMemoryCount == 0);
+}
+
+void VulkanMemoryAllocator::Initialize() {
+    vkGetPhysicalDeviceMemoryProperties(m_renderer->GetPhysicalDevice()->GetDevice(), &m_memoryProperties);
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; ++i) {
+        VkDeviceSize heapSize = m_memoryProperties.memoryHeaps[m_memoryProperties.memoryTypes[i].heapIndex].size;
+        m_blockSizes[i] = heapSize > SMALL_HEAP_SIZE ? DEFAULT_BLOCK_SIZE : heapSize / 8;
+    }
+
+    // Linear and optimal resources closer than the granularity would alias each other's pages
+    m_separateResourceTypes = m_renderer->GetPhysicalDevice()->GetDeviceLimits().bufferImageGranularity > 1;
+}
+
+void VulkanMemoryAllocator::Finalize() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &pool : m_pools) {
+        for (auto &block : pool) {
+            if (!block->Ranges.IsEmpty()) {
+                LOG_ERROR("Freeing device memory block of type %u with %u allocations still held\n", block->MemoryTypeIndex,
+                    block->Ranges.GetStats().AllocationCount);
+            }
+            _destroyBlock(block.get());
+        }
+        pool.clear();
+    }
+}
+
+Graphics::GraphicsError VulkanMemoryAllocator::Allocate(VkMemoryRequirements const &requirements, VkMemoryPropertyFlags properties,
+                                                        ResourceType resourceType, Allocation *outAllocation) {
+    ASSERT(outAllocation);
+    ASSERT(!outAllocation->Memory);
+
+    uint32_t memoryTypeIndex;
+    if (m_renderer->GetMemoryTypeIndex(requirements.memoryTypeBits, properties, 0, &memoryTypeIndex) != Graphics::GraphicsError::OK) {
+        return Graphics::GraphicsError::NO_SUPPORTED_MEMORY;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint32_t poolIndex = _getPoolIndex(memoryTypeIndex, resourceType);
+    BlockArray &pool = m_pools[poolIndex];
+    bool dedicated = requirements.size > m_blockSizes[memoryTypeIndex] / 2;
+
+    // Older blocks are tried first so that newer ones empty out and can be freed
+    if (!dedicated) {
+        for (auto &block : pool) {
+            if (block->Dedicated) {
+                continue;
+            }
+            auto handle = block->Ranges.Allocate(requirements.size, requirements.alignment);
+            if (handle != Graphics::TlsfAllocator::INVALID_HANDLE) {
+                _fillAllocation(block.get(), handle, outAllocation);
+                return Graphics::GraphicsError::OK;
+            }
+        }
+    }
+
+    Block *block = nullptr;
+    auto err = _createBlock(memoryTypeIndex, poolIndex, dedicated ? requirements.size : m_blockSizes[memoryTypeIndex], dedicated, &block);
+    if (err != Graphics::GraphicsError::OK) {
+        return err;
+    }
+
+    // Blocks start at offset 0, which satisfies any alignment
+    auto handle = block->Ranges.Allocate(requirements.size, requirements.alignment);
+    ASSERT(handle != Graphics::TlsfAllocator::INVALID_HANDLE);
+    _fillAllocation(block, handle, outAllocation);
+    return Graphics::GraphicsError::OK;
+}
+
+void VulkanMemoryAllocator::Free(Allocation *allocation) {
+    ASSERT(allocation);
+    if (!allocation->Memory) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Block *block = allocation->OwnerBlock;
+    block->Ranges.Free(allocation->Handle);
+    *allocation = {};
+
+    if (!block->Ranges.IsEmpty()) {
+        return;
+    }
+
+    // One empty block is kept per pool so that short lived staging buffers do not allocate and free a block every time
+    BlockArray &pool = m_pools[block->PoolIndex];
+    bool keep = !block->Dedicated && std::none_of(pool.begin(), pool.end(), [block](std::unique_ptr<Block> const &other) {
+        return other.get() != block && !other->Dedicated && other->Ranges.IsEmpty();
+    });
+    if (keep) {
+        return;
+    }
+    auto it = std::find_if(pool.begin(), pool.end(), [block](std::unique_ptr<Block> const &other) {
+        return other.get() == block;
+    });
+    ASSERT(it != pool.end());
+    _destroyBlock(block);
+    pool.erase(it);
+}
+
+VulkanMemoryAllocator::Stats VulkanMemoryAllocator::GetStats(uint32_t memoryTypeIndex) const {
+    ASSERT(memoryTypeIndex < VK_MAX_MEMORY_TYPES);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats{};
+    for (uint32_t resourceType = 0; resourceType < RESOURCE_TYPE_COUNT; ++resourceType) {
+        for (auto &block : m_pools[memoryTypeIndex * RESOURCE_TYPE_COUNT + resourceType]) {
+            Graphics::TlsfAllocator::Stats blockStats = block->Ranges.GetStats();
+            ++stats.BlockCount;
+            stats.Ranges.Size += blockStats.Size;
+            stats.Ranges.UsedSize += blockStats.UsedSize;
+            stats.Ranges.AllocationCount += blockStats.AllocationCount;
+            stats.Ranges.FreeRangeCount += blockStats.FreeRangeCount;
+            stats.Ranges.LargestFreeRange = std::max(stats.Ranges.LargestFreeRange, blockStats.LargestFreeRange);
+        }
+    }
+    stats.Fragmentation = Graphics::TlsfAllocator::GetFragmentation(stats.Ranges);
+    return stats;
+}
+
+void VulkanMemoryAllocator::LogStats() const {
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; ++i) {
+        Stats stats = GetStats(i);
+        if (stats.BlockCount == 0) {
+            continue;
+        }
+        LOG_INFO("Device memory type %u: %u blocks of %.2f MB, %u allocations using %.2f MB, %u free ranges, largest %.2f MB, %.0f%% fragmented\n",
+            i, stats.BlockCount, stats.Ranges.Size / MB, stats.Ranges.AllocationCount, stats.Ranges.UsedSize / MB,
+            stats.Ranges.FreeRangeCount, stats.Ranges.LargestFreeRange / MB, stats.Fragmentation * 100.0f);
+    }
+}
+
+uint32_t VulkanMemoryAllocator::_getPoolIndex(uint32_t memoryTypeIndex, ResourceType resourceType) const {
+    ASSERT(memoryTypeIndex < m_memoryProperties.memoryTypeCount);
+    ASSERT(resourceType < RESOURCE_TYPE_COUNT);
+    return memoryTypeIndex * RESOURCE_TYPE_COUNT + (m_separateResourceTypes ? resourceType : RESOURCE_TYPE_LINEAR);
+}
+
+Graphics::GraphicsError VulkanMemoryAllocator::_createBlock(uint32_t memoryTypeIndex, uint32_t poolIndex, VkDeviceSize size, bool dedicated, Block **outBlock) {
+    uint32_t maxAllocationCount = m_renderer->GetPhysicalDevice()->GetDeviceLimits().maxMemoryAllocationCount;
+    if (m_deviceMemoryCount >= maxAllocationCount) {
+        LOG_ERROR("Device memory block of type %u not created, all %u device memory allocations are in use\n", memoryTypeIndex, maxAllocationCount);
+        return Graphics::GraphicsError::OUT_OF_DEVICE_MEMORY;
+    }
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    VkDeviceMemory memory;
+    VkResult result = vkAllocateMemory(m_renderer->GetDevice(), &allocInfo, nullptr, &memory);
+    if (result != VK_SUCCESS) {
+        LOG_ERROR("Failed to allocate a device memory block of %.2f MB of type %u\n", size / MB, memoryTypeIndex);
+        return VulkanErrorToGraphicsError(result);
+    }
+
+    void *mappedMemory = nullptr;
+    if (m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        result = vkMapMemory(m_renderer->GetDevice(), memory, 0, VK_WHOLE_SIZE, 0, &mappedMemory);
+        if (result != VK_SUCCESS) {
+            vkFreeMemory(m_renderer->GetDevice(), memory, VK_NULL_HANDLE);
+            return VulkanErrorToGraphicsError(result);
+        }
+    }
+    ++m_deviceMemoryCount;
+
+    auto block = std::make_unique<Block>();
+    block->Memory = memory;
+    block->MemoryTypeIndex = memoryTypeIndex;
+    block->PoolIndex = poolIndex;
+    block->Dedicated = dedicated;
+    block->MappedMemory = mappedMemory;
+    block->Ranges.Initialize(size);
+    *outBlock = block.get();
+    m_pools[poolIndex].push_back(std::move(block));
+
+    return Graphics::GraphicsError::OK;
+}
+
+void VulkanMemoryAllocator::_destroyBlock(Block *block) {
+    // Freeing memory unmaps it as well
+    vkFreeMemory(m_renderer->GetDevice(), block->Memory, VK_NULL_HANDLE);
+    --m_deviceMemoryCount;
+}
+
+void VulkanMemoryAllocator::_fillAllocation(Block *block, Graphics::TlsfAllocator::Handle handle, Allocation *outAllocation) {
+    outAllocation->Memory = block->Memory;
+    outAllocation->Offset = block->Ranges.GetOffset(handle);
+    outAllocation->Size = block->Ranges.GetSize(handle);
+    outAllocation->MappedMemory = block->MappedMemory ? reinterpret_cast<uint8_t*>(block->MappedMemory) + outAllocation->Offset : nullptr;
+    outAllocation->OwnerBlock = block;
+    outAllocation->Handle = handle;
+}
+
+} // namespace Vulkan
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "TlsfAllocator.h"
+#include <memory>
+#include <mutex>
+
+namespace Vulkan {
+
+class RendererImpl;
+
+// Renderer wide device memory allocator that places resources in large blocks of each memory type, rather than giving each
+//   one its own vkAllocateMemory, which is slow and limited to maxMemoryAllocationCount allocations
+// Blocks are split up with a TlsfAllocator, host visible blocks stay mapped for as long as they live
+// Buffers and optimally tiled images only share blocks if the device's bufferImageGranularity is 1
+// Safe to use from worker threads
+class VulkanMemoryAllocator {
+public:
+    enum ResourceType : uint32_t {
+        RESOURCE_TYPE_LINEAR = 0, // Buffers and linearly tiled images
+        RESOURCE_TYPE_OPTIMAL,    // Optimally tiled images
+
+        RESOURCE_TYPE_COUNT
+    };
+
+private:
+    struct Block;
+
+public:
+    // Range of a block that one resource is bound to
+    struct Allocation {
+        VkDeviceMemory Memory;
+        VkDeviceSize Offset;
+        VkDeviceSize Size;
+        void *MappedMemory; // Start of the range, null unless the memory is host visible
+        Block *OwnerBlock;
+        Graphics::TlsfAllocator::Handle Handle;
+    };
+
+    struct Stats {
+        uint32_t BlockCount;
+        Graphics::TlsfAllocator::Stats Ranges; // Summed over every block, Size is the device memory the blocks hold
+        f32 Fragmentation;                     // Of the free space of every block together
+    };
+
+public:
+    VulkanMemoryAllocator(RendererImpl *renderer);
+    VulkanMemoryAllocator(VulkanMemoryAllocator const &) = delete;
+    VulkanMemoryAllocator &operator=(VulkanMemoryAllocator const &) = delete;
+    ~VulkanMemoryAllocator();
+
+    // Call once the device is created
+    void Initialize();
+
+    // Frees every block, allocations that are still held are reported
+    void Finalize();
+
+    // Sub-allocates from a block of the first memory type with properties, a new block is created if none has room
+    // Requests larger than half a block get a block of their own
+    Graphics::GraphicsError Allocate(VkMemoryRequirements const &requirements, VkMemoryPropertyFlags properties, ResourceType resourceType,
+                                     Allocation *outAllocation);
+
+    // Resets allocation, freeing an empty allocation does nothing
+    void Free(Allocation *allocation);
+
+    Stats GetStats(uint32_t memoryTypeIndex) const;
+    void LogStats() const;
+
+private:
+    struct Block {
+        VkDeviceMemory Memory;
+        uint32_t MemoryTypeIndex;
+        uint32_t PoolIndex;
+        bool Dedicated; // Holds a single request larger than half a block
+        void *MappedMemory;
+        Graphics::TlsfAllocator Ranges;
+    };
+
+    typedef std::vector<std::unique_ptr<Block>> BlockArray;
+
+    uint32_t _getPoolIndex(uint32_t memoryTypeIndex, ResourceType resourceType) const;
+
+    Graphics::GraphicsError _createBlock(uint32_t memoryTypeIndex, uint32_t poolIndex, VkDeviceSize size, bool dedicated, Block **outBlock);
+    void _destroyBlock(Block *block);
+
+    static void _fillAllocation(Block *block, Graphics::TlsfAllocator::Handle handle, Allocation *outAllocation);
+
+private:
+    RendererImpl *m_renderer;
+
+    mutable std::mutex m_mutex;
+    VkPhysicalDeviceMemoryProperties m_memoryProperties;
+    VkDeviceSize m_blockSizes[VK_MAX_MEMORY_TYPES];
+    bool m_separateResourceTypes;
+    uint32_t m_deviceMemoryCount; // Blocks of every memory type, counts against maxMemoryAllocationCount
+    BlockArray m_pools[VK_MAX_MEMORY_TYPES * RESOURCE_TYPE_COUNT];
+};
+
+} // namespace Vulkan
@@ -7,8 +7,7 @@ namespace Vulkan {
 VulkanMultiBuffer::VulkanMultiBuffer(RendererImpl *renderer)
   : m_renderer(renderer),
     m_sizePerBuffer(0),
-    m_vkMemory(VK_NULL_HANDLE),
-    m_mappedMemory(nullptr) {
+    m_allocation{} {
     ASSERT(renderer);
 }
 
@@ -40,7 +39,7 @@ Graphics::GraphicsError VulkanMultiBuffer::Initialize(VkDeviceSize sizePerBuffer
 }
 
 Graphics::GraphicsError VulkanMultiBuffer::Allocate(VkMemoryPropertyFlags properties) {
-    if (m_vkMemory) {
+    if (m_allocation.Memory) {
         return Graphics::GraphicsError::OK;
     }
     if (m_vkBuffers.empty()) {
@@ -57,20 +56,16 @@ Graphics::GraphicsError VulkanMultiBuffer::Allocate(VkMemoryPropertyFlags proper
     m_sizePerBuffer = (m_sizePerBuffer + memRequirements.alignment - 1) & ~(memRequirements.alignment - 1);
 
     // Allocate the memory for all buffers
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = m_sizePerBuffer * m_vkBuffers.size();
-    if (m_renderer->GetMemoryTypeIndex(memRequirements.memoryTypeBits, properties, 0, &allocInfo.memoryTypeIndex) != Graphics::GraphicsError::OK) {
-        return Graphics::GraphicsError::INITIALIZATION_FAILED;
-    }
-
-    if (vkAllocateMemory(m_renderer->GetDevice(), &allocInfo, nullptr, &m_vkMemory) != VK_SUCCESS) {
+    VkMemoryRequirements allRequirements = memRequirements;
+    allRequirements.size = m_sizePerBuffer * m_vkBuffers.size();
+    VulkanMemoryAllocator *allocator = m_renderer->GetMemoryAllocator();
+    if (allocator->Allocate(allRequirements, properties, VulkanMemoryAllocator::RESOURCE_TYPE_LINEAR, &m_allocation) != Graphics::GraphicsError::OK) {
         return Graphics::GraphicsError::INITIALIZATION_FAILED;
     }
 
     // Bind each buffer
     for (size_t i = 0; i < m_vkBuffers.size(); ++i) {
-        if (vkBindBufferMemory(m_renderer->GetDevice(), m_vkBuffers[i], m_vkMemory, _calculateOffset(i)) != VK_SUCCESS) {
+        if (vkBindBufferMemory(m_renderer->GetDevice(), m_vkBuffers[i], m_allocation.Memory, m_allocation.Offset + _calculateOffset(i)) != VK_SUCCESS) {
             return Graphics::GraphicsError::INITIALIZATION_FAILED;
         }
     }
@@ -87,39 +82,28 @@ size_t VulkanMultiBuffer::GetVkBufferCount() const {
 }
 
 VkDeviceMemory VulkanMultiBuffer::GetVkDeviceMemory() const {
-    return m_vkMemory;
+    return m_allocation.Memory;
 }
 
-void *VulkanMultiBuffer::GetMappedMemory(size_t index) const {
-    if (!m_mappedMemory) {
-        if (vkMapMemory(m_renderer->GetDevice(), m_vkMemory, 0, m_sizePerBuffer * m_vkBuffers.size(), 0, &m_mappedMemory) != VK_SUCCESS) {
-            return nullptr;
-        }
-    }
-
-    return reinterpret_cast<uint8_t*>(m_mappedMemory) + _calculateOffset(index);
+VkDeviceSize VulkanMultiBuffer::GetMemoryOffset() const {
+    return m_allocation.Offset;
 }
 
-void VulkanMultiBuffer::UnmapMemory() {
-    if (m_mappedMemory) {
-        vkUnmapMemory(m_renderer->GetDevice(), m_vkMemory);
-        m_mappedMemory = nullptr;
+void *VulkanMultiBuffer::GetMappedMemory(size_t index) const {
+    if (!m_allocation.MappedMemory) {
+        return nullptr;
     }
+
+    return reinterpret_cast<uint8_t*>(m_allocation.MappedMemory) + _calculateOffset(index);
 }
 
 void VulkanMultiBuffer::Clear() {
-    UnmapMemory();
-
-    if (m_vkMemory) {
-        vkFreeMemory(m_renderer->GetDevice(), m_vkMemory, VK_NULL_HANDLE);
-        m_vkMemory = VK_NULL_HANDLE;
-    }
     for (auto &buffer : m_vkBuffers) {
         vkDestroyBuffer(m_renderer->GetDevice(), buffer, VK_NULL_HANDLE);
     }
     m_vkBuffers.clear();
+    m_renderer->GetMemoryAllocator()->Free(&m_allocation);
     m_sizePerBuffer = 0;
-    m_mappedMemory = nullptr;
 }
 
 VkDeviceSize VulkanMultiBuffer::_calculateOffset(size_t index) const {
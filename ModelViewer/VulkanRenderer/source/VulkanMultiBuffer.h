@@ -1,5 +1,7 @@
 #pragma once
 
+#include "VulkanMemoryAllocator.h"
+
 namespace Vulkan {
 
 class RendererImpl;
@@ -18,8 +20,10 @@ public:
     VkBuffer GetVkBuffer(size_t index) const;
     size_t GetVkBufferCount() const;
     VkDeviceMemory GetVkDeviceMemory() const;
+    VkDeviceSize GetMemoryOffset() const;
+
+    // Host visible memory stays mapped for as long as it is allocated
     void *GetMappedMemory(size_t index) const;
-    void UnmapMemory();
 
     void Clear();
 
@@ -32,8 +36,7 @@ private:
     typedef std::vector<VkBuffer> BufferArray;
     VkDeviceSize m_sizePerBuffer;
     BufferArray m_vkBuffers;
-    VkDeviceMemory m_vkMemory;
-    mutable void *m_mappedMemory;
+    VulkanMemoryAllocator::Allocation m_allocation;
 };
 
 } // namespace Vulkan
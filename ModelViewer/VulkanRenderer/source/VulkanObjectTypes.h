@@ -5,6 +5,10 @@ namespace Vulkan {
 enum RenderableObjectType {
     RENDERABLE_OBJECT_TYPE_STATIC_MODEL_TEXTURED = 0,
 
+    // Same descriptor set layout as RENDERABLE_OBJECT_TYPE_STATIC_MODEL_TEXTURED, only the vertex input differs
+    RENDERABLE_OBJECT_TYPE_STATIC_MODEL_TEXTURED_COMPACT,
+    RENDERABLE_OBJECT_TYPE_STATIC_MODEL_TEXTURED_COMPACT_COLOR,
+
     RENDERABLE_OBJECT_TYPE_COUNT
 };
 
@@ -10,7 +10,9 @@ VulkanPhysicalDevice::VulkanPhysicalDevice()
     : m_api(nullptr),
     m_device(0),
     m_vkProperties({}),
-    m_vkFeatures({}) {
+    m_vkFeatures({}),
+    m_vkDescriptorIndexingFeatures({}),
+    m_vkDescriptorIndexingProperties({}) {
 }
 
 VulkanPhysicalDevice::~VulkanPhysicalDevice() {
@@ -67,6 +69,18 @@ bool VulkanPhysicalDevice::SupportsFeature(char const *featureName, Graphics::Re
         return m_vkFeatures.samplerAnisotropy;
     }
 
+    if (strcmp(featureName, FEATURE_TEXTURE_COMPRESSION_BC) == 0) {
+        return m_vkFeatures.textureCompressionBC;
+    }
+
+    if (strcmp(featureName, FEATURE_DESCRIPTOR_INDEXING) == 0) {
+        // Only what the bindless texture array uses, texture indices are uniform within a draw so non-uniform indexing is not needed
+        return m_vkDescriptorIndexingFeatures.runtimeDescriptorArray &&
+            m_vkDescriptorIndexingFeatures.descriptorBindingPartiallyBound &&
+            m_vkDescriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+            m_vkDescriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending;
+    }
+
     // Unknown feature
     ERROR_MSG(L"Unknown feature name: %hs", featureName);
     return false;
@@ -85,6 +99,21 @@ Graphics::GraphicsError VulkanPhysicalDevice::Initialize(APIImpl *api, VkPhysica
     vkGetPhysicalDeviceProperties(m_device, &m_vkProperties);
     vkGetPhysicalDeviceFeatures(m_device, &m_vkFeatures);
 
+    // Descriptor indexing is core since Vulkan 1.2
+    if (m_vkProperties.apiVersion >= VK_API_VERSION_1_2) {
+        m_vkDescriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &m_vkDescriptorIndexingFeatures;
+        vkGetPhysicalDeviceFeatures2(m_device, &features2);
+
+        m_vkDescriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &m_vkDescriptorIndexingProperties;
+        vkGetPhysicalDeviceProperties2(m_device, &properties2);
+    }
+
     LOG_INFO("\t%s (%u) %u\n\t\tVendor: %u\n\t\tApi Version: %u\n\t\tDriver Version: %u\n",
         m_vkProperties.deviceName, m_vkProperties.deviceID, m_vkProperties.deviceType,
         m_vkProperties.vendorID,
@@ -269,4 +298,8 @@ const VkPhysicalDeviceLimits &VulkanPhysicalDevice::GetDeviceLimits() const {
     return m_vkProperties.limits;
 }
 
+const VkPhysicalDeviceDescriptorIndexingProperties &VulkanPhysicalDevice::GetDescriptorIndexingProperties() const {
+    return m_vkDescriptorIndexingProperties;
+}
+
 } // namespace Vulkan
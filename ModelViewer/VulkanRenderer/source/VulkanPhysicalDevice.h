@@ -37,12 +37,15 @@ public:
     std::optional<VulkanSwapChain> GetSupportedSurfaceDescription(int surfaceIndex, Graphics::RendererRequirements *requirements) const;
 
     const VkPhysicalDeviceLimits &GetDeviceLimits() const;
+    const VkPhysicalDeviceDescriptorIndexingProperties &GetDescriptorIndexingProperties() const;
 
 private:
     APIImpl *m_api;
     VkPhysicalDevice m_device;
     VkPhysicalDeviceProperties m_vkProperties;
     VkPhysicalDeviceFeatures m_vkFeatures;
+    VkPhysicalDeviceDescriptorIndexingFeatures m_vkDescriptorIndexingFeatures;
+    VkPhysicalDeviceDescriptorIndexingProperties m_vkDescriptorIndexingProperties;
 
     typedef std::vector<VkExtensionProperties> ExtensionList;
     ExtensionList m_supportedExtensions;
@@ -13,6 +13,9 @@
 
 namespace Vulkan {
 
+// Has to be a power of 2, see VulkanStagingRing::Initialize
+static const VkDeviceSize STAGING_RING_SIZE = 32 * 1024 * 1024;
+
 RendererImpl::RendererImpl()
   : m_api(nullptr),
     m_physicalDevice(nullptr),
@@ -23,7 +26,10 @@ RendererImpl::RendererImpl()
     m_commandPools{},
     m_transferCommandPools{},
     m_swapChainOutOfDate(0),
-    m_useValidation(false) {
+    m_useValidation(false),
+    m_assetCache(this),
+    m_memoryAllocator(this),
+    m_stagingRing(this) {
 }
 
 RendererImpl::~RendererImpl() {
@@ -41,6 +47,9 @@ Graphics::GraphicsError RendererImpl::Initialize(API *api, VulkanPhysicalDevice
     auto useValidationOption = requirements->GetBoolean(JSON_REQ_USE_VALIDATION);
     m_useValidation = useValidationOption.has_value() ? useValidationOption.value() : false;
 
+    // The thread that submits work to the pool also runs tasks, so leave one hardware thread for it
+    m_workerThreadPool.Initialize(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+
     // Get the combined list of required and optional features
     std::set<std::string> features;
     auto requiredFeatures = requirements->GetArray(JSON_REQ_FEATURES_REQUIRED);
@@ -61,6 +70,8 @@ Graphics::GraphicsError RendererImpl::Initialize(API *api, VulkanPhysicalDevice
     std::optional<uint32_t> queueIndices[QueueType::QUEUE_COUNT] = {};
     std::set<uint32_t> uniqueQueues;
     VkPhysicalDeviceFeatures deviceFeatures{};
+    VkPhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures{};
+    descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
     for (auto &it : features) {
         if (it == FEATURE_IS_DISCRETE_GPU) {
             // Nothing to do
@@ -119,6 +130,23 @@ Graphics::GraphicsError RendererImpl::Initialize(API *api, VulkanPhysicalDevice
             }
             deviceFeatures.samplerAnisotropy = true;
         }
+        else if (it == FEATURE_TEXTURE_COMPRESSION_BC) {
+            if (!m_physicalDevice->SupportsFeature(FEATURE_TEXTURE_COMPRESSION_BC, m_requirements)) {
+                LOG_ERROR("BC texture compression required but not supported\n");
+                return Graphics::GraphicsError::NO_SUPPORTED_DEVICE;
+            }
+            deviceFeatures.textureCompressionBC = true;
+        }
+        else if (it == FEATURE_DESCRIPTOR_INDEXING) {
+            if (!m_physicalDevice->SupportsFeature(FEATURE_DESCRIPTOR_INDEXING, m_requirements)) {
+                LOG_ERROR("Descriptor indexing required but not supported\n");
+                return Graphics::GraphicsError::NO_SUPPORTED_DEVICE;
+            }
+            descriptorIndexingFeatures.runtimeDescriptorArray = true;
+            descriptorIndexingFeatures.descriptorBindingPartiallyBound = true;
+            descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = true;
+            descriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending = true;
+        }
         else {
             ERROR_MSG(L"Unknown feature name: %hs", it.c_str());
         }
@@ -162,6 +190,11 @@ Graphics::GraphicsError RendererImpl::Initialize(API *api, VulkanPhysicalDevice
     sync2Features.synchronization2 = true;
     createInfo.pNext = &sync2Features;
 
+    // Only chained when used, devices below Vulkan 1.2 may not know the structure
+    if (features.find(FEATURE_DESCRIPTOR_INDEXING) != features.end()) {
+        sync2Features.pNext = &descriptorIndexingFeatures;
+    }
+
     // Require fillModeNonSolid
     deviceFeatures.fillModeNonSolid = true;
 
@@ -181,6 +214,12 @@ Graphics::GraphicsError RendererImpl::Initialize(API *api, VulkanPhysicalDevice
         LOG_ERROR("vkCreateDevice failed: %d\n", vkResult);
         return VulkanErrorToGraphicsError(vkResult);
     }
+    m_enabledFeatures = std::move(features);
+    m_memoryAllocator.Initialize();
+
+    if (m_stagingRing.Initialize(STAGING_RING_SIZE) != Graphics::GraphicsError::OK) {
+        LOG_ERROR("Unable to create staging ring, uploads will use staging buffers of their own\n");
+    }
 
     for (int i = 0; i < QueueType::QUEUE_COUNT; ++i) {
         if (queueIndices[i]) {
@@ -233,6 +272,13 @@ Graphics::GraphicsError RendererImpl::Initialize(API *api, VulkanPhysicalDevice
 Graphics::GraphicsError RendererImpl::Finalize() {
     ASSERT(m_api->m_vkInstance);
 
+    m_workerThreadPool.Finalize();
+
+    // Scenes are finalized first so every asset should have been released by now
+    m_assetCache.LogStats();
+    m_memoryAllocator.LogStats();
+    m_stagingRing.LogStats();
+
     vkDeviceWaitIdle(m_device);
 
     std::set<VkCommandPool> uniquePools;
@@ -257,6 +303,9 @@ Graphics::GraphicsError RendererImpl::Finalize() {
     }
     _cleanupSwapChain(-1);
 
+    m_stagingRing.Finalize();
+    m_memoryAllocator.Finalize();
+
     if (m_device) {
         vkDestroyDevice(m_device, VK_NULL_HANDLE);
         m_device = VK_NULL_HANDLE;
@@ -290,44 +339,47 @@ Graphics::GraphicsError RendererImpl::Update(f64 deltaTime) {
     /* Transfer command submission */
     // Check if any transfer commands need to be submitted
     if (!m_registeredTransfers.empty()) {
+        // Transfers registered by the transfer funcs themselves wait for the next update
+        TransferFunctions transfers;
+        transfers.swap(m_registeredTransfers);
+
         // Reserve the required amount of memory for all command buffers
         size_t totalCommandBufferCount = 0;
-        for (auto &transferFunc : m_registeredTransfers) {
+        for (auto &transferFunc : transfers) {
             totalCommandBufferCount += transferFunc.commandBufferCount;
         }
         m_activeTransferCommandBuffers.reserve(totalCommandBufferCount);
 
-        for (size_t i = 0; i < m_registeredTransfers.size(); ++i) {
+        for (size_t i = 0; i < transfers.size(); ++i) {
             // Create command buffers for each transfer func
             size_t startIndex = m_activeTransferCommandBuffers.size();
-            auto err = _allocateTransferCommandBuffers(m_registeredTransfers[i].queue, static_cast<uint32_t>(m_registeredTransfers[i].commandBufferCount), &m_activeTransferCommandBuffers);
+            auto err = _allocateTransferCommandBuffers(transfers[i].queue, static_cast<uint32_t>(transfers[i].commandBufferCount), &m_activeTransferCommandBuffers);
             if (err != Graphics::GraphicsError::OK) {
                 // Call the error func then remove this transfer func
-                m_registeredTransfers[i].errorFunc();
-                m_registeredTransfers.erase(m_registeredTransfers.begin() + i);
+                transfers[i].errorFunc();
+                transfers.erase(transfers.begin() + i);
                 --i;
                 continue;
             }
 
             // Call the beginFunc of the transfer
-            err = m_registeredTransfers[i].beginFunc(&m_activeTransferCommandBuffers.at(startIndex));
+            err = transfers[i].beginFunc(&m_activeTransferCommandBuffers.at(startIndex));
             if (err != Graphics::GraphicsError::OK) {
                 // No additional calls to the transfer func
-                m_registeredTransfers.erase(m_registeredTransfers.begin() + i);
+                transfers.erase(transfers.begin() + i);
                 --i;
                 continue;
             }
-            m_registeredTransfers[i].commandBufferIndex = startIndex;
+            transfers[i].commandBufferIndex = startIndex;
         }
 
         // Call the endFunc of each transfer after all beginFuncs have been called
-        for (size_t i = 0; i < m_registeredTransfers.size(); ++i) {
+        for (size_t i = 0; i < transfers.size(); ++i) {
             // Ignore any errors as there will be no other calls to the transfer func regardless
-            m_registeredTransfers[i].endFunc(&m_activeTransferCommandBuffers.at(m_registeredTransfers[i].commandBufferIndex));
+            transfers[i].endFunc(&m_activeTransferCommandBuffers.at(transfers[i].commandBufferIndex));
         }
 
-        // Clean up transfer funcs and command buffers
-        m_registeredTransfers.clear();
+        // Clean up command buffers
         _freeTransferCommandBuffers(&m_activeTransferCommandBuffers);
 
         // Try to minimize amount of device memory held in cache
@@ -666,6 +718,10 @@ VulkanPhysicalDevice *RendererImpl::GetPhysicalDevice() const {
     return m_physicalDevice;
 }
 
+bool RendererImpl::IsFeatureEnabled(char const *featureName) const {
+    return m_enabledFeatures.find(featureName) != m_enabledFeatures.end();
+}
+
 Graphics::RendererRequirements *RendererImpl::GetRequirements() const {
     return m_requirements;
 }
@@ -674,6 +730,22 @@ uint32_t RendererImpl::GetQueueIndex(QueueType type) const {
     return m_queueIndices[type];
 }
 
+Graphics::ThreadPool *RendererImpl::GetWorkerThreadPool() {
+    return &m_workerThreadPool;
+}
+
+VulkanAssetCache *RendererImpl::GetAssetCache() {
+    return &m_assetCache;
+}
+
+VulkanMemoryAllocator *RendererImpl::GetMemoryAllocator() {
+    return &m_memoryAllocator;
+}
+
+VulkanStagingRing *RendererImpl::GetStagingRing() {
+    return &m_stagingRing;
+}
+
 VkQueue RendererImpl::GetQueue(QueueType type) const {
     return m_queues[type];
 }
@@ -2,6 +2,10 @@
 
 #include "base/Renderer_Base.h"
 #include "VulkanPhysicalDevice.h"
+#include "VulkanAssetCache.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanStagingRing.h"
+#include "ThreadPool.h"
 #include <vector>
 
 namespace Graphics {
@@ -52,12 +56,28 @@ public:
     VulkanPhysicalDevice *GetPhysicalDevice() const;
     Graphics::RendererRequirements *GetRequirements() const;
 
+    // Whether a required or supported optional feature was enabled on the device
+    bool IsFeatureEnabled(char const *featureName) const;
+
     uint32_t GetQueueIndex(QueueType type) const;
     VkQueue GetQueue(QueueType type) const;
 
+    // Worker threads for CPU heavy work such as parsing model files
+    Graphics::ThreadPool *GetWorkerThreadPool();
+
+    // Meshes, textures and samplers shared between every scene of this renderer
+    VulkanAssetCache *GetAssetCache();
+
+    // Device memory of every buffer and image of this renderer
+    VulkanMemoryAllocator *GetMemoryAllocator();
+
+    // Host visible memory shared by uploads, see VulkanStagingBuffer
+    VulkanStagingRing *GetStagingRing();
+
     // Allows batch submitting one time queue operations before the next Update step
     // When called in the EarlyUpdate step, registered functions will execute in the same frame
     // Otherwise registered functions will execute in the next frame
+    // Functions registered from a beginFunc or endFunc execute in the next frame
     // beginFunc is called at the start to record commands
     // endFunc is called after all commands have been submitted, with the same command buffers as beginFunc
     // Note that the commands are not guaranteed to have executed yet during endFunc
@@ -102,6 +122,7 @@ private:
     VulkanPhysicalDevice *m_physicalDevice;
     VkDevice m_device;
     Graphics::RendererRequirements *m_requirements;
+    std::set<std::string> m_enabledFeatures;
 
     typedef std::vector<std::pair<Graphics::Renderer_Base::OnDestroySwapChainFn, Graphics::Renderer_Base::OnCreateSwapChainFn>> SwapChainFuncArray;
     SwapChainFuncArray m_swapChainFuncs;
@@ -123,6 +144,11 @@ private:
 
     bool m_useValidation;
 
+    Graphics::ThreadPool m_workerThreadPool;
+    VulkanAssetCache m_assetCache;
+    VulkanMemoryAllocator m_memoryAllocator;
+    VulkanStagingRing m_stagingRing;
+
     typedef std::vector<char const*> StringLiteralArray;
     StringLiteralArray m_vkExtensionsList;
     StringLiteralArray m_vkLayersList;
@@ -2,6 +2,7 @@
 #include "VulkanRendererSceneImpl_Basic.h"
 #include "VulkanRendererImpl.h"
 #include "VulkanDescriptorSetInstance.h"
+#include "VulkanFeaturesDefines.h"
 
 #include "VulkanPipeline.h"
 #include "glm/gtc/matrix_transform.hpp"
@@ -12,9 +13,13 @@ namespace Vulkan {
 RendererSceneImpl_Basic::RendererSceneImpl_Basic(RendererImpl *parentRenderer)
   : m_renderer(parentRenderer),
     m_vertexShader(parentRenderer),
+    m_compactVertexShader(parentRenderer),
+    m_compactColorVertexShader(parentRenderer),
     m_fragmentShader(parentRenderer),
+    m_bindlessFragmentShader(parentRenderer),
     m_renderPass(parentRenderer),
     m_depthBuffer(parentRenderer),
+    m_placeholder(nullptr),
     m_descriptorSetLayout(RENDERABLE_OBJECT_TYPE_COUNT, nullptr),
     m_pipeline(RENDERABLE_OBJECT_TYPE_COUNT, nullptr),
     m_perFrameDescriptorSetLayout(parentRenderer),
@@ -22,6 +27,8 @@ RendererSceneImpl_Basic::RendererSceneImpl_Basic(RendererImpl *parentRenderer)
     m_perFrameDescriptorSet{},
     m_persistentDescriptorPool(parentRenderer),
     m_perFrameDescriptorPool{},
+    m_textureStreamer(parentRenderer, FRAMES_IN_FLIGHT),
+    m_bindlessTextures(nullptr),
     m_curFrameIndex(0),
     m_curSwapChainImageIndex(0),
     m_commandBuffers{} {
@@ -50,12 +57,35 @@ Graphics::GraphicsError RendererSceneImpl_Basic::Initialize() {
         return Graphics::GraphicsError::INITIALIZATION_FAILED;
     }
 
+    m_compactVertexShader.SetShaderStage(VK_SHADER_STAGE_VERTEX_BIT);
+    m_compactVertexShader.CreateFromSpirv("resources/compact-vert.spv");
+    if (!m_compactVertexShader.GetLastError().empty()) {
+        LOG_ERROR(L"  Compact vertex shader creation error: %hs\n", m_compactVertexShader.GetLastError().c_str());
+        return Graphics::GraphicsError::INITIALIZATION_FAILED;
+    }
+
+    m_compactColorVertexShader.SetShaderStage(VK_SHADER_STAGE_VERTEX_BIT);
+    m_compactColorVertexShader.CreateFromSpirv("resources/compact-color-vert.spv");
+    if (!m_compactColorVertexShader.GetLastError().empty()) {
+        LOG_ERROR(L"  Compact color vertex shader creation error: %hs\n", m_compactColorVertexShader.GetLastError().c_str());
+        return Graphics::GraphicsError::INITIALIZATION_FAILED;
+    }
+
     m_fragmentShader.SetShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT);
     m_fragmentShader.CreateFromSpirv("resources/basic-frag.spv");
     if (!m_fragmentShader.GetLastError().empty()) {
         LOG_ERROR(L"  Fragment shader creation error: %hs\n", m_fragmentShader.GetLastError().c_str());
         return Graphics::GraphicsError::INITIALIZATION_FAILED;
     }
+
+    if (m_renderer->IsFeatureEnabled(FEATURE_DESCRIPTOR_INDEXING)) {
+        m_bindlessFragmentShader.SetShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT);
+        m_bindlessFragmentShader.CreateFromSpirv("resources/bindless-frag.spv");
+        if (!m_bindlessFragmentShader.GetLastError().empty()) {
+            LOG_ERROR(L"  Bindless fragment shader creation error: %hs\n", m_bindlessFragmentShader.GetLastError().c_str());
+            return Graphics::GraphicsError::INITIALIZATION_FAILED;
+        }
+    }
     LOG_INFO("Shaders loaded successfully\n");
 #pragma endregion
 
@@ -78,9 +108,20 @@ Graphics::GraphicsError RendererSceneImpl_Basic::Initialize() {
         return Graphics::GraphicsError::DESCRIPTOR_SET_CREATE_ERROR;
     }
 
-    m_persistentDescriptorPool.AddDescriptorLayout(m_descriptorSetLayout[RENDERABLE_OBJECT_TYPE_STATIC_MODEL_TEXTURED], 1);
+    // Models allocate one set per material texture
+    m_persistentDescriptorPool.AddDescriptorLayout(m_descriptorSetLayout[RENDERABLE_OBJECT_TYPE_STATIC_MODEL_TEXTURED]);
     m_persistentDescriptorPool.Initialize();
 
+    // Unless every texture goes in one bindless set, which stays bound between draws of different textures
+    if (m_renderer->IsFeatureEnabled(FEATURE_DESCRIPTOR_INDEXING)) {
+        m_bindlessTextures = new VulkanBindlessTextureSet(m_renderer, FRAMES_IN_FLIGHT);
+        if (m_bindlessTextures->Initialize(BINDLESS_TEXTURE_SLOT_COUNT) != Graphics::GraphicsError::OK) {
+            LOG_ERROR(L"  Failed to create bindless texture descriptor set\n");
+            return Graphics::GraphicsError::DESCRIPTOR_SET_CREATE_ERROR;
+        }
+        LOG_INFO(L"  Using bindless textures with %u slots\n", m_bindlessTextures->GetSlotCount());
+    }
+
     // Create descriptor pools and descriptor sets for each frame in flight
     for (size_t i = 0; i < FRAMES_IN_FLIGHT; ++i) {
         m_perFrameDescriptorSet[i] = new VulkanDescriptorSetInstance(m_renderer);
@@ -179,10 +220,10 @@ Graphics::GraphicsError RendererSceneImpl_Basic::Initialize() {
     pipeline->SetInputPrimitiveRestart(false);
 
     pipeline->SetShaderStage(&m_vertexShader, "main");
-    pipeline->SetShaderStage(&m_fragmentShader, "main");
+    pipeline->SetShaderStage(m_bindlessTextures ? &m_bindlessFragmentShader : &m_fragmentShader, "main");
 
     pipeline->SetDescriptorSet(0, &m_perFrameDescriptorSetLayout);
-    pipeline->SetDescriptorSet(1, m_descriptorSetLayout[RENDERABLE_OBJECT_TYPE_STATIC_MODEL_TEXTURED]);
+    pipeline->SetDescriptorSet(1, m_bindlessTextures ? m_bindlessTextures->GetDescriptorSetLayout() : m_descriptorSetLayout[RENDERABLE_OBJECT_TYPE_STATIC_MODEL_TEXTURED]);
     pipeline->AddPushConstantRange(0, sizeof(glm::mat4x4) + sizeof(glm::mat4x4), VK_SHADER_STAGE_VERTEX_BIT);
 
     pipeline->SetDepthClampEnable(false);
@@ -223,16 +264,27 @@ Graphics::GraphicsError RendererSceneImpl_Basic::Initialize() {
     pipeline->SetColorBlendLogicOp(false, VK_LOGIC_OP_COPY);
     pipeline->SetColorBlendConstants(0.0f, 0.0f, 0.0f, 0.0f);
 
-    if (pipeline->CreatePipeline(nullptr) != Graphics::GraphicsError::OK) {
+    auto err = pipeline->CreatePipeline(nullptr);
+    if (err != Graphics::GraphicsError::OK) {
         LOG_ERROR(L"  Failed to create 'StaticModelTextured' pipeline\n");
         return Graphics::GraphicsError::INITIALIZATION_FAILED;
     }
 
+    // Compact vertex layouts only change the vertex input and vertex shader
+    err = _createStaticModelPipelineVariant<VulkanTexturedVertexCompact>(RENDERABLE_OBJECT_TYPE_STATIC_MODEL_TEXTURED_COMPACT, &m_compactVertexShader, "StaticModelTexturedCompact");
+    if (err != Graphics::GraphicsError::OK) {
+        return err;
+    }
+    err = _createStaticModelPipelineVariant<VulkanTexturedVertexCompactColor>(RENDERABLE_OBJECT_TYPE_STATIC_MODEL_TEXTURED_COMPACT_COLOR, &m_compactColorVertexShader, "StaticModelTexturedCompactColor");
+    if (err != Graphics::GraphicsError::OK) {
+        return err;
+    }
+
     LOG_INFO(L"Pipelines created successfully\n");
 #pragma endregion
 
 #pragma region Frame buffers (swap chain)
-    auto err = _createSwapChainFrameBuffers(swapChain);
+    err = _createSwapChainFrameBuffers(swapChain);
     if (err != Graphics::GraphicsError::OK) {
         LOG_ERROR(L"  Failed to create frame buffer for swap chain\n");
         return Graphics::GraphicsError::INITIALIZATION_FAILED;
@@ -280,9 +332,15 @@ Graphics::GraphicsError RendererSceneImpl_Basic::Initialize() {
 
 #pragma region Scene object creation
     LOG_INFO(L"Creating scene objects\n");
+    // The placeholder is tiny and loaded up front so it is ready for the first frame
+    m_placeholder = new VulkanStaticModelTextured(this);
+    if (m_placeholder->LoadPlaceholder() != Graphics::GraphicsError::OK) {
+        LOG_ERROR(L"  Failed to create placeholder model\n");
+        return Graphics::GraphicsError::INITIALIZATION_FAILED;
+    }
+
     // Create one static model
-    auto *newObj = m_objects.emplace_back(new VulkanStaticModelTextured(this));
-    newObj->LoadFromObjFile("resources/viking_room.obj");
+    AddModelAsync("resources/viking_room.obj");
 
     //TODO: Move object initialization elsewhere
     m_camera.SetPosition(0.0f, 2.0f, -2.0f);
@@ -303,6 +361,8 @@ Graphics::GraphicsError RendererSceneImpl_Basic::Finalize() {
         delete object;
         object = nullptr;
     }
+    delete m_placeholder;
+    m_placeholder = nullptr;
 
     for (size_t i = 0; i < FRAMES_IN_FLIGHT; ++i) {
         delete m_commandBuffers[i];
@@ -327,6 +387,8 @@ Graphics::GraphicsError RendererSceneImpl_Basic::Finalize() {
             layout = nullptr;
         }
     }
+    delete m_bindlessTextures;
+    m_bindlessTextures = nullptr;
     m_renderPass.ResetResources();
 
     for (size_t i = 0; i < FRAMES_IN_FLIGHT; ++i) {
@@ -374,6 +436,25 @@ Graphics::GraphicsError RendererSceneImpl_Basic::EarlyUpdate(f64 deltaTime) {
         }
     }
 
+    // Objects that finished loading register their uploads here so they run before this frame is drawn
+    // A failed load only leaves its object empty
+    for (auto *object : m_objects) {
+        if (object->UpdateLoading() != Graphics::GraphicsError::OK) {
+            LOG_ERROR(L"Failed to upload a loaded model\n");
+        }
+    }
+
+    // Bindless slots freed by frames that are done can be written again
+    if (m_bindlessTextures) {
+        m_bindlessTextures->Update();
+    }
+
+    // Levels requested while drawing the last frame are uploaded before this one is drawn
+    // Failed uploads leave their textures at the levels they had
+    if (m_textureStreamer.Update() != Graphics::GraphicsError::OK) {
+        LOG_ERROR(L"Failed to stream texture levels\n");
+    }
+
     return Graphics::GraphicsError::OK;
 }
 
@@ -426,9 +507,11 @@ Graphics::GraphicsError RendererSceneImpl_Basic::Update(f64 deltaTime) {
     vkCmdBeginRenderPass(m_commandBuffers[m_curFrameIndex]->GetVkCommandBuffer(), &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 #if 1
-    // Render all objects
+    // Render all objects, objects that are still loading are drawn as the placeholder
     for (auto *object : m_objects) {
-        err = object->Draw(deltaTime);
+        VulkanStaticModelTextured::LoadState loadState = object->GetLoadState();
+        bool isLoading = loadState == VulkanStaticModelTextured::LOAD_STATE_IMPORTING || loadState == VulkanStaticModelTextured::LOAD_STATE_IMPORTED;
+        err = (isLoading ? m_placeholder : object)->Draw(deltaTime);
         if (err != Graphics::GraphicsError::OK) {
             return err;
         }
@@ -480,6 +563,18 @@ Graphics::Camera *RendererSceneImpl_Basic::GetCamera() {
     return &m_camera;
 }
 
+f32 RendererSceneImpl_Basic::GetViewportHeight() const {
+    return static_cast<f32>(m_renderer->m_swapchains[0].GetExtents().height);
+}
+
+VulkanStaticModelTextured *RendererSceneImpl_Basic::AddModelAsync(std::string const &filePath) {
+    auto *object = m_objects.emplace_back(new VulkanStaticModelTextured(this));
+    if (object->LoadFromFileAsync(filePath) != Graphics::GraphicsError::OK) {
+        LOG_ERROR(L"Failed to start loading %hs\n", filePath.c_str());
+    }
+    return object;
+}
+
 RendererImpl *RendererSceneImpl_Basic::GetRenderer() {
     return m_renderer;
 }
@@ -496,6 +591,14 @@ VulkanDescriptorSetAllocator *RendererSceneImpl_Basic::GetPersistentDescriptorPo
     return &m_persistentDescriptorPool;
 }
 
+VulkanTextureStreamer *RendererSceneImpl_Basic::GetTextureStreamer() {
+    return &m_textureStreamer;
+}
+
+VulkanBindlessTextureSet *RendererSceneImpl_Basic::GetBindlessTextureSet() {
+    return m_bindlessTextures;
+}
+
 VulkanDescriptorSetAllocator *RendererSceneImpl_Basic::GetPerFrameDescriptorPool() {
     return m_perFrameDescriptorPool[m_curFrameIndex];
 }
@@ -504,11 +607,19 @@ VulkanCommandBuffer *RendererSceneImpl_Basic::GetMainCommandBuffer() {
     return m_commandBuffers[m_curFrameIndex];
 }
 
+size_t RendererSceneImpl_Basic::GetCurrentFrameIndex() const {
+    return m_curFrameIndex;
+}
+
 void RendererSceneImpl_Basic::CommandBindPipeline(VulkanCommandBuffer *commandBuffer, VulkanPipeline *pipeline) {
     auto &swapChain = m_renderer->m_swapchains[0];
 
     vkCmdBindPipeline(commandBuffer->GetVkCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->GetVkPipeline());
-    vkCmdBindDescriptorSets(commandBuffer->GetVkCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->GetVkPipelineLayout(), 0, 1, &m_perFrameDescriptorSet[m_curFrameIndex]->GetVkDescriptorSet(), 0, nullptr);
+
+    // The bindless texture set is bound with the per frame set, models only pick slots from then on
+    VkDescriptorSet bindDescriptorSets[] = { m_perFrameDescriptorSet[m_curFrameIndex]->GetVkDescriptorSet(), m_bindlessTextures ? m_bindlessTextures->GetVkDescriptorSet() : VK_NULL_HANDLE };
+    uint32_t bindDescriptorSetCount = m_bindlessTextures ? 2 : 1;
+    vkCmdBindDescriptorSets(commandBuffer->GetVkCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->GetVkPipelineLayout(), 0, bindDescriptorSetCount, bindDescriptorSets, 0, nullptr);
 
     VkViewport viewport{};
     viewport.x = 0.0f;
@@ -564,9 +675,15 @@ void RendererSceneImpl_Basic::SetPipelineStateValue(const std::string &pipelineS
         return;
     }
 
-    //TODO: Hardcoded to static model pipeline
-    VulkanPipeline &pipeline = *m_pipeline[RENDERABLE_OBJECT_TYPE_STATIC_MODEL_TEXTURED];
+    //TODO: Hardcoded to static model pipelines, every vertex layout variant gets the same state
+    for (auto *staticModelPipeline : m_pipeline) {
+        if (staticModelPipeline) {
+            _setPipelineStateValue(*staticModelPipeline, pipelineState, pipelineStateValue);
+        }
+    }
+}
 
+void RendererSceneImpl_Basic::_setPipelineStateValue(VulkanPipeline &pipeline, const std::string &pipelineState, const std::string &pipelineStateValue) {
     if (pipelineState == "rasterizer.polygonMode") {
         if (pipelineStateValue == "VK_POLYGON_MODE_FILL") {
             pipeline.SetPolygonMode(VK_POLYGON_MODE_FILL);
@@ -594,6 +711,24 @@ void RendererSceneImpl_Basic::SetPipelineStateValue(const std::string &pipelineS
     }
 }
 
+template<class VertexType>
+Graphics::GraphicsError RendererSceneImpl_Basic::_createStaticModelPipelineVariant(RenderableObjectType type, VulkanShaderModule *vertexShader, const char *name) {
+    // Copies every state of the full pipeline but none of its resources
+    VulkanPipeline *pipeline = m_pipeline[type] = new VulkanPipeline(*m_pipeline[RENDERABLE_OBJECT_TYPE_STATIC_MODEL_TEXTURED]);
+
+    auto bindingDescription = VertexType::getBindingDescription();
+    auto attributeDescriptions = VertexType::getAttributeDescriptions();
+    pipeline->SetVertexInput(1, &bindingDescription,
+        static_cast<uint32_t>(attributeDescriptions.size()), attributeDescriptions.data());
+    pipeline->SetShaderStage(vertexShader, "main");
+
+    if (pipeline->CreatePipeline(nullptr) != Graphics::GraphicsError::OK) {
+        LOG_ERROR(L"  Failed to create '%hs' pipeline\n", name);
+        return Graphics::GraphicsError::INITIALIZATION_FAILED;
+    }
+    return Graphics::GraphicsError::OK;
+}
+
 Graphics::GraphicsError RendererSceneImpl_Basic::_onDestroySwapChain(int idx) {
     // Only using index 0
     if (idx == 0) {
@@ -12,6 +12,8 @@
 #include "Vulkan2DTextureBuffer.h"
 #include "VulkanSampler.h"
 #include "VulkanDepthStencilBuffer.h"
+#include "VulkanTextureStreamer.h"
+#include "VulkanBindlessTextureSet.h"
 #include "Camera.h"
 
 namespace Graphics {
@@ -25,8 +27,12 @@ class VulkanSwapChain;
 class VulkanStaticModelTextured;
 
 class RendererSceneImpl_Basic {
+public:
     static const size_t FRAMES_IN_FLIGHT = 3;
 
+    // Slots of the bindless texture set, fewer if the device limits are lower
+    static const uint32_t BINDLESS_TEXTURE_SLOT_COUNT = 4096;
+
 public:
     RendererSceneImpl_Basic(RendererImpl *parentRenderer);
     ~RendererSceneImpl_Basic();
@@ -39,6 +45,13 @@ public:
 
     Graphics::Camera *GetCamera();
 
+    // Height in pixels of the swap chain objects are drawn to, positive unlike the flipped viewport
+    f32 GetViewportHeight() const;
+
+    // Adds a model to the scene and starts loading it on the worker threads
+    // The model is drawn as a placeholder until its data is resident, the returned model stays owned by the scene
+    VulkanStaticModelTextured *AddModelAsync(std::string const &filePath);
+
     std::string GetPipelineStateValue(const std::string &pipelineState);
     void SetPipelineStateValue(const std::string &pipelineState, const std::string &pipelineStateValue);
 
@@ -48,10 +61,20 @@ public:
     VulkanDescriptorSetLayout *GetDescriptorSetLayout(RenderableObjectType type);
     VulkanDescriptorSetAllocator *GetPersistentDescriptorPool();
 
+    // Makes the levels of streaming textures resident as objects need them, updated every frame
+    VulkanTextureStreamer *GetTextureStreamer();
+
+    // Every texture of the scene when the device has the DESCRIPTOR_INDEXING feature, nullptr otherwise
+    // Static model pipelines then use it as descriptor set 1 and read the texture's slot from the draw's first instance
+    VulkanBindlessTextureSet *GetBindlessTextureSet();
+
 #pragma region Must be called during an update
     VulkanDescriptorSetAllocator *GetPerFrameDescriptorPool();
     VulkanCommandBuffer *GetMainCommandBuffer();
 
+    // Index of the frame in flight being recorded, its previous use has finished on the device
+    size_t GetCurrentFrameIndex() const;
+
     // Binds the pipeline and sets common dynamic states and descriptor sets
     void CommandBindPipeline(VulkanCommandBuffer *commandBuffer, VulkanPipeline *pipeline);
 #pragma endregion
@@ -62,6 +85,12 @@ private:
     Graphics::GraphicsError _createRenderPass(VulkanSwapChain &swapChain);
     Graphics::GraphicsError _createSwapChainFrameBuffers(VulkanSwapChain &swapChain);
 
+    void _setPipelineStateValue(VulkanPipeline &pipeline, const std::string &pipelineState, const std::string &pipelineStateValue);
+
+    // Creates a copy of the full textured model pipeline using another vertex layout and vertex shader
+    template<class VertexType>
+    Graphics::GraphicsError _createStaticModelPipelineVariant(RenderableObjectType type, VulkanShaderModule *vertexShader, const char *name);
+
 private:
     struct UBO {
         glm::mat4 viewProj;
@@ -69,6 +98,7 @@ private:
 
     //TODO: Should have a base object class
     std::vector<VulkanStaticModelTextured*> m_objects;
+    VulkanStaticModelTextured *m_placeholder; // Drawn in place of objects that are still loading
 
 private:
 
@@ -77,7 +107,10 @@ private:
     typedef std::vector<VkFramebuffer> FrameBufferArray;
 
     VulkanShaderModule m_vertexShader;
+    VulkanShaderModule m_compactVertexShader;
+    VulkanShaderModule m_compactColorVertexShader;
     VulkanShaderModule m_fragmentShader;
+    VulkanShaderModule m_bindlessFragmentShader;
     VulkanRenderPass m_renderPass;
     VulkanDepthStencilBuffer m_depthBuffer;
 
@@ -93,6 +126,9 @@ private:
     VulkanDescriptorSetAllocator m_persistentDescriptorPool;
     VulkanDescriptorSetAllocator *m_perFrameDescriptorPool[FRAMES_IN_FLIGHT];
 
+    VulkanTextureStreamer m_textureStreamer;
+    VulkanBindlessTextureSet *m_bindlessTextures;
+
     FrameBufferArray m_swapChainFramebuffers;
 
     size_t m_curFrameIndex;
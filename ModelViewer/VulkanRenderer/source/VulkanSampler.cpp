@@ -6,6 +6,8 @@
 
 namespace Vulkan {
 
+std::atomic<uint32_t> VulkanSampler::s_liveCount(0);
+
 VulkanSampler::VulkanSampler(RendererImpl *renderer)
   : m_renderer(renderer),
     m_sampler(VK_NULL_HANDLE),
@@ -25,6 +27,7 @@ VulkanSampler::VulkanSampler(RendererImpl *renderer)
     m_samplerProperties.maxAnisotropy = limits.maxSamplerAnisotropy;
     m_samplerProperties.compareEnable = VK_FALSE;
     m_samplerProperties.compareOp = VK_COMPARE_OP_ALWAYS;
+    m_samplerProperties.maxLod = VK_LOD_CLAMP_NONE; // Sample every mip level the texture has
     m_samplerProperties.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
     m_samplerProperties.unnormalizedCoordinates = VK_FALSE;
 }
@@ -32,6 +35,7 @@ VulkanSampler::VulkanSampler(RendererImpl *renderer)
 VulkanSampler::~VulkanSampler() {
     if (m_sampler) {
         vkDestroySampler(m_renderer->GetDevice(), m_sampler, VK_NULL_HANDLE);
+        --s_liveCount;
     }
 }
 
@@ -166,10 +170,25 @@ bool VulkanSampler::GetUnnormalizedCoordinates() const {
     return m_samplerProperties.unnormalizedCoordinates;
 }
 
+void VulkanSampler::SetProperties(VkSamplerCreateInfo const &properties) {
+    ASSERT(properties.sType == VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO);
+    ASSERT(!properties.pNext);
+    m_samplerProperties = properties;
+}
+
+VkSamplerCreateInfo const &VulkanSampler::GetProperties() const {
+    return m_samplerProperties;
+}
+
 Graphics::GraphicsError VulkanSampler::Initialize() {
+    ASSERT(!m_sampler);
+
     if (vkCreateSampler(m_renderer->GetDevice(), &m_samplerProperties, VK_NULL_HANDLE, &m_sampler) != VK_SUCCESS) {
+        LOG_ERROR("Failed to create sampler, %u of at most %u samplers live\n", GetLiveCount(),
+            m_renderer->GetPhysicalDevice()->GetDeviceLimits().maxSamplerAllocationCount);
         return Graphics::GraphicsError::INITIALIZATION_FAILED;
     }
+    ++s_liveCount;
 
     return Graphics::GraphicsError::OK;
 }
@@ -178,4 +197,8 @@ VkSampler VulkanSampler::GetVkSampler() const {
     return m_sampler;
 }
 
+uint32_t VulkanSampler::GetLiveCount() {
+    return s_liveCount;
+}
+
 } // namespace Vulkan
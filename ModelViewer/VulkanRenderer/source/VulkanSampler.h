@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+
 namespace Vulkan {
 
 class RendererImpl;
@@ -57,16 +59,26 @@ public:
     void SetUnnormalizedCoordinates(bool unnormalizedCoordinates);
     bool GetUnnormalizedCoordinates() const;
 
+    // Every setting at once, as passed to vkCreateSampler
+    // Extension structures are not supported, pNext must be null
+    void SetProperties(VkSamplerCreateInfo const &properties);
+    VkSamplerCreateInfo const &GetProperties() const;
+
     Graphics::GraphicsError Initialize();
 
     VkSampler GetVkSampler() const;
 
+    // Samplers created and not yet destroyed, devices limit this to maxSamplerAllocationCount
+    static uint32_t GetLiveCount();
+
 private:
 
     RendererImpl *m_renderer;
     VkSampler m_sampler;
     VkSamplerCreateInfo m_samplerProperties;
 
+    static std::atomic<uint32_t> s_liveCount;
+
 };
 
 } // namespace Vulkan
@@ -0,0 +1,264 @@
+#include "pch.h"
+#include "VulkanStagingBuffer.h"
+#include "VulkanRendererImpl.h"
+
+namespace Vulkan {
+
+// Small enough next to the ring that the space skipped when a chunk wraps around stays small
+static const VkDeviceSize MAX_CHUNK_SIZE = 4 * 1024 * 1024;
+
+const VkDeviceSize VulkanStagingBuffer::CHUNK_ALIGNMENT;
+
+VulkanStagingBuffer::VulkanStagingBuffer(RendererImpl *renderer)
+  : m_renderer(renderer),
+    m_roundIndex(0),
+    m_roundInOwnBuffer(false),
+    m_buffer(renderer) {
+    ASSERT(renderer);
+}
+
+VulkanStagingBuffer::~VulkanStagingBuffer() {
+    Clear();
+}
+
+VulkanStagingBuffer::VulkanStagingBuffer(VulkanStagingBuffer &&other) noexcept
+  : m_renderer(other.m_renderer),
+    m_chunks(std::move(other.m_chunks)),
+    m_placements(std::move(other.m_placements)),
+    m_round(std::move(other.m_round)),
+    m_roundIndex(other.m_roundIndex),
+    m_roundInOwnBuffer(other.m_roundInOwnBuffer),
+    m_hostMemory(std::move(other.m_hostMemory)),
+    m_buffer(std::move(other.m_buffer)) {
+    other.m_chunks.clear();
+    other.m_placements.clear();
+    other.m_round.clear();
+}
+
+VulkanStagingBuffer &VulkanStagingBuffer::operator=(VulkanStagingBuffer &&other) noexcept {
+    Clear();
+    m_renderer = other.m_renderer;
+    m_chunks = std::move(other.m_chunks);
+    m_placements = std::move(other.m_placements);
+    m_round = std::move(other.m_round);
+    m_roundIndex = other.m_roundIndex;
+    m_roundInOwnBuffer = other.m_roundInOwnBuffer;
+    m_hostMemory = std::move(other.m_hostMemory);
+    m_buffer = std::move(other.m_buffer);
+    other.m_chunks.clear();
+    other.m_placements.clear();
+    other.m_round.clear();
+
+    return *this;
+}
+
+Graphics::GraphicsError VulkanStagingBuffer::Allocate(VkDeviceSize size) {
+    std::vector<VkDeviceSize> chunkSizes;
+    for (VkDeviceSize offset = 0; offset < size; offset += MAX_CHUNK_SIZE) {
+        chunkSizes.push_back(std::min(MAX_CHUNK_SIZE, size - offset));
+    }
+    return Allocate(chunkSizes.data(), chunkSizes.size());
+}
+
+Graphics::GraphicsError VulkanStagingBuffer::Allocate(VkDeviceSize const *chunkSizes, size_t chunkCount) {
+    ASSERT(m_chunks.empty());
+    if (chunkCount == 0) {
+        return Graphics::GraphicsError::INITIALIZATION_FAILED;
+    }
+
+    // Chunks are reserved in order until the ring runs out of room, the rest wait on the host for a later round
+    VulkanStagingRing *ring = m_renderer->GetStagingRing();
+    VkDeviceSize sourceOffset = 0;
+    VkDeviceSize ownBufferSize = 0;
+    size_t hostSize = 0;
+    bool ringFull = false;
+    for (size_t i = 0; i < chunkCount; ++i) {
+        Chunk chunk{ sourceOffset, 0, chunkSizes[i], nullptr };
+        ChunkPlacement placement{};
+        if (chunkSizes[i] > ring->GetSize()) {
+            placement.State = CHUNK_IN_OWN_BUFFER;
+            ownBufferSize = (ownBufferSize + CHUNK_ALIGNMENT - 1) & ~(CHUNK_ALIGNMENT - 1);
+            chunk.BufferOffset = ownBufferSize;
+            ownBufferSize += chunkSizes[i];
+        }
+        else if (!ringFull && ring->Reserve(chunkSizes[i], CHUNK_ALIGNMENT, &placement.Slice)) {
+            placement.State = CHUNK_IN_RING;
+            chunk.BufferOffset = placement.Slice.Offset;
+            chunk.MappedMemory = placement.Slice.MappedMemory;
+        }
+        else {
+            ringFull = true;
+            placement.State = CHUNK_IN_HOST;
+            placement.HostOffset = hostSize;
+            hostSize += static_cast<size_t>(chunkSizes[i]);
+        }
+        m_chunks.push_back(chunk);
+        m_placements.push_back(placement);
+        sourceOffset += chunkSizes[i];
+    }
+
+    if (ownBufferSize > 0) {
+        auto err = _allocateOwnBuffer(ownBufferSize);
+        if (err != Graphics::GraphicsError::OK) {
+            Clear();
+            return err;
+        }
+    }
+    m_hostMemory.resize(hostSize);
+    for (size_t i = 0; i < m_chunks.size(); ++i) {
+        if (m_placements[i].State == CHUNK_IN_HOST) {
+            m_chunks[i].MappedMemory = m_hostMemory.data() + m_placements[i].HostOffset;
+        }
+    }
+
+    // The first round copies whatever found room in the ring, or the chunks too large for it
+    m_roundIndex = 0;
+    for (size_t i = 0; i < m_chunks.size(); ++i) {
+        if (m_placements[i].State == CHUNK_IN_RING) {
+            m_round.push_back(i);
+        }
+    }
+    if (m_round.empty()) {
+        for (size_t i = 0; i < m_chunks.size(); ++i) {
+            if (m_placements[i].State == CHUNK_IN_OWN_BUFFER) {
+                m_round.push_back(i);
+            }
+        }
+        m_roundInOwnBuffer = !m_round.empty();
+    }
+
+    return Graphics::GraphicsError::OK;
+}
+
+size_t VulkanStagingBuffer::GetChunkCount() const {
+    return m_chunks.size();
+}
+
+VulkanStagingBuffer::Chunk const &VulkanStagingBuffer::GetChunk(size_t index) const {
+    ASSERT(index < m_chunks.size());
+    return m_chunks[index];
+}
+
+VkBuffer VulkanStagingBuffer::GetVkBuffer() {
+    return m_roundInOwnBuffer ? m_buffer.GetVkBuffer() : m_renderer->GetStagingRing()->GetVkBuffer();
+}
+
+size_t VulkanStagingBuffer::GetRoundChunkCount() const {
+    return m_round.size();
+}
+
+VulkanStagingBuffer::Chunk const &VulkanStagingBuffer::GetRoundChunk(size_t index) const {
+    ASSERT(index < m_round.size());
+    return m_chunks[m_round[index]];
+}
+
+bool VulkanStagingBuffer::IsFirstRound() const {
+    return m_roundIndex == 0;
+}
+
+bool VulkanStagingBuffer::IsLastRound() const {
+    for (size_t i = 0; i < m_placements.size(); ++i) {
+        ChunkState state = m_placements[i].State;
+        bool inRound = m_roundInOwnBuffer ? state == CHUNK_IN_OWN_BUFFER : state == CHUNK_IN_RING;
+        if (state != CHUNK_COPIED && !inRound) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void VulkanStagingBuffer::NextRound() {
+    ASSERT(!IsLastRound());
+
+    VulkanStagingRing *ring = m_renderer->GetStagingRing();
+    for (size_t i : m_round) {
+        if (m_placements[i].State == CHUNK_IN_RING) {
+            ring->Release(m_placements[i].Slice);
+        }
+        m_placements[i].State = CHUNK_COPIED;
+    }
+    if (m_roundInOwnBuffer) {
+        m_buffer.Clear();
+    }
+    m_round.clear();
+    m_roundInOwnBuffer = false;
+    ++m_roundIndex;
+
+    // Chunks too large for the ring go next as they need no room in it
+    for (size_t i = 0; i < m_chunks.size(); ++i) {
+        if (m_placements[i].State == CHUNK_IN_OWN_BUFFER) {
+            m_round.push_back(i);
+        }
+    }
+    m_roundInOwnBuffer = !m_round.empty();
+    if (!m_roundInOwnBuffer) {
+        _stageHostChunks();
+    }
+}
+
+void VulkanStagingBuffer::Clear() {
+    if (!m_placements.empty()) {
+        VulkanStagingRing *ring = m_renderer->GetStagingRing();
+        for (auto const &placement : m_placements) {
+            if (placement.State == CHUNK_IN_RING) {
+                ring->Release(placement.Slice);
+            }
+        }
+        m_placements.clear();
+    }
+    m_chunks.clear();
+    m_round.clear();
+    m_roundIndex = 0;
+    m_roundInOwnBuffer = false;
+    std::vector<uint8_t>().swap(m_hostMemory);
+    m_buffer.Clear();
+}
+
+Graphics::GraphicsError VulkanStagingBuffer::_allocateOwnBuffer(VkDeviceSize size) {
+    // Cached memory is preferred for the same reason as in the ring
+    auto err = m_buffer.Initialize(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, nullptr, 0);
+    if (err == Graphics::GraphicsError::OK) {
+        err = m_buffer.Allocate(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+        if (err != Graphics::GraphicsError::OK) {
+            err = m_buffer.Allocate(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        }
+    }
+    uint8_t *mappedMemory = reinterpret_cast<uint8_t*>(m_buffer.GetMappedMemory());
+    if (err != Graphics::GraphicsError::OK || !mappedMemory) {
+        return err != Graphics::GraphicsError::OK ? err : Graphics::GraphicsError::INITIALIZATION_FAILED;
+    }
+
+    for (size_t i = 0; i < m_chunks.size(); ++i) {
+        if (m_placements[i].State == CHUNK_IN_OWN_BUFFER) {
+            m_chunks[i].MappedMemory = mappedMemory + m_chunks[i].BufferOffset;
+        }
+    }
+    return Graphics::GraphicsError::OK;
+}
+
+void VulkanStagingBuffer::_stageHostChunks() {
+    // Chunks keep their order, a chunk the ring has no room for holds back the ones after it
+    VulkanStagingRing *ring = m_renderer->GetStagingRing();
+    bool hostChunksLeft = false;
+    for (size_t i = 0; i < m_chunks.size(); ++i) {
+        ChunkPlacement &placement = m_placements[i];
+        if (placement.State != CHUNK_IN_HOST) {
+            continue;
+        }
+        if (hostChunksLeft || !ring->Reserve(m_chunks[i].Size, CHUNK_ALIGNMENT, &placement.Slice)) {
+            hostChunksLeft = true;
+            continue;
+        }
+        memcpy(placement.Slice.MappedMemory, m_hostMemory.data() + placement.HostOffset, static_cast<size_t>(m_chunks[i].Size));
+        placement.State = CHUNK_IN_RING;
+        m_chunks[i].BufferOffset = placement.Slice.Offset;
+        m_chunks[i].MappedMemory = placement.Slice.MappedMemory;
+        m_round.push_back(i);
+    }
+
+    if (!hostChunksLeft) {
+        std::vector<uint8_t>().swap(m_hostMemory);
+    }
+}
+
+} // namespace Vulkan
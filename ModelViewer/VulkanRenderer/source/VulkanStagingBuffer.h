@@ -0,0 +1,85 @@
+#pragma once
+
+#include "VulkanStagingRing.h"
+
+namespace Vulkan {
+
+class RendererImpl;
+
+// Host visible memory that one upload is written to before it is copied to the device
+// Every chunk is written once after Allocate, the copies then run in rounds of the chunks that fit in the renderer's staging ring together
+// Chunks the ring has no room for yet wait in host memory for a later round, after the chunks before them are copied and released
+// Only chunks larger than the whole ring get a buffer of their own, they are copied together in a round of their own
+class VulkanStagingBuffer {
+public:
+    // Chunks start at multiples of this, enough for any texel block and for buffer to image copies
+    static const VkDeviceSize CHUNK_ALIGNMENT = 16;
+
+    struct Chunk {
+        VkDeviceSize SourceOffset; // Where the chunk starts in the upload, chunks follow one another
+        VkDeviceSize BufferOffset; // In GetVkBuffer(), only valid while the chunk is in the current round
+        VkDeviceSize Size;
+        uint8_t *MappedMemory;     // Where the chunk is written after Allocate
+    };
+
+public:
+    VulkanStagingBuffer(RendererImpl *renderer);
+    VulkanStagingBuffer(VulkanStagingBuffer const &) = delete;
+    VulkanStagingBuffer &operator=(VulkanStagingBuffer const &) = delete;
+    ~VulkanStagingBuffer();
+
+    VulkanStagingBuffer(VulkanStagingBuffer &&other) noexcept;
+    VulkanStagingBuffer &operator=(VulkanStagingBuffer &&other) noexcept;
+
+    // Splits size into chunks small enough to share the ring with other uploads
+    Graphics::GraphicsError Allocate(VkDeviceSize size);
+
+    // One chunk per size, for data that has to stay in one piece
+    Graphics::GraphicsError Allocate(VkDeviceSize const *chunkSizes, size_t chunkCount);
+
+    size_t GetChunkCount() const;
+    Chunk const &GetChunk(size_t index) const;
+
+    // Chunks the current round copies from GetVkBuffer(), a round can be empty while other uploads fill the ring
+    VkBuffer GetVkBuffer();
+    size_t GetRoundChunkCount() const;
+    Chunk const &GetRoundChunk(size_t index) const;
+    bool IsFirstRound() const;
+    bool IsLastRound() const;
+
+    // Call once the copies of the current round have finished and it is not the last round
+    // Releases the round's chunks and moves as many of the waiting chunks as fit into the ring for the next one
+    void NextRound();
+
+    // Call once the copies of the last round have finished
+    void Clear();
+
+private:
+    enum ChunkState {
+        CHUNK_IN_RING,       // Reserved for the current round
+        CHUNK_IN_OWN_BUFFER, // Larger than the ring
+        CHUNK_IN_HOST,       // Waiting for room in the ring
+        CHUNK_COPIED,
+    };
+
+    struct ChunkPlacement {
+        ChunkState State;
+        VulkanStagingRing::Slice Slice; // While CHUNK_IN_RING
+        size_t HostOffset;              // In m_hostMemory while CHUNK_IN_HOST
+    };
+
+    Graphics::GraphicsError _allocateOwnBuffer(VkDeviceSize size);
+    void _stageHostChunks();
+
+private:
+    RendererImpl *m_renderer;
+    std::vector<Chunk> m_chunks;
+    std::vector<ChunkPlacement> m_placements; // One per chunk
+    std::vector<size_t> m_round;              // Chunks copied by the current round
+    uint32_t m_roundIndex;
+    bool m_roundInOwnBuffer;
+    std::vector<uint8_t> m_hostMemory;
+    VulkanBuffer m_buffer; // Chunks larger than the ring
+};
+
+} // namespace Vulkan
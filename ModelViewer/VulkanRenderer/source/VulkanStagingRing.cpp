@@ -0,0 +1,131 @@
+#include "pch.h"
+#include "VulkanStagingRing.h"
+#include "VulkanRendererImpl.h"
+
+namespace Vulkan {
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+VulkanStagingRing::VulkanStagingRing(RendererImpl *renderer)
+  : m_renderer(renderer),
+    m_buffer(renderer),
+    m_size(0),
+    m_mappedMemory(nullptr),
+    m_head(0),
+    m_tail(0),
+    m_firstReservationId(0),
+    m_stats{} {
+    ASSERT(renderer);
+}
+
+VulkanStagingRing::~VulkanStagingRing() {
+}
+
+Graphics::GraphicsError VulkanStagingRing::Initialize(VkDeviceSize size) {
+    ASSERT(m_size == 0);
+    ASSERT(size > 0 && (size & (size - 1)) == 0);
+
+    auto err = m_buffer.Initialize(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, nullptr, 0);
+    if (err != Graphics::GraphicsError::OK) {
+        return err;
+    }
+    // Textures are decoded straight into their slices and read back while their levels are generated, so cached memory is preferred
+    err = m_buffer.Allocate(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+    if (err != Graphics::GraphicsError::OK) {
+        err = m_buffer.Allocate(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    }
+    if (err != Graphics::GraphicsError::OK) {
+        m_buffer.Clear();
+        return err;
+    }
+
+    m_mappedMemory = reinterpret_cast<uint8_t*>(m_buffer.GetMappedMemory());
+    m_size = size;
+    return Graphics::GraphicsError::OK;
+}
+
+void VulkanStagingRing::Finalize() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_reservations.empty()) {
+        LOG_ERROR("Staging ring destroyed with %zu slices still reserved\n", m_reservations.size());
+    }
+    m_buffer.Clear();
+    m_mappedMemory = nullptr;
+    m_size = 0;
+}
+
+bool VulkanStagingRing::Reserve(VkDeviceSize size, VkDeviceSize alignment, Slice *outSlice) {
+    ASSERT(size > 0);
+    ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    ASSERT(outSlice);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (size > m_size || alignment > m_size) {
+        ++m_stats.RefusedCount;
+        return false;
+    }
+
+    // Slices do not wrap around the end of the ring, one that would is moved to the start of the next lap
+    uint64_t start = AlignUp(m_head, alignment);
+    if (start % m_size + size > m_size) {
+        start = AlignUp(start, m_size);
+    }
+    uint64_t end = start + size;
+    if (end - m_tail > m_size) {
+        ++m_stats.RefusedCount;
+        return false;
+    }
+
+    m_reservations.push_back({ end, false });
+    m_head = end;
+    ++m_stats.ReservedCount;
+    m_stats.PeakUsedSize = std::max(m_stats.PeakUsedSize, end - m_tail);
+
+    outSlice->Offset = start % m_size;
+    outSlice->Size = size;
+    outSlice->MappedMemory = m_mappedMemory + outSlice->Offset;
+    outSlice->Id = m_firstReservationId + m_reservations.size() - 1;
+    return true;
+}
+
+void VulkanStagingRing::Release(Slice const &slice) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ASSERT(slice.Id >= m_firstReservationId && slice.Id - m_firstReservationId < m_reservations.size());
+    m_reservations[static_cast<size_t>(slice.Id - m_firstReservationId)].Released = true;
+
+    while (!m_reservations.empty() && m_reservations.front().Released) {
+        m_tail = m_reservations.front().End;
+        m_reservations.pop_front();
+        ++m_firstReservationId;
+    }
+
+    // Once the ring is empty the next slice starts at the beginning again, without a wrap
+    if (m_reservations.empty()) {
+        m_head = 0;
+        m_tail = 0;
+    }
+}
+
+VkBuffer VulkanStagingRing::GetVkBuffer() {
+    return m_buffer.GetVkBuffer();
+}
+
+VkDeviceSize VulkanStagingRing::GetSize() const {
+    return m_size;
+}
+
+VulkanStagingRing::Stats VulkanStagingRing::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void VulkanStagingRing::LogStats() const {
+    Stats stats = GetStats();
+    LOG_INFO("Staging ring: %llu slices reserved, %llu refused, peak %.2f of %.2f MB\n",
+        static_cast<unsigned long long>(stats.ReservedCount), static_cast<unsigned long long>(stats.RefusedCount),
+        stats.PeakUsedSize / (1024.0 * 1024.0), m_size / (1024.0 * 1024.0));
+}
+
+} // namespace Vulkan
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "VulkanBuffer.h"
+#include <mutex>
+#include <deque>
+
+namespace Vulkan {
+
+class RendererImpl;
+
+// Renderer wide host visible buffer that uploads are staged in, so they do not create a staging buffer each
+// Slices are handed out one after another around the ring and stay mapped for as long as the ring lives
+// A slice is released once the copy out of it has finished, its space is reused once every slice reserved before it is released too
+// Safe to use from worker threads
+class VulkanStagingRing {
+public:
+    struct Slice {
+        VkDeviceSize Offset; // In GetVkBuffer()
+        VkDeviceSize Size;
+        uint8_t *MappedMemory;
+        uint64_t Id;
+    };
+
+    struct Stats {
+        uint64_t ReservedCount;
+        uint64_t RefusedCount;   // Reservations the ring had no room for
+        VkDeviceSize PeakUsedSize; // Alignment and wrapping padding included
+    };
+
+public:
+    VulkanStagingRing(RendererImpl *renderer);
+    VulkanStagingRing(VulkanStagingRing const &) = delete;
+    VulkanStagingRing &operator=(VulkanStagingRing const &) = delete;
+    ~VulkanStagingRing();
+
+    // Size must be a power of 2 so that aligned positions stay aligned when the ring wraps
+    Graphics::GraphicsError Initialize(VkDeviceSize size);
+    void Finalize();
+
+    // Returns false if the ring has no room until earlier slices are released, alignment must be a power of 2
+    bool Reserve(VkDeviceSize size, VkDeviceSize alignment, Slice *outSlice);
+
+    // Slices can be released in any order
+    void Release(Slice const &slice);
+
+    VkBuffer GetVkBuffer();
+    VkDeviceSize GetSize() const;
+
+    Stats GetStats() const;
+    void LogStats() const;
+
+private:
+    struct Reservation {
+        uint64_t End; // Position after the slice, positions count up across laps of the ring
+        bool Released;
+    };
+
+private:
+    RendererImpl *m_renderer;
+    VulkanBuffer m_buffer;
+    VkDeviceSize m_size;
+    uint8_t *m_mappedMemory;
+
+    mutable std::mutex m_mutex;
+    uint64_t m_head; // Where the next slice starts
+    uint64_t m_tail; // Where the oldest unreleased slice starts
+    std::deque<Reservation> m_reservations;
+    uint64_t m_firstReservationId;
+    Stats m_stats;
+};
+
+} // namespace Vulkan
@@ -1,83 +1,74 @@
 #include "pch.h"
 #include "VulkanStaticModelTextured.h"
 #include "VulkanRendererImpl.h"
+#include "VulkanAssetCache.h"
 
 //TODO: more generic class
 #include "VulkanRendererSceneImpl_Basic.h"
 
-#include "ModelObjLoader.h"
+#include "ModelObjVertexWriterT.h"
+#include "ModelGltfLoader.h"
+#include "ModelScanLoader.h"
+#include "ModelMeshCache.h"
+#include "MeshSimplifier.h"
+#include "Hash.h"
+#include "VulkanFeaturesDefines.h"
 
 #include "glm/gtc/matrix_inverse.hpp"
+#include "glm/gtc/matrix_transform.hpp"
 #include <filesystem>
+#include <atomic>
+#include <cctype>
+#include <chrono>
 
 namespace Vulkan {
 
-bool operator==(VulkanTexturedVertex const &lhs, VulkanTexturedVertex const &rhs) {
-    return lhs.position == rhs.position &&
-        lhs.normal == rhs.normal &&
-        lhs.color == rhs.color &&
-        lhs.texCoord == rhs.texCoord;
-}
-
-// Vertex writer for this vertex type
-class TexturedVertexWriter : public Graphics::ModelObjVertexWriter {
-public:
-    virtual uint32_t GetVertexSize() override {
-        return sizeof(VulkanTexturedVertex);
-    }
-
-    virtual void WriteMesh(uint32_t meshIndex, uint32_t meshFaceCount, uint32_t vertexIndexCount) override {
-        (void)meshFaceCount;
-
-        // Combine all meshes into one
-        if (meshIndex == 0) {
-            AddMesh(sizeof(VulkanTexturedVertex) * vertexIndexCount);
-        }
-        else {
-            ReserveCurrentMesh(sizeof(VulkanTexturedVertex) * vertexIndexCount);
-        }
-
-        for (uint32_t i = 0; i < vertexIndexCount; ++i) {
-            VulkanTexturedVertex newVert{};
-
-            auto index = FaceIndex(i);
+// Identifies the data written by TexturedVertexWriter in mesh caches
+// Change this whenever the vertex layout or the writer's output changes
+static const char TEXTURED_VERTEX_CACHE_FORMAT[] = "VulkanTexturedVertex/1";
 
-            // Engine uses left handle system with axes on [+x, +y, +z] for [Right, Up, Forward]
-            newVert.position.x = -AttributeVertex(index.VertexIndex * 3 + 0);
-            newVert.position.y = AttributeVertex(index.VertexIndex * 3 + 2);
-            newVert.position.z = -AttributeVertex(index.VertexIndex * 3 + 1);
-
-            newVert.normal.x = -AttributeNormal(index.NormalIndex * 3 + 0);
-            newVert.normal.y = AttributeNormal(index.NormalIndex * 3 + 2);
-            newVert.normal.z = -AttributeNormal(index.NormalIndex * 3 + 1);
+// 1x1 opaque white PNG, the texture of models with neither material textures nor a texture named after the file
+// Vertex colors are drawn unchanged with it
+static const uint8_t WHITE_TEXTURE_PNG[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x00, 0x01, 0x08, 0x06, 0x00, 0x00, 0x00, 0x1f, 0x15, 0xc4, 0x89, 0x00, 0x00, 0x00, 0x0b, 0x49, 0x44, 0x41,
+    0x54, 0x78, 0xda, 0x63, 0xf8, 0x0f, 0x04, 0x00, 0x09, 0xfb, 0x03, 0xfd, 0x68, 0xfa, 0x1c, 0xcc, 0x00, 0x00, 0x00, 0x00,
+    0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82
+};
 
-            newVert.color.r = AttributeColor(index.VertexIndex * 3 + 0);
-            newVert.color.g = AttributeColor(index.VertexIndex * 3 + 1);
-            newVert.color.b = AttributeColor(index.VertexIndex * 3 + 2);
+// Push constants of the compact vertex shaders, the same 128 bytes as the model and normal matrices of the full layout
+struct CompactPushConstants {
+    glm::mat4x4 modelMatrix;    // Includes the mapping from normalized positions to the mesh bounds
+    glm::vec4 normalMatrix[3];  // First three columns of the normal matrix
+    glm::vec4 texCoordRange;    // Min (xy) and extent (zw)
+};
+static_assert(sizeof(CompactPushConstants) == 2 * sizeof(glm::mat4x4), "Compact push constants must fit the pipeline's push constant range");
 
-            newVert.texCoord.x = AttributeTexCoord(index.TexCoordIndex * 2 + 0);
-            newVert.texCoord.y = 1.0f - AttributeTexCoord(index.TexCoordIndex * 2 + 1);
+// Vertex data is uploaded as ModelImporter encodes it
+static_assert(sizeof(VulkanTexturedVertex) == sizeof(Graphics::TexturedVertex) &&
+              sizeof(VulkanTexturedVertexCompact) == sizeof(Graphics::TexturedVertexCompact) &&
+              sizeof(VulkanTexturedVertexCompactColor) == sizeof(Graphics::TexturedVertexCompactColor), "Vertex inputs must match imported vertex layouts");
 
-            AddVertex(&newVert);
-        }
-    }
+// Vertex writer for this vertex type
+class TexturedVertexWriter : public Graphics::ModelObjVertexWriterT<TexturedVertexWriter, Graphics::TexturedVertex> {
+public:
+    // Combine all meshes into one
+    static const bool COMBINE_MESHES = true;
 
-    virtual bool CheckForUniqueVertex() const override {
-        return true;
-    }
+    static void BuildVertex(Corner const &corner, Graphics::TexturedVertex &vertex) {
+        // Engine uses left handle system with axes on [+x, +y, +z] for [Right, Up, Forward]
+        vertex.position.x = -corner.Position.x;
+        vertex.position.y = corner.Position.z;
+        vertex.position.z = -corner.Position.y;
 
-    virtual size_t HashVertex(void *vertexData) const override {
-        return std::hash<std::string_view>{}({ reinterpret_cast<char*>(vertexData), sizeof(VulkanTexturedVertex) });
-    }
+        vertex.normal.x = -corner.Normal.x;
+        vertex.normal.y = corner.Normal.z;
+        vertex.normal.z = -corner.Normal.y;
 
-    virtual bool CompareVertex(void *vertexDataLeft, void *vertexDataRight) const override {
-        VulkanTexturedVertex *lhs = reinterpret_cast<VulkanTexturedVertex*>(vertexDataLeft);
-        VulkanTexturedVertex *rhs = reinterpret_cast<VulkanTexturedVertex*>(vertexDataRight);
+        vertex.color = corner.Color;
 
-        return lhs->position == rhs->position &&
-            lhs->normal == rhs->normal &&
-            lhs->color == rhs->color &&
-            lhs->texCoord == rhs->texCoord;
+        vertex.texCoord.x = corner.TexCoord.x;
+        vertex.texCoord.y = 1.0f - corner.TexCoord.y;
     }
 };
 
@@ -115,67 +106,919 @@ std::array<VkVertexInputAttributeDescription, 4> VulkanTexturedVertex::getAttrib
     return attributeDescriptions;
 }
 
+VkVertexInputBindingDescription VulkanTexturedVertexCompact::getBindingDescription() {
+    VkVertexInputBindingDescription bindingDescription{};
+
+    bindingDescription.binding = 0;
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    bindingDescription.stride = sizeof(VulkanTexturedVertexCompact);
+
+    return bindingDescription;
+}
+
+std::array<VkVertexInputAttributeDescription, 3> VulkanTexturedVertexCompact::getAttributeDescriptions() {
+    // Locations match VulkanTexturedVertex, color (2) is not present
+    std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
+    attributeDescriptions[0].binding = 0;
+    attributeDescriptions[0].location = 0;
+    attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+    attributeDescriptions[0].offset = offsetof(VulkanTexturedVertexCompact, position);
+
+    attributeDescriptions[1].binding = 0;
+    attributeDescriptions[1].location = 1;
+    attributeDescriptions[1].format = VK_FORMAT_R16G16_SNORM;
+    attributeDescriptions[1].offset = offsetof(VulkanTexturedVertexCompact, normal);
+
+    attributeDescriptions[2].binding = 0;
+    attributeDescriptions[2].location = 3;
+    attributeDescriptions[2].format = VK_FORMAT_R16G16_UNORM;
+    attributeDescriptions[2].offset = offsetof(VulkanTexturedVertexCompact, texCoord);
+    return attributeDescriptions;
+}
+
+VkVertexInputBindingDescription VulkanTexturedVertexCompactColor::getBindingDescription() {
+    VkVertexInputBindingDescription bindingDescription{};
+
+    bindingDescription.binding = 0;
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    bindingDescription.stride = sizeof(VulkanTexturedVertexCompactColor);
+
+    return bindingDescription;
+}
+
+std::array<VkVertexInputAttributeDescription, 4> VulkanTexturedVertexCompactColor::getAttributeDescriptions() {
+    std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions{};
+    attributeDescriptions[0].binding = 0;
+    attributeDescriptions[0].location = 0;
+    attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+    attributeDescriptions[0].offset = offsetof(VulkanTexturedVertexCompactColor, position);
+
+    attributeDescriptions[1].binding = 0;
+    attributeDescriptions[1].location = 1;
+    attributeDescriptions[1].format = VK_FORMAT_R16G16_SNORM;
+    attributeDescriptions[1].offset = offsetof(VulkanTexturedVertexCompactColor, normal);
+
+    attributeDescriptions[2].binding = 0;
+    attributeDescriptions[2].location = 2;
+    attributeDescriptions[2].format = VK_FORMAT_R8G8B8A8_UNORM;
+    attributeDescriptions[2].offset = offsetof(VulkanTexturedVertexCompactColor, color);
+
+    attributeDescriptions[3].binding = 0;
+    attributeDescriptions[3].location = 3;
+    attributeDescriptions[3].format = VK_FORMAT_R16G16_UNORM;
+    attributeDescriptions[3].offset = offsetof(VulkanTexturedVertexCompactColor, texCoord);
+    return attributeDescriptions;
+}
+
+VulkanStaticModelTextured::MeshData::MeshData(RendererImpl *renderer)
+  : VertexData(renderer),
+    Layout(Graphics::ModelImporter::VERTEX_LAYOUT_FULL),
+    BoundsMin(0.0f),
+    BoundsMax(0.0f),
+    TexCoordRange(0.0f, 0.0f, 1.0f, 1.0f) {
+    // Imports may run on worker threads, their transfers are registered by _registerUploads on the main thread
+    VertexData.SetDeferTransfers(true);
+}
+
 VulkanStaticModelTextured::VulkanStaticModelTextured(RendererSceneImpl_Basic *owner)
   : m_owner(owner),
-    m_vertexData(owner->GetRenderer()),
-    m_descriptorSet(owner->GetRenderer()),
+    m_optimizeMesh(true),
+    m_cullMeshlets(true),
+    m_lodPixelError(1.0f),
+    m_textureCompression(Graphics::TextureCompressor::BLOCK_FORMAT_BC7),
+    m_streamTextures(false),
+    m_atlasTextures(false),
+    m_loadState(LOAD_STATE_EMPTY),
     m_accumulatedTime(0.0) {
 }
 
 VulkanStaticModelTextured::~VulkanStaticModelTextured() {
+    // A worker may still be importing into this model
+    {
+        std::unique_lock<std::mutex> lock(m_loadMutex);
+        m_loadFinished.wait(lock, [this]() { return m_loadState != LOAD_STATE_IMPORTING; });
+    }
+
+    for (auto *descriptorSet : m_descriptorSets) {
+        delete descriptorSet;
+    }
+
+    // The bindless set holds on to the slots until the frames in flight that may draw this model are done
+    for (uint32_t slot : m_bindlessSlots) {
+        m_owner->GetBindlessTextureSet()->FreeSlot(slot);
+    }
+}
+
+void VulkanStaticModelTextured::SetMeshOptimization(bool enable) {
+    m_optimizeMesh = enable;
 }
 
-Graphics::GraphicsError VulkanStaticModelTextured::LoadFromObjFile(std::string const &objFilePath) {
-    Graphics::ModelObjLoader loader;
-    TexturedVertexWriter vertexWriter;
+void VulkanStaticModelTextured::SetMeshletCulling(bool enable) {
+    m_cullMeshlets = enable;
+}
 
-    auto errorString = loader.Load(objFilePath, &vertexWriter);
-    if (!errorString.empty()) {
-        LOG_ERROR("Error when loading obj file: %s\n%s\n", objFilePath.c_str(), errorString.c_str());
-        return Graphics::GraphicsError::FILE_LOAD_ERROR;
+void VulkanStaticModelTextured::SetTextureCompression(Graphics::TextureCompressor::BlockFormat format) {
+    m_textureCompression = format;
+}
+
+void VulkanStaticModelTextured::SetTextureStreaming(bool enable) {
+    m_streamTextures = enable;
+}
+
+void VulkanStaticModelTextured::SetTextureAtlas(bool enable) {
+    m_atlasTextures = enable;
+}
+
+void VulkanStaticModelTextured::SetLodPixelError(f32 pixelError) {
+    m_lodPixelError = pixelError;
+}
+
+Graphics::GraphicsError VulkanStaticModelTextured::LoadFromFile(std::string const &filePath) {
+    ASSERT(m_loadState != LOAD_STATE_IMPORTING && m_loadState != LOAD_STATE_IMPORTED);
+
+    auto err = _importFile(filePath);
+    if (err == Graphics::GraphicsError::OK) {
+        err = _registerUploads();
     }
+    m_loadState = err == Graphics::GraphicsError::OK ? LOAD_STATE_READY : LOAD_STATE_FAILED;
+    return err;
+}
 
-    //TODO: This should be loaded in obj file but for now we're assuming one texture and manually load it
-    std::filesystem::path texturePath(objFilePath);
-    texturePath.replace_extension(".png");
-    auto &firstTexture = m_materialData.emplace_back(m_owner->GetRenderer());
-    firstTexture.LoadImageFromFile(texturePath.u8string());
-    firstTexture.FlushTextureToDevice();
-    firstTexture.ClearHostResources();
+Graphics::GraphicsError VulkanStaticModelTextured::LoadFromFileAsync(std::string const &filePath) {
+    if (m_loadState != LOAD_STATE_EMPTY) {
+        LOG_ERROR("Model is already loaded, unable to load %s\n", filePath.c_str());
+        return Graphics::GraphicsError::INITIALIZATION_FAILED;
+    }
 
-    auto &firstSampler = m_samplers.emplace_back(m_owner->GetRenderer());
-    firstSampler.Initialize();
+    // The model is not drawn until the import is done so the worker has the model to itself
+    m_loadState = LOAD_STATE_IMPORTING;
+    m_owner->GetRenderer()->GetWorkerThreadPool()->Enqueue([this, filePath]() {
+        auto startTime = std::chrono::steady_clock::now();
+        auto err = _importFile(filePath);
+        LOG_VERBOSE("Imported %s on a worker thread in %.3f ms\n", filePath.c_str(),
+            std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - startTime).count());
 
-    // Upload vertex and index data
-    m_vertexData.SetVertexCount(loader.GetVertexCount(0));
-    m_vertexData.SetIndexCount(loader.GetIndexCount(0));
-    //TODO: Add buffer type that allows using the vertex in-memory instead of needing to copy it
-    memcpy(m_vertexData.GetVertexData(), loader.GetVertexData(0), loader.GetVertexSize() * loader.GetVertexCount(0));
-    memcpy(m_vertexData.GetIndexData(), loader.GetIndexData(0), loader.GetIndexSize() * loader.GetIndexCount(0));
-    m_vertexData.FlushVertexToDevice();
-    m_vertexData.FlushIndexToDevice();
-
-    // Setup descriptor set
+        std::unique_lock<std::mutex> lock(m_loadMutex);
+        m_loadState = err == Graphics::GraphicsError::OK ? LOAD_STATE_IMPORTED : LOAD_STATE_FAILED;
+        m_loadFinished.notify_all();
+    });
+
+    return Graphics::GraphicsError::OK;
+}
+
+Graphics::GraphicsError VulkanStaticModelTextured::UpdateLoading() {
+    if (m_loadState != LOAD_STATE_IMPORTED) {
+        return Graphics::GraphicsError::OK;
+    }
+
+    auto err = _registerUploads();
+    m_loadState = err == Graphics::GraphicsError::OK ? LOAD_STATE_READY : LOAD_STATE_FAILED;
+    return err;
+}
+
+VulkanStaticModelTextured::LoadState VulkanStaticModelTextured::GetLoadState() const {
+    return m_loadState;
+}
+
+Graphics::GraphicsError VulkanStaticModelTextured::LoadPlaceholder() {
+    ASSERT(m_loadState == LOAD_STATE_EMPTY);
+
+    // Unit cube around the origin with 4 vertices per face for flat normals
+    // Faces are wound like imported meshes, which are mirrored into this left handed space so cross(b - a, c - a) points inwards
+    std::vector<Graphics::TexturedVertex> vertices;
+    std::vector<uint32_t> indices;
+    for (uint32_t axis = 0; axis < 3; ++axis) {
+        for (f32 sign : { -1.0f, 1.0f }) {
+            glm::vec3 normal(0.0f);
+            glm::vec3 tangent(0.0f);
+            glm::vec3 bitangent(0.0f);
+            normal[axis] = sign;
+            tangent[(axis + 1) % 3] = 0.5f;
+            bitangent[(axis + 2) % 3] = 0.5f * sign;
+
+            uint32_t firstVertex = static_cast<uint32_t>(vertices.size());
+            const glm::vec2 corners[] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+            for (auto const &corner : corners) {
+                Graphics::TexturedVertex vertex{};
+                vertex.position = normal * 0.5f + tangent * corner.x + bitangent * corner.y;
+                vertex.normal = normal;
+                vertex.color = glm::vec3(0.5f);
+                vertex.texCoord = corner * 0.5f + 0.5f;
+                vertices.push_back(vertex);
+            }
+            indices.insert(indices.end(), { firstVertex, firstVertex + 2, firstVertex + 1, firstVertex, firstVertex + 3, firstVertex + 2 });
+        }
+    }
+    Graphics::ModelObjLoader::SubMesh subMesh{ 0, static_cast<uint32_t>(indices.size()), -1 };
+
+    // Built in memory so it is not shared through the asset cache, its white texture still is
+    m_mesh = std::make_shared<MeshData>(m_owner->GetRenderer());
+    auto err = _importMesh(m_mesh.get(), "", 0, vertices.data(), vertices.size(), indices.data(), static_cast<uint32_t>(indices.size()), &subMesh, 1, m_mesh->MaterialTextures);
+    if (err == Graphics::GraphicsError::OK) {
+        m_drawRanges = m_mesh->DrawRanges;
+        m_lods = m_mesh->Lods;
+        err = _loadMaterials("", m_mesh->MaterialTextures);
+    }
+    if (err == Graphics::GraphicsError::OK) {
+        _assignDrawRangeMeshlets();
+        err = _registerUploads();
+    }
+    m_loadState = err == Graphics::GraphicsError::OK ? LOAD_STATE_READY : LOAD_STATE_FAILED;
+    return err;
+}
+
+Graphics::GraphicsError VulkanStaticModelTextured::_importFile(std::string const &filePath) {
+    auto err = _acquireMesh(filePath);
+    if (err != Graphics::GraphicsError::OK) {
+        return err;
+    }
+
+    // Draw ranges are copied since each model merges them by its own descriptor sets
+    m_drawRanges = m_mesh->DrawRanges;
+    m_lods = m_mesh->Lods;
+    err = _loadMaterials(filePath, m_mesh->MaterialTextures);
+    if (err != Graphics::GraphicsError::OK) {
+        return err;
+    }
+
+    _assignDrawRangeMeshlets();
+
+    return Graphics::GraphicsError::OK;
+}
+
+Graphics::GraphicsError VulkanStaticModelTextured::_registerUploads() {
+    // Shared meshes and textures are only uploaded by the first model to register them
+    m_mesh->VertexData.RegisterDeferredTransfers();
+    for (auto &texture : m_materialData) {
+        texture->FlushTextureToDevice();
+        texture->ClearHostResources();
+        if (texture->IsStreaming()) {
+            m_owner->GetTextureStreamer()->AddTexture(texture);
+        }
+    }
+
+    // One descriptor set per texture, or one slot of the scene's bindless texture set
+    // The image of a streaming texture is replaced as its levels change, so each frame in flight gets a binding it can rewrite
+    //   once the device is done with that frame
+    VulkanBindlessTextureSet *bindlessTextures = m_owner->GetBindlessTextureSet();
     VulkanDescriptorSetLayout *layout = m_owner->GetDescriptorSetLayout(RENDERABLE_OBJECT_TYPE_STATIC_MODEL_TEXTURED);
-    m_descriptorSet.SetDescriptorSetLayout(layout);
+    for (auto &texture : m_materialData) {
+        size_t bindingCount = texture->IsStreaming() ? RendererSceneImpl_Basic::FRAMES_IN_FLIGHT : 1;
+        if (bindlessTextures) {
+            m_textureBindings.push_back(static_cast<uint32_t>(m_bindlessSlots.size()));
+            for (size_t i = 0; i < bindingCount; ++i) {
+                uint32_t slot = bindlessTextures->AllocateSlot();
+                if (slot == VulkanBindlessTextureSet::INVALID_SLOT) {
+                    LOG_ERROR("Bindless texture set is out of slots\n");
+                    return Graphics::GraphicsError::DESCRIPTOR_SET_CREATE_ERROR;
+                }
+                bindlessTextures->WriteSlot(slot, texture->GetDeviceImageView(), m_sampler->GetVkSampler());
+                m_bindlessSlots.push_back(slot);
+                m_bindingVersions.push_back(texture->GetResidencyVersion());
+            }
+            continue;
+        }
+
+        m_textureBindings.push_back(static_cast<uint32_t>(m_descriptorSets.size()));
+        for (size_t i = 0; i < bindingCount; ++i) {
+            auto *descriptorSet = m_descriptorSets.emplace_back(new VulkanDescriptorSetInstance(m_owner->GetRenderer()));
+            descriptorSet->SetDescriptorSetLayout(layout);
 
-    VkDescriptorImageInfo imageInfo{};
-    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    imageInfo.imageView = firstTexture.GetDeviceImageView();
-    imageInfo.sampler = firstSampler.GetVkSampler();
-    m_descriptorSet.UpdateDescriptorWrite(0, &imageInfo);
+            VkDescriptorImageInfo imageInfo{};
+            imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            imageInfo.imageView = texture->GetDeviceImageView();
+            imageInfo.sampler = m_sampler->GetVkSampler();
+            descriptorSet->UpdateDescriptorWrite(0, &imageInfo);
+            m_bindingVersions.push_back(texture->GetResidencyVersion());
+        }
+    }
 
-    // Descriptor set will not be changing so allocate it in persistent pool
+    // Descriptor sets will not be changing so allocate them in persistent pool
+    // Allocated one at a time so models with more textures than a single pool holds still fit
     VulkanDescriptorSetAllocator *persistentPool = m_owner->GetPersistentDescriptorPool();
-    auto err = persistentPool->AllocateDescriptorSet(1, &m_descriptorSet);
+    for (auto *descriptorSet : m_descriptorSets) {
+        auto err = persistentPool->AllocateDescriptorSet(1, &descriptorSet);
+        if (err != Graphics::GraphicsError::OK) {
+            return err;
+        }
+    }
+
+    return Graphics::GraphicsError::OK;
+}
+
+Graphics::GraphicsError VulkanStaticModelTextured::_acquireMesh(std::string const &filePath) {
+    VulkanAssetCache *assetCache = m_owner->GetRenderer()->GetAssetCache();
+    VulkanAssetCache::AssetKey key;
+    auto err = VulkanAssetCache::GetFileKey(filePath, &key);
+    if (err != Graphics::GraphicsError::OK) {
+        LOG_ERROR("Unable to read model file %s\n", filePath.c_str());
+        return err;
+    }
+    key.Type = VulkanAssetCache::ASSET_TYPE_MESH;
+    key.Variant = _getImportSettingsKey();
+
+    return assetCache->Acquire<MeshData>(key, [this, &filePath, assetCache](MeshData **outAsset, VkDeviceSize *outDeviceMemorySize) {
+        auto *mesh = new MeshData(m_owner->GetRenderer());
+        auto err = _loadMesh(filePath, mesh);
+        if (err != Graphics::GraphicsError::OK) {
+            delete mesh;
+            return err;
+        }
+        *outAsset = mesh;
+        *outDeviceMemorySize = assetCache->GetDeviceMemorySize(mesh->VertexData.GetVertexDeviceBuffer()) + assetCache->GetDeviceMemorySize(mesh->VertexData.GetIndexDeviceBuffer());
+        return Graphics::GraphicsError::OK;
+    }, &m_mesh);
+}
+
+Graphics::GraphicsError VulkanStaticModelTextured::_loadMesh(std::string const &filePath, MeshData *mesh) {
+    // Optimized and unoptimized imports are cached separately
+    const uint64_t cacheFormatKey = _getImportSettingsKey();
+
+    // Previously imported models are uploaded straight from the mapped cache
+    Graphics::ModelMeshCache meshCache;
+    if (meshCache.Open(filePath, cacheFormatKey)) {
+        uint32_t cacheVertexLayout = meshCache.GetVertexLayout();
+        if (cacheVertexLayout < Graphics::ModelImporter::VERTEX_LAYOUT_COUNT &&
+            meshCache.GetVertexSize() == Graphics::ModelImporter::GetVertexLayoutStride(static_cast<Graphics::ModelImporter::VertexLayout>(cacheVertexLayout))) {
+            LOG_VERBOSE("Loading %s from mesh cache\n", filePath.c_str());
+            mesh->BoundsMin = meshCache.GetBounds().Min;
+            mesh->BoundsMax = meshCache.GetBounds().Max;
+            mesh->Layout = static_cast<Graphics::ModelImporter::VertexLayout>(cacheVertexLayout);
+            mesh->TexCoordRange = meshCache.GetTexCoordRange();
+
+            // Caches without levels of detail hold full detail only
+            Graphics::ModelMeshCache::Lod fullDetail{ 0, meshCache.GetSubMeshCount(), 0.0f, 0 };
+            if (meshCache.GetLodCount() > 0) {
+                _addDrawRanges(mesh, meshCache.GetSubMeshes(), meshCache.GetLods(), meshCache.GetLodCount());
+            }
+            else {
+                _addDrawRanges(mesh, meshCache.GetSubMeshes(), &fullDetail, 1);
+            }
+            mesh->Meshlets.assign(meshCache.GetMeshlets(), meshCache.GetMeshlets() + meshCache.GetMeshletCount());
+            for (uint32_t i = 0; i < meshCache.GetMaterialCount(); ++i) {
+                mesh->MaterialTextures.push_back(meshCache.GetMaterialTexture(i));
+            }
+
+            mesh->VertexData.SetVertexStride(meshCache.GetVertexSize());
+            auto err = mesh->VertexData.FlushVertexToDevice(meshCache.GetVertexData(), static_cast<size_t>(meshCache.GetVertexCount()));
+            if (err != Graphics::GraphicsError::OK) {
+                return err;
+            }
+            // Ranges bind their own index type when drawn, the data is uploaded as-is
+            return mesh->VertexData.FlushIndexToDevice(meshCache.GetIndexData(), static_cast<size_t>(meshCache.GetIndexDataSize() / sizeof(uint16_t)), VK_INDEX_TYPE_UINT16);
+        }
+        meshCache.Close();
+    }
+    else {
+        LOG_VERBOSE("Mesh cache not used for %s: %s\n", filePath.c_str(), meshCache.GetLastError().c_str());
+    }
+
+    // Every format ends up as one mesh where every material is one contiguous range of the index buffer
+    Graphics::ModelObjLoader objLoader;
+    Graphics::ModelGltfLoader gltfLoader;
+    Graphics::ModelScanLoader scanLoader;
+    std::vector<Graphics::TexturedVertex> gltfVertices;
+    std::vector<uint32_t> gltfIndices;
+    std::vector<Graphics::ModelObjLoader::SubMesh> gltfSubMeshes;
+    const Graphics::TexturedVertex *vertices = nullptr;
+    const uint32_t *indices = nullptr;
+    size_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    const Graphics::ModelObjLoader::SubMesh *subMeshes = nullptr;
+    uint32_t subMeshCount = 0;
+
+    std::string extension = std::filesystem::path(filePath).extension().u8string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(tolower(c)); });
+    if (extension == ".gltf" || extension == ".glb") {
+        auto errorString = gltfLoader.Load(filePath);
+        if (!errorString.empty()) {
+            LOG_ERROR("Error when loading gltf file: %s\n%s\n", filePath.c_str(), errorString.c_str());
+            return Graphics::GraphicsError::FILE_LOAD_ERROR;
+        }
+        if (!_gatherGltfMesh(gltfLoader, &gltfVertices, &gltfIndices, &gltfSubMeshes)) {
+            LOG_ERROR("Invalid indices in gltf file: %s\n", filePath.c_str());
+            return Graphics::GraphicsError::FILE_LOAD_ERROR;
+        }
+
+        vertices = gltfVertices.data();
+        vertexCount = gltfVertices.size();
+        indices = gltfIndices.data();
+        indexCount = static_cast<uint32_t>(gltfIndices.size());
+        subMeshes = gltfSubMeshes.data();
+        subMeshCount = static_cast<uint32_t>(gltfSubMeshes.size());
+        for (uint32_t i = 0; i < gltfLoader.GetMaterialCount(); ++i) {
+            mesh->MaterialTextures.push_back(gltfLoader.GetMaterial(i).DiffuseTexture);
+        }
+    }
+    else if (extension == ".ply" || extension == ".stl") {
+        // Scans can take a while, progress is logged every tenth of the file
+        uint32_t loggedTenths = 0;
+        scanLoader.SetProgressCallback([&](f32 progress) {
+            uint32_t tenths = static_cast<uint32_t>(progress * 10.0f);
+            if (tenths > loggedTenths) {
+                loggedTenths = tenths;
+                LOG_VERBOSE("Loading %s: %u%%\n", filePath.c_str(), tenths * 10);
+            }
+        });
+
+        TexturedVertexWriter vertexWriter;
+        auto errorString = scanLoader.Load(filePath, &vertexWriter);
+        if (!errorString.empty()) {
+            LOG_ERROR("Error when loading scan file: %s\n%s\n", filePath.c_str(), errorString.c_str());
+            return Graphics::GraphicsError::FILE_LOAD_ERROR;
+        }
+
+        ASSERT(scanLoader.GetIndexSize() == sizeof(uint32_t));
+        vertices = reinterpret_cast<const Graphics::TexturedVertex*>(scanLoader.GetVertexData(0));
+        vertexCount = scanLoader.GetVertexCount(0);
+        indices = reinterpret_cast<const uint32_t*>(scanLoader.GetIndexData(0));
+        indexCount = scanLoader.GetIndexCount(0);
+        subMeshes = scanLoader.GetSubMeshes(0);
+        subMeshCount = scanLoader.GetSubMeshCount(0);
+    }
+    else {
+        TexturedVertexWriter vertexWriter;
+        objLoader.SetThreadPool(m_owner->GetRenderer()->GetWorkerThreadPool());
+        auto errorString = objLoader.Load(filePath, &vertexWriter);
+        if (!errorString.empty()) {
+            LOG_ERROR("Error when loading obj file: %s\n%s\n", filePath.c_str(), errorString.c_str());
+            return Graphics::GraphicsError::FILE_LOAD_ERROR;
+        }
+        objLoader.BatchSubMeshesByMaterial(0);
+
+        ASSERT(objLoader.GetIndexSize() == sizeof(uint32_t));
+        vertices = reinterpret_cast<const Graphics::TexturedVertex*>(objLoader.GetVertexData(0));
+        vertexCount = objLoader.GetVertexCount(0);
+        indices = reinterpret_cast<const uint32_t*>(objLoader.GetIndexData(0));
+        indexCount = objLoader.GetIndexCount(0);
+        subMeshes = objLoader.GetSubMeshes(0);
+        subMeshCount = objLoader.GetSubMeshCount(0);
+        for (uint32_t i = 0; i < objLoader.GetMaterialCount(); ++i) {
+            mesh->MaterialTextures.push_back(objLoader.GetMaterial(i).DiffuseTexture);
+        }
+    }
+
+    // Atlasing moves texture coordinates, so it runs before anything is optimized or encoded
+    std::vector<Graphics::TexturedVertex> atlasVertices;
+    std::vector<uint32_t> atlasIndices;
+    std::vector<Graphics::ModelObjLoader::SubMesh> atlasSubMeshes;
+    if (m_atlasTextures) {
+        // Pages are block compressed like the textures they replace, where the device supports it
+        RendererImpl *renderer = m_owner->GetRenderer();
+        Graphics::TextureCompressor::BlockFormat pageFormat = Graphics::TextureCompressor::BLOCK_FORMAT_NONE;
+        if (m_textureCompression != Graphics::TextureCompressor::BLOCK_FORMAT_NONE &&
+            renderer->GetPhysicalDevice()->SupportsFeature(FEATURE_TEXTURE_COMPRESSION_BC, renderer->GetRequirements())) {
+            pageFormat = m_textureCompression;
+        }
+
+        Graphics::ModelImporter importer;
+        importer.SetThreadPool(renderer->GetWorkerThreadPool());
+        if (importer.BuildTextureAtlas(filePath, gltfLoader, pageFormat, vertices, vertexCount, indices, indexCount, subMeshes, subMeshCount,
+                                       &mesh->MaterialTextures, &atlasVertices, &atlasIndices, &atlasSubMeshes)) {
+            vertices = atlasVertices.data();
+            vertexCount = atlasVertices.size();
+            indices = atlasIndices.data();
+            subMeshes = atlasSubMeshes.data();
+            subMeshCount = static_cast<uint32_t>(atlasSubMeshes.size());
+        }
+    }
+
+    return _importMesh(mesh, filePath, cacheFormatKey, vertices, vertexCount, indices, indexCount, subMeshes, subMeshCount, mesh->MaterialTextures);
+}
+
+Graphics::GraphicsError VulkanStaticModelTextured::_importMesh(MeshData *mesh, std::string const &cachePath, uint64_t cacheFormatKey, const Graphics::TexturedVertex *vertices, size_t vertexCount,
+                                                               const uint32_t *indices, uint32_t indexCount, const Graphics::ModelObjLoader::SubMesh *subMeshes, uint32_t subMeshCount,
+                                                               std::vector<std::string> const &materialTextures) {
+    Graphics::ModelImporter importer;
+    importer.SetOptimization(m_optimizeMesh);
+    Graphics::ModelImporter::Mesh imported;
+    importer.Import(vertices, vertexCount, indices, indexCount, subMeshes, subMeshCount, &imported);
+
+    // Store the imported mesh so later loads can skip parsing
+    Graphics::ModelMeshCache meshCache;
+    if (!cachePath.empty() && !meshCache.Save(cachePath, cacheFormatKey, Graphics::ModelImporter::GetCacheData(imported, materialTextures))) {
+        LOG_ERROR("Unable to write mesh cache for %s: %s\n", cachePath.c_str(), meshCache.GetLastError().c_str());
+    }
+
+    mesh->Layout = imported.Layout;
+    mesh->BoundsMin = imported.Bounds.Min;
+    mesh->BoundsMax = imported.Bounds.Max;
+    mesh->TexCoordRange = imported.TexCoordRange;
+    mesh->Meshlets = std::move(imported.Meshlets);
+    _addDrawRanges(mesh, imported.SubMeshes.data(), imported.Lods.data(), static_cast<uint32_t>(imported.Lods.size()));
+
+    // Upload vertex and index data
+    mesh->VertexData.SetVertexStride(Graphics::ModelImporter::GetVertexLayoutStride(imported.Layout));
+    auto err = mesh->VertexData.FlushVertexToDevice(imported.VertexData.data(), imported.VertexCount);
     if (err != Graphics::GraphicsError::OK) {
         return err;
     }
+    return mesh->VertexData.FlushIndexToDevice(imported.IndexData.data(), imported.IndexData.size() / sizeof(uint16_t), VK_INDEX_TYPE_UINT16);
+}
+
+void VulkanStaticModelTextured::_addDrawRanges(MeshData *mesh, const Graphics::ModelMeshCache::SubMesh *subMeshes, const Graphics::ModelMeshCache::Lod *lods, uint32_t lodCount) {
+    for (uint32_t lod = 0; lod < lodCount; ++lod) {
+        for (uint32_t i = lods[lod].FirstSubMesh; i < lods[lod].FirstSubMesh + lods[lod].SubMeshCount; ++i) {
+            Graphics::ModelMeshCache::SubMesh const &subMesh = subMeshes[i];
+            VkIndexType indexType = subMesh.IndexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+            mesh->DrawRanges.push_back({ subMesh.IndexOffset, subMesh.IndexCount, subMesh.MaterialId, 0, indexType, static_cast<int32_t>(subMesh.BaseVertex), subMesh.SourceFirstIndex, 0, 0, lod });
+        }
+        mesh->Lods.push_back({ 0, 0, lods[lod].Error });
+    }
+}
+
+bool VulkanStaticModelTextured::_gatherGltfMesh(Graphics::ModelGltfLoader const &loader, std::vector<Graphics::TexturedVertex> *outVertices, std::vector<uint32_t> *outIndices,
+                                                std::vector<Graphics::ModelObjLoader::SubMesh> *outSubMeshes) {
+    struct PrimitiveInstance {
+        const Graphics::ModelGltfLoader::Primitive *Primitive;
+        const glm::mat4x4 *Transform;
+        uint32_t FirstVertex;
+        uint32_t FirstIndex;
+        uint32_t IndexCount;
+    };
+
+    // Primitives are laid out by material so each material is one contiguous range, like batched obj submeshes
+    std::vector<PrimitiveInstance> primitives;
+    for (uint32_t i = 0; i < loader.GetMeshInstanceCount(); ++i) {
+        Graphics::ModelGltfLoader::MeshInstance const &instance = loader.GetMeshInstances()[i];
+        for (auto const &primitive : loader.GetMesh(instance.MeshIndex).Primitives) {
+            uint32_t indexCount = primitive.Indices.Count > 0 ? primitive.Indices.Count : primitive.Positions.Count;
+            if (indexCount > 0 && indexCount % 3 == 0) {
+                primitives.push_back({ &primitive, &instance.Transform, 0, 0, indexCount });
+            }
+        }
+    }
+    std::stable_sort(primitives.begin(), primitives.end(), [](PrimitiveInstance const &lhs, PrimitiveInstance const &rhs) {
+        return lhs.Primitive->MaterialId < rhs.Primitive->MaterialId;
+    });
+
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    outSubMeshes->clear();
+    for (auto &primitive : primitives) {
+        primitive.FirstVertex = static_cast<uint32_t>(vertexCount);
+        primitive.FirstIndex = static_cast<uint32_t>(indexCount);
+        vertexCount += primitive.Primitive->Positions.Count;
+        indexCount += primitive.IndexCount;
+        if (vertexCount > std::numeric_limits<uint32_t>::max() || indexCount > std::numeric_limits<uint32_t>::max()) {
+            return false;
+        }
+
+        int32_t materialId = primitive.Primitive->MaterialId;
+        if (!outSubMeshes->empty() && outSubMeshes->back().MaterialId == materialId) {
+            outSubMeshes->back().IndexCount += primitive.IndexCount;
+        }
+        else {
+            outSubMeshes->push_back({ primitive.FirstIndex, primitive.IndexCount, materialId });
+        }
+    }
+    outVertices->resize(vertexCount);
+    outIndices->resize(indexCount);
+
+    // Primitives write disjoint ranges so they are copied in parallel, each attribute is one strided pass over the mapped file
+    std::atomic<bool> indicesValid(true);
+    m_owner->GetRenderer()->GetWorkerThreadPool()->ParallelFor(static_cast<uint32_t>(primitives.size()), [&](uint32_t primitiveIndex) {
+        PrimitiveInstance const &instance = primitives[primitiveIndex];
+        Graphics::ModelGltfLoader::Primitive const &primitive = *instance.Primitive;
+        Graphics::TexturedVertex *vertices = outVertices->data() + instance.FirstVertex;
+        uint32_t *indices = outIndices->data() + instance.FirstIndex;
+        uint32_t primitiveVertexCount = primitive.Positions.Count;
+
+        // Untextured materials are drawn with their base color as the vertex color
+        glm::vec3 baseColor(1.0f);
+        if (primitive.MaterialId >= 0) {
+            baseColor = glm::vec3(loader.GetMaterial(static_cast<uint32_t>(primitive.MaterialId)).BaseColorFactor);
+        }
+        for (uint32_t i = 0; i < primitiveVertexCount; ++i) {
+            vertices[i].normal = glm::vec3(0.0f);
+            vertices[i].color = glm::vec3(1.0f);
+            vertices[i].texCoord = glm::vec2(0.0f);
+        }
+        Graphics::ModelGltfLoader::ReadFloats(primitive.Positions, 3, &vertices->position, sizeof(Graphics::TexturedVertex));
+        Graphics::ModelGltfLoader::ReadFloats(primitive.Normals, 3, &vertices->normal, sizeof(Graphics::TexturedVertex));
+        Graphics::ModelGltfLoader::ReadFloats(primitive.Colors, 3, &vertices->color, sizeof(Graphics::TexturedVertex));
+        Graphics::ModelGltfLoader::ReadFloats(primitive.TexCoords, 2, &vertices->texCoord, sizeof(Graphics::TexturedVertex));
+
+        // Node transforms are baked in, then glTF's right handed +Y up space is mirrored into the engine's left handed one
+        // The mirror matches the obj import so both keep the same winding, only mirroring node transforms flip it
+        glm::mat4x4 const &transform = *instance.Transform;
+        bool identity = transform == glm::mat4x4(1.0f);
+        glm::mat3x3 normalTransform = glm::inverseTranspose(glm::mat3x3(transform));
+        for (uint32_t i = 0; i < primitiveVertexCount; ++i) {
+            Graphics::TexturedVertex &vertex = vertices[i];
+            if (!identity) {
+                vertex.position = glm::vec3(transform * glm::vec4(vertex.position, 1.0f));
+                glm::vec3 normal = normalTransform * vertex.normal;
+                f32 length = glm::length(normal);
+                vertex.normal = length > 0.0f ? normal / length : normal;
+            }
+            vertex.position.x = -vertex.position.x;
+            vertex.normal.x = -vertex.normal.x;
+            vertex.color *= baseColor;
+        }
+
+        if (primitive.Indices.Count > 0) {
+            if (!Graphics::ModelGltfLoader::ReadIndices(primitive.Indices, primitiveVertexCount, instance.FirstVertex, indices)) {
+                indicesValid = false;
+                return;
+            }
+        }
+        else {
+            for (uint32_t i = 0; i < instance.IndexCount; ++i) {
+                indices[i] = instance.FirstVertex + i;
+            }
+        }
+        if (glm::determinant(glm::mat3x3(transform)) < 0.0f) {
+            for (uint32_t i = 0; i < instance.IndexCount; i += 3) {
+                std::swap(indices[i + 1], indices[i + 2]);
+            }
+        }
+    });
+
+    LOG_VERBOSE("Gathered %zu gltf primitives: %zu vertices, %zu indices, %zu materials\n",
+        primitives.size(), vertexCount, indexCount, outSubMeshes->size());
+    return indicesValid;
+}
+
+uint64_t VulkanStaticModelTextured::_getImportSettingsKey() const {
+    uint64_t key = Graphics::HashCombine64(Graphics::HashBytes64(TEXTURED_VERTEX_CACHE_FORMAT, sizeof(TEXTURED_VERTEX_CACHE_FORMAT) - 1), m_optimizeMesh ? 1 : 0);
+
+    // Atlased meshes refer to pages stored in the compression format, keys without atlasing stay as they were
+    if (m_atlasTextures) {
+        key = Graphics::HashCombine64(key, 2 + static_cast<uint64_t>(m_textureCompression));
+    }
+    return key;
+}
+
+uint32_t VulkanStaticModelTextured::_selectLod(Graphics::Camera const &camera, glm::mat4x4 const &modelMatrix, f32 viewportHeight) const {
+    if (m_lods.size() <= 1) {
+        return 0;
+    }
+
+    // Errors and the bounding sphere scale with the largest axis of the model matrix
+    f32 scale = std::max(glm::length(glm::vec3(modelMatrix[0])), std::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+    glm::vec3 center = glm::vec3(modelMatrix * glm::vec4((m_mesh->BoundsMin + m_mesh->BoundsMax) * 0.5f, 1.0f));
+    f32 radius = glm::length(m_mesh->BoundsMax - m_mesh->BoundsMin) * 0.5f * scale;
+    f32 distance = std::max(glm::length(camera.GetPosition() - center) - radius, 0.0f);
+
+    f32 lodErrors[Graphics::ModelImporter::MAX_LOD_COUNT];
+    uint32_t lodCount = std::min(static_cast<uint32_t>(m_lods.size()), Graphics::ModelImporter::MAX_LOD_COUNT);
+    for (uint32_t i = 0; i < lodCount; ++i) {
+        lodErrors[i] = m_lods[i].Error * scale;
+    }
+    return Graphics::SelectLodLevel(lodErrors, lodCount, distance, fabsf(camera.ProjectionMatrix()[1][1]), viewportHeight, m_lodPixelError);
+}
+
+f32 VulkanStaticModelTextured::_getScreenSize(Graphics::Camera const &camera, glm::mat4x4 const &modelMatrix, f32 viewportHeight) const {
+    f32 scale = std::max(glm::length(glm::vec3(modelMatrix[0])), std::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+    glm::vec3 center = glm::vec3(modelMatrix * glm::vec4((m_mesh->BoundsMin + m_mesh->BoundsMax) * 0.5f, 1.0f));
+    f32 radius = glm::length(m_mesh->BoundsMax - m_mesh->BoundsMin) * 0.5f * scale;
+    f32 distance = glm::length(camera.GetPosition() - center);
+
+    // Models around the camera cover the whole screen
+    if (distance <= radius) {
+        return std::numeric_limits<f32>::max();
+    }
+    return radius / distance * fabsf(camera.ProjectionMatrix()[1][1]) * viewportHeight;
+}
+
+uint32_t VulkanStaticModelTextured::_updateTextureBinding(uint32_t textureIndex) {
+    Vulkan2DTextureBuffer const &texture = *m_materialData[textureIndex];
+    uint32_t binding = m_textureBindings[textureIndex];
+    if (!texture.IsStreaming()) {
+        return binding;
+    }
+    binding += static_cast<uint32_t>(m_owner->GetCurrentFrameIndex());
+
+    // The device is done with the frame that last used this binding, so it can take the texture's current image
+    if (m_bindingVersions[binding] != texture.GetResidencyVersion()) {
+        VulkanBindlessTextureSet *bindlessTextures = m_owner->GetBindlessTextureSet();
+        if (bindlessTextures) {
+            bindlessTextures->WriteSlot(m_bindlessSlots[binding], texture.GetDeviceImageView(), m_sampler->GetVkSampler());
+        }
+        else {
+            VulkanDescriptorSetInstance *descriptorSet = m_descriptorSets[binding];
+            VkDescriptorImageInfo imageInfo{};
+            imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            imageInfo.imageView = texture.GetDeviceImageView();
+            imageInfo.sampler = m_sampler->GetVkSampler();
+            descriptorSet->UpdateDescriptorWrite(0, &imageInfo);
+            descriptorSet->SetInternalDescriptorSet(descriptorSet->GetVkDescriptorSet());
+        }
+        m_bindingVersions[binding] = texture.GetResidencyVersion();
+    }
+
+    return binding;
+}
+
+void VulkanStaticModelTextured::_assignDrawRangeMeshlets() {
+    std::vector<Graphics::Meshlet> const &meshlets = m_mesh->Meshlets;
+    for (auto &drawRange : m_drawRanges) {
+        // First meshlet ending after the range starts, up to the first one starting at or after its end
+        auto first = std::upper_bound(meshlets.begin(), meshlets.end(), drawRange.SourceFirstIndex, [](uint32_t index, Graphics::Meshlet const &meshlet) {
+            return index < meshlet.FirstIndex + meshlet.TriangleCount * 3;
+        });
+        auto last = std::lower_bound(first, meshlets.end(), drawRange.SourceFirstIndex + drawRange.IndexCount, [](Graphics::Meshlet const &meshlet, uint32_t index) {
+            return meshlet.FirstIndex < index;
+        });
+        drawRange.FirstMeshlet = static_cast<uint32_t>(first - meshlets.begin());
+        drawRange.MeshletCount = static_cast<uint32_t>(last - first);
+    }
+}
+
+void VulkanStaticModelTextured::_drawVisibleMeshlets(VkCommandBuffer commandBuffer, DrawRange const &drawRange, uint32_t firstInstance, Graphics::Frustum const &frustum, glm::vec3 const &cameraPosition) {
+    // Meshlets are clipped to the range since compacted ranges can be split in the middle of one
+    uint32_t rangeEnd = drawRange.SourceFirstIndex + drawRange.IndexCount;
+    uint32_t runStart = 0;
+    uint32_t runEnd = 0;
+    for (uint32_t i = drawRange.FirstMeshlet; i < drawRange.FirstMeshlet + drawRange.MeshletCount; ++i) {
+        Graphics::Meshlet const &meshlet = m_mesh->Meshlets[i];
+        if (!Graphics::IsMeshletVisible(meshlet, frustum, cameraPosition)) {
+            continue;
+        }
+
+        uint32_t meshletStart = std::max(meshlet.FirstIndex, drawRange.SourceFirstIndex);
+        uint32_t meshletEnd = std::min(meshlet.FirstIndex + meshlet.TriangleCount * 3, rangeEnd);
+        if (meshletStart != runEnd) {
+            if (runEnd > runStart) {
+                vkCmdDrawIndexed(commandBuffer, runEnd - runStart, 1, drawRange.FirstIndex + (runStart - drawRange.SourceFirstIndex), drawRange.BaseVertex, firstInstance);
+            }
+            runStart = meshletStart;
+        }
+        runEnd = meshletEnd;
+    }
+    if (runEnd > runStart) {
+        vkCmdDrawIndexed(commandBuffer, runEnd - runStart, 1, drawRange.FirstIndex + (runStart - drawRange.SourceFirstIndex), drawRange.BaseVertex, firstInstance);
+    }
+}
+
+RenderableObjectType VulkanStaticModelTextured::_getVertexLayoutObjectType(Graphics::ModelImporter::VertexLayout vertexLayout) {
+    switch (vertexLayout) {
+    case Graphics::ModelImporter::VERTEX_LAYOUT_COMPACT:
+        return RENDERABLE_OBJECT_TYPE_STATIC_MODEL_TEXTURED_COMPACT;
+    case Graphics::ModelImporter::VERTEX_LAYOUT_COMPACT_COLOR:
+        return RENDERABLE_OBJECT_TYPE_STATIC_MODEL_TEXTURED_COMPACT_COLOR;
+    default:
+        return RENDERABLE_OBJECT_TYPE_STATIC_MODEL_TEXTURED;
+    }
+}
+
+Graphics::GraphicsError VulkanStaticModelTextured::_loadMaterials(std::string const &filePath, std::vector<std::string> const &materialTextures) {
+    const uint32_t NO_TEXTURE = std::numeric_limits<uint32_t>::max();
+
+    // Material textures are relative to the model file or embedded in it, each distinct texture is only loaded once
+    std::filesystem::path modelDirectory = std::filesystem::path(filePath).parent_path();
+    std::vector<std::string> texturePaths;
+    std::vector<uint32_t> materialTextureIndices(materialTextures.size(), NO_TEXTURE);
+    std::map<std::string, uint32_t> textureIndices;
+    for (size_t i = 0; i < materialTextures.size(); ++i) {
+        if (materialTextures[i].empty()) {
+            continue;
+        }
+        uint32_t imageIndex = 0;
+        std::string texturePath = Graphics::ModelGltfLoader::ParseEmbeddedImageName(materialTextures[i], &imageIndex) ?
+            materialTextures[i] : (modelDirectory / materialTextures[i]).u8string();
+        auto inserted = textureIndices.emplace(texturePath, static_cast<uint32_t>(texturePaths.size()));
+        if (inserted.second) {
+            texturePaths.push_back(texturePath);
+        }
+        materialTextureIndices[i] = inserted.first->second;
+    }
+
+    // Textures and the sampler are shared with every other model using them through the asset cache
+    VulkanAssetCache *assetCache = m_owner->GetRenderer()->GetAssetCache();
+    m_materialData.clear();
+    auto err = assetCache->AcquireDefaultSampler(&m_sampler);
+    if (err != Graphics::GraphicsError::OK) {
+        LOG_ERROR("Unable to create sampler for %s\n", filePath.c_str());
+        return err;
+    }
+
+    // Embedded images are decoded straight from the mapped glTF file
+    Graphics::ModelGltfLoader gltfLoader;
+    bool gltfLoaded = false;
+    std::vector<VulkanAssetCache::TextureSource> textureSources;
+    std::vector<uint32_t> sourceTextureIndices;
+    for (size_t i = 0; i < texturePaths.size(); ++i) {
+        VulkanAssetCache::TextureSource source{ texturePaths[i], nullptr, 0 };
+        uint32_t imageIndex = 0;
+        if (Graphics::ModelGltfLoader::ParseEmbeddedImageName(texturePaths[i], &imageIndex)) {
+            if (!gltfLoaded) {
+                gltfLoaded = gltfLoader.Load(filePath).empty();
+            }
+            if (!gltfLoaded || imageIndex >= gltfLoader.GetImageCount() || !gltfLoader.GetImage(imageIndex).Data) {
+                LOG_ERROR("Unable to load material texture %s\n", texturePaths[i].c_str());
+                continue;
+            }
+            source.Data = gltfLoader.GetImage(imageIndex).Data;
+            source.DataSize = gltfLoader.GetImage(imageIndex).DataSize;
+        }
+        textureSources.push_back(std::move(source));
+        sourceTextureIndices.push_back(static_cast<uint32_t>(i));
+    }
+
+    // Textures are decoded and staged in parallel, each lands in its own slot as soon as it is ready
+    std::vector<std::shared_ptr<Vulkan2DTextureBuffer>> loadedTextures(texturePaths.size());
+    auto onTextureLoaded = [&loadedTextures, &sourceTextureIndices, &texturePaths](uint32_t index, Graphics::GraphicsError err,
+                                                                                  std::shared_ptr<Vulkan2DTextureBuffer> const &texture) {
+        uint32_t textureIndex = sourceTextureIndices[index];
+        if (err != Graphics::GraphicsError::OK) {
+            LOG_ERROR("Unable to load material texture %s\n", texturePaths[textureIndex].c_str());
+            return;
+        }
+        loadedTextures[textureIndex] = texture;
+    };
+    assetCache->AcquireTextures(textureSources, m_textureCompression, m_streamTextures, onTextureLoaded);
+
+    std::vector<uint32_t> loadedTextureIndices(texturePaths.size(), NO_TEXTURE);
+    for (size_t i = 0; i < texturePaths.size(); ++i) {
+        if (loadedTextures[i]) {
+            loadedTextureIndices[i] = static_cast<uint32_t>(m_materialData.size());
+            m_materialData.push_back(std::move(loadedTextures[i]));
+        }
+    }
+
+    // Ranges without a usable texture fall back to the texture named after the model file, or to plain white without one
+    uint32_t fallbackTextureIndex = NO_TEXTURE;
+    for (auto &drawRange : m_drawRanges) {
+        uint32_t textureIndex = NO_TEXTURE;
+        if (drawRange.MaterialId >= 0 && static_cast<size_t>(drawRange.MaterialId) < materialTextureIndices.size() &&
+            materialTextureIndices[drawRange.MaterialId] != NO_TEXTURE) {
+            textureIndex = loadedTextureIndices[materialTextureIndices[drawRange.MaterialId]];
+        }
+
+        if (textureIndex == NO_TEXTURE) {
+            if (fallbackTextureIndex == NO_TEXTURE) {
+                std::filesystem::path fallbackTexturePath(filePath);
+                fallbackTexturePath.replace_extension(".png");
+
+                // Models built in memory have no file to name a texture after
+                std::shared_ptr<Vulkan2DTextureBuffer> texture;
+                err = Graphics::GraphicsError::FILE_LOAD_ERROR;
+                if (!filePath.empty()) {
+                    err = assetCache->AcquireTexture(fallbackTexturePath.u8string(), m_textureCompression, m_streamTextures, &texture);
+                }
+                if (err == Graphics::GraphicsError::FILE_LOAD_ERROR) {
+                    LOG_VERBOSE("No texture %s, drawing untextured\n", fallbackTexturePath.u8string().c_str());
+                    err = assetCache->AcquireTexture(WHITE_TEXTURE_PNG, sizeof(WHITE_TEXTURE_PNG), Graphics::TextureCompressor::BLOCK_FORMAT_NONE, false, &texture);
+                }
+                if (err != Graphics::GraphicsError::OK) {
+                    LOG_ERROR("Unable to load texture %s\n", fallbackTexturePath.u8string().c_str());
+                    return err;
+                }
+                fallbackTextureIndex = static_cast<uint32_t>(m_materialData.size());
+                m_materialData.push_back(std::move(texture));
+            }
+            textureIndex = fallbackTextureIndex;
+        }
+
+        drawRange.DescriptorSetIndex = textureIndex;
+    }
+
+    // Sort the draws of each level of detail so each descriptor set is only bound once, merging ranges that end up adjacent
+    std::stable_sort(m_drawRanges.begin(), m_drawRanges.end(), [](DrawRange const &lhs, DrawRange const &rhs) {
+        if (lhs.Lod != rhs.Lod) {
+            return lhs.Lod < rhs.Lod;
+        }
+        return lhs.DescriptorSetIndex < rhs.DescriptorSetIndex;
+    });
+    std::vector<DrawRange> mergedDrawRanges;
+    for (auto &drawRange : m_drawRanges) {
+        if (!mergedDrawRanges.empty()) {
+            auto &lastRange = mergedDrawRanges.back();
+            if (lastRange.Lod == drawRange.Lod && lastRange.DescriptorSetIndex == drawRange.DescriptorSetIndex && lastRange.IndexType == drawRange.IndexType &&
+                lastRange.BaseVertex == drawRange.BaseVertex && lastRange.FirstIndex + lastRange.IndexCount == drawRange.FirstIndex &&
+                lastRange.SourceFirstIndex + lastRange.IndexCount == drawRange.SourceFirstIndex) {
+                lastRange.IndexCount += drawRange.IndexCount;
+                continue;
+            }
+        }
+        mergedDrawRanges.push_back(drawRange);
+    }
+    m_drawRanges.swap(mergedDrawRanges);
+
+    for (auto &lod : m_lods) {
+        lod.FirstDrawRange = 0;
+        lod.DrawRangeCount = 0;
+    }
+    for (uint32_t i = static_cast<uint32_t>(m_drawRanges.size()); i > 0; --i) {
+        LodLevel &lod = m_lods[m_drawRanges[i - 1].Lod];
+        lod.FirstDrawRange = i - 1;
+        ++lod.DrawRangeCount;
+    }
+
+    LOG_VERBOSE("Loaded %s with %zu materials, %zu textures, %zu levels of detail and %zu draws\n",
+        filePath.c_str(), materialTextures.size(), m_materialData.size(), m_lods.size(), m_drawRanges.size());
 
     return Graphics::GraphicsError::OK;
 }
 
 Graphics::GraphicsError VulkanStaticModelTextured::Draw(f64 deltaTime) {
+    // Nothing is resident until the load has registered its uploads
+    if (m_loadState != LOAD_STATE_READY) {
+        return Graphics::GraphicsError::OK;
+    }
+
     // Update transform
     m_accumulatedTime += deltaTime;
     //m_transform.SetRotation(0.0f, m_accumulatedTime * glm::radians(90.0f), 0.0f);
@@ -184,26 +1027,96 @@ Graphics::GraphicsError VulkanStaticModelTextured::Draw(f64 deltaTime) {
     glm::mat4x4 modelMatrix = m_transform.GetTransformMatrix();
     glm::mat4x4 normalMatrix = glm::inverseTranspose(camera->ViewMatrix() * modelMatrix);
 
-    VulkanPipeline *pipeline = m_owner->GetPipeline(RENDERABLE_OBJECT_TYPE_STATIC_MODEL_TEXTURED);
+    // Meshlets are culled in the model's local space
+    bool cullMeshlets = m_cullMeshlets && !m_mesh->Meshlets.empty();
+    Graphics::Frustum frustum{};
+    glm::vec3 localCameraPosition(0.0f);
+    if (cullMeshlets) {
+        frustum = Graphics::ExtractFrustum(camera->ProjectionMatrix() * camera->ViewMatrix() * modelMatrix);
+        localCameraPosition = glm::vec3(glm::inverse(modelMatrix) * glm::vec4(camera->GetPosition(), 1.0f));
+    }
+
+    VulkanPipeline *pipeline = m_owner->GetPipeline(_getVertexLayoutObjectType(m_mesh->Layout));
     VulkanCommandBuffer *commandBuffer = m_owner->GetMainCommandBuffer();
 
+    // Sizes on screen are measured against the swap chain, the pipeline's viewport is dynamic state and left empty
+    f32 viewportHeight = m_owner->GetViewportHeight();
+
+    // Only the draws of the level of detail matching the model's size on screen are issued
+    uint32_t firstDrawRange = 0;
+    uint32_t drawRangeCount = static_cast<uint32_t>(m_drawRanges.size());
+    if (!m_lods.empty()) {
+        LodLevel const &lod = m_lods[_selectLod(*camera, modelMatrix, viewportHeight)];
+        firstDrawRange = lod.FirstDrawRange;
+        drawRangeCount = lod.DrawRangeCount;
+    }
+
+    // Streaming textures ask for the levels the model needs at its size on screen, the streamer uploads them before the next frame
+    if (m_streamTextures) {
+        f32 screenSize = _getScreenSize(*camera, modelMatrix, viewportHeight);
+        for (auto &texture : m_materialData) {
+            if (texture->IsStreaming()) {
+                m_owner->GetTextureStreamer()->RequestScreenSize(texture.get(), screenSize);
+            }
+        }
+    }
+
     // Bind the pipeline for this object type
     m_owner->CommandBindPipeline(commandBuffer, pipeline);
 
     // Bind vertex buffer data
     VkDeviceSize offsets = 0;
-    vkCmdBindVertexBuffers(commandBuffer->GetVkCommandBuffer(), 0, 1, &m_vertexData.GetVertexDeviceBuffer(), &offsets);
-    vkCmdBindIndexBuffer(commandBuffer->GetVkCommandBuffer(), m_vertexData.GetIndexDeviceBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    vkCmdBindVertexBuffers(commandBuffer->GetVkCommandBuffer(), 0, 1, &m_mesh->VertexData.GetVertexDeviceBuffer(), &offsets);
 
     // Bind model matrix as a push constant
-    vkCmdPushConstants(commandBuffer->GetVkCommandBuffer(), pipeline->GetVkPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4x4), &modelMatrix);
-    vkCmdPushConstants(commandBuffer->GetVkCommandBuffer(), pipeline->GetVkPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, sizeof(glm::mat4x4), sizeof(glm::mat4x4), &normalMatrix);
+    if (m_mesh->Layout == Graphics::ModelImporter::VERTEX_LAYOUT_FULL) {
+        vkCmdPushConstants(commandBuffer->GetVkCommandBuffer(), pipeline->GetVkPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4x4), &modelMatrix);
+        vkCmdPushConstants(commandBuffer->GetVkCommandBuffer(), pipeline->GetVkPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, sizeof(glm::mat4x4), sizeof(glm::mat4x4), &normalMatrix);
+    }
+    else {
+        // Normalized positions are mapped back to the mesh bounds by the model matrix
+        CompactPushConstants pushConstants;
+        pushConstants.modelMatrix = glm::scale(glm::translate(modelMatrix, m_mesh->BoundsMin), m_mesh->BoundsMax - m_mesh->BoundsMin);
+        for (int i = 0; i < 3; ++i) {
+            pushConstants.normalMatrix[i] = normalMatrix[i];
+        }
+        pushConstants.texCoordRange = m_mesh->TexCoordRange;
+        vkCmdPushConstants(commandBuffer->GetVkCommandBuffer(), pipeline->GetVkPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pushConstants), &pushConstants);
+    }
+
+    // Draw ranges are sorted by texture so each descriptor set is bound once
+    // With the bindless texture set nothing is bound between draws, the texture's slot is passed as the draw's first instance
+    // The index buffer is only rebound when the index type changes, ranges are addressed from offset 0 either way
+    VulkanBindlessTextureSet *bindlessTextures = m_owner->GetBindlessTextureSet();
+    uint32_t boundTexture = std::numeric_limits<uint32_t>::max();
+    uint32_t firstInstance = 0;
+    VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+    for (uint32_t i = firstDrawRange; i < firstDrawRange + drawRangeCount; ++i) {
+        DrawRange const &drawRange = m_drawRanges[i];
+        if (drawRange.IndexType != boundIndexType) {
+            vkCmdBindIndexBuffer(commandBuffer->GetVkCommandBuffer(), m_mesh->VertexData.GetIndexDeviceBuffer(), 0, drawRange.IndexType);
+            boundIndexType = drawRange.IndexType;
+        }
 
-    // Bind descriptor sets
-    VkDescriptorSet bindDescriptorSets[] = { m_descriptorSet.GetVkDescriptorSet() };
-    vkCmdBindDescriptorSets(commandBuffer->GetVkCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->GetVkPipelineLayout(), 1, countof(bindDescriptorSets), bindDescriptorSets, 0, nullptr);
+        if (drawRange.DescriptorSetIndex != boundTexture) {
+            uint32_t binding = _updateTextureBinding(drawRange.DescriptorSetIndex);
+            if (bindlessTextures) {
+                firstInstance = m_bindlessSlots[binding];
+            }
+            else {
+                VkDescriptorSet bindDescriptorSets[] = { m_descriptorSets[binding]->GetVkDescriptorSet() };
+                vkCmdBindDescriptorSets(commandBuffer->GetVkCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->GetVkPipelineLayout(), 1, countof(bindDescriptorSets), bindDescriptorSets, 0, nullptr);
+            }
+            boundTexture = drawRange.DescriptorSetIndex;
+        }
 
-    vkCmdDrawIndexed(commandBuffer->GetVkCommandBuffer(), static_cast<uint32_t>(m_vertexData.GetIndexCount()), 1, 0, 0, 0);
+        if (cullMeshlets && drawRange.MeshletCount > 0) {
+            _drawVisibleMeshlets(commandBuffer->GetVkCommandBuffer(), drawRange, firstInstance, frustum, localCameraPosition);
+        }
+        else {
+            vkCmdDrawIndexed(commandBuffer->GetVkCommandBuffer(), drawRange.IndexCount, 1, drawRange.FirstIndex, drawRange.BaseVertex, firstInstance);
+        }
+    }
 
     return Graphics::GraphicsError::OK;
 }
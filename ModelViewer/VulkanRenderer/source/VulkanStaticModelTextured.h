@@ -1,48 +1,229 @@
 #pragma once
 
 #include "Transform.h"
+#include "Camera.h"
 #include "VulkanVertexBuffer.h"
 #include "Vulkan2DTextureBuffer.h"
 #include "VulkanSampler.h"
 #include "VulkanDescriptorSetLayout.h"
 #include "VulkanDescriptorSetInstance.h"
+#include "VulkanObjectTypes.h"
+#include "ModelObjLoader.h"
+#include "ModelGltfLoader.h"
+#include "MeshletBuilder.h"
+#include "ModelImporter.h"
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 namespace Vulkan {
 
 class RendererSceneImpl_Basic; // TODO: This should be a generic scene class
+class VulkanPipeline;
+class VulkanCommandBuffer;
 
 // A static model that is textured
 // Each vertex contains a 3D position, normal, RGB color, and UV texture coordinates
-struct VulkanTexturedVertex {
-    glm::vec3 position;
-    glm::vec3 normal;
-    glm::vec3 color;
-    glm::vec2 texCoord;
+// Imported meshes are built from Graphics::TexturedVertex, this only adds the vertex input of the full layout
+struct VulkanTexturedVertex : Graphics::TexturedVertex {
+    static VkVertexInputBindingDescription getBindingDescription();
+    static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions();
+};
+
+// Vertex inputs of the compact layouts ModelImporter encodes
+struct VulkanTexturedVertexCompact : Graphics::TexturedVertexCompact {
+    static VkVertexInputBindingDescription getBindingDescription();
+    static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions();
+};
 
+struct VulkanTexturedVertexCompactColor : Graphics::TexturedVertexCompactColor {
     static VkVertexInputBindingDescription getBindingDescription();
     static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions();
 };
 
 class VulkanStaticModelTextured {
+public:
+    // Progress of a load, the model only draws once it is ready
+    enum LoadState : uint32_t {
+        LOAD_STATE_EMPTY = 0,
+        LOAD_STATE_IMPORTING, // Parsing, decoding and filling staging buffers on a worker thread
+        LOAD_STATE_IMPORTED,  // Waiting for UpdateLoading to register the uploads
+        LOAD_STATE_READY,
+        LOAD_STATE_FAILED
+    };
+
 public:
     VulkanStaticModelTextured(RendererSceneImpl_Basic *owner);
     VulkanStaticModelTextured(VulkanStaticModelTextured const &) = delete;
     VulkanStaticModelTextured &operator=(VulkanStaticModelTextured const &) = delete;
     ~VulkanStaticModelTextured();
 
-    Graphics::GraphicsError LoadFromObjFile(std::string const &objFilePath);
+    // Reorders imported meshes for the vertex cache, overdraw and vertex fetch, on by default
+    // Takes effect on the next load
+    void SetMeshOptimization(bool enable);
+
+    // Skips meshlets outside the view frustum or facing away from the camera when drawing, on by default
+    void SetMeshletCulling(bool enable);
+
+    // Block format imported textures are compressed to where the device supports it, BC7 by default
+    // Compressed textures are cached as DDS files next to their source, .dds and .ktx2 textures are always loaded as stored
+    // Takes effect on the next load
+    void SetTextureCompression(Graphics::TextureCompressor::BlockFormat format);
+
+    // Uploads only the mip tail of material textures at first and streams finer levels in as the model grows on screen, off by default
+    // Textures with a .dds, .ktx2 or DDS cache file re-read finer levels from it, others keep every level in host memory
+    // The scene's texture streamer decides which levels are resident, within its VRAM and host memory budgets
+    // Takes effect on the next load
+    void SetTextureStreaming(bool enable);
+
+    // Packs material textures of up to 256 pixels into atlas pages saved next to the model, off by default
+    // Texture coordinates are rewritten to the pages and submeshes sharing a page are merged, so the model binds and draws less
+    // Textures whose coordinates leave [0, 1] repeat and are left as they are
+    // Takes effect on the next load
+    void SetTextureAtlas(bool enable);
+
+    // Largest error in pixels a coarser level of detail may show on screen, 0 always draws full detail
+    // Defaults to 1
+    void SetLodPixelError(f32 pixelError);
+
+    // .gltf and .glb files are loaded as glTF, .ply and .stl as scans, anything else as obj
+    // Blocks until the model is loaded and its uploads are registered
+    Graphics::GraphicsError LoadFromFile(std::string const &filePath);
+
+    // Starts loading on the renderer's worker threads and returns immediately, only valid on a model never loaded before
+    // Parsing, decoding and filling the staging buffers run on a worker, UpdateLoading registers the uploads afterwards
+    Graphics::GraphicsError LoadFromFileAsync(std::string const &filePath);
+
+    // Registers the uploads of a finished asynchronous load, call every frame from the scene's early update
+    // Uploads registered in the early update run before the frame is drawn, so the model draws from that frame on
+    Graphics::GraphicsError UpdateLoading();
+
+    LoadState GetLoadState() const;
+
+    // Loads a grey unit cube, drawn by the scene in place of models that are still loading
+    Graphics::GraphicsError LoadPlaceholder();
 
     Graphics::GraphicsError Draw(f64 deltaTime);
 
+private:
+    // Range of the index buffer drawn with one descriptor set
+    // Ranges pick the narrowest index type for their vertices, so the index buffer can mix 16 and 32-bit ranges
+    struct DrawRange {
+        uint32_t FirstIndex; // In units of IndexType from the start of the index buffer
+        uint32_t IndexCount;
+        int32_t MaterialId;
+        uint32_t DescriptorSetIndex;
+        VkIndexType IndexType;
+        int32_t BaseVertex;
+        uint32_t SourceFirstIndex; // Position of FirstIndex in the uncompacted 32-bit indices, which meshlets refer to
+        uint32_t FirstMeshlet;     // Meshlets overlapping the range
+        uint32_t MeshletCount;
+        uint32_t Lod;              // Index into m_lods
+    };
+
+    // Draw ranges of one level of detail
+    struct LodLevel {
+        uint32_t FirstDrawRange;
+        uint32_t DrawRangeCount;
+        f32 Error; // In model units
+    };
+
+    // Imported mesh, shared through the asset cache by every model loaded from the same file with the same import settings
+    struct MeshData {
+        MeshData(RendererImpl *renderer);
+
+        VulkanVertexBuffer<VulkanTexturedVertex> VertexData; // Stride depends on Layout
+        Graphics::ModelImporter::VertexLayout Layout;
+        std::vector<DrawRange> DrawRanges; // Without descriptor sets, each model assigns its own
+        std::vector<Graphics::Meshlet> Meshlets; // Sorted by FirstIndex
+        std::vector<LodLevel> Lods;
+        std::vector<std::string> MaterialTextures;
+
+        // Local space bounds of the mesh, compact layouts store positions relative to them
+        glm::vec3 BoundsMin;
+        glm::vec3 BoundsMax;
+
+        // Min (xy) and extent (zw) of the texture coordinates in compact layouts
+        glm::vec4 TexCoordRange;
+    };
+
+private:
+    // Loads the mesh and materials into staging buffers, safe to run on a worker thread
+    Graphics::GraphicsError _importFile(std::string const &filePath);
+
+    // Registers the staged transfers and creates the descriptor sets, on the main thread
+    Graphics::GraphicsError _registerUploads();
+
+    // Finds the mesh in the asset cache or loads it
+    Graphics::GraphicsError _acquireMesh(std::string const &filePath);
+
+    // Stages the mesh and fills the draw ranges with their material ids
+    Graphics::GraphicsError _loadMesh(std::string const &filePath, MeshData *mesh);
+
+    // Imports and stages a parsed mesh, saving it to the mesh cache unless cachePath is empty
+    Graphics::GraphicsError _importMesh(MeshData *mesh, std::string const &cachePath, uint64_t cacheFormatKey, const Graphics::TexturedVertex *vertices, size_t vertexCount,
+                                        const uint32_t *indices, uint32_t indexCount, const Graphics::ModelObjLoader::SubMesh *subMeshes, uint32_t subMeshCount,
+                                        std::vector<std::string> const &materialTextures);
+
+    // Appends the draw ranges and levels of detail of imported or cached submeshes
+    void _addDrawRanges(MeshData *mesh, const Graphics::ModelMeshCache::SubMesh *subMeshes, const Graphics::ModelMeshCache::Lod *lods, uint32_t lodCount);
+
+    // Copies every triangle primitive instance of the glTF scene into one mesh with a submesh per material
+    // Returns false if a primitive's indices are out of range
+    bool _gatherGltfMesh(Graphics::ModelGltfLoader const &loader, std::vector<Graphics::TexturedVertex> *outVertices, std::vector<uint32_t> *outIndices,
+                         std::vector<Graphics::ModelObjLoader::SubMesh> *outSubMeshes);
+
+    // Identifies the import settings in mesh and asset cache keys
+    uint64_t _getImportSettingsKey() const;
+
+    // Coarsest level of detail whose error stays within m_lodPixelError on screen
+    uint32_t _selectLod(Graphics::Camera const &camera, glm::mat4x4 const &modelMatrix, f32 viewportHeight) const;
+
+    // Height in pixels of the model's bounding sphere on screen
+    f32 _getScreenSize(Graphics::Camera const &camera, glm::mat4x4 const &modelMatrix, f32 viewportHeight) const;
+
+    // Index of a texture's binding for the current frame, into m_descriptorSets or m_bindlessSlots
+    // Rewrites the current frame's binding of a streaming texture whose image was replaced
+    uint32_t _updateTextureBinding(uint32_t textureIndex);
+
+    // Finds the meshlets each draw range covers
+    void _assignDrawRangeMeshlets();
+
+    // Draws the visible meshlets of a draw range, merging neighbours into one draw
+    void _drawVisibleMeshlets(VkCommandBuffer commandBuffer, DrawRange const &drawRange, uint32_t firstInstance, Graphics::Frustum const &frustum, glm::vec3 const &cameraPosition);
+
+    static RenderableObjectType _getVertexLayoutObjectType(Graphics::ModelImporter::VertexLayout vertexLayout);
+
+    // Acquires every material's texture and assigns each draw range its descriptor set index
+    Graphics::GraphicsError _loadMaterials(std::string const &filePath, std::vector<std::string> const &materialTextures);
+
 private:
     RendererSceneImpl_Basic *m_owner;
 
-    VulkanVertexBuffer<VulkanTexturedVertex> m_vertexData;
-    std::vector<Vulkan2DTextureBuffer> m_materialData;
-    std::vector<VulkanSampler> m_samplers;
-    VulkanDescriptorSetInstance m_descriptorSet;
+    std::shared_ptr<MeshData> m_mesh;
+    std::vector<std::shared_ptr<Vulkan2DTextureBuffer>> m_materialData;
+    std::shared_ptr<VulkanSampler> m_sampler;
+    std::vector<VulkanDescriptorSetInstance*> m_descriptorSets; // One per texture in m_materialData, one per frame in flight for streaming textures
+    std::vector<uint32_t> m_bindlessSlots;                      // Replace m_descriptorSets when the scene has a bindless texture set
+    std::vector<uint32_t> m_textureBindings;                    // First binding of each texture in m_descriptorSets or m_bindlessSlots
+    std::vector<uint32_t> m_bindingVersions;                    // Residency version of the texture each binding was written with
+    std::vector<DrawRange> m_drawRanges;                        // Sorted by level of detail, then descriptor set
+    std::vector<LodLevel> m_lods;                               // From full detail to coarsest
     Graphics::Transform m_transform;
 
+    bool m_optimizeMesh;
+    bool m_cullMeshlets;
+    f32 m_lodPixelError;
+    Graphics::TextureCompressor::BlockFormat m_textureCompression;
+    bool m_streamTextures;
+    bool m_atlasTextures;
+
+    // Set by the worker once an asynchronous import is done, the destructor waits on it
+    std::atomic<LoadState> m_loadState;
+    std::mutex m_loadMutex;
+    std::condition_variable m_loadFinished;
+
     f64 m_accumulatedTime;
 };
 
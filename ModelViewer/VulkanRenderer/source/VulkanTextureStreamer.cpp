@@ -0,0 +1,229 @@
+#include "pch.h"
+#include "VulkanTextureStreamer.h"
+#include "VulkanRendererImpl.h"
+#include "Vulkan2DTextureBuffer.h"
+
+namespace Vulkan {
+
+namespace {
+
+const VkDeviceSize DEFAULT_UPLOAD_BUDGET = 8 * 1024 * 1024;
+const VkDeviceSize DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024;
+const VkDeviceSize DEFAULT_HOST_MEMORY_BUDGET = 512 * 1024 * 1024;
+
+// Levels finer than a texture's size on screen that are requested, since few textures are spread evenly over their object
+const f32 SCREEN_SIZE_LEVEL_BIAS = 1.0f;
+
+} // namespace
+
+VulkanTextureStreamer::VulkanTextureStreamer(RendererImpl *renderer, uint32_t framesInFlight)
+  : m_renderer(renderer),
+    m_framesInFlight(framesInFlight),
+    m_uploadBudget(DEFAULT_UPLOAD_BUDGET),
+    m_memoryBudget(DEFAULT_MEMORY_BUDGET),
+    m_hostMemoryBudget(DEFAULT_HOST_MEMORY_BUDGET),
+    m_frame(0),
+    m_stats{} {
+    ASSERT(renderer);
+}
+
+VulkanTextureStreamer::~VulkanTextureStreamer() {
+}
+
+void VulkanTextureStreamer::SetUploadBudget(VkDeviceSize uploadBudget) {
+    m_uploadBudget = uploadBudget;
+}
+
+void VulkanTextureStreamer::SetMemoryBudget(VkDeviceSize memoryBudget) {
+    m_memoryBudget = memoryBudget;
+}
+
+void VulkanTextureStreamer::SetHostMemoryBudget(VkDeviceSize hostMemoryBudget) {
+    m_hostMemoryBudget = hostMemoryBudget;
+}
+
+void VulkanTextureStreamer::AddTexture(std::shared_ptr<Vulkan2DTextureBuffer> const &texture) {
+    ASSERT(texture && texture->IsStreaming());
+
+    // A released texture's address may be reused before the next update drops it
+    auto it = m_textureIndices.find(texture.get());
+    if (it != m_textureIndices.end()) {
+        m_textures[it->second].Texture = texture;
+        return;
+    }
+
+    m_textureIndices.emplace(texture.get(), m_textures.size());
+    m_textures.push_back({ texture, texture.get(), 0.0f, texture->GetResidentLevel() });
+}
+
+void VulkanTextureStreamer::RequestScreenSize(Vulkan2DTextureBuffer *texture, f32 screenSize) {
+    auto it = m_textureIndices.find(texture);
+    if (it == m_textureIndices.end()) {
+        return;
+    }
+    StreamedTexture &streamedTexture = m_textures[it->second];
+    streamedTexture.ScreenSize = std::max(streamedTexture.ScreenSize, screenSize);
+}
+
+Graphics::GraphicsError VulkanTextureStreamer::Update() {
+    ++m_frame;
+    m_stats = Stats{};
+
+    // Images replaced before the oldest frame in flight are no longer read
+    uint64_t lastCompletedFrame = m_frame > m_framesInFlight ? m_frame - m_framesInFlight : 0;
+
+    // Drop released textures
+    std::vector<std::shared_ptr<Vulkan2DTextureBuffer>> textures;
+    textures.reserve(m_textures.size());
+    for (size_t i = 0; i < m_textures.size();) {
+        auto texture = m_textures[i].Texture.lock();
+        if (!texture) {
+            m_textureIndices.erase(m_textures[i].TexturePtr);
+            m_textures[i] = m_textures.back();
+            m_textures.pop_back();
+            if (i < m_textures.size()) {
+                m_textureIndices[m_textures[i].TexturePtr] = i;
+            }
+            continue;
+        }
+        texture->ReleaseRetiredImages(lastCompletedFrame);
+        textures.push_back(std::move(texture));
+        ++i;
+    }
+    m_stats.TextureCount = static_cast<uint32_t>(m_textures.size());
+
+    // Textures drawn largest are served first, textures not drawn since the last update come last
+    std::vector<size_t> order(m_textures.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [this](size_t lhs, size_t rhs) {
+        return m_textures[lhs].ScreenSize > m_textures[rhs].ScreenSize;
+    });
+
+    // Fit the wanted levels into the memory budget, textures past it get the finest level that still fits
+    VkDeviceSize memoryLeft = m_memoryBudget;
+    for (size_t index : order) {
+        StreamedTexture &streamedTexture = m_textures[index];
+        Vulkan2DTextureBuffer &texture = *textures[index];
+        uint32_t tailLevel = texture.GetTailLevel();
+        VkDeviceSize tailSize = texture.GetLevelsSize(tailLevel);
+
+        uint32_t level = streamedTexture.ScreenSize > 0.0f ? _getLevelForScreenSize(texture, streamedTexture.ScreenSize) : tailLevel;
+        level = std::min(std::max(level, texture.GetFinestLevel()), tailLevel);
+        while (level < tailLevel && texture.GetLevelsSize(level) - tailSize > memoryLeft) {
+            ++level;
+        }
+        memoryLeft -= texture.GetLevelsSize(level) - tailSize;
+        streamedTexture.TargetLevel = level;
+        streamedTexture.ScreenSize = 0.0f;
+    }
+
+    // Finer levels already resident stay while the budget allows, so objects moving back and forth do not upload them again
+    for (size_t index : order) {
+        StreamedTexture &streamedTexture = m_textures[index];
+        Vulkan2DTextureBuffer &texture = *textures[index];
+        uint32_t residentLevel = texture.GetResidentLevel();
+        if (residentLevel >= streamedTexture.TargetLevel) {
+            continue;
+        }
+        VkDeviceSize keptSize = texture.GetLevelsSize(residentLevel) - texture.GetLevelsSize(streamedTexture.TargetLevel);
+        if (keptSize <= memoryLeft) {
+            memoryLeft -= keptSize;
+            streamedTexture.TargetLevel = residentLevel;
+        }
+    }
+
+    Graphics::GraphicsError err = Graphics::GraphicsError::OK;
+    VkDeviceSize uploadLeft = m_uploadBudget;
+
+    // Evictions keep the memory budget and are never deferred, they only upload the levels that stay
+    for (size_t index : order) {
+        Vulkan2DTextureBuffer &texture = *textures[index];
+        uint32_t targetLevel = m_textures[index].TargetLevel;
+        if (targetLevel <= texture.GetResidentLevel() || texture.IsStreamingPending()) {
+            continue;
+        }
+
+        auto streamErr = texture.StreamLevels(targetLevel, m_frame);
+        if (streamErr != Graphics::GraphicsError::OK) {
+            err = streamErr;
+            continue;
+        }
+        VkDeviceSize size = texture.GetLevelsSize(targetLevel);
+        uploadLeft -= std::min(size, uploadLeft);
+        m_stats.UploadedSize += size;
+        ++m_stats.UploadCount;
+        ++m_stats.EvictionCount;
+    }
+
+    // Finer levels are uploaded in priority order, as close to the target as the upload budget allows
+    bool raisedLevels = false;
+    for (size_t index : order) {
+        Vulkan2DTextureBuffer &texture = *textures[index];
+        uint32_t targetLevel = m_textures[index].TargetLevel;
+        uint32_t residentLevel = texture.GetResidentLevel();
+        if (targetLevel >= residentLevel || texture.IsStreamingPending()) {
+            continue;
+        }
+
+        // The whole chain is uploaded again since the new image replaces the resident one
+        uint32_t level = targetLevel;
+        while (level + 1 < residentLevel && texture.GetLevelsSize(level) > uploadLeft) {
+            ++level;
+        }
+        VkDeviceSize size = texture.GetLevelsSize(level);
+        if (size > uploadLeft && raisedLevels) {
+            break;
+        }
+
+        auto streamErr = texture.StreamLevels(level, m_frame);
+        if (streamErr != Graphics::GraphicsError::OK) {
+            err = streamErr;
+            continue;
+        }
+        uploadLeft -= std::min(size, uploadLeft);
+        m_stats.UploadedSize += size;
+        ++m_stats.UploadCount;
+        raisedLevels = true;
+    }
+
+    for (size_t index : order) {
+        Vulkan2DTextureBuffer &texture = *textures[index];
+        m_stats.ResidentSize += texture.GetLevelsSize(texture.GetResidentLevel()) - texture.GetLevelsSize(texture.GetTailLevel());
+        m_stats.HostSize += texture.GetHostSize();
+    }
+
+    // Host memory past its budget is taken from the least needed textures first, down to the levels they are drawn with
+    // Uploads copy their levels into staging memory right away, so pending ones do not need them either
+    for (auto it = order.rbegin(); it != order.rend() && m_stats.HostSize > m_hostMemoryBudget; ++it) {
+        Vulkan2DTextureBuffer &texture = *textures[*it];
+        VkDeviceSize hostSize = texture.GetHostSize();
+        texture.ReleaseHostLevels(std::min(m_textures[*it].TargetLevel, texture.GetResidentLevel()));
+        m_stats.HostSize -= hostSize - texture.GetHostSize();
+    }
+
+    if (m_stats.EvictionCount > 0) {
+        LOG_VERBOSE("Texture streaming over its %.2f MB budget, dropped fine levels of %u textures\n",
+            m_memoryBudget / (1024.0 * 1024.0), m_stats.EvictionCount);
+    }
+
+    return err;
+}
+
+VulkanTextureStreamer::Stats VulkanTextureStreamer::GetStats() const {
+    return m_stats;
+}
+
+uint32_t VulkanTextureStreamer::_getLevelForScreenSize(Vulkan2DTextureBuffer const &texture, f32 screenSize) {
+    VkExtent2D extent = texture.GetBaseExtent();
+    f32 texelSize = static_cast<f32>(std::max(extent.width, extent.height));
+    if (screenSize >= texelSize) {
+        return 0;
+    }
+
+    f32 level = floorf(log2f(texelSize / screenSize)) - SCREEN_SIZE_LEVEL_BIAS;
+    return level > 0.0f ? static_cast<uint32_t>(level) : 0;
+}
+
+} // namespace Vulkan
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <memory>
+
+namespace Vulkan {
+
+class RendererImpl;
+class Vulkan2DTextureBuffer;
+
+// Decides which mip levels of streaming textures are resident on the device
+// Objects request every frame the level their textures need from their size on screen, the streamer then uploads the finer
+//   levels of the largest objects first within a per-frame upload budget
+// When the resident levels would exceed the device memory budget, the least needed textures fall back to coarser levels
+// A texture's mip tail is always resident and does not count against the budget
+// Textures without a file to read their finer levels from keep them in host memory, past the host memory budget the least
+//   needed of them drop the levels finer than the ones they are drawn with and can no longer stream them
+class VulkanTextureStreamer {
+public:
+    struct Stats {
+        uint32_t TextureCount;
+        VkDeviceSize ResidentSize; // Levels above the mip tails
+        VkDeviceSize UploadedSize; // By the last update
+        uint32_t UploadCount;      // By the last update, including evictions
+        uint32_t EvictionCount;    // By the last update
+        VkDeviceSize HostSize;     // Levels kept in host memory to stream from, mip tails included
+    };
+
+public:
+    VulkanTextureStreamer(RendererImpl *renderer, uint32_t framesInFlight);
+    VulkanTextureStreamer(VulkanTextureStreamer const &) = delete;
+    VulkanTextureStreamer &operator=(VulkanTextureStreamer const &) = delete;
+    ~VulkanTextureStreamer();
+
+    // Bytes uploaded per update, 8MB by default
+    // An update always uploads at least one level so large levels are not starved
+    void SetUploadBudget(VkDeviceSize uploadBudget);
+
+    // Bytes the levels above the mip tails may take on the device, 256MB by default
+    void SetMemoryBudget(VkDeviceSize memoryBudget);
+
+    // Bytes streaming textures may keep in host memory, 512MB by default
+    void SetHostMemoryBudget(VkDeviceSize hostMemoryBudget);
+
+    // Starts streaming a flushed streaming texture, adding a texture twice is ignored
+    // Textures are held weakly and dropped once released
+    void AddTexture(std::shared_ptr<Vulkan2DTextureBuffer> const &texture);
+
+    // Requests the level needed to draw the texture across screenSize pixels, the largest request of a frame wins
+    // Assumes the texture is spread evenly over its object and asks for one level finer to make up for uneven mappings
+    void RequestScreenSize(Vulkan2DTextureBuffer *texture, f32 screenSize);
+
+    // Applies the requests made since the last update, call from the early update so the uploads run before drawing
+    // Levels finer than requested stay resident until the memory budget is needed for others
+    Graphics::GraphicsError Update();
+
+    Stats GetStats() const;
+
+private:
+    struct StreamedTexture {
+        std::weak_ptr<Vulkan2DTextureBuffer> Texture;
+        Vulkan2DTextureBuffer *TexturePtr;
+        f32 ScreenSize; // Largest request since the last update, 0 if none
+        uint32_t TargetLevel;
+    };
+
+    // Finest level worth drawing a texture with at screenSize pixels
+    static uint32_t _getLevelForScreenSize(Vulkan2DTextureBuffer const &texture, f32 screenSize);
+
+private:
+    RendererImpl *m_renderer;
+    uint32_t m_framesInFlight;
+    VkDeviceSize m_uploadBudget;
+    VkDeviceSize m_memoryBudget;
+    VkDeviceSize m_hostMemoryBudget;
+    uint64_t m_frame;
+
+    std::vector<StreamedTexture> m_textures;
+    std::map<Vulkan2DTextureBuffer*, size_t> m_textureIndices; // Into m_textures
+    Stats m_stats;
+};
+
+} // namespace Vulkan
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "VulkanBuffer.h"
+#include "VulkanStagingBuffer.h"
 
 namespace Vulkan {
 
@@ -15,17 +16,36 @@ public:
     VulkanVertexBuffer &operator=(VulkanVertexBuffer const &) = delete;
     ~VulkanVertexBuffer();
 
+    // Size of one vertex in the buffer, defaults to sizeof(VertexType)
+    // Set before any vertex data when the layout is only known at load time
+    void SetVertexStride(uint32_t stride);
+    uint32_t GetVertexStride() const;
+
     void SetVertexCount(size_t count);
     void *GetVertexData();
     size_t GetVertexCount() const;
 
-    void SetIndexCount(size_t count);
+    // Index data is stored as indexType, either VK_INDEX_TYPE_UINT16 or VK_INDEX_TYPE_UINT32
+    void SetIndexCount(size_t count, VkIndexType indexType = VK_INDEX_TYPE_UINT32);
     void *GetIndexData();
     size_t GetIndexCount() const;
+    VkIndexType GetIndexType() const;
+
+    static uint32_t GetIndexTypeSize(VkIndexType indexType);
 
     Graphics::GraphicsError FlushVertexToDevice();
     Graphics::GraphicsError FlushIndexToDevice();
 
+    // Uploads data straight from external memory (eg. a mapped file) into the staging buffers
+    // The host copy is skipped entirely; the source memory only needs to stay valid for the duration of the call
+    Graphics::GraphicsError FlushVertexToDevice(const void *vertexData, size_t vertexCount);
+    Graphics::GraphicsError FlushIndexToDevice(const void *indexData, size_t indexCount, VkIndexType indexType = VK_INDEX_TYPE_UINT32);
+
+    // While set, flushes only fill the staging buffers and the transfers are held back until RegisterDeferredTransfers
+    // Transfers can only be registered from the main thread, this lets the rest of a flush run on a worker thread
+    void SetDeferTransfers(bool deferTransfers);
+    void RegisterDeferredTransfers();
+
     VkVertexInputBindingDescription GetBindingDescription() const;
     const std::vector<VkVertexInputAttributeDescription> &GetAttributeDescription() const;
     VkBuffer &GetVertexDeviceBuffer();
@@ -35,23 +55,38 @@ public:
     void ClearHostResources();
 
 private:
-    Graphics::GraphicsError _beginTransferCommand(VkDeviceSize size, VulkanBuffer *srcBuffer, VulkanBuffer *dstBuffer, VulkanCommandBuffer *commandBuffer);
-    Graphics::GraphicsError _endTransferCommand(VulkanBuffer *stagingBuffer, VulkanCommandBuffer *commandBuffer);
-    void _errorTransferCommand(VulkanBuffer *stagingBuffer);
+    Graphics::GraphicsError _flushToDevice(const void *data, VkDeviceSize size, VulkanBuffer *deviceBuffer, VulkanStagingBuffer *stagingBuffer);
+    void _registerTransfer(VulkanBuffer *deviceBuffer, VulkanStagingBuffer *stagingBuffer);
+    Graphics::GraphicsError _beginTransferCommand(VulkanStagingBuffer *srcBuffer, VulkanBuffer *dstBuffer, VulkanCommandBuffer *commandBuffer);
+    // Registers the next round of the copy while chunks are still waiting for room in the staging ring
+    Graphics::GraphicsError _endTransferCommand(VulkanStagingBuffer *stagingBuffer, VulkanBuffer *deviceBuffer, VulkanCommandBuffer *commandBuffer);
+    void _errorTransferCommand(VulkanStagingBuffer *stagingBuffer);
 
 private:
-    typedef std::vector<VertexType> VertexData;
-    typedef std::vector<uint32_t> IndexData;
+    typedef std::vector<uint8_t> VertexData;
+    typedef std::vector<uint8_t> IndexData;
+
+    struct DeferredTransfer {
+        VulkanBuffer *DeviceBuffer;
+        VulkanStagingBuffer *StagingBuffer;
+    };
 
     RendererImpl *m_renderer;
 
     VertexData m_vertexData;
     IndexData m_indexData;
+    uint32_t m_vertexStride;
+    size_t m_vertexCount;
+    size_t m_indexCount;
+    VkIndexType m_indexType;
 
     VulkanBuffer m_vertexBuffer;
-    VulkanBuffer m_vertexStagingBuffer;
+    VulkanStagingBuffer m_vertexStagingBuffer;
     VulkanBuffer m_indexBuffer;
-    VulkanBuffer m_indexStagingBuffer;
+    VulkanStagingBuffer m_indexStagingBuffer;
+
+    bool m_deferTransfers;
+    std::vector<DeferredTransfer> m_deferredTransfers;
 };
 
 } // namespace Vulkan
@@ -9,7 +9,12 @@ VulkanVertexBuffer<VertexType>::VulkanVertexBuffer(RendererImpl *renderer)
     m_vertexBuffer(renderer),
     m_vertexStagingBuffer(renderer),
     m_indexBuffer(renderer),
-    m_indexStagingBuffer(renderer) {
+    m_indexStagingBuffer(renderer),
+    m_vertexStride(sizeof(VertexType)),
+    m_vertexCount(0),
+    m_indexCount(0),
+    m_indexType(VK_INDEX_TYPE_UINT32),
+    m_deferTransfers(false) {
     ASSERT(renderer);
 }
 
@@ -17,11 +22,23 @@ template<class VertexType>
 VulkanVertexBuffer<VertexType>::~VulkanVertexBuffer() {
 }
 
+template<class VertexType>
+void VulkanVertexBuffer<VertexType>::SetVertexStride(uint32_t stride) {
+    ASSERT(stride != 0);
+    m_vertexStride = stride;
+}
+
+template<class VertexType>
+uint32_t VulkanVertexBuffer<VertexType>::GetVertexStride() const {
+    return m_vertexStride;
+}
+
 template<class VertexType>
 void VulkanVertexBuffer<VertexType>::SetVertexCount(size_t count) {
-    m_vertexData.resize(count);
+    VkDeviceSize bufferSize = static_cast<VkDeviceSize>(m_vertexStride) * count;
+    m_vertexData.resize(static_cast<size_t>(bufferSize));
+    m_vertexCount = count;
 
-    VkDeviceSize bufferSize = sizeof(VertexType) * count;
     m_vertexBuffer.Clear();
 
     m_vertexBuffer.Initialize(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, nullptr, 0);
@@ -34,14 +51,16 @@ void *VulkanVertexBuffer<VertexType>::GetVertexData() {
 
 template<class VertexType>
 size_t VulkanVertexBuffer<VertexType>::GetVertexCount() const {
-    return m_vertexData.size();
+    return m_vertexCount;
 }
 
 template<class VertexType>
-void VulkanVertexBuffer<VertexType>::SetIndexCount(size_t count) {
-    m_indexData.resize(count);
+void VulkanVertexBuffer<VertexType>::SetIndexCount(size_t count, VkIndexType indexType) {
+    VkDeviceSize bufferSize = static_cast<VkDeviceSize>(GetIndexTypeSize(indexType)) * count;
+    m_indexData.resize(static_cast<size_t>(bufferSize));
+    m_indexCount = count;
+    m_indexType = indexType;
 
-    VkDeviceSize bufferSize = sizeof(IndexData::value_type) * count;
     m_indexBuffer.Clear();
 
     m_indexBuffer.Initialize(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, nullptr, 0);
@@ -54,83 +73,124 @@ void *VulkanVertexBuffer<VertexType>::GetIndexData() {
 
 template<class VertexType>
 size_t VulkanVertexBuffer<VertexType>::GetIndexCount() const {
-    return m_indexData.size();
+    return m_indexCount;
+}
+
+template<class VertexType>
+VkIndexType VulkanVertexBuffer<VertexType>::GetIndexType() const {
+    return m_indexType;
+}
+
+template<class VertexType>
+uint32_t VulkanVertexBuffer<VertexType>::GetIndexTypeSize(VkIndexType indexType) {
+    switch (indexType) {
+    case VK_INDEX_TYPE_UINT16:
+        return sizeof(uint16_t);
+    case VK_INDEX_TYPE_UINT32:
+        return sizeof(uint32_t);
+    default:
+        ASSERT(false);
+        return 0;
+    }
 }
 
 template<class VertexType>
 Graphics::GraphicsError VulkanVertexBuffer<VertexType>::FlushVertexToDevice() {
+    return _flushToDevice(m_vertexData.data(), m_vertexData.size(), &m_vertexBuffer, &m_vertexStagingBuffer);
+}
+
+template<class VertexType>
+Graphics::GraphicsError VulkanVertexBuffer<VertexType>::FlushIndexToDevice() {
+    return _flushToDevice(m_indexData.data(), m_indexData.size(), &m_indexBuffer, &m_indexStagingBuffer);
+}
+
+template<class VertexType>
+Graphics::GraphicsError VulkanVertexBuffer<VertexType>::FlushVertexToDevice(const void *vertexData, size_t vertexCount) {
+    // Host data is not used, so drop any previous copy
+    m_vertexData.clear();
+    m_vertexCount = vertexCount;
+
+    VkDeviceSize bufferSize = static_cast<VkDeviceSize>(m_vertexStride) * vertexCount;
+    m_vertexBuffer.Clear();
+    m_vertexBuffer.Initialize(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, nullptr, 0);
+
+    return _flushToDevice(vertexData, bufferSize, &m_vertexBuffer, &m_vertexStagingBuffer);
+}
+
+template<class VertexType>
+Graphics::GraphicsError VulkanVertexBuffer<VertexType>::FlushIndexToDevice(const void *indexData, size_t indexCount, VkIndexType indexType) {
+    // Host data is not used, so drop any previous copy
+    m_indexData.clear();
+    m_indexCount = indexCount;
+    m_indexType = indexType;
+
+    VkDeviceSize bufferSize = static_cast<VkDeviceSize>(GetIndexTypeSize(indexType)) * indexCount;
+    m_indexBuffer.Clear();
+    m_indexBuffer.Initialize(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, nullptr, 0);
+
+    return _flushToDevice(indexData, bufferSize, &m_indexBuffer, &m_indexStagingBuffer);
+}
+
+template<class VertexType>
+Graphics::GraphicsError VulkanVertexBuffer<VertexType>::_flushToDevice(const void *data, VkDeviceSize size, VulkanBuffer *deviceBuffer, VulkanStagingBuffer *stagingBuffer) {
     // Allocate memory for the buffer if necessary
-    auto err = m_vertexBuffer.Allocate(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    auto err = deviceBuffer->Allocate(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
     if (err != Graphics::GraphicsError::OK) {
         return err;
     }
 
-    // Allocate a staging buffer
-    VkDeviceSize bufferSize = sizeof(VertexType) * m_vertexData.size();
-    m_vertexStagingBuffer.Clear();
-    m_vertexStagingBuffer.Initialize(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, nullptr, 0);
-    m_vertexStagingBuffer.Allocate(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    // Copy the host data to staging buffer
-    void *mappedMemory = m_vertexStagingBuffer.GetMappedMemory();
-    if (!mappedMemory) {
-        m_vertexStagingBuffer.Clear();
-        return Graphics::GraphicsError::INITIALIZATION_FAILED;
+    // Copy the source data to the staging chunks
+    stagingBuffer->Clear();
+    err = stagingBuffer->Allocate(size);
+    if (err != Graphics::GraphicsError::OK) {
+        return err;
+    }
+    for (size_t i = 0; i < stagingBuffer->GetChunkCount(); ++i) {
+        auto const &chunk = stagingBuffer->GetChunk(i);
+        memcpy(chunk.MappedMemory, reinterpret_cast<const uint8_t*>(data) + chunk.SourceOffset, static_cast<size_t>(chunk.Size));
     }
-    memcpy(mappedMemory, m_vertexData.data(), bufferSize);
 
-    //TODO: If this needs to update frequently, don't unmap
-    m_vertexStagingBuffer.UnmapMemory();
+    if (m_deferTransfers) {
+        // A staging buffer that is flushed again replaces its earlier transfer
+        m_deferredTransfers.erase(std::remove_if(m_deferredTransfers.begin(), m_deferredTransfers.end(), [stagingBuffer](DeferredTransfer const &transfer) {
+            return transfer.StagingBuffer == stagingBuffer;
+        }), m_deferredTransfers.end());
+        m_deferredTransfers.push_back({ deviceBuffer, stagingBuffer });
+    }
+    else {
+        _registerTransfer(deviceBuffer, stagingBuffer);
+    }
 
-    // Register the transfer to run on the next frame update
-    m_renderer->RegisterTransfer(
-        RendererImpl::QUEUE_GRAPHICS,
-        1,
-        std::bind(&VulkanVertexBuffer<VertexType>::_beginTransferCommand, this, bufferSize, &m_vertexStagingBuffer, &m_vertexBuffer, std::placeholders::_1),
-        std::bind(&VulkanVertexBuffer<VertexType>::_endTransferCommand, this, &m_vertexStagingBuffer, std::placeholders::_1),
-        std::bind(&VulkanVertexBuffer<VertexType>::_errorTransferCommand, this, &m_vertexStagingBuffer)
-    );
-    
     return Graphics::GraphicsError::OK;
 }
 
 template<class VertexType>
-Graphics::GraphicsError VulkanVertexBuffer<VertexType>::FlushIndexToDevice() {
-    // Allocate memory for the buffer if necessary
-    auto err = m_indexBuffer.Allocate(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    if (err != Graphics::GraphicsError::OK) {
-        return err;
-    }
+void VulkanVertexBuffer<VertexType>::SetDeferTransfers(bool deferTransfers) {
+    m_deferTransfers = deferTransfers;
+}
 
-    // Allocate a staging buffer
-    VkDeviceSize bufferSize = sizeof(IndexData::value_type) * m_indexData.size();
-    m_indexStagingBuffer.Clear();
-    m_indexStagingBuffer.Initialize(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, nullptr, 0);
-    m_indexStagingBuffer.Allocate(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    // Copy the host data to staging buffer
-    void *mappedMemory = m_indexStagingBuffer.GetMappedMemory();
-    if (!mappedMemory) {
-        m_indexStagingBuffer.Clear();
-        return Graphics::GraphicsError::INITIALIZATION_FAILED;
+template<class VertexType>
+void VulkanVertexBuffer<VertexType>::RegisterDeferredTransfers() {
+    for (auto const &transfer : m_deferredTransfers) {
+        _registerTransfer(transfer.DeviceBuffer, transfer.StagingBuffer);
     }
-    memcpy(mappedMemory, m_indexData.data(), bufferSize);
-    m_indexStagingBuffer.UnmapMemory();
+    m_deferredTransfers.clear();
+}
 
+template<class VertexType>
+void VulkanVertexBuffer<VertexType>::_registerTransfer(VulkanBuffer *deviceBuffer, VulkanStagingBuffer *stagingBuffer) {
     // Register the transfer to run on the next frame update
     m_renderer->RegisterTransfer(
         RendererImpl::QUEUE_GRAPHICS,
         1,
-        std::bind(&VulkanVertexBuffer<VertexType>::_beginTransferCommand, this, bufferSize, &m_indexStagingBuffer, &m_indexBuffer, std::placeholders::_1),
-        std::bind(&VulkanVertexBuffer<VertexType>::_endTransferCommand, this, &m_indexStagingBuffer, std::placeholders::_1),
-        std::bind(&VulkanVertexBuffer<VertexType>::_errorTransferCommand, this, &m_indexStagingBuffer)
+        std::bind(&VulkanVertexBuffer<VertexType>::_beginTransferCommand, this, stagingBuffer, deviceBuffer, std::placeholders::_1),
+        std::bind(&VulkanVertexBuffer<VertexType>::_endTransferCommand, this, stagingBuffer, deviceBuffer, std::placeholders::_1),
+        std::bind(&VulkanVertexBuffer<VertexType>::_errorTransferCommand, this, stagingBuffer)
     );
-    
-    return Graphics::GraphicsError::OK;
 }
 
 template<class VertexType>
-Graphics::GraphicsError VulkanVertexBuffer<VertexType>::_beginTransferCommand(VkDeviceSize size, VulkanBuffer *srcBuffer, VulkanBuffer *dstBuffer, VulkanCommandBuffer *commandBuffer) {
+Graphics::GraphicsError VulkanVertexBuffer<VertexType>::_beginTransferCommand(VulkanStagingBuffer *srcBuffer, VulkanBuffer *dstBuffer, VulkanCommandBuffer *commandBuffer) {
     auto err = commandBuffer->BeginCommandBuffer();
     if (err != Graphics::GraphicsError::OK) {
         LOG_ERROR(L"Failed to copy vertex buffer to device\n");
@@ -138,11 +198,18 @@ Graphics::GraphicsError VulkanVertexBuffer<VertexType>::_beginTransferCommand(Vk
         return err;
     }
 
-    VkBufferCopy copyRegion{};
-    copyRegion.srcOffset = 0;
-    copyRegion.dstOffset = 0;
-    copyRegion.size = size;
-    vkCmdCopyBuffer(commandBuffer->GetVkCommandBuffer(), srcBuffer->GetVkBuffer(), dstBuffer->GetVkBuffer(), 1, &copyRegion);
+    // A round is empty while other uploads fill the staging ring, it is still submitted so the next round follows its fence
+    std::vector<VkBufferCopy> copyRegions(srcBuffer->GetRoundChunkCount());
+    for (size_t i = 0; i < copyRegions.size(); ++i) {
+        auto const &chunk = srcBuffer->GetRoundChunk(i);
+        copyRegions[i].srcOffset = chunk.BufferOffset;
+        copyRegions[i].dstOffset = chunk.SourceOffset;
+        copyRegions[i].size = chunk.Size;
+    }
+    if (!copyRegions.empty()) {
+        vkCmdCopyBuffer(commandBuffer->GetVkCommandBuffer(), srcBuffer->GetVkBuffer(), dstBuffer->GetVkBuffer(),
+            static_cast<uint32_t>(copyRegions.size()), copyRegions.data());
+    }
 
     err = commandBuffer->EndCommandBuffer();
     if (err != Graphics::GraphicsError::OK) {
@@ -162,15 +229,21 @@ Graphics::GraphicsError VulkanVertexBuffer<VertexType>::_beginTransferCommand(Vk
 }
 
 template<class VertexType>
-Graphics::GraphicsError VulkanVertexBuffer<VertexType>::_endTransferCommand(VulkanBuffer *stagingBuffer, VulkanCommandBuffer *commandBuffer) {
+Graphics::GraphicsError VulkanVertexBuffer<VertexType>::_endTransferCommand(VulkanStagingBuffer *stagingBuffer, VulkanBuffer *deviceBuffer, VulkanCommandBuffer *commandBuffer) {
     VkFence fence = commandBuffer->GetWaitFence();
     vkWaitForFences(m_renderer->GetDevice(), 1, &fence, true, std::numeric_limits<uint64_t>::max());
-    stagingBuffer->Clear();
+    if (stagingBuffer->IsLastRound()) {
+        stagingBuffer->Clear();
+    }
+    else {
+        stagingBuffer->NextRound();
+        _registerTransfer(deviceBuffer, stagingBuffer);
+    }
     return Graphics::GraphicsError::OK;
 }
 
 template<class VertexType>
-void VulkanVertexBuffer<VertexType>::_errorTransferCommand(VulkanBuffer *stagingBuffer) {
+void VulkanVertexBuffer<VertexType>::_errorTransferCommand(VulkanStagingBuffer *stagingBuffer) {
     LOG_ERROR(L"Failed to copy vertex buffer to device\n");
     stagingBuffer->Clear();
 }